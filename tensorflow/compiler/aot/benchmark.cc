@@ -133,6 +133,24 @@ void Benchmark(const Options& options, const BenchmarkFn& fn, Stats* stats) {
   }
 }
 
+void BenchmarkThroughput(const Options& options,
+                         const std::vector<int>& concurrencies,
+                         int64 batch_size, const ThroughputFn& fn) {
+  std::vector<std::pair<int, double>> requests_per_sec;
+  for (int concurrency : concurrencies) {
+    Stats stats;
+    Benchmark(options, fn(concurrency), &stats);
+    const double total_requests = batch_size * stats.per_iter_us.size();
+    requests_per_sec.emplace_back(concurrency,
+                                  total_requests * 1e6 / stats.total_us);
+  }
+  printf("Throughput of batches of %lld requests\n", batch_size);
+  for (const auto& r : requests_per_sec) {
+    printf("  concurrency %3d: %12.1f requests/s  (%.2fx)\n", r.first,
+           r.second, r.second / requests_per_sec.front().second);
+  }
+}
+
 }  // namespace benchmark
 }  // namespace tfcompile
 }  // namespace tensorflow
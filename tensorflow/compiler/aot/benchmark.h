@@ -63,6 +63,17 @@ typedef std::function<void()> BenchmarkFn;
 // Use `options` to configure benchmarking options.
 void Benchmark(const Options& options, const BenchmarkFn& fn, Stats* stats);
 
+// ThroughputFn returns a function that runs one batch of requests on
+// `concurrency` workers.
+typedef std::function<BenchmarkFn(int concurrency)> ThroughputFn;
+
+// BenchmarkThroughput runs a benchmark of the function returned by `fn` for
+// each of the `concurrencies`, where each call runs `batch_size` requests, and
+// printfs to stdout the throughput at each concurrency.
+void BenchmarkThroughput(const Options& options,
+                         const std::vector<int>& concurrencies,
+                         int64 batch_size, const ThroughputFn& fn);
+
 }  // namespace benchmark
 }  // namespace tfcompile
 }  // namespace tensorflow
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/compiler/aot/benchmark.h"
 
+#include <vector>
+
 #include "tensorflow/compiler/aot/test_graph_tfadd.h"
 #include "tensorflow/core/platform/test.h"
 
@@ -40,6 +42,24 @@ TEST(Benchmark, Benchmark) {
   EXPECT_EQ(stats5.per_iter_us.size(), 5);
 }
 
+TEST(Benchmark, BenchmarkThroughput) {
+  AddComp add;
+
+  Options options;
+  options.max_iters = 3;
+  std::vector<int> concurrencies;
+  int calls = 0;
+  BenchmarkThroughput(options, {1, 2}, /*batch_size=*/4, [&](int concurrency) {
+    concurrencies.push_back(concurrency);
+    return [&] {
+      ++calls;
+      add.Run();
+    };
+  });
+  EXPECT_EQ(concurrencies, std::vector<int>({1, 2}));
+  EXPECT_EQ(calls, 6);
+}
+
 }  // namespace
 }  // namespace benchmark
 }  // namespace tfcompile
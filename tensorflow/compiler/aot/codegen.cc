@@ -20,6 +20,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_replace.h"
@@ -386,6 +387,42 @@ Status GenerateHeader(const CodegenOpts& opts, const tf2xla::Config& config,
             "data->hlo_profile_printer_data()->profile_counters_size());"
           : "";
 
+  // When the function was also compiled for target variants, the generated
+  // class picks the entry point to run the first time StaticData is called,
+  // based on the features of the host CPU.
+  string variant_entry_decls;
+  string raw_function = compile_result.entry_point;
+  string select_raw_function;
+  if (!compile_result.variants.empty()) {
+    raw_function = "SelectRawFunction()";
+    select_raw_function =
+        "\n"
+        "  // Returns the entry point of the first specialization of the "
+        "function\n"
+        "  // whose target features the host CPU supports.\n"
+        "  static tensorflow::XlaCompiledCpuFunction::RawFunction "
+        "SelectRawFunction() {\n";
+    for (const TargetVariant& variant : compile_result.variants) {
+      absl::StrAppend(&variant_entry_decls, "\nextern \"C\" void ",
+                      variant.entry_point,
+                      "(\n"
+                      "    void* result, const xla::ExecutableRunOptions* "
+                      "run_options,\n"
+                      "    const void** args, void** temps, "
+                      "tensorflow::int64* profile_counters);\n");
+      absl::StrAppend(&select_raw_function,
+                      "    if (::tensorflow::cpu_function_runtime::"
+                      "HostSupportsTargetFeatures(\n"
+                      "            \"",
+                      absl::CEscape(variant.dispatch_features),
+                      "\")) {\n"
+                      "      return ",
+                      variant.entry_point, ";\n    }\n");
+    }
+    absl::StrAppend(&select_raw_function, "    return ",
+                    compile_result.entry_point, ";\n  }\n");
+  }
+
   // Use a poor-man's text templating mechanism; first populate the full header
   // with placeholder tokens, and then rewrite the tokens with real values.
   *header =
@@ -412,7 +449,7 @@ namespace xla { class ExecutableRunOptions; }
 extern "C" void {{ENTRY}}(
     void* result, const xla::ExecutableRunOptions* run_options,
     const void** args, void** temps, tensorflow::int64* profile_counters);
-
+{{VARIANT_ENTRY_DECLS}}
 {{DECLS_FROM_OBJ_FILE}}
 
 {{NS_START}}
@@ -462,7 +499,7 @@ class {{CLASS}} : public tensorflow::XlaCompiledCpuFunction {
     static XlaCompiledCpuFunction::StaticData* kStaticData = [](){
       XlaCompiledCpuFunction::StaticData* data =
         new XlaCompiledCpuFunction::StaticData;
-      data->set_raw_function({{ENTRY}});
+      data->set_raw_function({{RAW_FUNCTION}});
       data->set_buffer_infos(BufferInfos());
       data->set_num_buffers(kNumBuffers);
       data->set_arg_index_table(ArgIndexToBufferIndex());
@@ -559,6 +596,7 @@ class {{CLASS}} : public tensorflow::XlaCompiledCpuFunction {
       {{HLO_PROFILE_PRINTER_DATA_SHIM_EXPRESSION}};
     return kHloProfilePrinterData;
   }
+{{SELECT_RAW_FUNCTION}}
 };
 {{NS_END}}
 
@@ -588,12 +626,15 @@ class {{CLASS}} : public tensorflow::XlaCompiledCpuFunction {
       {"{{NS_END}}\n", ns_end},
       {"{{NS_START}}\n", ns_start},
       {"{{PROGRAM_SHAPE}}", xla::ShapeUtil::HumanString(ps)},
+      {"{{RAW_FUNCTION}}", raw_function},
+      {"{{SELECT_RAW_FUNCTION}}\n", select_raw_function},
       {"{{PROGRAM_SHAPE_SHIM_EXPRESSION}}",
        metadata_result.program_shape_access_shim},
       {"{{RESULT_INDEX}}", absl::StrCat(result_index)},
       {"{{RESULT_NAMES_CODE}}", result_names_code},
       {"{{TEMP_BYTES_ALIGNED}}", absl::StrCat(temp_bytes_aligned)},
       {"{{TEMP_BYTES_TOTAL}}", absl::StrCat(temp_bytes_total)},
+      {"{{VARIANT_ENTRY_DECLS}}\n", variant_entry_decls},
       {"{{NUM_BUFFERS}}", absl::StrCat(buffer_infos.size())},
       {"{{BUFFER_INFOS_AS_STRING}}",
        absl::StrJoin(buffer_infos_as_strings, ",\n")}};
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/compiler/aot/codegen.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/match.h"
@@ -205,6 +206,74 @@ TEST(CodegenTest, Golden) {
       GenerateHeader(opts, config, compile_result, metadata_result, &header));
 
   CompareWithGoldenFile("compiler/aot/codegen_test_h.golden", header);
+
+  // With target variants, the generated class dispatches between the entry
+  // points at runtime.
+  TargetVariant variant;
+  variant.target_cpu = "haswell";
+  variant.target_features = "+avx2,+fma";
+  variant.dispatch_features = "+avx,+avx2,+fma";
+  variant.entry_point = "entry_point_variant0";
+  compile_result.variants.push_back(std::move(variant));
+  TF_ASSERT_OK(
+      GenerateHeader(opts, config, compile_result, metadata_result, &header));
+  EXPECT_TRUE(absl::StrContains(header, "extern \"C\" void entry_point("));
+  EXPECT_TRUE(
+      absl::StrContains(header, "extern \"C\" void entry_point_variant0("));
+  EXPECT_TRUE(absl::StrContains(
+      header, "data->set_raw_function(SelectRawFunction());"));
+  EXPECT_TRUE(absl::StrContains(header, "HostSupportsTargetFeatures(\n"
+                                        "            \"+avx,+avx2,+fma\")) {\n"
+                                        "      return entry_point_variant0;"));
+  EXPECT_TRUE(absl::StrContains(header, "    return entry_point;\n  }\n};"));
+}
+
+TEST(ParseTargetVariantsTest, Simple) {
+  std::vector<TargetVariant> variants;
+  TF_EXPECT_OK(ParseTargetVariants("", &variants));
+  EXPECT_TRUE(variants.empty());
+  TF_EXPECT_OK(ParseTargetVariants(
+      "skylake-avx512:+avx512f,+avx512bw;haswell:+avx2,+fma", &variants));
+  ASSERT_EQ(2, variants.size());
+  EXPECT_EQ("skylake-avx512", variants[0].target_cpu);
+  EXPECT_EQ("+avx512f,+avx512bw", variants[0].target_features);
+  EXPECT_EQ("haswell", variants[1].target_cpu);
+  EXPECT_EQ("+avx2,+fma", variants[1].target_features);
+
+  ExpectErrorContains(ParseTargetVariants("haswell", &variants),
+                      "<target_cpu>:<target_features>");
+  ExpectErrorContains(ParseTargetVariants("haswell:", &variants),
+                      "<target_cpu>:<target_features>");
+}
+
+TEST(SetDispatchFeaturesTest, IncludesFeaturesOfTargetCpu) {
+  LLVMInitializeX86Target();
+  LLVMInitializeX86TargetInfo();
+  LLVMInitializeX86TargetMC();
+  const string triple = "x86_64-pc-linux";
+  TargetVariant variant;
+  variant.target_cpu = "skylake-avx512";
+  variant.target_features = "+avx2";
+  TF_ASSERT_OK(SetDispatchFeatures(triple, &variant));
+  for (const string& feature : {"+avx2", "+avx512f", "+avx512bw", "+sse2"}) {
+    EXPECT_TRUE(absl::StrContains(variant.dispatch_features, feature))
+        << variant.dispatch_features;
+  }
+
+  // Disabled features need not be supported.
+  variant.target_cpu = "haswell";
+  variant.target_features = "-avx2,-fma";
+  TF_ASSERT_OK(SetDispatchFeatures(triple, &variant));
+  EXPECT_TRUE(absl::StrContains(variant.dispatch_features, "+avx"));
+  EXPECT_FALSE(absl::StrContains(variant.dispatch_features, "+avx2"));
+  EXPECT_FALSE(absl::StrContains(variant.dispatch_features, "+fma"));
+
+  variant.target_features = "+avx512vnni";
+  ExpectErrorContains(SetDispatchFeatures(triple, &variant),
+                      "can't be checked on the host");
+  variant.target_features = "+neon";
+  ExpectErrorContains(SetDispatchFeatures("aarch64-none-linux-gnu", &variant),
+                      "only supported for x86-64");
 }
 }  // namespace
 }  // namespace tfcompile
@@ -16,11 +16,20 @@ limitations under the License.
 #include "tensorflow/compiler/aot/compile.h"
 
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Support/TargetRegistry.h"
 #include "tensorflow/compiler/aot/flags.h"
+#include "tensorflow/compiler/tf2xla/cpu_function_runtime.h"
 #include "tensorflow/compiler/tf2xla/tf2xla.h"
 #include "tensorflow/compiler/tf2xla/tf2xla_util.h"
 #include "tensorflow/compiler/xla/client/client_library.h"
@@ -82,8 +91,106 @@ Status CompileXla(xla::CompileOnlyClient* client,
   return Status::OK();
 }
 
+// Compiles the XLA computation once more for `variant`, which must use the
+// same buffers as the function compiled for the baseline target.
+Status CompileVariant(xla::CompileOnlyClient* client,
+                      const xla::XlaComputation& computation,
+                      const MainFlags& flags, int index,
+                      const CompileResult& base, TargetVariant* variant) {
+  TF_RETURN_IF_ERROR(SetDispatchFeatures(flags.target_triple, variant));
+  variant->entry_point = absl::StrCat(flags.entry_point, "_variant", index);
+  xla::cpu::CpuAotCompilationOptions aot_opts(
+      flags.target_triple, variant->target_cpu, variant->target_features,
+      variant->entry_point,
+      xla::cpu::CpuAotCompilationOptions::RelocationModel::BigPic);
+  CompileResult variant_result;
+  TF_RETURN_IF_ERROR(
+      CompileXla(client, computation, aot_opts, &variant_result));
+  if (variant_result.aot->buffer_infos() != base.aot->buffer_infos() ||
+      variant_result.aot->result_buffer_index() !=
+          base.aot->result_buffer_index()) {
+    return errors::InvalidArgument(
+        "Target variant ", variant->target_cpu, ":", variant->target_features,
+        " assigns different buffers than the target ", flags.target_cpu, ":",
+        flags.target_features);
+  }
+  variant->aot = std::move(variant_result.aot);
+  return Status::OK();
+}
+
 }  // namespace
 
+Status ParseTargetVariants(const string& target_variants,
+                           std::vector<TargetVariant>* variants) {
+  variants->clear();
+  for (absl::string_view spec :
+       absl::StrSplit(target_variants, ';', absl::SkipWhitespace())) {
+    std::vector<string> parts = absl::StrSplit(spec, absl::MaxSplits(':', 1));
+    if (parts.size() != 2 || parts[0].empty() || parts[1].empty()) {
+      return errors::InvalidArgument(
+          "Target variant must be <target_cpu>:<target_features>, got: ",
+          spec);
+    }
+    TargetVariant variant;
+    variant.target_cpu = parts[0];
+    variant.target_features = parts[1];
+    variants->push_back(std::move(variant));
+  }
+  return Status::OK();
+}
+
+Status SetDispatchFeatures(const string& target_triple,
+                           TargetVariant* variant) {
+  const llvm::Triple triple(llvm::Triple::normalize(target_triple));
+  if (triple.getArch() != llvm::Triple::x86_64) {
+    return errors::InvalidArgument(
+        "Target variants are only supported for x86-64 targets, got: ",
+        target_triple);
+  }
+  std::set<string> checkable_features;
+  for (const char* const* feature =
+           cpu_function_runtime::kHostCheckableTargetFeatures;
+       *feature != nullptr; ++feature) {
+    checkable_features.insert(*feature);
+  }
+  for (absl::string_view feature :
+       absl::StrSplit(variant->target_features, ',', absl::SkipEmpty())) {
+    if (absl::ConsumePrefix(&feature, "+") &&
+        checkable_features.count(string(feature)) == 0) {
+      return errors::InvalidArgument(
+          "Target variant feature +", feature,
+          " can't be checked on the host CPU");
+    }
+  }
+
+  string error;
+  const llvm::Target* target =
+      llvm::TargetRegistry::lookupTarget(triple.getTriple(), error);
+  if (target == nullptr) {
+    return errors::InvalidArgument("TargetRegistry::lookupTarget failed: ",
+                                   error);
+  }
+  std::unique_ptr<llvm::MCSubtargetInfo> subtarget(
+      target->createMCSubtargetInfo(triple.getTriple(), variant->target_cpu,
+                                    variant->target_features));
+  if (subtarget == nullptr ||
+      !subtarget->isCPUStringValid(variant->target_cpu)) {
+    return errors::InvalidArgument("Unknown target cpu of target variant: ",
+                                   variant->target_cpu);
+  }
+  // The features of the cpu that the host CPU may lack, even if they are not
+  // listed in the target features, e.g. AVX-512 for skylake-avx512.
+  std::vector<string> dispatch_features;
+  for (const string& feature : checkable_features) {
+    const string enabled = absl::StrCat("+", feature);
+    if (subtarget->checkFeatures(enabled)) {
+      dispatch_features.push_back(enabled);
+    }
+  }
+  variant->dispatch_features = absl::StrJoin(dispatch_features, ",");
+  return Status::OK();
+}
+
 Status CompileGraph(const GraphDef& graph_def, const tf2xla::Config& config,
                     const MainFlags& flags, CompileResult* compile_result) {
   // Converts the graph into an XLA computation, and compiles the
@@ -112,7 +219,17 @@ Status CompileGraph(const GraphDef& graph_def, const tf2xla::Config& config,
       flags.entry_point,
       xla::cpu::CpuAotCompilationOptions::RelocationModel::BigPic);
 
-  return CompileXla(client, computation, aot_opts, compile_result);
+  TF_RETURN_IF_ERROR(
+      CompileXla(client, computation, aot_opts, compile_result));
+
+  TF_RETURN_IF_ERROR(
+      ParseTargetVariants(flags.target_variants, &compile_result->variants));
+  for (int i = 0; i < compile_result->variants.size(); ++i) {
+    TF_RETURN_IF_ERROR(CompileVariant(client, computation, flags, i,
+                                      *compile_result,
+                                      &compile_result->variants[i]));
+  }
+  return Status::OK();
 }
 
 }  // namespace tfcompile
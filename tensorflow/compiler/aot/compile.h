@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "tensorflow/compiler/aot/flags.h"
 #include "tensorflow/compiler/tf2xla/tf2xla.pb.h"
@@ -28,6 +29,21 @@ limitations under the License.
 namespace tensorflow {
 namespace tfcompile {
 
+// TargetVariant describes a specialization of the generated function for a
+// target cpu and target features, in addition to the one compiled for the
+// target of MainFlags.
+struct TargetVariant {
+  string target_cpu;
+  string target_features;
+  // The features the host CPU must support to run the variant: the features
+  // enabled by target_cpu and target_features, as listed by
+  // cpu_function_runtime::kHostCheckableTargetFeatures.
+  string dispatch_features;
+  string entry_point;  // Name of generated function.
+  // Contains object file and meta-info.
+  std::unique_ptr<xla::cpu::CpuAotCompilationResult> aot;
+};
+
 // CompileResult describes the output of CompileGraph, where the object file
 // data and meta-information is available in aot.
 struct CompileResult {
@@ -36,8 +52,26 @@ struct CompileResult {
   xla::ProgramShape program_shape;  // Static shape of args and results.
   string entry_point;               // Name of generated function.
   int pointer_size = 0;             // Size of a pointer in bytes.
+  // Specializations of the function for MainFlags::target_variants, most
+  // preferred first.  They all use the buffers of aot.
+  std::vector<TargetVariant> variants;
 };
 
+// ParseTargetVariants parses the target cpus and target features of
+// `target_variants`, a semicolon-separated list of
+// <target_cpu>:<target_features>, into `variants`.
+Status ParseTargetVariants(const string& target_variants,
+                           std::vector<TargetVariant>* variants);
+
+// SetDispatchFeatures sets the dispatch_features of `variant` from its
+// target cpu and target features, as understood by LLVM for
+// `target_triple`.  LLVM's target for `target_triple` must be initialized.
+// Fails unless `target_triple` is x86-64 and every feature enabled by
+// the target features of `variant` can be checked on the host, since the
+// generated code could otherwise run the variant on a CPU missing some of
+// its features.
+Status SetDispatchFeatures(const string& target_triple, TargetVariant* variant);
+
 // CompileGraph compiles the graph_def into an object file containing a function
 // that performs the graph operations.
 //
@@ -48,6 +48,14 @@ void AppendMainFlags(std::vector<Flag>* flag_list, MainFlags* flags) {
        "http://clang.llvm.org/docs/CrossCompilation.html#cpu-fpu-abi"},
       {"target_features", &flags->target_features,
        "Target features, e.g. +avx2, +neon, etc."},
+      {"target_variants", &flags->target_variants,
+       "Semicolon-separated list of additional <target_cpu>:<target_features> "
+       "specializations of the generated function, most preferred first, "
+       "e.g. \"skylake-avx512:+avx512f,+avx512bw;haswell:+avx2,+fma\".  The "
+       "generated class runs the first specialization whose target features "
+       "the host CPU supports, including the features implied by its target "
+       "cpu, and otherwise the function compiled for --target_cpu and "
+       "--target_features.  Only supported for x86-64 targets."},
       {"entry_point", &flags->entry_point,
        "Name of the generated function.  If multiple generated object files "
        "will be linked into the same binary, each will need a unique entry "
@@ -62,6 +70,10 @@ void AppendMainFlags(std::vector<Flag>* flag_list, MainFlags* flags) {
       {"out_function_object", &flags->out_function_object,
        "Output object file containing the generated function for the "
        "TensorFlow model."},
+      {"out_variant_function_objects", &flags->out_variant_function_objects,
+       "Comma-separated list of output object files, containing the "
+       "specializations of the generated function for each of the "
+       "--target_variants."},
       {"out_header", &flags->out_header, "Output header file name."},
       {"out_metadata_object", &flags->out_metadata_object,
        "Output object file name containing optional metadata for the generated "
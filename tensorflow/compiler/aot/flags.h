@@ -32,9 +32,11 @@ struct MainFlags {
   string target_triple;
   string target_cpu;
   string target_features;
+  string target_variants;
   string entry_point;
   string cpp_class;
   string out_function_object;
+  string out_variant_function_objects;
   string out_metadata_object;
   string out_header;
   string out_session_module;
@@ -16,6 +16,11 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 #define EIGEN_USE_CUSTOM_THREAD_POOL
 
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <utility>
+
 #include "absl/strings/str_split.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/compiler/aot/tests/test_graph_tfadd.h"
@@ -30,6 +35,7 @@ limitations under the License.
 #include "tensorflow/compiler/aot/tests/test_graph_tfmatmulandadd_with_profiling.h"
 #include "tensorflow/compiler/aot/tests/test_graph_tfsplits.h"
 #include "tensorflow/compiler/aot/tests/test_graph_tftop_k.h"
+#include "tensorflow/compiler/tf2xla/xla_compiled_cpu_function_batch.h"
 #include "tensorflow/compiler/xla/service/hlo_profile_printer.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/test.h"
@@ -97,6 +103,47 @@ TEST(TFCompileTest, Add_SetArg) {
   EXPECT_EQ(add.result0_data(), add.results()[0]);
 }
 
+TEST(TFCompileTest, Add_Batch) {
+  XlaCompiledCpuFunctionBatch batch(AddComp::StaticData(), /*num_workers=*/3);
+  EXPECT_EQ(batch.num_workers(), 3);
+
+  constexpr int kNumRequests = 10;
+  int32 arg_x[kNumRequests];
+  int32 arg_y[kNumRequests];
+  void* args[2 * kNumRequests];
+  for (int i = 0; i < kNumRequests; ++i) {
+    arg_x[i] = i;
+    arg_y[i] = 100 * i;
+    args[2 * i] = &arg_x[i];
+    args[2 * i + 1] = &arg_y[i];
+  }
+  int32 results[kNumRequests] = {};
+  const void* result_buffers[kNumRequests] = {};
+  auto done = [&](int request, const XlaCompiledCpuFunction& function) {
+    results[request] = *static_cast<const int32*>(function.result_data(0));
+    result_buffers[request] = function.result_data(0);
+  };
+
+  Eigen::ThreadPool pool(2);
+  auto schedule = [&pool](std::function<void()> fn) {
+    pool.Schedule(std::move(fn));
+  };
+  EXPECT_TRUE(batch.Run(kNumRequests, args, done, schedule));
+  std::set<const void*> distinct_result_buffers;
+  for (int i = 0; i < kNumRequests; ++i) {
+    EXPECT_EQ(results[i], 101 * i);
+    distinct_result_buffers.insert(result_buffers[i]);
+  }
+  // Each worker reuses its result buffer.
+  EXPECT_LE(distinct_result_buffers.size(), 3);
+
+  // Fewer requests than workers.
+  std::fill(results, results + kNumRequests, 0);
+  EXPECT_TRUE(batch.Run(1, args + 2, done, schedule));
+  EXPECT_EQ(results[0], 101);
+  EXPECT_TRUE(batch.Run(0, args, done, schedule));
+}
+
 TEST(TFCompileTest, AddWithCkpt) {
   AddWithCkptComp add;
   EXPECT_EQ(add.arg0_data(), add.arg_data(0));
@@ -38,6 +38,7 @@ def tf_library(
         tfcompile_tool = "//tensorflow/compiler/aot:tfcompile",
         include_standard_runtime_deps = True,
         enable_xla_hlo_profiling = False,
+        target_variants = None,
         deps = None,
         tags = None):
     """Runs tfcompile to compile a TensorFlow graph into executable code.
@@ -88,6 +89,12 @@ def tf_library(
       enable_xla_hlo_profiling: Enable XLA HLO profiling in the generated
         program, and emit metadata that lets us pretty-print the gathered
         profile counters.
+      target_variants: A list of additional "<target_cpu>:<target_features>"
+        specializations of the generated function, most preferred first, e.g.
+        ["haswell:+avx2,+fma"].  At runtime the generated class runs the first
+        specialization whose target cpu and target features the host CPU
+        supports, and otherwise the function compiled for the target of
+        tfcompile_flags.  Only supported for x86-64 targets.
       deps: a list of deps to include on the build rules for the generated
         library, added to the standard deps if standard_runtime_deps is True.
       tags: tags to apply to subsidiary build rules.
@@ -175,6 +182,20 @@ def tf_library(
         profiling_flag = "--xla_hlo_profile"
     else:
         profiling_flag = ""
+    variant_object_files = [
+        name + "_tfcompile_function_variant" + str(i) + ".o"
+        for i in range(len(target_variants or []))
+    ]
+    if target_variants:
+        variant_flags = (
+            " --target_variants='" + ";".join(target_variants) + "'" +
+            " --out_variant_function_objects=" + ",".join([
+                "$(@D)/" + f
+                for f in variant_object_files
+            ])
+        )
+    else:
+        variant_flags = ""
     native.genrule(
         name = ("gen_" + name),
         srcs = [
@@ -185,7 +206,7 @@ def tf_library(
             header_file,
             metadata_object_file,
             function_object_file,
-        ],
+        ] + variant_object_files,
         cmd = (
             "CUDA_VISIBLE_DEVICES='' " +
             "$(location " + tfcompile_tool + ")" +
@@ -197,6 +218,7 @@ def tf_library(
             " --out_header=$(@D)/" + header_file +
             " --out_metadata_object=$(@D)/" + metadata_object_file +
             " --out_function_object=$(@D)/" + function_object_file +
+            variant_flags +
             " " + flags + " " + profiling_flag
         ),
         tools = [tfcompile_tool],
@@ -251,7 +273,8 @@ def tf_library(
     need_xla_data_proto = (flags and flags.find("--gen_program_shape") != -1)
     native.cc_library(
         name = name,
-        srcs = [function_object_file, metadata_object_file],
+        srcs = [function_object_file, metadata_object_file] +
+               variant_object_files,
         hdrs = [header_file],
         visibility = visibility,
         testonly = testonly,
@@ -372,6 +395,7 @@ def tf_library(
             deps = [
                 ":" + name,
                 "//tensorflow/compiler/aot:benchmark",
+                "//tensorflow/compiler/tf2xla:xla_compiled_cpu_function_batch",
                 "//tensorflow/compiler/xla:executable_run_options",
                 "//third_party/eigen3",
             ] + if_android([
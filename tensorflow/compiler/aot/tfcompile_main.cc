@@ -20,6 +20,7 @@ limitations under the License.
 
 #include "absl/strings/match.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/compiler/aot/codegen.h"
 #include "tensorflow/compiler/aot/compile.h"
@@ -95,6 +96,21 @@ Status Main(const MainFlags& flags) {
   TF_RETURN_IF_ERROR(
       WriteStringToFile(env, flags.out_function_object,
                         absl::string_view(obj.data(), obj.size())));
+  const std::vector<string> variant_objects = absl::StrSplit(
+      flags.out_variant_function_objects, ',', absl::SkipEmpty());
+  if (variant_objects.size() != compile_result.variants.size()) {
+    return errors::InvalidArgument(
+        "Must specify one --out_variant_function_objects file for each of the ",
+        compile_result.variants.size(), " --target_variants, got ",
+        variant_objects.size());
+  }
+  for (int i = 0; i < variant_objects.size(); ++i) {
+    const std::vector<char>& variant_obj =
+        compile_result.variants[i].aot->object_file_data();
+    TF_RETURN_IF_ERROR(WriteStringToFile(
+        env, variant_objects[i],
+        absl::string_view(variant_obj.data(), variant_obj.size())));
+  }
   CodegenOpts codegen_opts;
   codegen_opts.gen_name_to_index = flags.gen_name_to_index;
   codegen_opts.gen_program_shape = flags.gen_program_shape;
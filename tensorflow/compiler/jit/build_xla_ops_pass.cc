@@ -15,8 +15,10 @@ limitations under the License.
 
 #include "tensorflow/compiler/jit/build_xla_ops_pass.h"
 #include "absl/algorithm/container.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/cc/framework/ops.h"
 #include "tensorflow/cc/framework/scope_internal.h"
+#include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/compiler/jit/defs.h"
 #include "tensorflow/compiler/jit/encapsulate_subgraphs_pass.h"
 #include "tensorflow/compiler/tf2xla/cc/ops/xla_jit_ops.h"
@@ -107,7 +109,127 @@ Status CopyIncomingControlEdges(Graph* g, Node* from, Node* to) {
   return Status::OK();
 }
 
-Status ReplaceNodeWithXlaCompileAndXlaRun(Graph* g, Node* n) {
+// Adds a call of the function called by the cluster `n`, taking `inputs`, to
+// be run instead of the compiled cluster. The call has a control dependency on
+// `pivot`, so that it only runs when `pivot` is alive. `pivot` must not be a
+// Switch: control edges out of a Switch are alive on both of its branches.
+Status AddFallbackCall(Graph* g, Node* n, const std::vector<Output>& inputs,
+                       const Output& pivot, Node** call) {
+  NodeDef call_def = n->def();
+  call_def.set_name(absl::StrCat(n->name(), "/fallback_call"));
+  call_def.clear_input();
+  call_def.mutable_attr()->erase(kXlaCompiledKernelAttr);
+  call_def.mutable_attr()->erase(kXlaNumConstantArgsAttr);
+  call_def.mutable_attr()->erase(kXlaNumResourceArgsAttr);
+  Status status;
+  *call = g->AddNode(call_def, &status);
+  TF_RETURN_IF_ERROR(status);
+  (*call)->set_assigned_device_name(n->assigned_device_name());
+  for (int i = 0; i < inputs.size(); ++i) {
+    g->AddEdge(inputs[i].node(), inputs[i].index(), *call, i);
+  }
+  g->AddControlEdge(pivot.node(), *call);
+  return Status::OK();
+}
+
+// Replaces the outputs of the cluster `n` by merges of the outputs of
+// `xla_run` and `call`, only one of which runs.
+Status MergeOutgoingEdges(const Scope& root, Graph* g, Node* n, Node* xla_run,
+                          Node* call) {
+  std::vector<Output> merged_outputs;
+  for (int i = 0; i < n->num_outputs(); ++i) {
+    ops::Merge merge(root.WithOpName(absl::StrCat("merge_output_", i)),
+                     {Output(xla_run, i), Output(call, i)});
+    merged_outputs.push_back(merge.output);
+  }
+
+  Node* merged_control = nullptr;
+  std::vector<const Edge*> out_edges(n->out_edges().begin(),
+                                     n->out_edges().end());
+  for (const Edge* edge : out_edges) {
+    if (edge->IsControlEdge()) {
+      if (merged_control == nullptr) {
+        // Control edges out of a dead node would kill their destination, so
+        // they hang off a merge of constants that depend on either branch.
+        Output xla_run_done = ops::Const(
+            root.WithOpName("xla_run_done")
+                .WithControlDependencies({Operation(xla_run)}),
+            false);
+        Output call_done =
+            ops::Const(root.WithOpName("fallback_call_done")
+                           .WithControlDependencies({Operation(call)}),
+                       false);
+        ops::Merge merge(root.WithOpName("merge_control"),
+                         {xla_run_done, call_done});
+        merged_control = merge.output.node();
+      }
+      g->AddControlEdge(merged_control, edge->dst());
+    } else {
+      const Output& merged = merged_outputs[edge->src_output()];
+      g->AddEdge(merged.node(), merged.index(), edge->dst(),
+                 edge->dst_input());
+    }
+    g->RemoveEdge(edge);
+  }
+  return root.status();
+}
+
+// Replaces the cluster `n` by _XlaCompile, and by _XlaRun if the cluster was
+// compiled or a call of its function otherwise.
+Status ReplaceNodeWithAsyncXlaCompile(
+    const Scope& root, Graph* g, Node* n, const XlaClusterInfo& cluster_info,
+    const ops::_XlaCompile::Attrs& compile_attrs) {
+  ops::_XlaCompile xla_compile(root.WithOpName("xla_compile"),
+                               /*constants=*/cluster_info.constant_inputs,
+                               /*args=*/cluster_info.non_constant_inputs,
+                               /*resources=*/cluster_info.resource_inputs,
+                               cluster_info.function,
+                               ops::_XlaCompile::Attrs(compile_attrs)
+                                   .MustCompile(false));
+  TF_RETURN_IF_ERROR(
+      CopyIncomingControlEdges(g, /*from=*/n, /*to=*/xla_compile.key.node()));
+
+  // The true outputs of the switches feed _XlaRun, the false ones the call.
+  auto predicated = [&](const Output& input, const string& name) {
+    return ops::Switch(root.WithOpName(name), input,
+                       xla_compile.compilation_successful);
+  };
+  ops::Switch key = predicated(xla_compile.key, "predicated_key");
+  std::vector<Output> xla_run_args;
+  std::vector<Output> call_args;
+  for (int i = 0; i < cluster_info.constant_inputs.size(); ++i) {
+    call_args.push_back(predicated(cluster_info.constant_inputs[i],
+                                   absl::StrCat("predicated_constant_", i))
+                            .output_false);
+  }
+  std::vector<Output> run_inputs = cluster_info.non_constant_inputs;
+  absl::c_copy(cluster_info.resource_inputs, std::back_inserter(run_inputs));
+  for (int i = 0; i < run_inputs.size(); ++i) {
+    ops::Switch input =
+        predicated(run_inputs[i], absl::StrCat("predicated_arg_", i));
+    xla_run_args.push_back(input.output_true);
+    call_args.push_back(input.output_false);
+  }
+  TF_RETURN_IF_ERROR(root.status());
+
+  ops::_XlaRun xla_run(root.WithOpName("xla_run"), xla_run_args,
+                       key.output_true, n->output_types());
+  // Clusters without inputs would otherwise run the call on both branches.
+  ops::Identity fallback_pivot(root.WithOpName("fallback_pivot"),
+                               key.output_false);
+  TF_RETURN_IF_ERROR(root.status());
+  Node* call;
+  TF_RETURN_IF_ERROR(
+      AddFallbackCall(g, n, call_args, fallback_pivot.output, &call));
+  TF_RETURN_IF_ERROR(
+      MergeOutgoingEdges(root, g, n, xla_run.operation.node(), call));
+  g->RemoveNode(n);
+  return Status::OK();
+}
+
+Status ReplaceNodeWithXlaCompileAndXlaRun(
+    Graph* g, Node* n, bool async_compilation,
+    const ops::_XlaCompile::Attrs& compile_attrs) {
   Status status;
   Scope root = NewInternalScope(g, &status, /*refiner=*/nullptr)
                    .NewSubScope(n->name())
@@ -116,12 +238,16 @@ Status ReplaceNodeWithXlaCompileAndXlaRun(Graph* g, Node* n) {
 
   XlaClusterInfo cluster_info;
   TF_RETURN_IF_ERROR(GetXlaClusterInfo(n, &cluster_info));
+  if (async_compilation) {
+    return ReplaceNodeWithAsyncXlaCompile(root, g, n, cluster_info,
+                                          compile_attrs);
+  }
 
   ops::_XlaCompile xla_compile(root.WithOpName("xla_compile"),
                                /*constants=*/cluster_info.constant_inputs,
                                /*args=*/cluster_info.non_constant_inputs,
                                /*resources=*/cluster_info.resource_inputs,
-                               cluster_info.function);
+                               cluster_info.function, compile_attrs);
   TF_RETURN_IF_ERROR(
       CopyIncomingControlEdges(g, /*from=*/n, /*to=*/xla_compile.key.node()));
 
@@ -140,6 +266,18 @@ Status ReplaceNodeWithXlaCompileAndXlaRun(Graph* g, Node* n) {
 
 Status BuildXlaOpsPass::Run(const GraphOptimizationPassOptions& options) {
   Graph* graph = options.graph->get();
+  bool async_compilation = false;
+  std::vector<int> leading_dim_buckets;
+  if (options.session_options != nullptr) {
+    const OptimizerOptions& optimizer_options =
+        options.session_options->config.graph_options().optimizer_options();
+    async_compilation = optimizer_options.async_jit_compilation();
+    leading_dim_buckets.assign(
+        optimizer_options.jit_leading_dim_buckets().begin(),
+        optimizer_options.jit_leading_dim_buckets().end());
+  }
+  const ops::_XlaCompile::Attrs compile_attrs =
+      ops::_XlaCompile::LeadingDimBuckets(leading_dim_buckets);
 
   for (Node* n : graph->op_nodes()) {
     // In all cases, only try to compile computational nodes.
@@ -150,7 +288,9 @@ Status BuildXlaOpsPass::Run(const GraphOptimizationPassOptions& options) {
     // Only compile nodes that are marked for compilation by the
     // compilation-marking pass (via 'attr_name').
     if (IsXlaCompiledKernel(*n)) {
-      TF_RETURN_IF_ERROR(ReplaceNodeWithXlaCompileAndXlaRun(graph, n));
+      TF_RETURN_IF_ERROR(
+          ReplaceNodeWithXlaCompileAndXlaRun(graph, n, async_compilation,
+                                             compile_attrs));
     }
   }
 
@@ -23,6 +23,11 @@ namespace tensorflow {
 
 // Adds _XlaCompile and _XlaRun operations to the TF graph that compiles and
 // executes (using XLA) TF function calls marked with "_XlaCompiledKernel".
+//
+// With OptimizerOptions::async_jit_compilation, the function calls are kept
+// and run whenever _XlaCompile reports that the cluster is not compiled yet:
+// _XlaRun and the call are fed through Switch nodes predicated on the
+// compilation status, and their outputs are merged.
 class BuildXlaOpsPass : public GraphOptimizationPass {
  public:
   Status Run(const GraphOptimizationPassOptions& options) override;
@@ -26,16 +26,20 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
 namespace {
 
 using ::tensorflow::testing::FindNodeByName;
 using ::tensorflow::testing::matchers::CtrlDeps;
+using ::tensorflow::testing::matchers::Inputs;
+using ::tensorflow::testing::matchers::Name;
 using ::tensorflow::testing::matchers::NodeWith;
 using ::tensorflow::testing::matchers::Op;
 
-Status BuildXlaOps(const Scope& s, std::unique_ptr<Graph>* result) {
+Status BuildXlaOps(const Scope& s, std::unique_ptr<Graph>* result,
+                   bool async_compilation = false) {
   auto graph = absl::make_unique<Graph>(OpRegistry::Global());
   TF_RETURN_IF_ERROR(s.ToGraph(graph.get()));
 
@@ -47,8 +51,13 @@ Status BuildXlaOps(const Scope& s, std::unique_ptr<Graph>* result) {
     }
   }
 
+  SessionOptions session_options;
+  session_options.config.mutable_graph_options()
+      ->mutable_optimizer_options()
+      ->set_async_jit_compilation(async_compilation);
   GraphOptimizationPassOptions opt_options;
   opt_options.graph = &graph;
+  opt_options.session_options = &session_options;
   BuildXlaOpsPass pass;
   TF_RETURN_IF_ERROR(pass.Run(opt_options));
   *result = std::move(graph);
@@ -134,5 +143,68 @@ TEST(BuildXlaOps, CleanFailureOnBogusAttr) {
   EXPECT_EQ(failure_status.code(), error::INVALID_ARGUMENT);
 }
 
+TEST(BuildXlaOps, AsyncCompilationFallsBackToFunctionCall) {
+  Scope root = Scope::NewRootScope().ExitOnError();
+
+  FunctionDefLibrary flib_def =
+      CreateFunctionDefLibWithConstFunction("cluster_0");
+  TF_ASSERT_OK(root.graph()->AddFunctionLibrary(flib_def));
+  Node* call;
+  TF_ASSERT_OK(MakeXlaCompiledKernel(root.graph(), "cluster_0", "C", &call));
+  ops::Identity consumer(root.WithOpName("consumer"), Output(call, 0));
+  Node* write_op = MakeWrite(root, "write");
+  root.graph()->AddControlEdge(call, write_op);
+
+  std::unique_ptr<Graph> graph;
+  TF_ASSERT_OK(BuildXlaOps(root, &graph, /*async_compilation=*/true));
+
+  Node* xla_compile = FindNodeByName(graph.get(), "C/xla_compile");
+  ASSERT_NE(xla_compile, nullptr);
+  bool must_compile;
+  TF_ASSERT_OK(
+      GetNodeAttr(xla_compile->attrs(), "must_compile", &must_compile));
+  EXPECT_FALSE(must_compile);
+
+  // The call only runs when the compilation key is routed away from _XlaRun.
+  auto predicated_key = NodeWith(Op("Switch"), Name("C/predicated_key"));
+  auto xla_run = NodeWith(Op("_XlaRun"), Inputs(predicated_key));
+  auto fallback_pivot = NodeWith(Op("Identity"), Name("C/fallback_pivot"),
+                                 Inputs(predicated_key));
+  auto fallback_call = NodeWith(Op("cluster_0"), CtrlDeps(fallback_pivot));
+  EXPECT_THAT(FindNodeByName(graph.get(), "consumer"),
+              NodeWith(Inputs(NodeWith(Op("Merge"),
+                                       Inputs(xla_run, fallback_call)))));
+  EXPECT_THAT(FindNodeByName(graph.get(), write_op->name()),
+              NodeWith(CtrlDeps(NodeWith(Op("Merge")))));
+}
+
+TEST(BuildXlaOps, AsyncFallbackCallWithoutInputsOnlyRunsOnFalseBranch) {
+  Scope root = Scope::NewRootScope().ExitOnError();
+
+  FunctionDefLibrary flib_def =
+      CreateFunctionDefLibWithConstFunction("cluster_0");
+  TF_ASSERT_OK(root.graph()->AddFunctionLibrary(flib_def));
+  Node* call;
+  TF_ASSERT_OK(MakeXlaCompiledKernel(root.graph(), "cluster_0", "C", &call));
+  ops::Identity consumer(root.WithOpName("consumer"), Output(call, 0));
+
+  std::unique_ptr<Graph> graph;
+  TF_ASSERT_OK(BuildXlaOps(root, &graph, /*async_compilation=*/true));
+
+  // A control edge out of the Switch itself would be alive on both branches,
+  // and the call would then run along with _XlaRun.
+  Node* fallback_call = FindNodeByName(graph.get(), "C/fallback_call");
+  ASSERT_NE(fallback_call, nullptr);
+  ASSERT_EQ(fallback_call->in_edges().size(), 1);
+  const Edge* pivot_edge = *fallback_call->in_edges().begin();
+  EXPECT_TRUE(pivot_edge->IsControlEdge());
+  EXPECT_EQ(pivot_edge->src()->type_string(), "Identity");
+
+  const Edge* switch_edge;
+  TF_ASSERT_OK(pivot_edge->src()->input_edge(0, &switch_edge));
+  EXPECT_EQ(switch_edge->src()->name(), "C/predicated_key");
+  EXPECT_EQ(switch_edge->src_output(), 0);
+}
+
 }  // namespace
 }  // namespace tensorflow
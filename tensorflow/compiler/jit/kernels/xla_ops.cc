@@ -18,6 +18,7 @@ limitations under the License.
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "tensorflow/compiler/jit/defs.h"
+#include "tensorflow/compiler/jit/xla_shape_bucketing.h"
 #include "tensorflow/compiler/tf2xla/shape_util.h"
 #include "tensorflow/compiler/tf2xla/tf2xla_util.h"
 #include "tensorflow/compiler/tf2xla/xla_compiler.h"
@@ -100,12 +101,16 @@ class XlaExecutableClosure {
       xla::LocalClient* client, xla::LocalExecutable* executable,
       const XlaCompiler::CompilationResult* compilation_result,
       std::map<int, OptionalTensor> resource_var_snapshots,
-      int num_constant_args)
+      int num_constant_args, int64 padded_dim0 = -1, int64 num_rows = -1,
+      std::vector<bool> padded_outputs = {})
       : client_(client),
         executable_(executable),
         compilation_result_(compilation_result),
         resource_var_snapshots_(std::move(resource_var_snapshots)),
-        num_constant_args_(num_constant_args) {}
+        num_constant_args_(num_constant_args),
+        padded_dim0_(padded_dim0),
+        num_rows_(num_rows),
+        padded_outputs_(std::move(padded_outputs)) {}
 
   XlaExecutableClosure(XlaExecutableClosure&&) = default;
   XlaExecutableClosure& operator=(XlaExecutableClosure&&) = default;
@@ -120,12 +125,23 @@ class XlaExecutableClosure {
   }
   int num_constant_args() const { return num_constant_args_; }
 
+  // The size the leading dimension of the args is padded to, or -1 if it is
+  // not padded.
+  int64 padded_dim0() const { return padded_dim0_; }
+  // The unpadded size of the leading dimension of the padded args.
+  int64 num_rows() const { return num_rows_; }
+  // Whether each output is padded, and must be sliced to `num_rows()` rows.
+  const std::vector<bool>& padded_outputs() const { return padded_outputs_; }
+
  private:
   xla::LocalClient* client_;
   xla::LocalExecutable* executable_;
   const XlaCompiler::CompilationResult* compilation_result_;
   std::map<int, OptionalTensor> resource_var_snapshots_;
   int num_constant_args_;
+  int64 padded_dim0_;
+  int64 num_rows_;
+  std::vector<bool> padded_outputs_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(XlaExecutableClosure);
 };
@@ -169,6 +185,36 @@ class XlaExecutableClosureStore {
   TF_DISALLOW_COPY_AND_ASSIGN(XlaExecutableClosureStore);
 };
 
+// Pads the leading dimension of `input` to `rows` rows of zeros.
+Status PadLeadingDim(OpKernelContext* ctx, const Tensor& input, int64 rows,
+                     Tensor* padded) {
+  TensorShape shape = input.shape();
+  shape.set_dim(0, rows);
+  TF_RETURN_IF_ERROR(ctx->allocate_temp(input.dtype(), shape, padded));
+  const uint64 size = input.TotalBytes();
+  const uint64 padded_size = padded->TotalBytes();
+  char* dst = static_cast<char*>(DMAHelper::base(padded));
+  const void* src = DMAHelper::base(&input);
+
+  se::Stream* stream =
+      ctx->op_device_context() ? ctx->op_device_context()->stream() : nullptr;
+  if (stream == nullptr) {
+    memcpy(dst, src, size);
+    memset(dst + size, 0, padded_size - size);
+    return Status::OK();
+  }
+  se::DeviceMemoryBase dst_mem(dst, size);
+  stream->ThenMemcpyD2D(&dst_mem,
+                        se::DeviceMemoryBase(const_cast<void*>(src), size),
+                        size);
+  se::DeviceMemoryBase padding(dst + size, padded_size - size);
+  stream->ThenMemZero(&padding, padded_size - size);
+  if (!stream->ok()) {
+    return errors::Internal("Failed to pad an input of an XLA computation");
+  }
+  return Status::OK();
+}
+
 }  // namespace
 
 XlaLocalLaunchBase::XlaLocalLaunchBase(OpKernelConstruction* ctx,
@@ -222,7 +268,10 @@ static Status CompileToLocalExecutable(
     absl::Span<const int> constants, xla::LocalClient** client,
     std::map<int, OptionalTensor>* variables,
     const XlaCompiler::CompilationResult** kernel,
-    xla::LocalExecutable** executable) {
+    xla::LocalExecutable** executable,
+    XlaCompilationCache::CompileMode compile_mode =
+        XlaCompilationCache::CompileMode::kStrict,
+    int64 padded_dim0 = -1) {
   // We store information about the JIT-compiled XLA computation
   // in the ResourceMgr.
   ResourceMgr* rm = ctx->resource_manager();
@@ -277,7 +326,8 @@ static Status CompileToLocalExecutable(
   compile_options.always_return_tuple = false;
 
   return cache->Compile(options, function, constant_args, *variables, ctx,
-                        kernel, executable, compile_options);
+                        kernel, executable, compile_options, compile_mode,
+                        padded_dim0);
 }
 
 void XlaLocalLaunchBase::Compute(OpKernelContext* ctx) {
@@ -394,6 +444,59 @@ XlaCompileOp::XlaCompileOp(OpKernelConstruction* ctx)
       resources_(ResourcesVector(ctx)),
       function_(FunctionAttr(ctx)) {
   OP_REQUIRES_OK(ctx, PlatformInfoFromContext(ctx, &platform_info_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("must_compile", &must_compile_));
+  OP_REQUIRES_OK(ctx,
+                 ctx->GetAttr("leading_dim_buckets", &leading_dim_buckets_));
+
+  // Padding is only implemented for args in regular device memory, and the
+  // function must not observe the padded shapes.
+  mutex_lock lock(mu_);
+  padding_disabled_ =
+      leading_dim_buckets_.empty() || platform_info_.is_on_xla_device() ||
+      ctx->function_library() == nullptr ||
+      FunctionReadsInputShapes(
+          *ctx->function_library()->GetFunctionLibraryDefinition(),
+          function_.name());
+}
+
+int64 XlaCompileOp::PaddedDim0(OpKernelContext* ctx,
+                               std::set<int>* padded_args, int64* num_rows) {
+  {
+    mutex_lock lock(mu_);
+    if (padding_disabled_) return -1;
+  }
+  // The args are padded if they all have the same leading dimension.
+  int64 rows = -1;
+  const int num_args = ctx->num_inputs() - resources_.size();
+  for (int i = constants_.size(); i < num_args; ++i) {
+    const Tensor& input = ctx->input(i);
+    if (input.dims() == 0) continue;
+    if (input.NumElements() == 0 || (rows != -1 && input.dim_size(0) != rows)) {
+      return -1;
+    }
+    rows = input.dim_size(0);
+    padded_args->insert(i);
+  }
+  if (rows == -1) return -1;
+  const int64 bucket = ShapeBucket(leading_dim_buckets_, rows);
+  if (bucket <= rows) return -1;
+  *num_rows = rows;
+  return bucket;
+}
+
+Status XlaCompileOp::PaddedOutputs(
+    const XlaCompiler::CompilationResult* kernel,
+    const std::set<int>& padded_args, std::vector<bool>* padded_outputs) {
+  mutex_lock lock(mu_);
+  auto it = padded_outputs_.find(kernel);
+  if (it == padded_outputs_.end()) {
+    std::vector<bool> outputs;
+    TF_RETURN_IF_ERROR(
+        AnalyzeLeadingDimPadding(*kernel, padded_args, &outputs));
+    it = padded_outputs_.emplace(kernel, std::move(outputs)).first;
+  }
+  *padded_outputs = it->second;
+  return Status::OK();
 }
 
 void XlaCompileOp::Compute(OpKernelContext* ctx) {
@@ -401,19 +504,37 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
   const XlaCompiler::CompilationResult* kernel;
   xla::LocalExecutable* executable;
   std::map<int, OptionalTensor> variables;
-
-  OP_REQUIRES_OK(
-      ctx, CompileToLocalExecutable(ctx, function_, platform_info_, resources_,
-                                    constants_, &client, &variables, &kernel,
-                                    &executable));
-
-  // Each execution of an XlaCompile op creates a new XlaExecutableClosure, even
-  // if it didn't have to compile the cluster because of a compilation-cache
-  // hit.  This is because we at least need new snapshots of the resource
-  // variables.
-  XlaExecutableClosureStore::KeyT key =
-      XlaExecutableClosureStore::Global()->Produce(XlaExecutableClosure(
-          client, executable, kernel, std::move(variables), constants_.size()));
+  const XlaCompilationCache::CompileMode compile_mode =
+      must_compile_ ? XlaCompilationCache::CompileMode::kStrict
+                    : XlaCompilationCache::CompileMode::kAsync;
+
+  std::set<int> padded_args;
+  int64 num_rows = -1;
+  int64 padded_dim0 = PaddedDim0(ctx, &padded_args, &num_rows);
+  Status status = CompileToLocalExecutable(
+      ctx, function_, platform_info_, resources_, constants_, &client,
+      &variables, &kernel, &executable, compile_mode, padded_dim0);
+  std::vector<bool> padded_outputs;
+  if (padded_dim0 >= 0) {
+    Status padding_status = status;
+    if (status.ok() && kernel != nullptr) {
+      padding_status = PaddedOutputs(kernel, padded_args, &padded_outputs);
+    }
+    if (!padding_status.ok()) {
+      VLOG(1) << "Compiling " << function_.name()
+              << " for the exact shapes of its args: " << padding_status;
+      {
+        mutex_lock lock(mu_);
+        padding_disabled_ = true;
+      }
+      padded_dim0 = -1;
+      padded_outputs.clear();
+      status = CompileToLocalExecutable(
+          ctx, function_, platform_info_, resources_, constants_, &client,
+          &variables, &kernel, &executable, compile_mode);
+    }
+  }
+  OP_REQUIRES_OK(ctx, status);
 
   Allocator* cpu_allocator = [&] {
     AllocatorAttributes host_alloc_attrs;
@@ -423,9 +544,27 @@ void XlaCompileOp::Compute(OpKernelContext* ctx) {
   }();
 
   Tensor compilation_key(cpu_allocator, DT_STRING, TensorShape({}));
-  compilation_key.flat<string>()(0) = key;
-
   Tensor compilation_successful(cpu_allocator, DT_BOOL, TensorShape({}));
+  if (kernel == nullptr) {
+    // Still compiling in the background, or failed to compile: the graph runs
+    // the uncompiled cluster instead of _XlaRun.
+    DCHECK(!must_compile_);
+    compilation_successful.flat<bool>()(0) = false;
+    ctx->set_output(0, compilation_key);
+    ctx->set_output(1, compilation_successful);
+    return;
+  }
+
+  // Each execution of an XlaCompile op creates a new XlaExecutableClosure, even
+  // if it didn't have to compile the cluster because of a compilation-cache
+  // hit.  This is because we at least need new snapshots of the resource
+  // variables.
+  XlaExecutableClosureStore::KeyT key =
+      XlaExecutableClosureStore::Global()->Produce(XlaExecutableClosure(
+          client, executable, kernel, std::move(variables), constants_.size(),
+          padded_dim0, num_rows, std::move(padded_outputs)));
+
+  compilation_key.flat<string>()(0) = key;
   compilation_successful.flat<bool>()(0) = true;
 
   ctx->set_output(0, compilation_key);
@@ -448,12 +587,25 @@ void XlaRunOp::Compute(OpKernelContext* ctx) {
       /*allocate_xla_tensors=*/platform_info_.is_on_xla_device(),
       /*use_multiple_streams=*/platform_info_.UseMultipleStreams());
 
+  // The non-resource args the computation was compiled for are padded.
+  std::map<int, Tensor> padded_inputs;
+  if (closure.padded_dim0() >= 0) {
+    for (int i = 0; i < ctx->num_inputs() - 1; ++i) {
+      const Tensor& input = ctx->input(i);
+      if (input.dtype() == DT_RESOURCE || input.dims() == 0) continue;
+      Tensor& padded = padded_inputs[i + closure.num_constant_args()];
+      OP_REQUIRES_OK(
+          ctx, PadLeadingDim(ctx, input, closure.padded_dim0(), &padded));
+    }
+  }
+
   // We're missing the must-be-constant inputs, tell `PopulateInputs`
   // about this.  We don't actually need these inputs because they've
   // already been baked into the compiled kernel.
   launch_context.PopulateInputs(
       ctx, closure.compilation_result(), closure.resource_var_snapshots(),
-      /*missing_ctx_input_prefix=*/closure.num_constant_args());
+      /*missing_ctx_input_prefix=*/closure.num_constant_args(),
+      &padded_inputs);
 
   se::Stream* stream =
       ctx->op_device_context() ? ctx->op_device_context()->stream() : nullptr;
@@ -477,6 +629,14 @@ void XlaRunOp::Compute(OpKernelContext* ctx) {
       launch_context.PopulateOutputs(
           ctx, closure.compilation_result(), run_result.ConsumeValueOrDie(),
           /*missing_ctx_input_prefix=*/closure.num_constant_args()));
+
+  // Drops the padding rows of the outputs. The slices alias the outputs.
+  for (int i = 0; i < closure.padded_outputs().size(); ++i) {
+    if (closure.padded_outputs()[i]) {
+      Tensor* output = ctx->mutable_output(i);
+      *output = output->Slice(0, closure.num_rows());
+    }
+  }
 }
 
 REGISTER_KERNEL_BUILDER(Name("XlaLaunch").Device(DEVICE_CPU), XlaLocalLaunchOp);
@@ -491,7 +651,8 @@ REGISTER_KERNEL_BUILDER(Name("_XlaCompile").Device(DEVICE_CPU), XlaCompileOp);
 REGISTER_KERNEL_BUILDER(Name("_XlaCompile")
                             .Device(DEVICE_GPU)
                             .HostMemory("constants")
-                            .HostMemory("resources"),
+                            .HostMemory("resources")
+                            .HostMemory("compilation_successful"),
                         XlaCompileOp);
 
 REGISTER_KERNEL_BUILDER(Name("_XlaRun").Device(DEVICE_CPU), XlaRunOp);
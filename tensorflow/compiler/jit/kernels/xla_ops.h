@@ -16,6 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_JIT_KERNELS_XLA_OPS_H_
 #define TENSORFLOW_COMPILER_JIT_KERNELS_XLA_OPS_H_
 
+#include <set>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/compiler/jit/xla_compilation_cache.h"
 #include "tensorflow/compiler/jit/xla_device.h"
 #include "tensorflow/compiler/jit/xla_launch_util.h"
@@ -24,6 +28,8 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/util/stream_executor_util.h"
 
 namespace tensorflow {
@@ -151,6 +157,37 @@ class XlaCompileOp : public OpKernel {
   NameAttrList function_;
 
   XlaPlatformInfo platform_info_;
+
+  // If false, new signatures are compiled in the background and the op
+  // reports them as not compiled until they are.
+  bool must_compile_;
+
+  // Sizes the leading dimension of the args is padded to (see
+  // xla_shape_bucketing.h). Empty if the args are never padded.
+  std::vector<int64> leading_dim_buckets_;
+
+  // Returns the size the leading dimension of the args is padded to, or -1 if
+  // it is not padded. Sets `*padded_args` to the padded args, and `*num_rows`
+  // to their unpadded size.
+  int64 PaddedDim0(OpKernelContext* ctx, std::set<int>* padded_args,
+                   int64* num_rows);
+
+  // Checks that padding `padded_args` leaves the unpadded rows of the outputs
+  // of `kernel` unchanged, and sets `*padded_outputs` to whether each output
+  // is padded.
+  Status PaddedOutputs(const XlaCompiler::CompilationResult* kernel,
+                       const std::set<int>& padded_args,
+                       std::vector<bool>* padded_outputs);
+
+  mutex mu_;
+
+  // Set once padding the args proved unsafe or failed to compile, after which
+  // the op compiles for the exact shapes of the args.
+  bool padding_disabled_ GUARDED_BY(mu_) = false;
+
+  // The padded outputs of the computations compiled for padded args.
+  absl::flat_hash_map<const XlaCompiler::CompilationResult*, std::vector<bool>>
+      padded_outputs_ GUARDED_BY(mu_);
 };
 
 class XlaRunOp : public OpKernel {
@@ -42,6 +42,8 @@ static void AllocateFlags() {
   flags->tf_xla_cpu_global_jit = false;
   flags->tf_xla_clustering_fuel = std::numeric_limits<int64>::max();
   flags->tf_xla_fusion_only = false;
+  flags->tf_xla_cpu_cost_based_clustering = false;
+  flags->tf_xla_cpu_max_clustered_contraction_flops = 1 << 20;
   flag_list = new std::vector<Flag>(
       {Flag("tf_xla_auto_jit", &flags->tf_xla_auto_jit,
             "Control compilation of operators into XLA computations on CPU and "
@@ -63,7 +65,17 @@ static void AllocateFlags() {
             "eligible for clustering."),
        Flag("tf_xla_fusion_only", &flags->tf_xla_fusion_only,
             "enable fusion of element-wise operations only using XLA when "
-            "global_jit_level is ON*.")});
+            "global_jit_level is ON*."),
+       Flag("tf_xla_cpu_cost_based_clustering",
+            &flags->tf_xla_cpu_cost_based_clustering,
+            "On CPU, only cluster element-wise ops, reductions and small "
+            "contractions, and only compile clusters estimated to run faster "
+            "with XLA than with the TensorFlow kernels."),
+       Flag("tf_xla_cpu_max_clustered_contraction_flops",
+            &flags->tf_xla_cpu_max_clustered_contraction_flops,
+            "With tf_xla_cpu_cost_based_clustering, contractions (MatMul, "
+            "Conv2D, ...) doing more flops, or of unknown size, are left to "
+            "the TensorFlow kernels.")});
   xla::legacy_flags::ParseFlagsFromEnv(*flag_list);
 }
 
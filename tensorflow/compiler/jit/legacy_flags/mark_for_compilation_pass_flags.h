@@ -55,6 +55,15 @@ typedef struct {
                             // is set to ON* and overrides its behavior. If
                             // true, enable fusion of element-wise operations
                             // only using XLA.
+  bool tf_xla_cpu_cost_based_clustering;  // Only clusters CPU ops that an
+                                          // estimate says run faster as XLA
+                                          // computations than as TensorFlow
+                                          // kernels.
+  int64 tf_xla_cpu_max_clustered_contraction_flops;  // With the above,
+                                                     // leaves contractions
+                                                     // (MatMul, Conv2D, ...)
+                                                     // doing more flops to
+                                                     // the native kernels.
 } MarkForCompilationPassFlags;
 
 // Return a pointer to the MarkForCompilationPassFlags struct;
@@ -22,6 +22,7 @@ limitations under the License.
 #include <unordered_set>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
 #include "tensorflow/compiler/jit/deadness_analysis.h"
 #include "tensorflow/compiler/jit/defs.h"
 #include "tensorflow/compiler/jit/graphcycles/graphcycles.h"
@@ -34,6 +35,7 @@ limitations under the License.
 #include "tensorflow/compiler/tf2xla/xla_op_registry.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/core/common_runtime/function.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
 #include "tensorflow/core/framework/graph_def_util.h"
 #include "tensorflow/core/framework/memory_types.h"
 #include "tensorflow/core/framework/node_def.pb.h"
@@ -365,6 +367,201 @@ bool IsXlaFusable(const NodeDef& node) {
   return elementwise_ops->count(node.op()) > 0;
 }
 
+// The CPU clustering policy (--tf_xla_cpu_cost_based_clustering).
+//
+// Auto-clustering on CPU often makes models slower: XLA's code for large
+// contractions is no faster than Eigen's, and every cluster adds the overhead
+// of _XlaCompile and _XlaRun. The policy therefore only clusters element-wise
+// ops, reductions and small contractions on CPU, and only compiles a cluster
+// if a rough model estimates that it runs faster than the TensorFlow kernels
+// it replaces. The model counts a fixed overhead per kernel and per cluster
+// and the memory traffic of the intermediate tensors fusion avoids.
+
+// Executor overhead of running one TensorFlow kernel.
+const int64 kCpuTfOpOverheadNs = 1000;
+// Overhead of running a cluster: _XlaCompile's cache lookup and _XlaRun's
+// argument and result handling.
+const int64 kCpuXlaClusterOverheadNs = 10000;
+// Memory bandwidth available to a single op.
+const int64 kCpuBytesPerNs = 8;
+
+bool IsContractionOp(const Node& node) {
+  static const std::unordered_set<std::string>* contraction_ops =
+      new std::unordered_set<std::string>({"MatMul", "BatchMatMul", "Conv2D",
+                                           "Conv3D",
+                                           "DepthwiseConv2dNative"});
+  return contraction_ops->count(node.type_string()) > 0;
+}
+
+// Returns the number of elements of `shape`, or -1 if it is not known.
+int64 NumElements(shape_inference::InferenceContext* ic,
+                  shape_inference::ShapeHandle shape) {
+  if (!ic->FullyDefined(shape)) {
+    return -1;
+  }
+  int64 num_elements = 1;
+  for (int i = 0; i < ic->Rank(shape); ++i) {
+    num_elements *= ic->Value(ic->Dim(shape, i));
+  }
+  return num_elements;
+}
+
+// Returns the number of flops done by the contraction `node`, or -1 if the
+// shapes it works on are not known.
+int64 ContractionFlops(const Node& node, const ShapeRefiner& shapes) {
+  shape_inference::InferenceContext* ic = shapes.GetContext(&node);
+  if (ic == nullptr || ic->num_inputs() < 2 || ic->num_outputs() < 1) {
+    return -1;
+  }
+  shape_inference::ShapeHandle lhs = ic->input(0);
+  shape_inference::ShapeHandle rhs = ic->input(1);
+  int64 output_elements = NumElements(ic, ic->output(0));
+  if (output_elements < 0 || !ic->FullyDefined(lhs) ||
+      !ic->FullyDefined(rhs)) {
+    return -1;
+  }
+
+  // The number of multiply-adds computing each output element.
+  int64 reduction_size;
+  if (node.type_string() == "MatMul" || node.type_string() == "BatchMatMul") {
+    bool transposed = false;
+    const char* attr =
+        node.type_string() == "MatMul" ? "transpose_a" : "adj_x";
+    int rank = ic->Rank(lhs);
+    if (!GetNodeAttr(node.attrs(), attr, &transposed).ok() || rank < 2) {
+      return -1;
+    }
+    reduction_size = ic->Value(ic->Dim(lhs, transposed ? rank - 2 : rank - 1));
+  } else {
+    // The filter is [spatial dims..., input depth, output depth] and, for
+    // depthwise convolutions, the output depth is the product of the last two.
+    int rank = ic->Rank(rhs);
+    if (rank < 2) {
+      return -1;
+    }
+    int64 output_depth = ic->Value(ic->Dim(rhs, rank - 1));
+    if (node.type_string() == "DepthwiseConv2dNative") {
+      output_depth *= ic->Value(ic->Dim(rhs, rank - 2));
+    }
+    if (output_depth == 0) {
+      return 0;
+    }
+    reduction_size = NumElements(ic, rhs) / output_depth;
+  }
+  return 2 * output_elements * reduction_size;
+}
+
+// Returns the size in bytes of output `index` of `node`, or 0 if it is not
+// known.
+int64 OutputBytes(const Node& node, int index, const ShapeRefiner& shapes) {
+  shape_inference::InferenceContext* ic = shapes.GetContext(&node);
+  if (ic == nullptr || index >= ic->num_outputs()) {
+    return 0;
+  }
+  int64 num_elements = NumElements(ic, ic->output(index));
+  return num_elements < 0
+             ? 0
+             : num_elements * DataTypeSize(node.output_type(index));
+}
+
+// Infers the static shapes of the nodes of `graph`, as well as it can.
+std::unique_ptr<ShapeRefiner> InferShapesForCpuClustering(const Graph& graph) {
+  auto shapes = absl::make_unique<ShapeRefiner>(graph.versions(),
+                                                graph.op_registry());
+  shapes->set_require_shape_inference_fns(false);
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  for (Node* node : order) {
+    // Nodes in loops, and nodes without shape functions, fail, leaving their
+    // shapes (and those of the nodes they feed) unknown.
+    Status status = shapes->AddNode(node);
+    if (!status.ok()) {
+      VLOG(3) << "No static shapes for " << node->name() << ": " << status;
+    }
+  }
+  return shapes;
+}
+
+bool IsMarkedForCompilation(const Node& node,
+                            const FunctionLibraryDefinition& flib_def) {
+  bool compile = false;
+  if (GetNodeAttr(node.attrs(), kXlaCompileAttr, &compile).ok() ||
+      flib_def.GetAttr(node, kXlaCompileAttr, &compile).ok()) {
+    return compile;
+  }
+  return false;
+}
+
+// Removes from `candidates` the CPU nodes the CPU clustering policy leaves to
+// the TensorFlow kernels, unless they are explicitly marked for compilation.
+Status RemoveCpuPolicyRejectedCandidates(
+    const ShapeRefiner& shapes, const FunctionLibraryDefinition& flib_def,
+    int64 max_contraction_flops, OrderedNodeSet* candidates) {
+  for (auto it = candidates->begin(); it != candidates->end();) {
+    Node* node = *it;
+    DeviceType device_type("");
+    TF_RETURN_IF_ERROR(
+        DeviceToDeviceType(node->assigned_device_name(), &device_type));
+    bool keep = device_type != DEVICE_CPU ||
+                IsMarkedForCompilation(*node, flib_def);
+    if (!keep && IsContractionOp(*node)) {
+      int64 flops = ContractionFlops(*node, shapes);
+      keep = flops >= 0 && flops <= max_contraction_flops;
+      if (!keep) {
+        VLOG(2) << "CPU clustering policy: leaving " << node->name() << " ("
+                << node->type_string() << ", "
+                << (flops < 0 ? "unknown" : absl::StrCat(flops))
+                << " flops) to the TensorFlow kernel.";
+      }
+    } else if (!keep) {
+      keep = IsXlaFusable(node->def());
+      if (!keep) {
+        VLOG(2) << "CPU clustering policy: not clustering " << node->name()
+                << " (" << node->type_string()
+                << "): neither element-wise, a reduction nor a contraction.";
+      }
+    }
+    it = keep ? std::next(it) : candidates->erase(it);
+  }
+  return Status::OK();
+}
+
+// Estimated costs of running a CPU cluster with the TensorFlow kernels and as
+// an XLA computation.
+struct CpuClusterCost {
+  int num_ops = 0;
+  int64 tf_ns = 0;
+  int64 xla_ns = kCpuXlaClusterOverheadNs;
+
+  bool ShouldCompile() const { return xla_ns < tf_ns; }
+};
+
+// Adds the cost of `node`, in the cluster `cluster_of[node->id()]`, to `cost`.
+// Outputs that are only consumed within the cluster are not written to memory
+// by the XLA computation.
+void AddCpuNodeCost(const Node& node, const ShapeRefiner& shapes,
+                    const std::vector<int>& cluster_of, CpuClusterCost* cost) {
+  if (node.type_string() != "Identity") {
+    cost->num_ops++;
+    cost->tf_ns += kCpuTfOpOverheadNs;
+  }
+  std::vector<bool> consumed_outside(node.num_outputs(), false);
+  for (const Edge* e : node.out_edges()) {
+    if (!e->IsControlEdge() &&
+        cluster_of[e->dst()->id()] != cluster_of[node.id()]) {
+      consumed_outside[e->src_output()] = true;
+    }
+  }
+  for (int i = 0; i < node.num_outputs(); ++i) {
+    // Written once and read at least once.
+    int64 traffic_ns = 2 * OutputBytes(node, i, shapes) / kCpuBytesPerNs;
+    cost->tf_ns += traffic_ns;
+    if (consumed_outside[i]) {
+      cost->xla_ns += traffic_ns;
+    }
+  }
+}
+
 // Nodes that XLA can compile are put in `candidates`.  Nodes put in
 // `isolated_nodes` must either be unclustered or be put in trivial single-node
 // clusters.
@@ -662,6 +859,34 @@ static string RatioToString(int numerator, int denominator) {
                          (100.0 * numerator) / denominator);
 }
 
+// Returns the decisions of the CPU clustering policy, one line per cluster.
+static string CpuClusteringReport(
+    const Graph& g, const std::map<int, CpuClusterCost>& cpu_cluster_costs,
+    const std::vector<int>& effective_cluster_sizes,
+    const std::unordered_map<int, string>& cluster_names,
+    int min_cluster_size) {
+  string report = "*** CPU clustering policy decisions";
+  for (const auto& rep_cost_pair : cpu_cluster_costs) {
+    int rep = rep_cost_pair.first;
+    const CpuClusterCost& cost = rep_cost_pair.second;
+    auto name = cluster_names.find(rep);
+    string decision;
+    if (name != cluster_names.end()) {
+      decision = absl::StrCat("compiled as ", name->second);
+    } else if (effective_cluster_sizes[rep] < min_cluster_size) {
+      decision = "too small";
+    } else {
+      decision = "slower with XLA";
+    }
+    absl::StrAppendFormat(
+        &report, "\n  cluster of %s: %d ops, ~%dns with TensorFlow, ~%dns "
+        "with XLA: %s",
+        g.FindNodeId(rep)->name(), cost.num_ops, cost.tf_ns, cost.xla_ns,
+        decision);
+  }
+  return report;
+}
+
 static void VLogClusteringSummary(const Graph& g) {
   if (!VLOG_IS_ON(2)) {
     return;
@@ -856,6 +1081,19 @@ Status MarkForCompilationPass::RunImpl(
                                            : Env::Default(),
       is_compilable_fn, &compilation_candidates, &isolated_nodes));
 
+  legacy_flags::MarkForCompilationPassFlags* flags =
+      legacy_flags::GetMarkForCompilationPassFlags();
+
+  std::unique_ptr<ShapeRefiner> cpu_shapes;
+  if (flags->tf_xla_cpu_cost_based_clustering &&
+      !compilation_candidates.empty()) {
+    cpu_shapes = InferShapesForCpuClustering(*graph);
+    TF_RETURN_IF_ERROR(RemoveCpuPolicyRejectedCandidates(
+        *cpu_shapes, *options.flib_def,
+        flags->tf_xla_cpu_max_clustered_contraction_flops,
+        &compilation_candidates));
+  }
+
   if (compilation_candidates.empty()) {
     VLOG(2) << "No compilable candidates";
     return Status::OK();
@@ -879,8 +1117,6 @@ Status MarkForCompilationPass::RunImpl(
 
   OptimizerOptions::GlobalJitLevel global_jit_level =
       GetGlobalJitLevel(options);
-  legacy_flags::MarkForCompilationPassFlags* flags =
-      legacy_flags::GetMarkForCompilationPassFlags();
 
   // Repeatedly contract edges between clusters that are on the same device,
   // provided the contraction would not create a cycle.
@@ -979,6 +1215,25 @@ Status MarkForCompilationPass::RunImpl(
     }
   }
 
+  // Estimate the costs of the clusters placed on CPU for the CPU clustering
+  // policy, keyed by representative.
+  std::map<int, CpuClusterCost> cpu_cluster_costs;
+  if (cpu_shapes != nullptr) {
+    std::vector<int> cluster_of(graph->num_node_ids(), -1);
+    for (const Node* n : compilation_candidates) {
+      cluster_of[n->id()] = clusters[n->id()].Get().representative;
+    }
+    for (const Node* n : compilation_candidates) {
+      DeviceType device_type("");
+      TF_RETURN_IF_ERROR(
+          DeviceToDeviceType(n->assigned_device_name(), &device_type));
+      if (device_type == DEVICE_CPU) {
+        AddCpuNodeCost(*n, *cpu_shapes, cluster_of,
+                       &cpu_cluster_costs[cluster_of[n->id()]]);
+      }
+    }
+  }
+
   // Names for each cluster.
   std::unordered_map<int, string> cluster_names;
 
@@ -991,7 +1246,9 @@ Status MarkForCompilationPass::RunImpl(
   // * are placed on a device that requires compilation (an XlaDevice),
   // * are explicitly marked for compilation (_XlaCompile=true), or
   // * have more than flags->tf_xla_min_cluster_size elements (applicable only
-  //   if compilation is enabled, otherwise there will be no such candidates).
+  //   if compilation is enabled, otherwise there will be no such candidates),
+  //   and, with the CPU clustering policy, are estimated to be faster as XLA
+  //   computations when placed on CPU.
   const int min_cluster_size = flags->tf_xla_min_cluster_size;
   for (Node* n : compilation_candidates) {
     int cluster = clusters[n->id()].Get().representative;
@@ -1018,7 +1275,11 @@ Status MarkForCompilationPass::RunImpl(
     // Also, always compile if the operator is placed on a device that requires
     // compilation, or if it contains at least one op that is marked for
     // compilation that is not an Identity op.
-    if (effective_cluster_sizes[cluster] >= min_cluster_size ||
+    auto cpu_cost = cpu_cluster_costs.find(cluster);
+    bool beneficial = cpu_cost == cpu_cluster_costs.end() ||
+                      cpu_cost->second.ShouldCompile();
+    if ((effective_cluster_sizes[cluster] >= min_cluster_size &&
+         beneficial) ||
         (effective_cluster_sizes[cluster] > 0 && marked_for_compilation) ||
         registration->requires_compilation) {
       string& name = cluster_names[cluster];
@@ -1036,6 +1297,13 @@ Status MarkForCompilationPass::RunImpl(
                                 options.flib_def);
   }
 
+  if (!cpu_cluster_costs.empty() &&
+      (flags->tf_xla_clustering_debug || VLOG_IS_ON(2))) {
+    LOG(INFO) << CpuClusteringReport(*graph, cpu_cluster_costs,
+                                     effective_cluster_sizes, cluster_names,
+                                     min_cluster_size);
+  }
+
   VLogClusteringSummary(*graph);
 
   return Status::OK();
@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/sendrecv_ops.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/compiler/jit/defs.h"
+#include "tensorflow/compiler/jit/legacy_flags/mark_for_compilation_pass_flags.h"
 #include "tensorflow/compiler/tf2xla/xla_op_kernel.h"
 #include "tensorflow/compiler/tf2xla/xla_op_registry.h"
 #include "tensorflow/core/framework/node_def_util.h"
@@ -961,5 +962,89 @@ TEST(XlaCompilationTest, TensorArrayShapeOnXlaDevice) {
   EXPECT_EQ(clusters["test/read"], clusters["test/reshape"]);
 }
 
+// Turns on the CPU clustering policy for the lifetime of the object.
+class ScopedCpuCostBasedClustering {
+ public:
+  ScopedCpuCostBasedClustering()
+      : flags_(legacy_flags::GetMarkForCompilationPassFlags()),
+        saved_(flags_->tf_xla_cpu_cost_based_clustering) {
+    flags_->tf_xla_cpu_cost_based_clustering = true;
+  }
+  ~ScopedCpuCostBasedClustering() {
+    flags_->tf_xla_cpu_cost_based_clustering = saved_;
+  }
+
+ private:
+  legacy_flags::MarkForCompilationPassFlags* flags_;
+  bool saved_;
+};
+
+TEST(XlaCompilationTest, CpuPolicyLeavesLargeContractionsNative) {
+  ScopedCpuCostBasedClustering cpu_policy;
+  Scope root = Scope::NewRootScope().ExitOnError();
+  auto a = ops::Placeholder(root.WithOpName("A"), DT_FLOAT,
+                            ops::Placeholder::Shape({256, 256}));
+  auto b = ops::Placeholder(root.WithOpName("B"), DT_FLOAT,
+                            ops::Placeholder::Shape({256, 256}));
+  auto matmul = ops::MatMul(root.WithOpName("MatMul"), a, b);
+  auto relu = ops::Relu(root.WithOpName("Relu"), matmul);
+  auto tanh = ops::Tanh(root.WithOpName("Tanh"), relu);
+  ops::Sigmoid(root.WithOpName("Sigmoid"), tanh);
+  std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
+  TF_ASSERT_OK(root.ToGraph(graph.get()));
+
+  TF_ASSERT_OK(MarkForCompilationPassTestHelper::MarkForCompilation(&graph));
+  auto clusters = GetClusters(*graph);
+  EXPECT_EQ(3, clusters.size());
+  EXPECT_TRUE(clusters.find("MatMul") == clusters.cend());
+  EXPECT_EQ(clusters["Relu"], clusters["Tanh"]);
+  EXPECT_EQ(clusters["Relu"], clusters["Sigmoid"]);
+}
+
+TEST(XlaCompilationTest, CpuPolicyClustersSmallContractions) {
+  ScopedCpuCostBasedClustering cpu_policy;
+  Scope root = Scope::NewRootScope().ExitOnError();
+  auto a = ops::Placeholder(root.WithOpName("A"), DT_FLOAT,
+                            ops::Placeholder::Shape({4096, 1}));
+  auto b = ops::Placeholder(root.WithOpName("B"), DT_FLOAT,
+                            ops::Placeholder::Shape({1, 16}));
+  auto matmul = ops::MatMul(root.WithOpName("MatMul"), a, b);
+  auto relu = ops::Relu(root.WithOpName("Relu"), matmul);
+  ops::Tanh(root.WithOpName("Tanh"), relu);
+  std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
+  TF_ASSERT_OK(root.ToGraph(graph.get()));
+
+  TF_ASSERT_OK(MarkForCompilationPassTestHelper::MarkForCompilation(&graph));
+  auto clusters = GetClusters(*graph);
+  EXPECT_EQ(3, clusters.size());
+  EXPECT_EQ(clusters["MatMul"], clusters["Relu"]);
+  EXPECT_EQ(clusters["MatMul"], clusters["Tanh"]);
+}
+
+TEST(XlaCompilationTest, CpuPolicyRejectsUnprofitableClusters) {
+  ScopedCpuCostBasedClustering cpu_policy;
+  Scope root = Scope::NewRootScope().ExitOnError();
+  auto a = ops::Placeholder(root.WithOpName("A"), DT_FLOAT,
+                            ops::Placeholder::Shape({}));
+  auto relu = ops::Relu(root.WithOpName("Relu"), a);
+  auto tanh = ops::Tanh(root.WithOpName("Tanh"), relu);
+  ops::Sigmoid(root.WithOpName("Sigmoid"), tanh);
+  std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
+  TF_ASSERT_OK(root.ToGraph(graph.get()));
+
+  TF_ASSERT_OK(MarkForCompilationPassTestHelper::MarkForCompilation(&graph));
+  EXPECT_TRUE(GetClusters(*graph).empty());
+
+  // Explicitly marked nodes are still compiled.
+  for (Node* n : graph->op_nodes()) {
+    if (n->name() == "Tanh") {
+      n->AddAttr(kXlaCompileAttr, true);
+    }
+  }
+  TF_ASSERT_OK(MarkForCompilationPassTestHelper::MarkForCompilation(&graph));
+  auto clusters = GetClusters(*graph);
+  EXPECT_FALSE(clusters["Tanh"].empty());
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -61,6 +61,8 @@ REGISTER_OP("_XlaCompile")
     .Output("key: string")
     .Output("compilation_successful: bool")
     .Attr("function: func")
+    .Attr("must_compile: bool = true")
+    .Attr("leading_dim_buckets: list(int) = []")
     // The compilation cache is stateful.
     .SetIsStateful()
     .Doc(R"(XLA Compile Op. For use by the XLA JIT only.
@@ -72,7 +74,17 @@ key: A key that can be used to look up the local executable compiled by the
    node and associated metadata.
 
 compilation_successful: True iff the compilation was successful.  Always true
-for now.
+if must_compile is true.
+
+must_compile: If true, the op blocks until the function is compiled and fails
+   if compilation fails.  Otherwise new signatures are compiled in the
+   background, and compilation_successful is false until their compilation
+   succeeds.
+
+leading_dim_buckets: If not empty, the op compiles for the non-constant args
+   padded along their leading dimension to the smallest bucket that fits, if
+   they all share that dimension and padding cannot change the unpadded part
+   of the results; _XlaRun then pads the args and slices the results.
 )");
 
 REGISTER_OP("_XlaRun")
@@ -15,8 +15,10 @@ limitations under the License.
 
 #include "tensorflow/compiler/jit/xla_compilation_cache.h"
 
+#include <algorithm>
 #include <numeric>
 
+#include "absl/memory/memory.h"
 #include "tensorflow/compiler/tf2xla/dump_graph.h"
 #include "tensorflow/compiler/tf2xla/shape_util.h"
 #include "tensorflow/compiler/tf2xla/type_util.h"
@@ -31,16 +33,65 @@ limitations under the License.
 #include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/kernels/variable_ops.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/port.h"
 #include "tensorflow/core/public/version.h"
 
 namespace tensorflow {
 
+namespace {
+
+auto* xla_compilation_cache_requests = monitoring::Counter<2>::New(
+    "/tensorflow/compiler/jit/xla_compilation_cache/requests",
+    "The number of lookups of XLA cluster signatures in the compilation "
+    "cache, by cluster and result (hit or miss).",
+    "cluster", "result");
+
+auto* xla_compilation_cache_padded_requests = monitoring::Counter<1>::New(
+    "/tensorflow/compiler/jit/xla_compilation_cache/padded_requests",
+    "The number of lookups of XLA cluster signatures whose arguments are "
+    "padded to a shape bucket, by cluster.",
+    "cluster");
+
+auto* xla_compilations = monitoring::Counter<1>::New(
+    "/tensorflow/compiler/jit/xla_compilation_cache/compilations",
+    "The number of (re)compilations of XLA clusters, by cluster.", "cluster");
+
+// Records a lookup of a signature of the cluster `function_name`.
+void RecordRequest(const string& function_name, bool hit, int64 padded_dim0) {
+  xla_compilation_cache_requests->GetCell(function_name, hit ? "hit" : "miss")
+      ->IncrementBy(1);
+  if (padded_dim0 >= 0) {
+    xla_compilation_cache_padded_requests->GetCell(function_name)
+        ->IncrementBy(1);
+  }
+}
+
+// Returns the shape `input` is compiled for.
+TensorShape CompiledShape(const Tensor& input, int64 padded_dim0) {
+  TensorShape shape = input.shape();
+  if (padded_dim0 >= 0 && shape.dims() > 0) {
+    shape.set_dim(0, padded_dim0);
+  }
+  return shape;
+}
+
+}  // namespace
+
 XlaCompilationCache::XlaCompilationCache(xla::LocalClient* client,
                                          DeviceType device_type)
     : client_(client), device_type_(std::move(device_type)) {}
 XlaCompilationCache::~XlaCompilationCache() {
+  // Wait for the background compilations, which write to the cache entries.
+  std::unique_ptr<thread::ThreadPool> async_compile_threads;
+  {
+    mutex_lock lock(compile_cache_mu_);
+    async_compile_threads = std::move(async_compile_threads_);
+  }
+  async_compile_threads.reset();
+
   // Ensure any use of our programs have completed by waiting for all stream
   // executors to complete.
   for (auto* executor : client_->backend().stream_executors()) {
@@ -110,7 +161,7 @@ uint64 XlaCompilationCache::Signature::Hash::operator()(
 Status XlaCompilationCache::BuildSignature(
     const NameAttrList& function, const std::map<int, Tensor>& constant_args,
     const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
-    Signature* signature) {
+    int64 padded_dim0, Signature* signature) {
   signature->name = Canonicalize(function.name(), AttrSlice(&function.attr()));
   signature->arg_values.reserve(constant_args.size());
 
@@ -129,8 +180,8 @@ Status XlaCompilationCache::BuildSignature(
         signature->arg_types.emplace_back(DT_INVALID, TensorShape());
       }
     } else {
-      signature->arg_types.emplace_back(ctx->input_dtype(i),
-                                        ctx->input(i).shape());
+      signature->arg_types.emplace_back(
+          ctx->input_dtype(i), CompiledShape(ctx->input(i), padded_dim0));
     }
   }
   return Status::OK();
@@ -141,7 +192,7 @@ namespace {
 // Builds a XlaCompiler::Argument vector from the arguments to the XlaLaunch op.
 Status BuildArguments(const std::map<int, Tensor>& constant_args,
                       const std::map<int, OptionalTensor>& variable_args,
-                      OpKernelContext* ctx,
+                      OpKernelContext* ctx, int64 padded_dim0,
                       std::vector<XlaCompiler::Argument>* args) {
   args->resize(ctx->num_inputs());
 
@@ -159,14 +210,15 @@ Status BuildArguments(const std::map<int, Tensor>& constant_args,
       // Handles the non-constant arguments.
       const Tensor& input = ctx->input(input_num);
       TF_RET_CHECK(input.dtype() != DT_RESOURCE);
-      if (input.NumElements() > 0) {
+      const TensorShape shape = CompiledShape(input, padded_dim0);
+      if (shape.num_elements() > 0) {
         arg.kind = XlaCompiler::Argument::kParameter;
       } else {
         arg.kind = XlaCompiler::Argument::kConstant;
-        arg.constant_value = input;
+        arg.constant_value = Tensor(input.dtype(), shape);
       }
       arg.type = input.dtype();
-      arg.shape = input.shape();
+      arg.shape = shape;
     } else {
       // Handles resource variables.
       const Tensor& input = ctx->input(input_num);
@@ -224,15 +276,137 @@ Status XlaCompilationCache::BuildExecutable(
   return Status::OK();
 }
 
+void XlaCompilationCache::RecordCompileTime(const string& function_name,
+                                            uint64 compile_time_us) {
+  xla_compilations->GetCell(function_name)->IncrementBy(1);
+  mutex_lock lock(compile_stats_mu_);
+  auto it = compile_stats_.emplace(function_name, CompileStats{}).first;
+  it->second.compile_count++;
+  it->second.cumulative_compile_time_us += compile_time_us;
+  VLOG(1) << "compiled " << function_name << " " << it->second.compile_count
+          << " times, compile time: " << compile_time_us
+          << " us, cumulative: " << it->second.cumulative_compile_time_us
+          << " us ("
+          << tensorflow::strings::HumanReadableElapsedTime(compile_time_us /
+                                                           1.0e6)
+          << " / "
+          << tensorflow::strings::HumanReadableElapsedTime(
+                 it->second.cumulative_compile_time_us / 1.0e6)
+          << ")";
+}
+
 Status XlaCompilationCache::Compile(
     const XlaCompiler::Options& options, const NameAttrList& function,
     const std::map<int, Tensor>& constant_args,
     const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
     const XlaCompiler::CompilationResult** compilation_result,
     xla::LocalExecutable** executable,
-    const XlaCompiler::CompileOptions& compile_options) {
-  return CompileImpl(options, function, constant_args, variable_args, ctx,
-                     compilation_result, executable, compile_options, false);
+    const XlaCompiler::CompileOptions& compile_options,
+    CompileMode compile_mode, int64 padded_dim0) {
+  if (compile_mode == CompileMode::kStrict) {
+    return CompileImpl(options, function, constant_args, variable_args, ctx,
+                       compilation_result, executable, compile_options, false,
+                       padded_dim0);
+  }
+
+  CHECK_NE(executable, nullptr);
+  TF_RET_CHECK(constant_args.size() + variable_args.size() <=
+               ctx->num_inputs());
+  Signature signature;
+  TF_RETURN_IF_ERROR(BuildSignature(function, constant_args, variable_args,
+                                    ctx, padded_dim0, &signature));
+  Entry* entry;
+  {
+    mutex_lock lock(compile_cache_mu_);
+    std::unique_ptr<Entry>& e = cache_[signature];
+    if (!e) {
+      e.reset(new Entry);
+    }
+    entry = e.get();
+  }
+
+  *compilation_result = nullptr;
+  *executable = nullptr;
+  mutex_lock entry_lock(entry->mu);
+  RecordRequest(function.name(), entry->compiled, padded_dim0);
+  if (!entry->compiled) {
+    if (!entry->compiling) {
+      Status status = CompileAsync(
+          options, function, constant_args, variable_args, ctx,
+          compile_options, padded_dim0, SignatureDebugString(signature), entry);
+      entry->compiling = status.ok();
+      TF_RETURN_IF_ERROR(status);
+    }
+    return Status::OK();
+  }
+  if (entry->compilation_status.ok()) {
+    *compilation_result = &entry->compilation_result;
+    *executable = entry->executable.get();
+  }
+  return Status::OK();
+}
+
+Status XlaCompilationCache::CompileAsync(
+    const XlaCompiler::Options& options, const NameAttrList& function,
+    const std::map<int, Tensor>& constant_args,
+    const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
+    const XlaCompiler::CompileOptions& compile_options, int64 padded_dim0,
+    const string& signature_debug_string, Entry* entry) {
+  VLOG(2) << "Compiling signature in the background: "
+          << signature_debug_string;
+  // Everything the compilation reads is copied, since the kernel that
+  // requested it may be gone by the time it runs. The function library is
+  // copied for the same reason, and compilation allocates from the backend's
+  // allocator instead of the kernel's.
+  auto args = std::make_shared<std::vector<XlaCompiler::Argument>>();
+  TF_RETURN_IF_ERROR(BuildArguments(constant_args, variable_args, ctx,
+                                    padded_dim0, args.get()));
+  auto flib_def =
+      std::make_shared<FunctionLibraryDefinition>(*options.flib_def);
+  XlaCompiler::Options async_options = options;
+  async_options.flib_def = flib_def.get();
+  async_options.device_allocator = nullptr;
+
+  auto compile = [this, async_options, flib_def, function, args,
+                  compile_options, signature_debug_string, entry]() {
+    const uint64 compile_start_us = Env::Default()->NowMicros();
+    XlaCompiler::CompilationResult compilation_result;
+    std::unique_ptr<xla::LocalExecutable> executable;
+    XlaCompiler compiler(async_options);
+    Status status = compiler.CompileFunction(compile_options, function, *args,
+                                             &compilation_result);
+    if (status.ok()) {
+      status =
+          BuildExecutable(async_options, compilation_result, &executable);
+    }
+    RecordCompileTime(function.name(),
+                      Env::Default()->NowMicros() - compile_start_us);
+    if (!status.ok()) {
+      LOG(WARNING) << "Background compilation failed; the cluster keeps "
+                      "running uncompiled for signature "
+                   << signature_debug_string << ": " << status;
+    }
+
+    mutex_lock entry_lock(entry->mu);
+    entry->compiling = false;
+    if (entry->compiled) {
+      // Compiled synchronously in the meantime.
+      return;
+    }
+    entry->compiled = true;
+    entry->compilation_status = status;
+    entry->compilation_result = std::move(compilation_result);
+    entry->executable = std::move(executable);
+  };
+
+  mutex_lock lock(compile_cache_mu_);
+  if (!async_compile_threads_) {
+    async_compile_threads_ = absl::make_unique<thread::ThreadPool>(
+        Env::Default(), "xla_async_compile",
+        std::max(1, port::NumSchedulableCPUs() / 4));
+  }
+  async_compile_threads_->Schedule(std::move(compile));
+  return Status::OK();
 }
 
 Status XlaCompilationCache::CompileSingleOp(
@@ -247,7 +421,8 @@ Status XlaCompilationCache::CompileSingleOp(
   name.set_name(def.op());
   *name.mutable_attr() = def.attr();
   return CompileImpl(options, name, constant_args, variable_args, ctx,
-                     compilation_result, executable, compile_options, true);
+                     compilation_result, executable, compile_options, true,
+                     /*padded_dim0=*/-1);
 }
 
 Status XlaCompilationCache::CompileImpl(
@@ -256,8 +431,8 @@ Status XlaCompilationCache::CompileImpl(
     const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
     const XlaCompiler::CompilationResult** compilation_result,
     xla::LocalExecutable** executable,
-    const XlaCompiler::CompileOptions& compile_options,
-    bool compile_single_op) {
+    const XlaCompiler::CompileOptions& compile_options, bool compile_single_op,
+    int64 padded_dim0) {
   CHECK_NE(executable, nullptr);
   VLOG(2) << "XlaCompilationCache::Compile " << DebugString();
 
@@ -288,8 +463,8 @@ Status XlaCompilationCache::CompileImpl(
                ctx->num_inputs());
 
   Signature signature;
-  TF_RETURN_IF_ERROR(
-      BuildSignature(function, constant_args, variable_args, ctx, &signature));
+  TF_RETURN_IF_ERROR(BuildSignature(function, constant_args, variable_args,
+                                    ctx, padded_dim0, &signature));
 
   VLOG(2) << "Signature: " << SignatureDebugString(signature);
   // The outer lock protects the existence of the cache entry. It does not
@@ -309,6 +484,7 @@ Status XlaCompilationCache::CompileImpl(
   // TODO(phawkins): this locking will need to be restructured when we implement
   // cache eviction.
   mutex_lock entry_lock(entry->mu);
+  RecordRequest(function.name(), entry->compiled, padded_dim0);
   if (!entry->compiled) {
     VLOG(2) << "Compilation cache miss for signature: "
             << SignatureDebugString(signature);
@@ -317,8 +493,8 @@ Status XlaCompilationCache::CompileImpl(
     // Do the actual JIT compilation without holding the lock (it can take
     // a long time.)
     std::vector<XlaCompiler::Argument> args;
-    TF_RETURN_IF_ERROR(
-        BuildArguments(constant_args, variable_args, ctx, &args));
+    TF_RETURN_IF_ERROR(BuildArguments(constant_args, variable_args, ctx,
+                                      padded_dim0, &args));
 
     XlaCompiler compiler(options);
     entry->compiled = true;
@@ -337,24 +513,7 @@ Status XlaCompilationCache::CompileImpl(
         BuildExecutable(options, entry->compilation_result, &entry->executable);
 
     const uint64 compile_end_us = env->NowMicros();
-    const uint64 compile_time_us = compile_end_us - compile_start_us;
-    {
-      mutex_lock lock(compile_stats_mu_);
-      auto it = compile_stats_.emplace(function.name(), CompileStats{}).first;
-      it->second.compile_count++;
-      it->second.cumulative_compile_time_us += compile_time_us;
-      VLOG(1) << "compiled " << function.name() << " "
-              << it->second.compile_count
-              << " times, compile time: " << compile_time_us
-              << " us, cumulative: " << it->second.cumulative_compile_time_us
-              << " us ("
-              << tensorflow::strings::HumanReadableElapsedTime(compile_time_us /
-                                                               1.0e6)
-              << " / "
-              << tensorflow::strings::HumanReadableElapsedTime(
-                     it->second.cumulative_compile_time_us / 1.0e6)
-              << ")";
-    }
+    RecordCompileTime(function.name(), compile_end_us - compile_start_us);
   }
   TF_RETURN_IF_ERROR(entry->compilation_status);
   *compilation_result = &entry->compilation_result;
@@ -50,6 +50,14 @@ class XlaCompilationCache : public ResourceBase {
   XlaCompilationCache(xla::LocalClient* client, DeviceType device_type);
   ~XlaCompilationCache() override;
 
+  enum class CompileMode {
+    // Compiles new signatures before returning.
+    kStrict,
+    // Compiles new signatures on a background thread, and returns without
+    // a compilation result until that compilation succeeds.
+    kAsync,
+  };
+
   // Compiles a function into a XlaCompiler::CompilationResult that can be used
   // to execute an XLA Computation. Compilation results are cached.
   // `function` is the name of a Tensorflow function to compile.
@@ -63,6 +71,11 @@ class XlaCompilationCache : public ResourceBase {
   // xla::LocalExecutable and sets `executable` to point to it. The resulting
   // executable pointer may be null if the computation has no non-constant
   // outputs.
+  // In CompileMode::kAsync, `*compilation_result` and `*executable` are set to
+  // null while the signature is being compiled, and if its compilation failed.
+  // If `padded_dim0` is not -1, compiles for non-constant, non-resource
+  // arguments whose leading dimension is `padded_dim0` instead of that of the
+  // inputs of `ctx` (see xla_shape_bucketing.h).
   Status Compile(const XlaCompiler::Options& options,
                  const NameAttrList& function,
                  const std::map<int, Tensor>& constant_args,
@@ -70,7 +83,9 @@ class XlaCompilationCache : public ResourceBase {
                  OpKernelContext* ctx,
                  const XlaCompiler::CompilationResult** compilation_result,
                  xla::LocalExecutable** executable,
-                 const XlaCompiler::CompileOptions& compile_options);
+                 const XlaCompiler::CompileOptions& compile_options,
+                 CompileMode compile_mode = CompileMode::kStrict,
+                 int64 padded_dim0 = -1);
 
   // As above, but calls XlaCompiler::CompileSingleOp instead of
   // XlaCompiler::CompileFunction.
@@ -97,7 +112,11 @@ class XlaCompilationCache : public ResourceBase {
                      const XlaCompiler::CompilationResult** compilation_result,
                      xla::LocalExecutable** executable,
                      const XlaCompiler::CompileOptions& compile_options,
-                     bool compile_single_op);
+                     bool compile_single_op, int64 padded_dim0);
+
+  // Adds a compilation of `function_name` taking `compile_time_us` to the
+  // compilation statistics.
+  void RecordCompileTime(const string& function_name, uint64 compile_time_us);
 
   // Takes `result` which has been compiled from a Tensorflow subgraph to a
   // XLA computation already, and generates an XLA LocalExecutable `executable`.
@@ -131,7 +150,8 @@ class XlaCompilationCache : public ResourceBase {
   Status BuildSignature(const NameAttrList& function,
                         const std::map<int, Tensor>& constant_args,
                         const std::map<int, OptionalTensor>& variable_args,
-                        OpKernelContext* ctx, Signature* signature);
+                        OpKernelContext* ctx, int64 padded_dim0,
+                        Signature* signature);
 
   // The value associated with a cache entry.
   struct Entry {
@@ -140,6 +160,9 @@ class XlaCompilationCache : public ResourceBase {
     // Have we tried compiling this entry?
     bool compiled = false;
 
+    // Is this entry being compiled in the background?
+    bool compiling GUARDED_BY(mu) = false;
+
     // Did compilation succeed?
     Status compilation_status GUARDED_BY(mu);
 
@@ -151,10 +174,26 @@ class XlaCompilationCache : public ResourceBase {
     std::unique_ptr<xla::LocalExecutable> executable GUARDED_BY(mu);
   };
 
+  // Schedules the compilation of `entry`, whose signature is described by
+  // `signature_debug_string`, on the background compilation threads.
+  Status CompileAsync(const XlaCompiler::Options& options,
+                      const NameAttrList& function,
+                      const std::map<int, Tensor>& constant_args,
+                      const std::map<int, OptionalTensor>& variable_args,
+                      OpKernelContext* ctx,
+                      const XlaCompiler::CompileOptions& compile_options,
+                      int64 padded_dim0, const string& signature_debug_string,
+                      Entry* entry);
+
   mutex compile_cache_mu_;
   absl::flat_hash_map<Signature, std::unique_ptr<Entry>, Signature::Hash> cache_
       GUARDED_BY(compile_cache_mu_);
 
+  // Threads compiling in the background, created on first use. The destructor
+  // waits for the pending compilations before destroying anything else.
+  std::unique_ptr<thread::ThreadPool> async_compile_threads_
+      GUARDED_BY(compile_cache_mu_);
+
   struct CompileStats {
     // Number of times the cluster has been (re-)compiled.
     int64 compile_count = 0;
@@ -135,7 +135,8 @@ XlaComputationLaunchContext::XlaComputationLaunchContext(
 void XlaComputationLaunchContext::PopulateInputs(
     OpKernelContext* ctx, const XlaCompiler::CompilationResult* kernel,
     const std::map<int, OptionalTensor>& variables,
-    int missing_ctx_input_prefix) {
+    int missing_ctx_input_prefix,
+    const std::map<int, Tensor>* input_overrides) {
   se::Stream* stream =
       ctx->op_device_context() ? ctx->op_device_context()->stream() : nullptr;
   // Build ShapedBuffers that point directly to the Tensor buffers.
@@ -152,6 +153,8 @@ void XlaComputationLaunchContext::PopulateInputs(
     if (variables.count(arg_num)) {
       t = &(variables.at(arg_num).value);
       CHECK(t);
+    } else if (input_overrides && input_overrides->count(arg_num)) {
+      t = &input_overrides->at(arg_num);
     } else {
       t = &(ctx->input(arg_num - missing_ctx_input_prefix));
     }
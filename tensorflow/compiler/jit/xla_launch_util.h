@@ -94,10 +94,13 @@ class XlaComputationLaunchContext {
   // missing and adjusts input indices accordingly.  All elements in kernel's
   // input_mapping must be greater than or equal to `missing_ctx_input_prefix`
   // (in other words, no inputs actually required by the kernel can be missing).
-  void PopulateInputs(OpKernelContext* ctx,
-                      const XlaCompiler::CompilationResult* kernel,
-                      const std::map<int, OptionalTensor>& variables,
-                      int missing_ctx_input_prefix);
+  // If non-null, `input_overrides` maps TensorFlow argument numbers to tensors
+  // passed instead of the inputs of `ctx`.
+  void PopulateInputs(
+      OpKernelContext* ctx, const XlaCompiler::CompilationResult* kernel,
+      const std::map<int, OptionalTensor>& variables,
+      int missing_ctx_input_prefix,
+      const std::map<int, Tensor>* input_overrides = nullptr);
 
   // Given the XLA output in `output`, populate all outputs of `ctx`.
   //
@@ -0,0 +1,317 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/jit/xla_shape_bucketing.h"
+
+#include <algorithm>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/service/hlo_computation.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
+#include "tensorflow/compiler/xla/service/hlo_opcode.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/status_macros.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+
+namespace {
+
+// The padded dimension of values that do not depend on the padded rows.
+constexpr int64 kNotPadded = -1;
+
+// Returns the dimension of `dot` an operand dimension maps to, or nullopt if
+// the dimension is contracted.
+absl::optional<int64> DotOutputDimension(const xla::HloInstruction& dot,
+                                         int64 operand, int64 dim) {
+  const xla::DotDimensionNumbers& dnums = dot.dot_dimension_numbers();
+  const auto& batch = operand == 0 ? dnums.lhs_batch_dimensions()
+                                   : dnums.rhs_batch_dimensions();
+  const auto& contracting = operand == 0 ? dnums.lhs_contracting_dimensions()
+                                         : dnums.rhs_contracting_dimensions();
+  auto batch_it = absl::c_find(batch, dim);
+  if (batch_it != batch.end()) {
+    return batch_it - batch.begin();
+  }
+  if (absl::c_linear_search(contracting, dim)) {
+    return absl::nullopt;
+  }
+  // The output has the batch dimensions, then the free dimensions of the lhs,
+  // then those of the rhs.
+  auto is_free = [&](int64 d) {
+    return !absl::c_linear_search(batch, d) &&
+           !absl::c_linear_search(contracting, d);
+  };
+  int64 output_dim = batch.size();
+  if (operand == 1) {
+    output_dim += xla::ShapeUtil::Rank(dot.operand(0)->shape()) -
+                  dnums.lhs_batch_dimensions_size() -
+                  dnums.lhs_contracting_dimensions_size();
+  }
+  for (int64 d = 0; d < dim; ++d) {
+    output_dim += is_free(d);
+  }
+  return output_dim;
+}
+
+// Returns the dimension of the result of `instruction` carrying the padded
+// rows, given that of its operands (kNotPadded for operands that do not
+// depend on the padded rows).
+xla::StatusOr<int64> PaddedDimension(const xla::HloInstruction& instruction,
+                                     const std::vector<int64>& operand_dims) {
+  auto first_padded = absl::c_find_if(
+      operand_dims, [](int64 dim) { return dim != kNotPadded; });
+  if (first_padded == operand_dims.end()) {
+    return kNotPadded;
+  }
+  const int64 padded_operand = first_padded - operand_dims.begin();
+  const int64 d = *first_padded;
+  auto only_operand_padded = [&](int64 operand) {
+    for (int64 i = 0; i < operand_dims.size(); ++i) {
+      if (i != operand && operand_dims[i] != kNotPadded) return false;
+    }
+    return padded_operand == operand;
+  };
+  auto unsupported = [&]() {
+    return errors::Unimplemented(
+        "Padding the leading dimension of the arguments changes the result "
+        "of ",
+        instruction.ToString());
+  };
+
+  if (instruction.IsElementwise()) {
+    for (int64 operand_dim : operand_dims) {
+      if (operand_dim != kNotPadded && operand_dim != d) return unsupported();
+    }
+    return d;
+  }
+
+  switch (instruction.opcode()) {
+    case xla::HloOpcode::kBroadcast:
+      return instruction.dimensions(d);
+    case xla::HloOpcode::kTranspose:
+      return absl::c_find(instruction.dimensions(), d) -
+             instruction.dimensions().begin();
+    case xla::HloOpcode::kReshape:
+      // Only reshapes of the dimensions after the leading one keep the rows.
+      if (d == 0 && xla::ShapeUtil::Rank(instruction.shape()) > 0 &&
+          instruction.shape().dimensions(0) ==
+              instruction.operand(0)->shape().dimensions(0)) {
+        return d;
+      }
+      return unsupported();
+    case xla::HloOpcode::kReverse:
+      if (absl::c_linear_search(instruction.dimensions(), d)) {
+        return unsupported();
+      }
+      return d;
+    case xla::HloOpcode::kSlice:
+      if (instruction.slice_starts(d) != 0 ||
+          instruction.slice_strides(d) != 1 ||
+          instruction.slice_limits(d) !=
+              instruction.operand(0)->shape().dimensions(d)) {
+        return unsupported();
+      }
+      return d;
+    case xla::HloOpcode::kPad: {
+      const auto& padding = instruction.padding_config().dimensions(d);
+      if (!only_operand_padded(0) || padding.edge_padding_low() != 0 ||
+          padding.edge_padding_high() != 0 || padding.interior_padding() != 0) {
+        return unsupported();
+      }
+      return d;
+    }
+    case xla::HloOpcode::kConcatenate:
+      for (int64 operand_dim : operand_dims) {
+        if (operand_dim != kNotPadded && operand_dim != d) return unsupported();
+      }
+      if (instruction.concatenate_dimension() == d) return unsupported();
+      return d;
+    case xla::HloOpcode::kReduce: {
+      if (instruction.operand_count() != 2 || !only_operand_padded(0) ||
+          absl::c_linear_search(instruction.dimensions(), d)) {
+        return unsupported();
+      }
+      return d - absl::c_count_if(instruction.dimensions(),
+                                  [d](int64 reduced) { return reduced < d; });
+    }
+    case xla::HloOpcode::kReduceWindow: {
+      const xla::WindowDimension& window = instruction.window().dimensions(d);
+      if (!only_operand_padded(0) || window.size() != 1 ||
+          window.stride() != 1 || window.padding_low() != 0 ||
+          window.padding_high() != 0 || window.window_dilation() != 1 ||
+          window.base_dilation() != 1) {
+        return unsupported();
+      }
+      return d;
+    }
+    case xla::HloOpcode::kDot: {
+      absl::optional<int64> output_dim = kNotPadded;
+      for (int64 operand = 0; operand < 2; ++operand) {
+        if (operand_dims[operand] == kNotPadded) continue;
+        absl::optional<int64> dim =
+            DotOutputDimension(instruction, operand, operand_dims[operand]);
+        if (!dim.has_value() ||
+            (*output_dim != kNotPadded && *output_dim != *dim)) {
+          return unsupported();
+        }
+        output_dim = dim;
+      }
+      return *output_dim;
+    }
+    case xla::HloOpcode::kConvolution: {
+      const xla::ConvolutionDimensionNumbers& dnums =
+          instruction.convolution_dimension_numbers();
+      if (!only_operand_padded(0) || d != dnums.input_batch_dimension()) {
+        return unsupported();
+      }
+      return dnums.output_batch_dimension();
+    }
+    case xla::HloOpcode::kBatchNormInference:
+      if (!only_operand_padded(0) || d == instruction.feature_index()) {
+        return unsupported();
+      }
+      return d;
+    default:
+      return unsupported();
+  }
+}
+
+}  // namespace
+
+int64 ShapeBucket(absl::Span<const int64> buckets, int64 size) {
+  int64 bucket = -1;
+  for (int64 b : buckets) {
+    if (b >= size && (bucket == -1 || b < bucket)) {
+      bucket = b;
+    }
+  }
+  return bucket;
+}
+
+bool FunctionReadsInputShapes(const FunctionLibraryDefinition& flib_def,
+                              const string& function_name) {
+  static const std::set<string>* const kShapeOps = new std::set<string>{
+      "BroadcastArgs", "BroadcastGradientArgs", "Shape", "ShapeN", "Size"};
+  std::vector<string> pending = {function_name};
+  std::set<string> visited;
+  while (!pending.empty()) {
+    const string name = pending.back();
+    pending.pop_back();
+    if (!visited.insert(name).second) continue;
+    const FunctionDef* fdef = flib_def.Find(name);
+    if (fdef == nullptr) continue;
+    for (const NodeDef& node : fdef->node_def()) {
+      if (kShapeOps->count(node.op()) > 0) {
+        return true;
+      }
+      // Function calls, and functions passed to functional ops.
+      pending.push_back(node.op());
+      for (const auto& attr : node.attr()) {
+        if (attr.second.has_func()) {
+          pending.push_back(attr.second.func().name());
+        }
+      }
+    }
+  }
+  return false;
+}
+
+Status AnalyzeLeadingDimPadding(const xla::HloModule& module,
+                                const std::set<int64>& padded_parameters,
+                                std::vector<bool>* padded_results) {
+  const xla::HloComputation* entry = module.entry_computation();
+  const xla::HloInstruction* root = entry->root_instruction();
+  absl::flat_hash_map<const xla::HloInstruction*, int64> padded_dims;
+  for (const xla::HloInstruction* instruction :
+       entry->MakeInstructionPostOrder()) {
+    if (instruction->opcode() == xla::HloOpcode::kParameter) {
+      padded_dims[instruction] =
+          padded_parameters.count(instruction->parameter_number()) > 0
+              ? 0
+              : kNotPadded;
+      continue;
+    }
+    if (instruction == root &&
+        instruction->opcode() == xla::HloOpcode::kTuple) {
+      continue;
+    }
+    std::vector<int64> operand_dims;
+    for (const xla::HloInstruction* operand : instruction->operands()) {
+      operand_dims.push_back(padded_dims.at(operand));
+    }
+    TF_ASSIGN_OR_RETURN(padded_dims[instruction],
+                        PaddedDimension(*instruction, operand_dims));
+  }
+
+  std::vector<const xla::HloInstruction*> results;
+  if (root->opcode() == xla::HloOpcode::kTuple) {
+    results.assign(root->operands().begin(), root->operands().end());
+  } else {
+    results.push_back(root);
+  }
+  padded_results->clear();
+  for (const xla::HloInstruction* result : results) {
+    const int64 dim = padded_dims.at(result);
+    if (dim != kNotPadded && dim != 0) {
+      return errors::Unimplemented("The rows of ", result->ToString(),
+                                   " are along dimension ", dim);
+    }
+    padded_results->push_back(dim == 0);
+  }
+  return Status::OK();
+}
+
+Status AnalyzeLeadingDimPadding(const XlaCompiler::CompilationResult& result,
+                                const std::set<int>& padded_args,
+                                std::vector<bool>* padded_outputs) {
+  TF_RET_CHECK(result.computation != nullptr);
+  const xla::HloModuleProto& proto = result.computation->proto();
+  TF_ASSIGN_OR_RETURN(
+      xla::HloModuleConfig config,
+      xla::HloModule::CreateModuleConfigFromProto(proto, xla::DebugOptions()));
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<xla::HloModule> module,
+                      xla::HloModule::CreateFromProto(proto, config));
+
+  std::set<int64> padded_parameters;
+  for (int i = 0; i < result.input_mapping.size(); ++i) {
+    if (padded_args.count(result.input_mapping[i]) > 0) {
+      padded_parameters.insert(i);
+    }
+  }
+  std::vector<bool> padded_results;
+  TF_RETURN_IF_ERROR(
+      AnalyzeLeadingDimPadding(*module, padded_parameters, &padded_results));
+
+  // The results are the non-constant outputs, then the resource updates.
+  padded_outputs->assign(result.outputs.size(), false);
+  int next_result = 0;
+  for (int i = 0; i < result.outputs.size(); ++i) {
+    if (result.outputs[i].is_constant) continue;
+    TF_RET_CHECK(next_result < padded_results.size());
+    (*padded_outputs)[i] = padded_results[next_result++];
+  }
+  for (; next_result < padded_results.size(); ++next_result) {
+    if (padded_results[next_result]) {
+      return errors::Unimplemented(
+          "A resource update depends on the padded arguments");
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,68 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Contains utilities for padding the leading dimension of the arguments of
+// XLA clusters up to one of a fixed set of sizes (shape buckets), so that
+// clusters fed inputs of variable length compile one computation per bucket
+// instead of one per length.
+
+#ifndef TENSORFLOW_COMPILER_JIT_XLA_SHAPE_BUCKETING_H_
+#define TENSORFLOW_COMPILER_JIT_XLA_SHAPE_BUCKETING_H_
+
+#include <set>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_compiler.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+
+// Returns the smallest of `buckets` that is at least `size`, or -1 if there is
+// none.
+int64 ShapeBucket(absl::Span<const int64> buckets, int64 size);
+
+// Returns true if the function `function_name` in `flib_def`, or a function it
+// calls, reads the shapes of its inputs as values (e.g. with a Shape op).
+// Compiled for a bucket, such a function would read the padded shapes.
+bool FunctionReadsInputShapes(const FunctionLibraryDefinition& flib_def,
+                              const string& function_name);
+
+// Checks that padding the leading dimension of the parameters
+// `padded_parameters` of `module` with rows of zeros leaves the other rows of
+// the results of its entry computation unchanged, i.e. that each row of the
+// results only depends on the same row of the padded parameters. For each
+// element of the result (the result itself if it is not a tuple), sets
+// `(*padded_results)[i]` to whether its leading dimension is the padded one;
+// the other elements do not depend on the padded parameters.
+//
+// Returns Unimplemented if the rows are mixed, or if the module contains an
+// operation on the padded rows that the analysis does not model.
+Status AnalyzeLeadingDimPadding(const xla::HloModule& module,
+                                const std::set<int64>& padded_parameters,
+                                std::vector<bool>* padded_results);
+
+// As above, for the computation of `result` with the arguments `padded_args`
+// padded. Sets `(*padded_outputs)[i]` for each output of `result`. Resource
+// updates must not depend on the padded arguments.
+Status AnalyzeLeadingDimPadding(const XlaCompiler::CompilationResult& result,
+                                const std::set<int>& padded_args,
+                                std::vector<bool>* padded_outputs);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMPILER_JIT_XLA_SHAPE_BUCKETING_H_
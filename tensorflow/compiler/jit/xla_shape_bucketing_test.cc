@@ -0,0 +1,141 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/jit/xla_shape_bucketing.h"
+
+#include "tensorflow/compiler/xla/service/hlo_parser.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Analyzes the HLO module `hlo` with its parameter 0 padded.
+Status Analyze(const string& hlo, std::vector<bool>* padded_results) {
+  auto module = xla::ParseHloString(hlo);
+  TF_RETURN_IF_ERROR(module.status());
+  return AnalyzeLeadingDimPadding(*module.ValueOrDie(), {0}, padded_results);
+}
+
+TEST(XlaShapeBucketingTest, ShapeBucket) {
+  const std::vector<int64> buckets = {32, 8, 16};
+  EXPECT_EQ(8, ShapeBucket(buckets, 5));
+  EXPECT_EQ(8, ShapeBucket(buckets, 8));
+  EXPECT_EQ(32, ShapeBucket(buckets, 17));
+  EXPECT_EQ(-1, ShapeBucket(buckets, 33));
+  EXPECT_EQ(-1, ShapeBucket({}, 1));
+}
+
+TEST(XlaShapeBucketingTest, FunctionReadsInputShapes) {
+  FunctionDefLibrary library;
+  *library.add_function() = FunctionDefHelper::Define(
+      "ReadsShape", {"x: float"}, {"y: int32"}, {},
+      {{{"y"}, "Shape", {"x"}, {{"T", DT_FLOAT}, {"out_type", DT_INT32}}}});
+  *library.add_function() = FunctionDefHelper::Define(
+      "CallsReadsShape", {"x: float"}, {"y: int32"}, {},
+      {{{"y"}, "ReadsShape", {"x"}}});
+  *library.add_function() = test::function::XTimesTwo();
+  FunctionLibraryDefinition flib_def(OpRegistry::Global(), library);
+
+  EXPECT_TRUE(FunctionReadsInputShapes(flib_def, "ReadsShape"));
+  EXPECT_TRUE(FunctionReadsInputShapes(flib_def, "CallsReadsShape"));
+  EXPECT_FALSE(FunctionReadsInputShapes(flib_def, "XTimesTwo"));
+}
+
+TEST(XlaShapeBucketingTest, RowWiseComputationsArePaddable) {
+  std::vector<bool> padded_results;
+  TF_ASSERT_OK(Analyze(R"(
+HloModule dense
+
+ENTRY main {
+  x = f32[8,4] parameter(0)
+  w = f32[4,3] parameter(1)
+  b = f32[3] parameter(2)
+  dot = f32[8,3] dot(x, w), lhs_contracting_dims={1}, rhs_contracting_dims={0}
+  bias = f32[8,3] broadcast(b), dimensions={1}
+  add = f32[8,3] add(dot, bias)
+  zero = f32[] constant(0)
+  zeros = f32[8,3] broadcast(zero), dimensions={}
+  relu = f32[8,3] maximum(add, zeros)
+  ROOT result = (f32[8,3], f32[3]) tuple(relu, b)
+}
+)",
+                       &padded_results));
+  EXPECT_EQ(std::vector<bool>({true, false}), padded_results);
+
+  TF_ASSERT_OK(Analyze(R"(
+HloModule row_sum
+
+add {
+  a = f32[] parameter(0)
+  b = f32[] parameter(1)
+  ROOT sum = f32[] add(a, b)
+}
+
+ENTRY main {
+  x = f32[8,4] parameter(0)
+  zero = f32[] constant(0)
+  ROOT sum = f32[8] reduce(x, zero), dimensions={1}, to_apply=add
+}
+)",
+                       &padded_results));
+  EXPECT_EQ(std::vector<bool>({true}), padded_results);
+}
+
+TEST(XlaShapeBucketingTest, MixingRowsIsNotPaddable) {
+  std::vector<bool> padded_results;
+  EXPECT_TRUE(errors::IsUnimplemented(Analyze(R"(
+HloModule column_sum
+
+add {
+  a = f32[] parameter(0)
+  b = f32[] parameter(1)
+  ROOT sum = f32[] add(a, b)
+}
+
+ENTRY main {
+  x = f32[8,4] parameter(0)
+  zero = f32[] constant(0)
+  ROOT sum = f32[4] reduce(x, zero), dimensions={0}, to_apply=add
+}
+)",
+                                              &padded_results)));
+
+  EXPECT_TRUE(errors::IsUnimplemented(Analyze(R"(
+HloModule first_rows
+
+ENTRY main {
+  x = f32[8,4] parameter(0)
+  ROOT rows = f32[4,4] slice(x), slice={[0:4], [0:4]}
+}
+)",
+                                              &padded_results)));
+
+  // The rows end up along another dimension of the result.
+  EXPECT_TRUE(errors::IsUnimplemented(Analyze(R"(
+HloModule transposed
+
+ENTRY main {
+  x = f32[8,4] parameter(0)
+  ROOT t = f32[4,8] transpose(x), dimensions={1,0}
+}
+)",
+                                              &padded_results)));
+}
+
+}  // namespace
+}  // namespace tensorflow
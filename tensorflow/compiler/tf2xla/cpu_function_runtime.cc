@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/compiler/tf2xla/cpu_function_runtime.h"
 
+#include <cstring>
+
 #include "tensorflow/core/platform/dynamic_annotations.h"
 
 namespace tensorflow {
@@ -52,6 +54,44 @@ void aligned_free(void* aligned_memory) {
 size_t align_to(size_t n, size_t align) {
   return (((n - 1) / align) + 1) * align;
 }
+
+// The x86 features HostSupportsTargetFeatures checks, spelled as in LLVM
+// target features.
+#define TF_FOR_EACH_HOST_CHECKABLE_FEATURE(X) \
+  X("sse2")                                   \
+  X("sse3")                                   \
+  X("ssse3")                                  \
+  X("sse4.1")                                 \
+  X("sse4.2")                                 \
+  X("popcnt")                                 \
+  X("avx")                                    \
+  X("avx2")                                   \
+  X("fma")                                    \
+  X("bmi")                                    \
+  X("bmi2")                                   \
+  X("avx512f")                                \
+  X("avx512cd")                               \
+  X("avx512vl")                               \
+  X("avx512bw")                               \
+  X("avx512dq")
+
+// Returns true iff the host CPU supports the feature named by the `length`
+// characters at `feature`, spelled as in LLVM target features.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+bool HostSupportsFeature(const char* feature, size_t length) {
+  __builtin_cpu_init();
+  // __builtin_cpu_supports only accepts string literals.
+#define TF_TEST_CPU_FEATURE(name)                                          \
+  if (length == sizeof(name) - 1 && strncmp(feature, name, length) == 0) { \
+    return __builtin_cpu_supports(name);                                   \
+  }
+  TF_FOR_EACH_HOST_CHECKABLE_FEATURE(TF_TEST_CPU_FEATURE)
+#undef TF_TEST_CPU_FEATURE
+  return false;
+}
+#else
+bool HostSupportsFeature(const char* feature, size_t length) { return false; }
+#endif
 }  // namespace
 
 namespace cpu_function_runtime {
@@ -104,5 +144,25 @@ void FreeContiguous(void* contiguous) {
     aligned_free(contiguous);
   }
 }
+
+#define TF_FEATURE_NAME(name) name,
+const char* const kHostCheckableTargetFeatures[] = {
+    TF_FOR_EACH_HOST_CHECKABLE_FEATURE(TF_FEATURE_NAME) nullptr};
+#undef TF_FEATURE_NAME
+
+bool HostSupportsTargetFeatures(const char* target_features) {
+  const char* pos = target_features;
+  while (*pos != '\0') {
+    const char* end = strchr(pos, ',');
+    if (end == nullptr) {
+      end = pos + strlen(pos);
+    }
+    if (*pos == '+' && !HostSupportsFeature(pos + 1, end - pos - 1)) {
+      return false;
+    }
+    pos = *end == ',' ? end + 1 : end;
+  }
+  return true;
+}
 }  // namespace cpu_function_runtime
 }  // namespace tensorflow
@@ -159,6 +159,19 @@ void* MallocContiguousBuffers(const BufferInfo* buffer_infos, size_t n,
 // FreeContiguous frees the contiguous block of memory allocated by
 // MallocContiguousBuffers.
 void FreeContiguous(void* contiguous);
+
+// HostSupportsTargetFeatures returns true iff the host CPU supports every
+// feature enabled ("+feature") in `target_features`, a comma-separated list of
+// LLVM target features such as "+avx2,+fma".  Disabled features are ignored.
+// Only x86 features are recognized; unknown features are reported as
+// unsupported.  Used by the code generated by tfcompile to dispatch between
+// specializations of a function for different CPUs.
+bool HostSupportsTargetFeatures(const char* target_features);
+
+// The names of the x86 target features, without "+", that
+// HostSupportsTargetFeatures recognizes, terminated by nullptr.  The features
+// are listed whatever the host CPU, so that tfcompile can cross-compile.
+extern const char* const kHostCheckableTargetFeatures[];
 }  // namespace cpu_function_runtime
 }  // namespace tensorflow
 
@@ -167,5 +167,20 @@ TEST(XlaCompiledCpuFunctionTest, BufferInfoTest) {
       BufferInfo::MakeEntryParameter(/*size=*/4, /*param_number=*/0));
 }
 
+TEST(XlaCompiledCpuFunctionTest, HostSupportsTargetFeatures) {
+  EXPECT_TRUE(cpu_function_runtime::HostSupportsTargetFeatures(""));
+  EXPECT_TRUE(cpu_function_runtime::HostSupportsTargetFeatures("-avx512f"));
+  EXPECT_FALSE(
+      cpu_function_runtime::HostSupportsTargetFeatures("+no-such-feature"));
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  // Every x86-64 CPU supports SSE2.
+  EXPECT_TRUE(cpu_function_runtime::HostSupportsTargetFeatures("+sse2"));
+  EXPECT_TRUE(
+      cpu_function_runtime::HostSupportsTargetFeatures("-avx512f,+sse2"));
+  EXPECT_FALSE(cpu_function_runtime::HostSupportsTargetFeatures(
+      "+sse2,+no-such-feature"));
+#endif
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -0,0 +1,79 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/tf2xla/xla_compiled_cpu_function_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace tensorflow {
+
+XlaCompiledCpuFunctionBatch::XlaCompiledCpuFunctionBatch(
+    const XlaCompiledCpuFunction::StaticData& static_data, int num_workers) {
+  functions_.reserve(num_workers);
+  for (int i = 0; i < num_workers; ++i) {
+    functions_.emplace_back(new XlaCompiledCpuFunction(
+        static_data,
+        XlaCompiledCpuFunction::AllocMode::RESULTS_PROFILES_AND_TEMPS_ONLY));
+  }
+}
+
+bool XlaCompiledCpuFunctionBatch::Run(int num_requests, void* const* args,
+                                      const DoneCallback& done,
+                                      const Scheduler& schedule) {
+  const int num_workers =
+      std::min(num_requests, static_cast<int>(functions_.size()));
+  if (num_workers <= 0) {
+    return num_requests <= 0;
+  }
+  const int num_args = functions_[0]->num_args();
+
+  std::atomic<int> next_request(0);
+  std::atomic<bool> ok(true);
+  std::mutex mu;
+  std::condition_variable all_done;
+  int running_workers = num_workers;
+  auto work = [&](int worker) {
+    XlaCompiledCpuFunction* function = functions_[worker].get();
+    for (int request = next_request++; request < num_requests;
+         request = next_request++) {
+      for (int i = 0; i < num_args; ++i) {
+        function->set_arg_data(i, args[request * num_args + i]);
+      }
+      if (!function->Run()) {
+        ok = false;
+      }
+      if (done) {
+        done(request, *function);
+      }
+    }
+    std::lock_guard<std::mutex> lock(mu);
+    if (--running_workers == 0) {
+      all_done.notify_all();
+    }
+  };
+  for (int worker = 1; worker < num_workers; ++worker) {
+    schedule([&work, worker]() { work(worker); });
+  }
+  work(0);
+
+  std::unique_lock<std::mutex> lock(mu);
+  all_done.wait(lock, [&]() { return running_workers == 0; });
+  return ok;
+}
+
+}  // namespace tensorflow
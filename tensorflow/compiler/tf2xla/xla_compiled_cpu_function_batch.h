@@ -0,0 +1,82 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_TF2XLA_XLA_COMPILED_CPU_FUNCTION_BATCH_H_
+#define TENSORFLOW_COMPILER_TF2XLA_XLA_COMPILED_CPU_FUNCTION_BATCH_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/compiler/tf2xla/xla_compiled_cpu_function.h"
+
+namespace tensorflow {
+
+// Runs batches of independent requests through a function compiled by XLA, on
+// a fixed set of workers.
+//
+// Each worker owns an XlaCompiledCpuFunction, allocated once, whose result and
+// temp buffers are reused by every request the worker runs.  Constant buffers
+// are part of the compiled function, and shared by all workers.  Argument
+// buffers are owned by the caller.
+//
+// Requests are handed out to the workers one at a time, so that workers that
+// finish early take over the remaining requests.
+//
+// This class is thread-compatible.
+class XlaCompiledCpuFunctionBatch {
+ public:
+  // Starts `fn` on some thread, e.g. by passing it to a thread pool.
+  using Scheduler = std::function<void(std::function<void()> fn)>;
+
+  // Called on a worker once it ran request `request`, with the results of the
+  // request in `function`.  The result buffers are reused by later requests of
+  // the worker, so results must be consumed before returning.
+  using DoneCallback =
+      std::function<void(int request, const XlaCompiledCpuFunction& function)>;
+
+  // Creates `num_workers` instances of the function described by
+  // `static_data`, which must outlive this object.
+  XlaCompiledCpuFunctionBatch(
+      const XlaCompiledCpuFunction::StaticData& static_data, int num_workers);
+
+  XlaCompiledCpuFunctionBatch(const XlaCompiledCpuFunctionBatch&) = delete;
+  XlaCompiledCpuFunctionBatch& operator=(const XlaCompiledCpuFunctionBatch&) =
+      delete;
+
+  int num_workers() const { return functions_.size(); }
+
+  // Returns the function run by `worker`, e.g. to set its intra-op thread
+  // pool.
+  XlaCompiledCpuFunction* worker_function(int worker) {
+    return functions_[worker].get();
+  }
+
+  // Runs `num_requests` requests, where positional argument j of request i is
+  // read from args[i * num_args + j].  Calls `done`, if set, for each request.
+  //
+  // The calling thread runs the first worker; the others are started with
+  // `schedule`.  No more workers than requests are used.  Blocks until all
+  // requests have run.  Returns true iff every request ran successfully.
+  bool Run(int num_requests, void* const* args, const DoneCallback& done,
+           const Scheduler& schedule);
+
+ private:
+  std::vector<std::unique_ptr<XlaCompiledCpuFunction>> functions_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMPILER_TF2XLA_XLA_COMPILED_CPU_FUNCTION_BATCH_H_
@@ -682,6 +682,78 @@ string BufferAssignment::ToString() const {
   return output;
 }
 
+string BufferAssignment::LivenessReport() const {
+  const HloComputation* computation = module_->entry_computation();
+  string output;
+  absl::StrAppend(&output, "BufferLivenessReport(computation=",
+                  computation->name(), "):\n");
+  const std::vector<const HloInstruction*>* sequence =
+      liveness_->hlo_ordering().SequentialOrder(*computation);
+  if (sequence == nullptr || sequence->empty()) {
+    absl::StrAppend(&output, "  No sequential order.\n");
+    return output;
+  }
+
+  // Buffers without an allocation, e.g. those of constants on the stack, are
+  // not part of the report.
+  std::vector<std::pair<BufferLiveness::LiveRange, int64>> live_ranges;
+  std::vector<int64> live_bytes(sequence->size() + 1, 0);
+  for (const BufferLiveness::LiveRange& live_range :
+       liveness_->SequentialLiveRanges(*computation)) {
+    if (!HasAllocation(*live_range.buffer)) {
+      continue;
+    }
+    const int64 size = buffer_size_(*live_range.buffer);
+    live_ranges.emplace_back(live_range, size);
+    live_bytes[live_range.start] += size;
+    live_bytes[live_range.end + 1] -= size;
+  }
+  int64 peak_position = 0;
+  for (int64 i = 1; i < sequence->size(); ++i) {
+    live_bytes[i] += live_bytes[i - 1];
+    if (live_bytes[i] > live_bytes[peak_position]) {
+      peak_position = i;
+    }
+  }
+
+  absl::StrAppendFormat(&output, "  peak live bytes: %d (%s) at #%d %s\n",
+                        live_bytes[peak_position],
+                        HumanReadableNumBytes(live_bytes[peak_position]),
+                        peak_position, (*sequence)[peak_position]->name());
+  absl::StrAppendFormat(&output, "  temp allocation bytes: %d (%s)\n",
+                        temp_allocation_total_size(),
+                        HumanReadableNumBytes(temp_allocation_total_size()));
+
+  std::vector<std::pair<BufferLiveness::LiveRange, int64>> live_at_peak;
+  for (const auto& live_range : live_ranges) {
+    if (live_range.first.start <= peak_position &&
+        peak_position <= live_range.first.end) {
+      live_at_peak.push_back(live_range);
+    }
+  }
+  std::stable_sort(live_at_peak.begin(), live_at_peak.end(),
+                   [](const std::pair<BufferLiveness::LiveRange, int64>& a,
+                      const std::pair<BufferLiveness::LiveRange, int64>& b) {
+                     return a.second > b.second;
+                   });
+  absl::StrAppend(&output, "  live at peak, by defining instruction:\n");
+  for (const auto& live_range : live_at_peak) {
+    absl::StrAppendFormat(&output, "    %12d %s\n", live_range.second,
+                          live_range.first.buffer->ToString());
+  }
+
+  absl::StrAppend(&output,
+                  "  buffers, as [start, end] bytes buffer allocation:\n");
+  for (const auto& live_range : live_ranges) {
+    absl::StrAppendFormat(
+        &output, "    [%d, %d] %d %s %d\n", live_range.first.start,
+        live_range.first.end, live_range.second,
+        live_range.first.buffer->ToString(),
+        GetAssignedAllocation(*live_range.first.buffer).index());
+  }
+  return output;
+}
+
 BufferAssignmentProto BufferAssignment::ToProto() const {
   BufferAssignmentProto proto;
   // NOTE: TuplePointsToAnalysis state is serialized here in BufferAssigment,
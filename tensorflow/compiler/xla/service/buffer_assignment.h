@@ -430,6 +430,14 @@ class BufferAssignment {
   string ToString() const;
   BufferAssignmentProto ToProto() const;
 
+  // Returns a report of the live ranges of the buffers of the entry
+  // computation in its sequential order, and of the allocation each buffer
+  // was assigned to. The report breaks down the peak of live bytes by the
+  // instructions defining the buffers live at the peak. Buffers sharing an
+  // allocation are counted separately, so the peak is an upper bound of the
+  // memory used at any point.
+  string LivenessReport() const;
+
   // Statistics for the assignment.  Values initialized to -1 are not always
   // collected; fragmentation is only collected for instructions that have a
   // sequential total ordering.
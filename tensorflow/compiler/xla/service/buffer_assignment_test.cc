@@ -22,6 +22,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/literal.h"
 #include "tensorflow/compiler/xla/service/buffer_value.h"
 #include "tensorflow/compiler/xla/service/call_graph.h"
@@ -885,6 +886,38 @@ TEST_F(BufferAssignmentTest, UnaryOpReuseChain) {
   EXPECT_EQ(buffer_for_exp1, GetTopLevelAllocation(*assignment, neg));
 }
 
+TEST_F(BufferAssignmentTest, LivenessReport) {
+  // param0[100] ---> (exp) ---> (tanh) ---> (exp) ---> (neg)
+  auto builder = HloComputation::Builder(TestName());
+  auto param0 = builder.AddInstruction(
+      HloInstruction::CreateParameter(0, f32vec100_, "p"));
+  auto exp1 = builder.AddInstruction(
+      HloInstruction::CreateUnary(f32vec100_, HloOpcode::kExp, param0));
+  auto tanh = builder.AddInstruction(
+      HloInstruction::CreateUnary(f32vec100_, HloOpcode::kTanh, exp1));
+  auto exp2 = builder.AddInstruction(
+      HloInstruction::CreateUnary(f32vec100_, HloOpcode::kExp, tanh));
+  auto neg = builder.AddInstruction(
+      HloInstruction::CreateUnary(f32vec100_, HloOpcode::kNegate, exp2));
+
+  auto module = CreateNewModule();
+  module->AddEntryComputation(builder.Build());
+  EXPECT_THAT(RunBufferAssignment(module)->LivenessReport(),
+              ::testing::HasSubstr("No sequential order."));
+
+  auto assignment = RunBufferAssignmentWithInstructionSequence(
+      module, {param0, exp1, tanh, exp2, neg});
+  const string report = assignment->LivenessReport();
+  // Each instruction's buffer is live until its user runs, so two buffers of
+  // 400 bytes are live from exp1 on; the first such position is the peak.
+  EXPECT_THAT(report, ::testing::HasSubstr(absl::StrCat(
+                          "peak live bytes: 800 (800B) at #1 ", exp1->name())));
+  EXPECT_THAT(report, ::testing::HasSubstr(
+                          absl::StrCat("[0, 1] 400 ", param0->name())));
+  EXPECT_THAT(report,
+              ::testing::HasSubstr(absl::StrCat("[4, 4] 400 ", neg->name())));
+}
+
 TEST_F(BufferAssignmentTest, ReuseNonOperandBuffer) {
   // This computation is a chain of operations which decreases in buffer size
   // (via slice) then increases in size (via broadcast):
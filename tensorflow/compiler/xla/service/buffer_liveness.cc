@@ -17,9 +17,11 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/buffer_liveness.h"
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
@@ -73,6 +75,51 @@ Status BufferLiveness::Analyze() {
   return Status::OK();
 }
 
+std::vector<BufferLiveness::LiveRange> BufferLiveness::SequentialLiveRanges(
+    const HloComputation& computation) const {
+  std::vector<LiveRange> live_ranges;
+  const std::vector<const HloInstruction*>* sequence =
+      hlo_ordering_->SequentialOrder(computation);
+  if (sequence == nullptr) {
+    return live_ranges;
+  }
+  absl::flat_hash_map<const HloInstruction*, int64> positions;
+  for (int64 i = 0; i < sequence->size(); ++i) {
+    positions[(*sequence)[i]] = i;
+  }
+  const int64 last_position = static_cast<int64>(sequence->size()) - 1;
+  for (const HloInstruction* instruction : *sequence) {
+    for (const LogicalBuffer* buffer :
+         points_to_analysis_->GetBuffersDefinedByInstruction(instruction)) {
+      LiveRange live_range{buffer, positions.at(instruction),
+                           positions.at(instruction)};
+      // The buffer is live until the last use of any of its aliases.
+      for (const BufferAlias& alias :
+           points_to_analysis_->GetBufferAliases(*buffer)) {
+        auto it = positions.find(alias.instruction());
+        if (it == positions.end()) {
+          continue;
+        }
+        live_range.end = std::max(live_range.end, it->second);
+        if (alias.instruction() == computation.root_instruction()) {
+          live_range.end = last_position;
+        }
+        for (const HloInstruction* user : alias.instruction()->users()) {
+          auto user_it = positions.find(user);
+          if (user_it != positions.end()) {
+            live_range.end = std::max(live_range.end, user_it->second);
+          }
+        }
+      }
+      if (MaybeLiveOut(*buffer)) {
+        live_range.end = last_position;
+      }
+      live_ranges.push_back(live_range);
+    }
+  }
+  return live_ranges;
+}
+
 string BufferLiveness::ToString() const {
   std::vector<string> pieces;
   pieces.push_back(
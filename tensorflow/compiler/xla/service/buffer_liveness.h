@@ -19,6 +19,7 @@ limitations under the License.
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/compiler/xla/service/hlo_instruction.h"
@@ -67,6 +68,23 @@ class BufferLiveness {
 
   const HloModule& module() const { return *module_; }
 
+  // The live range of a buffer defined in a sequentially ordered computation:
+  // the buffer is live from position 'start' to position 'end', inclusive, of
+  // the sequential order of the computation.
+  struct LiveRange {
+    const LogicalBuffer* buffer;
+    int64 start;
+    int64 end;
+  };
+
+  // Returns the live ranges of the buffers defined by the instructions of
+  // 'computation', in the order the buffers are defined. Buffers which are
+  // live out of the computation live until the end of the sequential order.
+  // Returns an empty vector if the ordering has no sequential order for
+  // 'computation'.
+  std::vector<LiveRange> SequentialLiveRanges(
+      const HloComputation& computation) const;
+
   string ToString() const;
 
   static Colorer DefaultColorer() {
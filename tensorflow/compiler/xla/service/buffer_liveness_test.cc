@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
@@ -196,6 +198,50 @@ TEST_F(BufferLivenessTest, MultipleEntryParameters_Sequential) {
   EXPECT_FALSE(InstructionsMayInterfere(*liveness, add, exp));
 }
 
+TEST_F(BufferLivenessTest, SequentialLiveRanges) {
+  // param0 --> negate ---------------\
+  //                   param1 --> exp --> add
+  auto builder = HloComputation::Builder(TestName());
+  auto param0 = builder.AddInstruction(
+      HloInstruction::CreateParameter(0, vec_, "param0"));
+  auto param1 = builder.AddInstruction(
+      HloInstruction::CreateParameter(1, vec_, "param1"));
+  auto negate = builder.AddInstruction(
+      HloInstruction::CreateUnary(vec_, HloOpcode::kNegate, param0));
+  auto exp = builder.AddInstruction(
+      HloInstruction::CreateUnary(vec_, HloOpcode::kExp, param1));
+  auto add = builder.AddInstruction(
+      HloInstruction::CreateBinary(vec_, HloOpcode::kAdd, negate, exp));
+
+  auto module = CreateNewModule();
+  HloComputation* entry = module->AddEntryComputation(builder.Build());
+
+  HloSchedule schedule(module.get());
+  schedule.set_sequence(entry, {param0, negate, param1, exp, add});
+  auto liveness =
+      BufferLiveness::Run(module.get(),
+                          absl::make_unique<SequentialHloOrdering>(schedule))
+          .ConsumeValueOrDie();
+
+  std::vector<BufferLiveness::LiveRange> live_ranges =
+      liveness->SequentialLiveRanges(*entry);
+  ASSERT_EQ(5, live_ranges.size());
+  const std::vector<std::tuple<HloInstruction*, int64, int64>> expected = {
+      {param0, 0, 1}, {negate, 1, 4}, {param1, 2, 3}, {exp, 3, 4}, {add, 4, 4}};
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(std::get<0>(expected[i]), live_ranges[i].buffer->instruction());
+    EXPECT_EQ(std::get<1>(expected[i]), live_ranges[i].start);
+    EXPECT_EQ(std::get<2>(expected[i]), live_ranges[i].end);
+  }
+
+  // There are no live ranges without a sequential order.
+  auto dependency_liveness =
+      BufferLiveness::Run(
+          module.get(), absl::make_unique<DependencyHloOrdering>(module.get()))
+          .ConsumeValueOrDie();
+  EXPECT_TRUE(dependency_liveness->SequentialLiveRanges(*entry).empty());
+}
+
 TEST_F(BufferLivenessTest, NonElementwiseOperand) {
   // A chain of operations with two elementwise and one non-elementwise. The
   // elementwise op should not interfere with its operand, while the
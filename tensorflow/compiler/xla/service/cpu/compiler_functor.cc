@@ -42,6 +42,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/statusor.h"
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 
 namespace xla {
@@ -95,6 +96,36 @@ class FilteredPassManager : public llvm::legacy::PassManager {
 
 std::unique_ptr<llvm::MemoryBuffer> CompilerFunctor::operator()(
     llvm::Module& module) const {
+  if (object_cache_ == nullptr || pre_optimization_hook_ ||
+      post_optimization_hook_) {
+    return Compile(module);
+  }
+
+  // The key is computed before the module is optimized in place.
+  const string key =
+      ObjectCache::Key(module, *target_machine_, CodegenFlags());
+  std::unique_ptr<llvm::MemoryBuffer> object = object_cache_->Lookup(key);
+  if (object != nullptr) {
+    VLOG(1) << "Loaded object " << key << " from the object cache";
+    return object;
+  }
+  object = Compile(module);
+  Status s = object_cache_->Insert(key, object->getBuffer());
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to cache object " << key << ": " << s;
+  }
+  return object;
+}
+
+string CompilerFunctor::CodegenFlags() const {
+  return tensorflow::strings::StrCat(
+      "opt_level=", opt_level_, ",optimize_for_size=", optimize_for_size_,
+      ",fast_math=", enable_fast_math_,
+      ",disable_expensive_passes=", disable_expensive_passes_);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> CompilerFunctor::Compile(
+    llvm::Module& module) const {
   FilteredPassManager module_passes(disable_expensive_passes_);
   FilteredFunctionPassManager function_passes(&module,
                                               disable_expensive_passes_);
@@ -21,6 +21,7 @@ limitations under the License.
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Target/TargetMachine.h"
 #include "tensorflow/compiler/xla/service/cpu/disassembler.h"
+#include "tensorflow/compiler/xla/service/cpu/object_cache.h"
 #include "tensorflow/compiler/xla/service/llvm_compiler.h"
 #include "tensorflow/core/platform/logging.h"
 
@@ -29,6 +30,10 @@ namespace cpu {
 
 // Functor class for compiling an LLVM module down to an object file. For use by
 // Orc JIT compile layer.
+//
+// If an |object_cache| is given, the object files are looked up in it before
+// compiling and cached after compiling. The cache is bypassed when any of the
+// module hooks is set, since those expect to see the module being optimized.
 class CompilerFunctor {
  public:
   explicit CompilerFunctor(
@@ -36,7 +41,8 @@ class CompilerFunctor {
       int opt_level, bool optimize_for_size, bool enable_fast_math,
       bool disable_expensive_passes,
       LLVMCompiler::ModuleHook pre_optimization_hook = nullptr,
-      LLVMCompiler::ModuleHook post_optimization_hook = nullptr)
+      LLVMCompiler::ModuleHook post_optimization_hook = nullptr,
+      const ObjectCache* object_cache = nullptr)
       : target_machine_(target_machine),
         disassembler_(CHECK_NOTNULL(disassembler)),
         opt_level_(opt_level),
@@ -44,13 +50,21 @@ class CompilerFunctor {
         enable_fast_math_(enable_fast_math),
         disable_expensive_passes_(disable_expensive_passes),
         pre_optimization_hook_(pre_optimization_hook),
-        post_optimization_hook_(post_optimization_hook) {}
+        post_optimization_hook_(post_optimization_hook),
+        object_cache_(object_cache) {}
 
   // Compile a Module to an ObjectFile.
   std::unique_ptr<llvm::MemoryBuffer> operator()(
       llvm::Module& module) const;  // NOLINT
 
  private:
+  // Compiles |module| without consulting the object cache.
+  std::unique_ptr<llvm::MemoryBuffer> Compile(
+      llvm::Module& module) const;  // NOLINT
+
+  // Describes the flags the object code depends on, for the object cache key.
+  string CodegenFlags() const;
+
   // Populates the given pass manager with TargetLibraryInfo and
   // TargetTransformInfo passes.
   void AddTargetInfoPasses(llvm::legacy::PassManagerBase* passes) const;
@@ -68,6 +82,7 @@ class CompilerFunctor {
   const bool disable_expensive_passes_;
   LLVMCompiler::ModuleHook pre_optimization_hook_;
   LLVMCompiler::ModuleHook post_optimization_hook_;
+  const ObjectCache* object_cache_;
 };
 
 }  // namespace cpu
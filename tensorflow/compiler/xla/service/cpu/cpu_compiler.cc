@@ -28,6 +28,7 @@ limitations under the License.
 // IWYU pragma: no_include "llvm/Config/Targets.def.inc"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/Function.h"
@@ -70,6 +71,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/dfs_hlo_visitor_with_default.h"
 #include "tensorflow/compiler/xla/service/dot_decomposer.h"
 #include "tensorflow/compiler/xla/service/flatten_call_graph.h"
+#include "tensorflow/compiler/xla/service/heap_simulator.h"
 #include "tensorflow/compiler/xla/service/hlo.pb.h"
 #include "tensorflow/compiler/xla/service/hlo_computation.h"
 #include "tensorflow/compiler/xla/service/hlo_constant_folding.h"
@@ -83,6 +85,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/hlo_pass_fix.h"
 #include "tensorflow/compiler/xla/service/hlo_pass_pipeline.h"
 #include "tensorflow/compiler/xla/service/hlo_proto_util.h"
+#include "tensorflow/compiler/xla/service/hlo_rematerialization.h"
 #include "tensorflow/compiler/xla/service/hlo_subcomputation_unification.h"
 #include "tensorflow/compiler/xla/service/hlo_verifier.h"
 #include "tensorflow/compiler/xla/service/indexed_array_analysis.h"
@@ -377,6 +380,51 @@ Status CpuCompiler::RunHloPasses(HloModule* module, bool is_aot_compile,
                                      &target_machine_features);
 }
 
+StatusOr<HloSchedule> CpuCompiler::ScheduleModuleForMemory(
+    HloModule* module, const MemorySchedulerAlgorithm& algorithm) {
+  absl::optional<int64> budget_bytes =
+      options::MemoryBudgetBytes(module->config());
+  if (!budget_bytes) {
+    return ScheduleModule(*module, BufferSizeBytesFunction(), algorithm);
+  }
+
+  absl::optional<HloSchedule> best_schedule;
+  int64 best_bytes = 0;
+  for (const MemorySchedulerAlgorithm& candidate :
+       std::vector<MemorySchedulerAlgorithm>{
+           ListMemoryScheduler, DFSMemoryScheduler, PostOrderMemoryScheduler}) {
+    TF_ASSIGN_OR_RETURN(
+        HloSchedule schedule,
+        ScheduleModule(*module, BufferSizeBytesFunction(), candidate));
+    TF_ASSIGN_OR_RETURN(const int64 bytes,
+                        HeapSimulator::MinimumMemoryForModule(
+                            schedule, BufferSizeBytesFunction()));
+    if (!best_schedule || bytes < best_bytes) {
+      best_schedule = std::move(schedule);
+      best_bytes = bytes;
+    }
+  }
+  VLOG(1) << "Lowest peak memory of the schedules of " << module->name()
+          << ": " << best_bytes << " bytes, budget: " << *budget_bytes;
+  if (best_bytes <= *budget_bytes) {
+    return std::move(*best_schedule);
+  }
+
+  // Rematerialization updates the schedule of the module along with the
+  // instructions it rematerializes.
+  TF_RETURN_IF_ERROR(module->set_schedule(std::move(*best_schedule)));
+  HloRematerialization::RematerializationSizes sizes;
+  HloRematerialization rematerialization(ShapeSizeBytesFunction(),
+                                         *budget_bytes, &sizes);
+  // Rematerialization warns when it can't meet the budget.
+  TF_RETURN_IF_ERROR(rematerialization.Run(module).status());
+  VLOG(1) << "Peak memory of " << module->name() << " after rematerialization: "
+          << sizes.after_bytes << " bytes";
+  HloSchedule schedule = module->schedule();
+  module->clear_schedule();
+  return std::move(schedule);
+}
+
 namespace {
 
 // Align buffers to 16-byte boundaries.
@@ -557,7 +605,8 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::RunBackend(
       options::OptimizeForSizeRequested(module->config()),
       module->config().debug_options().xla_cpu_enable_fast_math(),
       module->config().debug_options().xla_llvm_disable_expensive_passes(),
-      pre_optimization_ir_hook, post_optimization_ir_hook);
+      pre_optimization_ir_hook, post_optimization_ir_hook,
+      options::ObjectCacheDir(module->config()));
   llvm_module->setDataLayout(jit->data_layout());
   llvm_module->setTargetTriple(jit->target_triple().getTriple());
 
@@ -586,7 +635,7 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::RunBackend(
   // and reduced memory usage (as compared to using DependencyHloOrdering).
   TF_ASSIGN_OR_RETURN(
       HloSchedule schedule,
-      ScheduleModule(*module, BufferSizeBytesFunction(), DFSMemoryScheduler));
+      ScheduleModuleForMemory(module.get(), DFSMemoryScheduler));
 
   // Run buffer allocation on the HLO graph.
   TF_ASSIGN_OR_RETURN(
@@ -599,6 +648,7 @@ StatusOr<std::unique_ptr<Executable>> CpuCompiler::RunBackend(
   // BufferAssignment::ToString() includes a header, so no need for us to
   // print one ourselves.
   XLA_VLOG_LINES(2, assignment->ToString());
+  XLA_VLOG_LINES(2, assignment->LivenessReport());
 
   if (!xla_dump_optimized_hlo_proto_to.empty()) {
     HloProto proto = MakeHloProto(*module, *assignment);
@@ -773,7 +823,7 @@ CpuCompiler::CompileAheadOfTime(std::vector<std::unique_ptr<HloModule>> modules,
     XLA_VLOG_LINES(2, module->ToString());
 
     TF_ASSIGN_OR_RETURN(HloSchedule schedule,
-                        ScheduleModule(*module, BufferSizeBytesFunction()));
+                        ScheduleModuleForMemory(module, /*algorithm=*/{}));
 
     // Run buffer analysis on the HLO graph. This analysis figures out which
     // temporary buffers are required to run the computation.
@@ -787,6 +837,7 @@ CpuCompiler::CompileAheadOfTime(std::vector<std::unique_ptr<HloModule>> modules,
     // BufferAssignment::ToString() includes a header, so no need for us to
     // print one ourselves.
     XLA_VLOG_LINES(2, assignment->ToString());
+    XLA_VLOG_LINES(2, assignment->LivenessReport());
 
     const string xla_dump_optimized_hlo_proto_to =
         module->config().debug_options().xla_dump_optimized_hlo_proto_to();
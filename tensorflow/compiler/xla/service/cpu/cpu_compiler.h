@@ -23,7 +23,9 @@ limitations under the License.
 #include "tensorflow/compiler/tf2xla/cpu_function_runtime.h"
 #include "tensorflow/compiler/xla/service/cpu/target_machine_features.h"
 #include "tensorflow/compiler/xla/service/executable.h"
+#include "tensorflow/compiler/xla/service/hlo_memory_scheduler.h"
 #include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_schedule.h"
 #include "tensorflow/compiler/xla/service/llvm_compiler.h"
 #include "tensorflow/compiler/xla/statusor.h"
 #include "tensorflow/core/platform/macros.h"
@@ -168,6 +170,13 @@ class CpuCompiler : public LLVMCompiler {
       HloModule* module, bool is_aot_compile,
       LLVMTargetMachineFeatures* target_machine_features);
 
+  // Schedules the module with `algorithm`, unless the module has a memory
+  // budget (see options::MemoryBudgetBytes). In that case the list, DFS and
+  // post-order schedules are compared, and the one with the lowest peak memory
+  // is used, rematerializing instructions if it exceeds the budget.
+  StatusOr<HloSchedule> ScheduleModuleForMemory(
+      HloModule* module, const MemorySchedulerAlgorithm& algorithm);
+
   TF_DISALLOW_COPY_AND_ASSIGN(CpuCompiler);
 };
 
@@ -85,6 +85,10 @@ class CpuExecutable : public Executable {
 
   const BufferAssignment& buffer_assignment() const { return *assignment_; }
 
+  // Returns the report of the buffer liveness of the executable, see
+  // BufferAssignment::LivenessReport.
+  string BufferLivenessReport() const { return assignment_->LivenessReport(); }
+
  private:
   // This is for sharing the code between ExecuteOnStream and
   // ExecuteAsyncOnStream.
@@ -27,6 +27,11 @@ const char* const kLlvmIrDotTilingFactor = "xla_llvm_dot_tiling_factor";
 const char* const kXlaEnableExperimentalLlvmIrGemm =
     "xla_enable_experimental_llvm_ir_gemm";
 const char* const kLlvmIrGemmTileSize = "xla_llvm_ir_gemm_tile_size";
+const char* const kXlaCpuObjectCacheDir = "xla_cpu_object_cache_dir";
+const char* const kXlaCpuParallelTaskCycles = "xla_cpu_parallel_task_cycles";
+const char* const kXlaCpuParallelMemoryBoundTasks =
+    "xla_cpu_parallel_memory_bound_tasks";
+const char* const kXlaCpuMemoryBudgetBytes = "xla_cpu_memory_budget_bytes";
 
 }  // namespace
 
@@ -100,6 +105,62 @@ absl::optional<std::tuple<int64, int64, int64>> LlvmIrGemmTileSize(
                                          tile_size_n_in_vector_width);
 }
 
+string ObjectCacheDir(const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  auto it = extra_options_map.find(kXlaCpuObjectCacheDir);
+  return it == extra_options_map.end() ? "" : it->second;
+}
+
+absl::optional<std::tuple<double, double, double, double>> ParallelTaskCycles(
+    const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  auto it = extra_options_map.find(kXlaCpuParallelTaskCycles);
+  if (it == extra_options_map.end()) {
+    return absl::nullopt;
+  }
+
+  std::vector<string> components = absl::StrSplit(it->second, ':');
+  CHECK_EQ(components.size(), 4);
+  double cycles[4];
+  for (int i = 0; i < 4; ++i) {
+    CHECK(absl::SimpleAtod(components[i], &cycles[i]));
+  }
+  return std::tuple<double, double, double, double>(cycles[0], cycles[1],
+                                                    cycles[2], cycles[3]);
+}
+
+absl::optional<std::tuple<int64, int64>> ParallelMemoryBoundTasks(
+    const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  auto it = extra_options_map.find(kXlaCpuParallelMemoryBoundTasks);
+  if (it == extra_options_map.end()) {
+    return absl::nullopt;
+  }
+
+  std::vector<string> components = absl::StrSplit(it->second, ':');
+  CHECK_EQ(components.size(), 2);
+  int64 max_tasks;
+  int64 min_task_bytes;
+  CHECK(absl::SimpleAtoi(components[0], &max_tasks));
+  CHECK(absl::SimpleAtoi(components[1], &min_task_bytes));
+  return std::tuple<int64, int64>(max_tasks, min_task_bytes);
+}
+
+absl::optional<int64> MemoryBudgetBytes(const HloModuleConfig& config) {
+  const auto& extra_options_map =
+      config.debug_options().xla_backend_extra_options();
+  auto it = extra_options_map.find(kXlaCpuMemoryBudgetBytes);
+  if (it == extra_options_map.end()) {
+    return absl::nullopt;
+  }
+  int64 budget_bytes;
+  CHECK(absl::SimpleAtoi(it->second, &budget_bytes));
+  return budget_bytes;
+}
+
 }  // namespace options
 }  // namespace cpu
 }  // namespace xla
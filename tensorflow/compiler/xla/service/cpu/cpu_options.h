@@ -30,6 +30,20 @@ bool EnableExperimentalLlvmIrGemm(const HloModuleConfig& config);
 absl::optional<int64> LlvmIrGemvTilingFactor(const HloModuleConfig& config);
 absl::optional<std::tuple<int64, int64, int64>> LlvmIrGemmTileSize(
     const HloModuleConfig& config);
+// Directory the compiled object files are cached in across processes, or the
+// empty string if they are not cached.
+string ObjectCacheDir(const HloModuleConfig& config);
+// Cycles per flop, per transcendental op, per byte accessed, and minimum
+// cycles of work per task of the parallel task cost model.
+absl::optional<std::tuple<double, double, double, double>> ParallelTaskCycles(
+    const HloModuleConfig& config);
+// Maximum task count, and minimum bytes per task, of memory-bound instructions
+// in the parallel task cost model.
+absl::optional<std::tuple<int64, int64>> ParallelMemoryBoundTasks(
+    const HloModuleConfig& config);
+// Peak temp memory, in bytes, the HLO schedule should stay under, possibly by
+// rematerializing instructions.
+absl::optional<int64> MemoryBudgetBytes(const HloModuleConfig& config);
 
 }  // namespace options
 }  // namespace cpu
@@ -52,6 +52,7 @@ limitations under the License.
 #include "tensorflow/compiler/xla/service/cpu/parallel_loop_emitter.h"
 #include "tensorflow/compiler/xla/service/cpu/shape_partition.h"
 #include "tensorflow/compiler/xla/service/cpu/simple_orc_jit.h"
+#include "tensorflow/compiler/xla/service/cpu/vector_support_library.h"
 #include "tensorflow/compiler/xla/service/elemental_ir_emitter.h"
 #include "tensorflow/compiler/xla/service/hlo_casting_utils.h"
 #include "tensorflow/compiler/xla/service/hlo_instructions.h"
@@ -1694,6 +1695,181 @@ void IrEmitter::EmitShardedVectorStore(
   }
 }
 
+StatusOr<bool> IrEmitter::EmitVectorizedRowReduce(
+    HloInstruction* reduce, HloInstruction* arg, HloInstruction* init_value,
+    absl::Span<const int64> dimensions,
+    const ReductionGenerator& reduction_generator, string* failure_reason) {
+  // Every output element must be reduced from a contiguous row of the operand,
+  // i.e. the reduced dimensions must be its most minor dimensions.
+  const Shape& arg_shape = arg->shape();
+  int64 row_size = 1;
+  for (int64 i = 0; i < dimensions.size(); ++i) {
+    const int64 dimension = LayoutUtil::Minor(arg_shape.layout(), i);
+    if (std::find(dimensions.begin(), dimensions.end(), dimension) ==
+        dimensions.end()) {
+      *failure_reason = "reduced dimensions are not the most minor dimensions";
+      return false;
+    }
+    row_size *= arg_shape.dimensions(dimension);
+  }
+
+  // The row is reduced in a different order than the element loop reduces it,
+  // which changes the result of floating point sums and products.
+  const PrimitiveType element_type = reduce->shape().element_type();
+  const HloOpcode reduction_opcode =
+      reduce->to_apply()->root_instruction()->opcode();
+  if (ShapeUtil::ElementIsFloating(reduce->shape()) &&
+      (reduction_opcode == HloOpcode::kAdd ||
+       reduction_opcode == HloOpcode::kMultiply) &&
+      !hlo_module_config_.debug_options().xla_cpu_enable_fast_math()) {
+    *failure_reason = "reassociating the reduction requires fast math";
+    return false;
+  }
+
+  const int64 vector_size =
+      target_machine_features_.vector_register_byte_size(
+          *compute_function_->function()) /
+      ShapeUtil::ByteSizeOfPrimitiveType(element_type);
+  if (vector_size < 2 || row_size < vector_size) {
+    *failure_reason = "row is shorter than a vector register";
+    return false;
+  }
+
+  // Independent accumulators hide the latency of the reduction function, at
+  // the cost of a longer horizontal reduction per row.
+  const int64 kMaxAccumulators = 4;
+  const int64 num_accumulators =
+      std::min(kMaxAccumulators, row_size / vector_size);
+  const int64 block_size = num_accumulators * vector_size;
+
+  CHECK(!ShapeUtil::IsTuple(reduce->shape()));
+  TF_RETURN_IF_ERROR(EmitTargetAddressForOp(reduce));
+
+  // The reduction is lowered as:
+  //
+  //  for (d in output dimensions) {
+  //    acc[0..N) = row[d][0..N*VS)
+  //    for (r in [N*VS, R) with stride N*VS) {
+  //      acc[0..N) = reduce(acc[0..N), row[d][r..r+N*VS))
+  //    }
+  //    acc[0] = reduce(acc[0], remaining vectors of row[d], acc[1..N))
+  //    output[d] = reduce(init, lanes of acc[0], remaining elements of row[d])
+  //  }
+  //
+  // where VS is the vector register size in elements and N the number of
+  // accumulators.  The output loops honor the dynamic loop bounds of the
+  // parallel backend.
+  std::vector<std::pair<llvm::Value*, llvm::Value*>> dynamic_loop_bounds;
+  if (ShouldEmitParallelLoopFor(*reduce)) {
+    dynamic_loop_bounds = compute_function_->GetDynamicLoopBounds();
+  }
+  llvm_ir::ForLoopNest loop_nest(IrName(reduce), &b_);
+  llvm_ir::IrArray::Index output_index(b_.getInt64Ty(),
+                                       reduce->shape().dimensions_size());
+  const int64 num_dims = LayoutUtil::MinorToMajor(reduce->shape()).size();
+  for (int i = num_dims - 1; i >= 0; --i) {
+    const int64 dimension = LayoutUtil::Minor(reduce->shape().layout(), i);
+    const int64 bounds_index = num_dims - 1 - i;
+    std::unique_ptr<llvm_ir::ForLoop> loop;
+    if (bounds_index < dynamic_loop_bounds.size()) {
+      loop = loop_nest.AddLoop(absl::StrFormat("dim.%d", dimension),
+                               dynamic_loop_bounds[bounds_index].first,
+                               dynamic_loop_bounds[bounds_index].second);
+    } else {
+      loop = loop_nest.AddLoop(/*start_index=*/0,
+                               reduce->shape().dimensions(dimension),
+                               absl::StrFormat("dim.%d", dimension));
+    }
+    output_index[dimension] = loop->GetIndVarValue();
+  }
+
+  if (llvm::BasicBlock* innermost_body_bb =
+          loop_nest.GetInnerLoopBodyBasicBlock()) {
+    SetToFirstInsertPoint(innermost_body_bb, &b_);
+  }
+  auto outermost_loop_exit_block = loop_nest.GetOuterLoopExitBasicBlock();
+
+  // Address the start of the row reduced into output[d].
+  llvm_ir::IrArray arg_array(GetIrArrayFor(arg));
+  llvm_ir::IrArray::Index row_index(b_.getInt64Ty(),
+                                    arg_shape.dimensions_size());
+  llvm_ir::IrArray::Index::const_iterator it = output_index.begin();
+  for (int64 i = 0; i < row_index.size(); ++i) {
+    if (std::find(dimensions.begin(), dimensions.end(), i) !=
+        dimensions.end()) {
+      row_index[i] = b_.getInt64(0);
+    } else {
+      row_index[i] = *it++;
+    }
+  }
+  CHECK(output_index.end() == it);
+
+  VectorSupportLibrary vsl(element_type, vector_size, &b_, IrName(reduce));
+  llvm::Value* row = vsl.ComputeOffsetPointer(
+      arg_array.EmitArrayElementAddress(row_index, &b_),
+      /*offset_elements=*/0);
+  auto load_vector = [&](llvm::Value* offset) {
+    llvm::Value* vector = vsl.LoadVector(row, offset);
+    arg_array.AnnotateLoadStoreInstructionWithMetadata(
+        llvm::cast<llvm::Instruction>(vector));
+    return vector;
+  };
+
+  std::vector<llvm::Value*> accumulators;
+  for (int64 i = 0; i < num_accumulators; ++i) {
+    accumulators.push_back(llvm_ir::EmitAllocaAtFunctionEntry(
+        vsl.vector_type(), "accumulator", &b_));
+    Store(load_vector(b_.getInt64(i * vector_size)), accumulators.back());
+  }
+
+  const int64 blocks_end = (row_size / block_size) * block_size;
+  if (blocks_end > block_size) {
+    std::unique_ptr<llvm_ir::ForLoop> loop = llvm_ir::ForLoop::EmitForLoop(
+        IrName(reduce, "row"), b_.getInt64(block_size), b_.getInt64(blocks_end),
+        b_.getInt64(block_size), &b_);
+    SetToFirstInsertPoint(loop->GetBodyBasicBlock(), &b_);
+    for (int64 i = 0; i < num_accumulators; ++i) {
+      llvm::Value* offset = Add(loop->GetIndVarValue(),
+                                b_.getInt64(i * vector_size));
+      Store(reduction_generator(&b_, Load(accumulators[i]),
+                                load_vector(offset)),
+            accumulators[i]);
+    }
+    SetToFirstInsertPoint(loop->GetExitBasicBlock(), &b_);
+  }
+
+  llvm::Value* accumulator = Load(accumulators[0]);
+  const int64 vectors_end = (row_size / vector_size) * vector_size;
+  for (int64 offset = blocks_end; offset < vectors_end;
+       offset += vector_size) {
+    accumulator = reduction_generator(&b_, accumulator,
+                                      load_vector(b_.getInt64(offset)));
+  }
+  for (int64 i = 1; i < num_accumulators; ++i) {
+    accumulator =
+        reduction_generator(&b_, accumulator, Load(accumulators[i]));
+  }
+
+  llvm::Value* result = Load(GetEmittedValueFor(init_value));
+  for (int64 i = 0; i < vector_size; ++i) {
+    result = reduction_generator(
+        &b_, result, b_.CreateExtractElement(accumulator, b_.getInt32(i)));
+  }
+  for (int64 offset = vectors_end; offset < row_size; ++offset) {
+    llvm::Value* element = vsl.LoadScalar(row, offset);
+    arg_array.AnnotateLoadStoreInstructionWithMetadata(
+        llvm::cast<llvm::Instruction>(element));
+    result = reduction_generator(&b_, result, element);
+  }
+  GetIrArrayFor(reduce).EmitWriteArrayElement(output_index, result, &b_);
+
+  if (outermost_loop_exit_block) {
+    b_.SetInsertPoint(outermost_loop_exit_block);
+  }
+
+  return true;
+}
+
 StatusOr<bool> IrEmitter::EmitVectorizedReduce(
     HloInstruction* reduce, HloInstruction* arg, HloInstruction* init_value,
     absl::Span<const int64> dimensions, HloComputation* function,
@@ -1726,9 +1902,21 @@ StatusOr<bool> IrEmitter::EmitVectorizedReduce(
       MinimumAlignmentForPrimitiveType(reduce->shape().element_type()));
 
   if (is_reduction_over_minor_dimension) {
-    // TODO(sanjoy): Implement vectorized reduction over the minor dimension.
-    *failure_reason = "reduction over minor dimension not implemented";
-    return false;
+    return EmitVectorizedRowReduce(reduce, arg, init_value, dimensions,
+                                   reduction_generator, failure_reason);
+  }
+
+  // The parallel backend partitions the most-major output dimensions (see
+  // ParallelTaskAssigner). The outer loops below honor the dynamic loop bounds
+  // of those dimensions, but the innermost dimension is strided by the
+  // vectorization factor and must not be partitioned.
+  std::vector<std::pair<llvm::Value*, llvm::Value*>> dynamic_loop_bounds;
+  if (ShouldEmitParallelLoopFor(*reduce)) {
+    if (num_dynamic_loop_bounds_ >= reduce->shape().dimensions_size()) {
+      *failure_reason = "partitioned innermost dimension not implemented";
+      return false;
+    }
+    dynamic_loop_bounds = compute_function_->GetDynamicLoopBounds();
   }
 
   CHECK(!ShapeUtil::IsTuple(reduce->shape()));
@@ -1757,13 +1945,22 @@ StatusOr<bool> IrEmitter::EmitVectorizedReduce(
   llvm_ir::ForLoopNest loop_nest(IrName(reduce), &b_);
   llvm_ir::IrArray::Index array_index(b_.getInt64Ty(),
                                       reduce->shape().dimensions_size());
-  for (int i = LayoutUtil::MinorToMajor(reduce->shape()).size() - 1; i > 0;
-       --i) {
+  const int64 num_dims = LayoutUtil::MinorToMajor(reduce->shape()).size();
+  for (int i = num_dims - 1; i > 0; --i) {
     int64 dimension = LayoutUtil::Minor(reduce->shape().layout(), i);
-    int64 start_index = 0;
-    int64 end_index = reduce->shape().dimensions(dimension);
-    std::unique_ptr<llvm_ir::ForLoop> loop = loop_nest.AddLoop(
-        start_index, end_index, absl::StrFormat("dim.%d", dimension));
+    const int64 bounds_index = num_dims - 1 - i;
+    std::unique_ptr<llvm_ir::ForLoop> loop;
+    if (bounds_index < dynamic_loop_bounds.size()) {
+      // Emit dynamic loop bounds for this dimension.
+      loop = loop_nest.AddLoop(absl::StrFormat("dim.%d", dimension),
+                               dynamic_loop_bounds[bounds_index].first,
+                               dynamic_loop_bounds[bounds_index].second);
+    } else {
+      int64 start_index = 0;
+      int64 end_index = reduce->shape().dimensions(dimension);
+      loop = loop_nest.AddLoop(start_index, end_index,
+                               absl::StrFormat("dim.%d", dimension));
+    }
     array_index[dimension] = loop->GetIndVarValue();
   }
 
@@ -379,6 +379,16 @@ class IrEmitter : public DfsHloVisitorWithDefault,
       HloInstruction* arg, absl::Span<const int64> dimensions,
       unsigned element_alignment);
 
+  // Emits a reduction over the most minor dimensions of "arg", reducing each
+  // contiguous row into several vector accumulators before reducing those
+  // horizontally.  Helper function for EmitVectorizedReduce.  Returns false,
+  // and stores a reason string into "failure_reason", if the reduction does
+  // not have that form.
+  StatusOr<bool> EmitVectorizedRowReduce(
+      HloInstruction* reduce, HloInstruction* arg, HloInstruction* init_value,
+      absl::Span<const int64> dimensions,
+      const ReductionGenerator& reduction_generator, string* failure_reason);
+
   // Tries to emit a fast concatenate operation using memcpy.  Returns true if
   // successful, and false on failure.  On failure, sets "failure_reason" to a
   // string describing why it could not emit a fast concatenate.
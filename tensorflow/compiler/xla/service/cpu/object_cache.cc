@@ -0,0 +1,116 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/object_cache.h"
+
+#include "llvm/Object/ObjectFile.h"
+#include "tensorflow/compiler/xla/service/llvm_ir/llvm_util.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/version.h"
+
+namespace xla {
+namespace cpu {
+
+namespace {
+
+// Bumped when the layout of the cached objects changes in a way the key does
+// not capture.
+const int kObjectCacheFormatVersion = 1;
+
+// Appends "value" to "data" so that the concatenation of the values is
+// unambiguous.
+void AppendField(tensorflow::StringPiece value, string* data) {
+  tensorflow::strings::StrAppend(data, value.size(), ":", value);
+}
+
+}  // namespace
+
+/* static */ string ObjectCache::Key(const llvm::Module& module,
+                                     const llvm::TargetMachine& target_machine,
+                                     const string& codegen_flags) {
+  string data;
+  AppendField(tensorflow::strings::StrCat(kObjectCacheFormatVersion), &data);
+  AppendField(TF_VERSION_STRING, &data);
+  AppendField(target_machine.getTargetTriple().str(), &data);
+  AppendField(target_machine.getTargetCPU().str(), &data);
+  AppendField(target_machine.getTargetFeatureString().str(), &data);
+  AppendField(codegen_flags, &data);
+  AppendField(llvm_ir::DumpModuleToString(module), &data);
+
+  const tensorflow::Fprint128 fingerprint = tensorflow::Fingerprint128(data);
+  return tensorflow::strings::StrCat(
+      tensorflow::strings::Hex(fingerprint.high64,
+                               tensorflow::strings::kZeroPad16),
+      tensorflow::strings::Hex(fingerprint.low64,
+                               tensorflow::strings::kZeroPad16));
+}
+
+string ObjectCache::EntryPath(const string& key) const {
+  return tensorflow::io::JoinPath(cache_dir_,
+                                  tensorflow::strings::StrCat(key, ".o"));
+}
+
+std::unique_ptr<llvm::MemoryBuffer> ObjectCache::Lookup(
+    const string& key) const {
+  const string path = EntryPath(key);
+  if (!env_->FileExists(path).ok()) {
+    return nullptr;
+  }
+  string contents;
+  Status s = tensorflow::ReadFileToString(env_, path, &contents);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to read cached object " << path << ": " << s;
+    return nullptr;
+  }
+  std::unique_ptr<llvm::MemoryBuffer> object =
+      llvm::MemoryBuffer::getMemBufferCopy(contents, path);
+  llvm::Expected<std::unique_ptr<llvm::object::ObjectFile>> object_file =
+      llvm::object::ObjectFile::createObjectFile(*object);
+  if (!object_file) {
+    llvm::consumeError(object_file.takeError());
+    LOG(WARNING) << "Removing corrupt cached object " << path;
+    env_->DeleteFile(path).IgnoreError();
+    return nullptr;
+  }
+  return object;
+}
+
+Status ObjectCache::Insert(const string& key, llvm::StringRef object) const {
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(cache_dir_));
+  // Written to a temporary file first, so that readers never see a partial
+  // entry.
+  const string path = EntryPath(key);
+  string tmp_path = path;
+  if (!env_->CreateUniqueFileName(&tmp_path, ".tmp")) {
+    return tensorflow::errors::Internal(
+        "Failed to create a temporary file name for ", path);
+  }
+  Status s = tensorflow::WriteStringToFile(
+      env_, tmp_path, tensorflow::StringPiece(object.data(), object.size()));
+  if (s.ok()) {
+    s = env_->RenameFile(tmp_path, path);
+  }
+  if (!s.ok()) {
+    env_->DeleteFile(tmp_path).IgnoreError();
+  }
+  return s;
+}
+
+}  // namespace cpu
+}  // namespace xla
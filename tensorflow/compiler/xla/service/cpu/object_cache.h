@@ -0,0 +1,71 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_XLA_SERVICE_CPU_OBJECT_CACHE_H_
+#define TENSORFLOW_COMPILER_XLA_SERVICE_CPU_OBJECT_CACHE_H_
+
+#include <memory>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Target/TargetMachine.h"
+#include "tensorflow/compiler/xla/status.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace xla {
+namespace cpu {
+
+// An on-disk cache of the object files compiled from the LLVM modules of XLA
+// computations, so that processes JIT-ing a computation they, or another
+// process sharing the cache, already compiled skip the LLVM optimization and
+// code generation passes. Cached objects contain relocations only, and are
+// linked against the runtime of the loading process like freshly compiled
+// ones.
+//
+// Entries are written atomically, so several processes can share a cache
+// directory. Entries that are not valid object files are treated as misses
+// and removed. Nothing is ever evicted.
+class ObjectCache {
+ public:
+  ObjectCache(tensorflow::Env* env, const string& cache_dir)
+      : env_(env), cache_dir_(cache_dir) {}
+
+  // Returns the key of the compilation of "module", before optimization, by
+  // "target_machine" with the code generation flags described by
+  // "codegen_flags". The key also depends on the target triple, CPU and
+  // features of "target_machine", and on the version of TensorFlow.
+  static string Key(const llvm::Module& module,
+                    const llvm::TargetMachine& target_machine,
+                    const string& codegen_flags);
+
+  // Returns the object file cached under "key", or nullptr if there is none.
+  std::unique_ptr<llvm::MemoryBuffer> Lookup(const string& key) const;
+
+  // Caches "object" under "key", replacing any previous entry.
+  Status Insert(const string& key, llvm::StringRef object) const;
+
+ private:
+  string EntryPath(const string& key) const;
+
+  tensorflow::Env* const env_;
+  const string cache_dir_;
+};
+
+}  // namespace cpu
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_SERVICE_CPU_OBJECT_CACHE_H_
@@ -0,0 +1,118 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/xla/service/cpu/object_cache.h"
+
+#include "absl/memory/memory.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/TargetSelect.h"
+#include "tensorflow/compiler/xla/service/cpu/compiler_functor.h"
+#include "tensorflow/compiler/xla/service/cpu/disassembler.h"
+#include "tensorflow/compiler/xla/service/cpu/simple_orc_jit.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+class ObjectCacheTest : public ::testing::Test {
+ protected:
+  ObjectCacheTest() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetDisassembler();
+    target_machine_ = SimpleOrcJIT::InferTargetMachineForJIT(
+        llvm::TargetOptions(), llvm::CodeGenOpt::Default);
+  }
+
+  // Returns a module with a function adding "addend" to its argument.
+  std::unique_ptr<llvm::Module> MakeModule(int addend) {
+    auto module = absl::make_unique<llvm::Module>("test", context_);
+    module->setDataLayout(target_machine_->createDataLayout());
+    module->setTargetTriple(target_machine_->getTargetTriple().getTriple());
+    llvm::IRBuilder<> b(context_);
+    llvm::Function* function = llvm::Function::Create(
+        llvm::FunctionType::get(b.getInt32Ty(), {b.getInt32Ty()},
+                                /*isVarArg=*/false),
+        llvm::GlobalValue::ExternalLinkage, "add", module.get());
+    b.SetInsertPoint(llvm::BasicBlock::Create(context_, "entry", function));
+    b.CreateRet(b.CreateAdd(&*function->arg_begin(), b.getInt32(addend)));
+    return module;
+  }
+
+  string CacheDir(const string& name) {
+    return tensorflow::io::JoinPath(tensorflow::testing::TmpDir(), name);
+  }
+
+  llvm::LLVMContext context_;
+  std::unique_ptr<llvm::TargetMachine> target_machine_;
+};
+
+TEST_F(ObjectCacheTest, KeyDependsOnInputs) {
+  const string key = ObjectCache::Key(*MakeModule(1), *target_machine_, "O2");
+  EXPECT_EQ(32, key.size());
+  EXPECT_EQ(key, ObjectCache::Key(*MakeModule(1), *target_machine_, "O2"));
+  EXPECT_NE(key, ObjectCache::Key(*MakeModule(2), *target_machine_, "O2"));
+  EXPECT_NE(key, ObjectCache::Key(*MakeModule(1), *target_machine_, "O3"));
+}
+
+TEST_F(ObjectCacheTest, CompilerFunctorCachesObjects) {
+  const string cache_dir = CacheDir("object_cache");
+  ObjectCache cache(tensorflow::Env::Default(), cache_dir);
+  Disassembler disassembler(*target_machine_);
+  CompilerFunctor compiler(target_machine_.get(), &disassembler,
+                           /*opt_level=*/2, /*optimize_for_size=*/false,
+                           /*enable_fast_math=*/false,
+                           /*disable_expensive_passes=*/false,
+                           /*pre_optimization_hook=*/nullptr,
+                           /*post_optimization_hook=*/nullptr, &cache);
+
+  std::unique_ptr<llvm::Module> module = MakeModule(1);
+  const string key = ObjectCache::Key(
+      *module, *target_machine_,
+      "opt_level=2,optimize_for_size=0,fast_math=0,"
+      "disable_expensive_passes=0");
+  EXPECT_EQ(nullptr, cache.Lookup(key));
+  std::unique_ptr<llvm::MemoryBuffer> compiled = compiler(*module);
+  ASSERT_NE(nullptr, compiled);
+
+  // Shared with other instances, and with other processes.
+  ObjectCache other_cache(tensorflow::Env::Default(), cache_dir);
+  std::unique_ptr<llvm::MemoryBuffer> cached = other_cache.Lookup(key);
+  ASSERT_NE(nullptr, cached);
+  EXPECT_EQ(compiled->getBuffer().str(), cached->getBuffer().str());
+  std::unique_ptr<llvm::MemoryBuffer> recompiled = compiler(*MakeModule(1));
+  EXPECT_EQ(compiled->getBuffer().str(), recompiled->getBuffer().str());
+}
+
+TEST_F(ObjectCacheTest, IgnoresCorruptEntries) {
+  const string cache_dir = CacheDir("corrupt_object_cache");
+  ObjectCache cache(tensorflow::Env::Default(), cache_dir);
+  const string key = ObjectCache::Key(*MakeModule(1), *target_machine_, "");
+  TF_ASSERT_OK(cache.Insert(key, "not an object file"));
+  EXPECT_EQ(nullptr, cache.Lookup(key));
+  EXPECT_FALSE(tensorflow::Env::Default()
+                   ->FileExists(tensorflow::io::JoinPath(
+                       cache_dir, tensorflow::strings::StrCat(key, ".o")))
+                   .ok());
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
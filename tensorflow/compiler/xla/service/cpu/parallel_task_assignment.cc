@@ -15,8 +15,13 @@ limitations under the License.
 
 #include "tensorflow/compiler/xla/service/cpu/parallel_task_assignment.h"
 
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
+
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/service/cpu/cpu_options.h"
 #include "tensorflow/compiler/xla/service/cpu/dot_op_emitter.h"
 #include "tensorflow/compiler/xla/service/cpu/ir_emission_utils.h"
 #include "tensorflow/compiler/xla/service/cpu/shape_partition.h"
@@ -30,100 +35,149 @@ namespace cpu {
 class SimpleCostModel : public ParallelCostModel {
  public:
   SimpleCostModel(const int64 max_parallelism,
-                  const HloCostAnalysis::ShapeSizeFunction& shape_size)
-      : max_parallelism_(max_parallelism), shape_size_(shape_size) {}
+                  const HloCostAnalysis::ShapeSizeFunction& shape_size,
+                  const int64 min_task_bytes)
+      : max_parallelism_(max_parallelism),
+        shape_size_(shape_size),
+        min_task_bytes_(min_task_bytes) {}
   ~SimpleCostModel() override {}
 
   int64 GetParallelTaskCount(HloInstruction* instruction) override {
     // Simple cost model based on hlo size and typical L2 cache size.
     const int64 instruction_cost = shape_size_(instruction->shape());
-    const int64 min_cost_per_thread = 256LL << 10;  // 256KB L2 Cache size.
     // Return target parallel task count in [1, max_parallelism_].
     return std::min(max_parallelism_,
-                    std::max(int64{1}, instruction_cost / min_cost_per_thread));
+                    std::max(int64{1}, instruction_cost / min_task_bytes_));
   }
 
  private:
   const int64 max_parallelism_;
   const HloCostAnalysis::ShapeSizeFunction shape_size_;
+  const int64 min_task_bytes_;
 };
 
 class DefaultCostModel : public ParallelCostModel {
  public:
-  DefaultCostModel(const int64 max_parallelism,
-                   const HloCostAnalysis::ShapeSizeFunction& shape_size,
-                   std::unique_ptr<HloCostAnalysis> cost_analysis)
+  // `cost_analyses` holds the cost analysis of each computation whose
+  // instructions are assigned parallel tasks. The instructions of the other
+  // computations are sized by their shape.
+  DefaultCostModel(
+      const int64 max_parallelism,
+      const HloCostAnalysis::ShapeSizeFunction& shape_size,
+      const ParallelCostModelParameters& parameters,
+      std::unordered_map<const HloComputation*,
+                         std::unique_ptr<HloCostAnalysis>>
+          cost_analyses)
       : max_parallelism_(max_parallelism),
-        shape_size_(shape_size),
-        cost_analysis_(std::move(cost_analysis)) {}
+        parameters_(parameters),
+        memory_bound_cost_model_(
+            std::min(max_parallelism, MemoryBoundMaxTasks(parameters)),
+            shape_size, parameters.memory_bound_min_task_bytes),
+        unknown_cost_model_(max_parallelism, shape_size,
+                            parameters.memory_bound_min_task_bytes),
+        cost_analyses_(std::move(cost_analyses)) {}
   ~DefaultCostModel() override {}
 
   int64 GetParallelTaskCount(HloInstruction* instruction) override {
-    // Parameters for parallel task count computation.
-    int64 instruction_cost;
-    int64 min_cost_per_thread;
-    int64 max_parallelism;
-    // Calculate flops-to-bytes-ratio for 'instruction'.
-    const int64 bytes_accessed =
-        std::max(int64{1}, cost_analysis_->bytes_accessed(*instruction));
-    const float flops_to_bytes_ratio =
-        cost_analysis_->flop_count(*instruction) /
-        static_cast<float>(bytes_accessed);
-    // Check for I/O bound instructions.
-    if (flops_to_bytes_ratio <= 1.0) {
+    auto it = cost_analyses_.find(instruction->parent());
+    if (it == cost_analyses_.end()) {
+      // Fall back to a simple cost model based on hlo size and L2 cache size.
+      return unknown_cost_model_.GetParallelTaskCount(instruction);
+    }
+    const HloCostAnalysis& cost_analysis = *it->second;
+    const double bytes_accessed =
+        std::max(int64{1}, cost_analysis.bytes_accessed(*instruction));
+    const double flop_cycles =
+        parameters_.flop_cycles * cost_analysis.flop_count(*instruction);
+    const double transcendental_count =
+        cost_analysis.transcendental_count(*instruction);
+    // Check for I/O bound instructions, by their compute cycles per byte
+    // accessed.
+    if ((flop_cycles + parameters_.memory_bound_transcendental_cycles *
+                           transcendental_count) /
+            bytes_accessed <=
+        parameters_.memory_bound_cycles_per_byte) {
       // Limit max parallelism for I/O bound instructions by assuming a
       // sub-linear scaling function (fit based on empirical benchmark results).
       // TODO(b/29630486) Develop system bandwidth model.
-      max_parallelism =
-          std::ceil(std::sqrt(tensorflow::port::NumSchedulableCPUs()));
-      // Use shape size instruction cost and L2 cache size min per-thread cost.
-      instruction_cost = shape_size_(instruction->shape());
-      min_cost_per_thread = 256LL << 10;  // 256KB L2 Cache size.
-    } else {
-      // Use max parallelism for compute bound instructions.
-      max_parallelism = max_parallelism_;
-      // Calculate the instruction cost in cycles.
-      // TODO(b/29630486) Improve on this linear cost model.
-      // Consider making 'min_cost_per_thread' be a function of the target
-      // bandwidth limit for instructions with low arithmetic complexity.
-      instruction_cost =
-          1 * cost_analysis_->flop_count(*instruction) +
-          2 * cost_analysis_->transcendental_count(*instruction) +
-          10 * cost_analysis_->bytes_accessed(*instruction);
-      // Minimum per-thread cost is 100us of work on a 2GHz core.
-      min_cost_per_thread = 100000;
+      return memory_bound_cost_model_.GetParallelTaskCount(instruction);
     }
+    // Use max parallelism for compute bound instructions, and split them into
+    // tasks of at least 'min_task_cycles'.
+    // TODO(b/29630486) Improve on this linear cost model.
+    const double instruction_cycles =
+        flop_cycles +
+        parameters_.transcendental_cycles * transcendental_count +
+        parameters_.byte_cycles * bytes_accessed;
+    const int64 task_count =
+        static_cast<int64>(instruction_cycles / parameters_.min_task_cycles);
     // Return target parallel task count in [1, max_parallelism_].
-    return std::min(max_parallelism,
-                    std::max(int64{1}, instruction_cost / min_cost_per_thread));
+    return std::min(max_parallelism_, std::max(int64{1}, task_count));
   }
 
  private:
+  static int64 MemoryBoundMaxTasks(
+      const ParallelCostModelParameters& parameters) {
+    if (parameters.memory_bound_max_tasks > 0) {
+      return parameters.memory_bound_max_tasks;
+    }
+    return std::ceil(std::sqrt(tensorflow::port::NumSchedulableCPUs()));
+  }
+
   const int64 max_parallelism_;
-  const HloCostAnalysis::ShapeSizeFunction shape_size_;
-  const std::unique_ptr<HloCostAnalysis> cost_analysis_;
+  const ParallelCostModelParameters parameters_;
+  SimpleCostModel memory_bound_cost_model_;
+  // Sizes the instructions of the computations whose cost analysis failed.
+  SimpleCostModel unknown_cost_model_;
+  const std::unordered_map<const HloComputation*,
+                           std::unique_ptr<HloCostAnalysis>>
+      cost_analyses_;
 };
 
+/* static */ ParallelCostModelParameters
+ParallelCostModelParameters::FromConfig(const HloModuleConfig& config) {
+  ParallelCostModelParameters parameters;
+  if (auto cycles = options::ParallelTaskCycles(config)) {
+    std::tie(parameters.flop_cycles, parameters.transcendental_cycles,
+             parameters.byte_cycles, parameters.min_task_cycles) = *cycles;
+    parameters.memory_bound_transcendental_cycles =
+        parameters.transcendental_cycles;
+  }
+  if (auto tasks = options::ParallelMemoryBoundTasks(config)) {
+    std::tie(parameters.memory_bound_max_tasks,
+             parameters.memory_bound_min_task_bytes) = *tasks;
+  }
+  return parameters;
+}
+
 ParallelTaskAssignment::ParallelTaskAssignment(
     const int64 max_parallelism,
     const HloCostAnalysis::ShapeSizeFunction& shape_size, HloModule* module,
     const TargetMachineFeatures* target_machine_features)
     : target_machine_features_(*target_machine_features) {
   VLOG(1) << "ParallelTaskAssignment max_parallelism: " << max_parallelism;
-  // Run cost analysis on 'module'.
-  auto cost_analysis = absl::make_unique<HloCostAnalysis>(shape_size);
-  HloComputation* computation = module->entry_computation();
-  Status status = computation->root_instruction()->Accept(cost_analysis.get());
-  if (status.ok()) {
-    // Set default cost model based on 'cost_analysis'.
-    cost_model_.reset(new DefaultCostModel(max_parallelism, shape_size,
-                                           std::move(cost_analysis)));
-  } else {
-    // Fall back to a simple cost model based on hlo size and L2 cache size.
-    // Note that HloCostAnalysis can returns an error status (likely because
-    // HLOs like CustomCall are not yet implemented in the HloCostAnalysis).
-    cost_model_.reset(new SimpleCostModel(max_parallelism, shape_size));
+  // Run cost analysis on each computation whose instructions may be assigned
+  // parallel tasks: the entry computation, and the bodies of kWhile and kCall.
+  // Note that HloCostAnalysis can return an error status (likely because HLOs
+  // like CustomCall are not yet implemented in the HloCostAnalysis), in which
+  // case the instructions of the computation are sized by their shape.
+  std::unordered_map<const HloComputation*, std::unique_ptr<HloCostAnalysis>>
+      cost_analyses;
+  for (HloComputation* computation : module->MakeNonfusionComputations()) {
+    auto cost_analysis = absl::make_unique<HloCostAnalysis>(shape_size);
+    Status status =
+        computation->root_instruction()->Accept(cost_analysis.get());
+    if (status.ok()) {
+      cost_analyses.emplace(computation, std::move(cost_analysis));
+    } else {
+      VLOG(1) << "Cost analysis of " << computation->name()
+              << " failed: " << status;
+    }
   }
+  cost_model_.reset(new DefaultCostModel(
+      max_parallelism, shape_size,
+      ParallelCostModelParameters::FromConfig(module->config()),
+      std::move(cost_analyses)));
 }
 
 int64 ParallelTaskAssignment::GetTargetParallelTaskCount(
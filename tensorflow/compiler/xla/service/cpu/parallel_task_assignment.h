@@ -24,6 +24,40 @@ limitations under the License.
 namespace xla {
 namespace cpu {
 
+// Parameters of the default parallel cost model. The defaults were fit on
+// x86 servers; the xla_cpu_parallel_task_cycles and
+// xla_cpu_parallel_memory_bound_tasks backend options override them for other
+// hosts (see cpu_options.h), e.g. from the timings of BM_ParallelTasks in
+// tests/fusion_test.cc.
+struct ParallelCostModelParameters {
+  // Cycles per flop, per transcendental op and per byte accessed by compute
+  // bound instructions.
+  double flop_cycles = 1;
+  double transcendental_cycles = 2;
+  double byte_cycles = 10;
+  // Minimum cycles of work per task, below which the fork/join overhead
+  // dominates. The default is 100us of work on a 2GHz core.
+  double min_task_cycles = 100000;
+
+  // Instructions doing at most this many cycles of compute per byte accessed
+  // are memory bound.
+  double memory_bound_cycles_per_byte = 1;
+  // Cycles per transcendental op counted when checking whether instructions
+  // are memory bound. By default only their flops are counted, and the
+  // xla_cpu_parallel_task_cycles option sets it to transcendental_cycles.
+  double memory_bound_transcendental_cycles = 0;
+  // Maximum task count of memory bound instructions, which scale sub-linearly
+  // with the number of threads. 0 means the square root of the number of
+  // schedulable CPUs.
+  int64 memory_bound_max_tasks = 0;
+  // Minimum bytes of output per task of memory bound instructions. The
+  // default is a typical L2 cache size.
+  int64 memory_bound_min_task_bytes = 256LL << 10;
+
+  // Returns the defaults, overridden by the backend options of `config`.
+  static ParallelCostModelParameters FromConfig(const HloModuleConfig& config);
+};
+
 // Simple interface for different parallel cost model implementations.
 class ParallelCostModel {
  public:
@@ -14,8 +14,13 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/compiler/xla/service/cpu/parallel_task_assignment.h"
+
+#include <map>
+#include <memory>
+
 #include "tensorflow/compiler/xla/service/cpu/cpu_executable.h"
 #include "tensorflow/compiler/xla/service/cpu/target_machine_features_fake.h"
+#include "tensorflow/compiler/xla/service/hlo_parser.h"
 #include "tensorflow/compiler/xla/test.h"
 #include "tensorflow/compiler/xla/tests/hlo_verified_test_base.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -44,6 +49,37 @@ class ParallelTaskAssignmentTest : public HloVerifiedTestBase {
                                      &target_machine_features_)
         .Run(module);
   }
+
+  // Parses 'hlo_string' into a module whose config sets the given backend
+  // options.
+  std::unique_ptr<HloModule> ParseModuleWithOptions(
+      const string& hlo_string,
+      const std::map<string, string>& backend_options) {
+    HloModuleConfig config;
+    DebugOptions debug_options = GetDebugOptionsForTest();
+    for (const auto& option : backend_options) {
+      (*debug_options.mutable_xla_backend_extra_options())[option.first] =
+          option.second;
+    }
+    config.set_debug_options(debug_options);
+    return ParseHloString(hlo_string, config).ConsumeValueOrDie();
+  }
+
+  // Returns the number of parallel tasks assigned to the root of the entry
+  // computation of 'module', or 1 if none were.
+  int64 RootParallelTaskCount(const HloModule& module) {
+    const HloInstruction* root =
+        module.entry_computation()->root_instruction();
+    if (root->opcode() != HloOpcode::kCall) {
+      return 1;
+    }
+    int64 task_count = 1;
+    for (int64 partitions :
+         root->to_apply()->root_instruction()->outer_dimension_partitions()) {
+      task_count *= partitions;
+    }
+    return task_count;
+  }
 };
 
 TEST_F(ParallelTaskAssignmentTest, DotOperationNotParallelized) {
@@ -121,5 +157,144 @@ TEST_F(ParallelTaskAssignmentTest, InfeedOutfeedOperationNotParallelized) {
   EXPECT_FALSE(changed);
 }
 
+TEST_F(ParallelTaskAssignmentTest, MemoryBoundTaskOptions) {
+  const string hlo_string = R"(
+    HloModule TestTaskParallel_add
+    ENTRY Add {
+      lhs = f32[1024,1024]{1,0} parameter(0)
+      rhs = f32[1024,1024]{1,0} parameter(1)
+      ROOT add = f32[1024,1024]{1,0} add(lhs, rhs)
+    }
+  )";
+
+  // 4MB of output, split into at most 4 tasks of at least 256KB.
+  auto module = ParseModuleWithOptions(
+      hlo_string, {{"xla_cpu_parallel_memory_bound_tasks", "4:262144"}});
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunParallelTaskAssigner(module.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_EQ(4, RootParallelTaskCount(*module));
+}
+
+TEST_F(ParallelTaskAssignmentTest, SmallMemoryBoundTasksNotParallelized) {
+  const string hlo_string = R"(
+    HloModule TestTaskParallel_add
+    ENTRY Add {
+      lhs = f32[1024,1024]{1,0} parameter(0)
+      rhs = f32[1024,1024]{1,0} parameter(1)
+      ROOT add = f32[1024,1024]{1,0} add(lhs, rhs)
+    }
+  )";
+
+  auto module = ParseModuleWithOptions(
+      hlo_string, {{"xla_cpu_parallel_memory_bound_tasks", "4:1073741824"}});
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunParallelTaskAssigner(module.get()));
+  EXPECT_FALSE(changed);
+}
+
+TEST_F(ParallelTaskAssignmentTest, TaskCyclesOptions) {
+  const string hlo_string = R"(
+    HloModule TestTaskParallel_exp
+    ENTRY Exp {
+      param = f32[1024,1024]{1,0} parameter(0)
+      ROOT exp = f32[1024,1024]{1,0} exponential(param)
+    }
+  )";
+
+  // By default, only flops make instructions compute bound, so exp is memory
+  // bound.
+  auto module = ParseModuleWithOptions(
+      hlo_string, {{"xla_cpu_parallel_memory_bound_tasks", "2:262144"}});
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunParallelTaskAssigner(module.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_EQ(2, RootParallelTaskCount(*module));
+}
+
+TEST_F(ParallelTaskAssignmentTest, TranscendentalFusionMemoryBoundByDefault) {
+  const string hlo_string = R"(
+    HloModule TestTaskParallel_exp_fusion
+    fused_computation {
+      param = f32[1024,1024]{1,0} parameter(0)
+      exp.0 = f32[1024,1024]{1,0} exponential(param)
+      exp.1 = f32[1024,1024]{1,0} exponential(exp.0)
+      exp.2 = f32[1024,1024]{1,0} exponential(exp.1)
+      exp.3 = f32[1024,1024]{1,0} exponential(exp.2)
+      ROOT exp.4 = f32[1024,1024]{1,0} exponential(exp.3)
+    }
+    ENTRY ExpFusion {
+      param = f32[1024,1024]{1,0} parameter(0)
+      ROOT fusion = f32[1024,1024]{1,0} fusion(param), kind=kLoop,
+        calls=fused_computation
+    }
+  )";
+
+  // At 2 cycles per transcendental op, the fusion does 1.25 cycles of
+  // compute per byte accessed, but it has no flops, so it stays memory bound
+  // unless the cycles are set.
+  auto module = ParseModuleWithOptions(
+      hlo_string, {{"xla_cpu_parallel_memory_bound_tasks", "2:262144"}});
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunParallelTaskAssigner(module.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_EQ(2, RootParallelTaskCount(*module));
+
+  module = ParseModuleWithOptions(
+      hlo_string, {{"xla_cpu_parallel_memory_bound_tasks", "2:262144"},
+                   {"xla_cpu_parallel_task_cycles", "1:2:10:100000"}});
+  TF_ASSERT_OK_AND_ASSIGN(changed, RunParallelTaskAssigner(module.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_EQ(max_parallelism_, RootParallelTaskCount(*module));
+}
+
+TEST_F(ParallelTaskAssignmentTest, ComputeBoundTaskCyclesOptions) {
+  const string hlo_string = R"(
+    HloModule TestTaskParallel_exp
+    ENTRY Exp {
+      param = f32[1024,1024]{1,0} parameter(0)
+      ROOT exp = f32[1024,1024]{1,0} exponential(param)
+    }
+  )";
+
+  // At 100 cycles per transcendental op, exp is compute bound and gets
+  // max_parallelism_ tasks.
+  auto module = ParseModuleWithOptions(
+      hlo_string, {{"xla_cpu_parallel_memory_bound_tasks", "2:262144"},
+                   {"xla_cpu_parallel_task_cycles", "1:100:10:100000"}});
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunParallelTaskAssigner(module.get()));
+  EXPECT_TRUE(changed);
+  EXPECT_EQ(max_parallelism_, RootParallelTaskCount(*module));
+}
+
+TEST_F(ParallelTaskAssignmentTest, WhileBodyParallelized) {
+  const string hlo_string = R"(
+    HloModule TestTaskParallel_while
+    cond {
+      cond_param = (s32[], f32[1024,1024]{1,0}) parameter(0)
+      counter = s32[] get-tuple-element(cond_param), index=0
+      limit = s32[] constant(10)
+      ROOT lt = pred[] less-than(counter, limit)
+    }
+    body {
+      body_param = (s32[], f32[1024,1024]{1,0}) parameter(0)
+      counter = s32[] get-tuple-element(body_param), index=0
+      one = s32[] constant(1)
+      next_counter = s32[] add(counter, one)
+      value = f32[1024,1024]{1,0} get-tuple-element(body_param), index=1
+      next_value = f32[1024,1024]{1,0} add(value, value)
+      ROOT next = (s32[], f32[1024,1024]{1,0}) tuple(next_counter, next_value)
+    }
+    ENTRY While {
+      init_value = f32[1024,1024]{1,0} parameter(0)
+      zero = s32[] constant(0)
+      init = (s32[], f32[1024,1024]{1,0}) tuple(zero, init_value)
+      ROOT while = (s32[], f32[1024,1024]{1,0}) while(init), condition=cond,
+        body=body
+    }
+  )";
+
+  auto module = ParseModuleWithOptions(
+      hlo_string, {{"xla_cpu_parallel_memory_bound_tasks", "4:262144"}});
+  TF_ASSERT_OK_AND_ASSIGN(bool changed, RunParallelTaskAssigner(module.get()));
+  EXPECT_TRUE(changed);
+}
+
 }  // namespace
 }  // namespace xla
@@ -96,10 +96,15 @@ SimpleOrcJIT::SimpleOrcJIT(const llvm::TargetOptions& target_options,
                            bool optimize_for_size, bool enable_fast_math,
                            bool disable_expensive_passes,
                            LLVMCompiler::ModuleHook pre_optimization_hook,
-                           LLVMCompiler::ModuleHook post_optimization_hook)
+                           LLVMCompiler::ModuleHook post_optimization_hook,
+                           const string& object_cache_dir)
     : target_machine_(InferTargetMachineForJIT(target_options, opt_level)),
       disassembler_(*target_machine_),
       data_layout_(target_machine_->createDataLayout()),
+      object_cache_(object_cache_dir.empty()
+                        ? nullptr
+                        : absl::make_unique<ObjectCache>(
+                              tensorflow::Env::Default(), object_cache_dir)),
       symbol_resolver_(llvm::orc::createLegacyLookupResolver(
           execution_session_,
           [this](const std::string& name) -> llvm::JITSymbol {
@@ -122,7 +127,8 @@ SimpleOrcJIT::SimpleOrcJIT(const llvm::TargetOptions& target_options,
                                      opt_level, optimize_for_size,
                                      enable_fast_math, disable_expensive_passes,
                                      std::move(pre_optimization_hook),
-                                     std::move(post_optimization_hook))) {
+                                     std::move(post_optimization_hook),
+                                     object_cache_.get())) {
   VLOG(1) << "CPU target: " << target_machine_->getTargetCPU().str()
           << " features: " << target_machine_->getTargetFeatureString().str();
 }
@@ -0,0 +1,147 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/service/cpu/cpu_executable.h"
+#include "tensorflow/compiler/xla/service/cpu/tests/cpu_codegen_test.h"
+#include "tensorflow/compiler/xla/service/hlo_parser.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace xla {
+namespace cpu {
+namespace {
+
+using ::testing::HasSubstr;
+
+class CpuMemoryBudgetTest : public CpuCodegenTest {
+ protected:
+  // Compiles `hlo_text`, with a peak memory budget of `budget_bytes` unless it
+  // is negative.
+  std::unique_ptr<Executable> Compile(const string& hlo_text,
+                                      int64 budget_bytes) {
+    HloModuleConfig config = GetModuleConfigForTest();
+    if (budget_bytes >= 0) {
+      DebugOptions debug_options = config.debug_options();
+      (*debug_options.mutable_xla_backend_extra_options())
+          ["xla_cpu_memory_budget_bytes"] = absl::StrCat(budget_bytes);
+      config.set_debug_options(debug_options);
+    }
+    std::unique_ptr<HloModule> module =
+        ParseHloString(hlo_text, config).ConsumeValueOrDie();
+    return CompileToExecutable(std::move(module)).ConsumeValueOrDie();
+  }
+
+  // Returns the buffer liveness report of `executable`.
+  static string Report(const Executable& executable) {
+    return static_cast<const CpuExecutable&>(executable)
+        .BufferLivenessReport();
+  }
+
+  // Returns the peak live bytes of the buffer liveness report of `executable`.
+  static int64 PeakLiveBytes(const Executable& executable) {
+    const string report = Report(executable);
+    const string prefix = "peak live bytes: ";
+    const size_t start = report.find(prefix);
+    CHECK_NE(start, string::npos) << report;
+    const size_t end = report.find(' ', start + prefix.size());
+    int64 bytes;
+    CHECK(absl::SimpleAtoi(
+        report.substr(start + prefix.size(), end - start - prefix.size()),
+        &bytes))
+        << report;
+    return bytes;
+  }
+
+  static int64 EntryInstructionCount(const Executable& executable) {
+    return executable.module().entry_computation()->instruction_count();
+  }
+};
+
+const char* const kHloText = R"(
+HloModule DotChain
+
+ENTRY main {
+  p0 = f32[64,64] parameter(0)
+  dot0 = f32[64,64] dot(p0, p0), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  dot1 = f32[64,64] dot(dot0, p0), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  dot2 = f32[64,64] dot(dot1, dot0), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  ROOT tuple = (f32[64,64], f32[64,64]) tuple(dot2, dot1)
+}
+)";
+
+TEST_F(CpuMemoryBudgetTest, ReportsBufferLiveness) {
+  const string report = Report(*Compile(kHloText, /*budget_bytes=*/-1));
+  EXPECT_THAT(report, HasSubstr("BufferLivenessReport(computation=main"));
+  EXPECT_THAT(report, HasSubstr("peak live bytes: "));
+  EXPECT_THAT(report, HasSubstr("live at peak, by defining instruction:"));
+  EXPECT_THAT(report, HasSubstr(" 16384 dot0"));
+}
+
+// "a" is live from the first dot to the fourth one, across the 64KiB "b1".
+// Rematerialization, which leaves out the parameters, peaks at 112KiB with
+// the output: a, b1 and b2 at "b2". Recomputing "a" before "c" brings that
+// down to 96KiB.
+const char* const kRematerializableHloText = R"(
+HloModule DotChainWithLongLivedOperand
+
+ENTRY main {
+  p0 = f32[64,64] parameter(0)
+  p1 = f32[64,256] parameter(1)
+  p2 = f32[256,64] parameter(2)
+  a = f32[64,64] dot(p0, p0), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  b1 = f32[64,256] dot(a, p1), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  b2 = f32[64,64] dot(b1, p2), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  c = f32[64,64] dot(b2, a), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+  ROOT r = f32[64,64] dot(c, p0), lhs_contracting_dims={1},
+    rhs_contracting_dims={0}
+}
+)";
+
+TEST_F(CpuMemoryBudgetTest, SchedulesUnderBudget) {
+  std::unique_ptr<Executable> unbudgeted =
+      Compile(kRematerializableHloText, /*budget_bytes=*/-1);
+
+  // A budget only met by rematerializing "a".
+  std::unique_ptr<Executable> budgeted =
+      Compile(kRematerializableHloText, /*budget_bytes=*/100000);
+  EXPECT_LE(PeakLiveBytes(*budgeted), PeakLiveBytes(*unbudgeted));
+  EXPECT_EQ(EntryInstructionCount(*unbudgeted) + 1,
+            EntryInstructionCount(*budgeted));
+
+  // A budget large enough for any schedule leaves the module unchanged.
+  std::unique_ptr<Executable> loose =
+      Compile(kRematerializableHloText, /*budget_bytes=*/1 << 30);
+  EXPECT_EQ(PeakLiveBytes(*unbudgeted), PeakLiveBytes(*loose));
+  EXPECT_EQ(EntryInstructionCount(*unbudgeted), EntryInstructionCount(*loose));
+
+  // A budget that can't be met even with rematerialization is only a warning.
+  EXPECT_THAT(Report(*Compile(kHloText, /*budget_bytes=*/1)),
+              HasSubstr("peak live bytes: "));
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace xla
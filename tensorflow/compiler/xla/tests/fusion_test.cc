@@ -23,6 +23,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
 #include "absl/types/span.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/compiler/xla/array2d.h"
@@ -41,8 +42,10 @@ limitations under the License.
 #include "tensorflow/compiler/xla/tests/hlo_test_base.h"
 #include "tensorflow/compiler/xla/tests/literal_test_util.h"
 #include "tensorflow/compiler/xla/tests/test_macros.h"
+#include "tensorflow/compiler/xla/tests/test_utils.h"
 #include "tensorflow/compiler/xla/xla_data.pb.h"
 #include "tensorflow/core/common_runtime/eigen_thread_pool.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -938,5 +941,191 @@ void BM_ParallelFusion(int num_iters) {
 
 BENCHMARK(BM_ParallelFusion);
 
+// Typical modules of inference graphs, to compare the parallel task
+// assignments of the CPU backend. Set the xla_cpu_parallel_task_cycles and
+// xla_cpu_parallel_memory_bound_tasks backend options through
+// --xla_backend_extra_options in XLA_FLAGS to time other parameters of its
+// cost model.
+const char* const kParallelTasksModules[] = {
+    // Memory bound elementwise fusion.
+    R"(
+HloModule ElementwiseFusion
+
+ENTRY main {
+  p0 = f32[1024,1024] parameter(0)
+  p1 = f32[1024,1024] parameter(1)
+  mul = f32[1024,1024] multiply(p0, p1)
+  ROOT add = f32[1024,1024] add(mul, p0)
+}
+)",
+    // Compute bound elementwise fusion.
+    R"(
+HloModule TranscendentalFusion
+
+ENTRY main {
+  p0 = f32[1024,1024] parameter(0)
+  exp = f32[1024,1024] exponential(p0)
+  ROOT tanh = f32[1024,1024] tanh(exp)
+}
+)",
+    // Reduction over the minor dimension.
+    R"(
+HloModule RowReduce
+
+Sum {
+  x = f32[] parameter(0)
+  y = f32[] parameter(1)
+  ROOT add = f32[] add(x, y)
+}
+
+ENTRY main {
+  p0 = f32[4096,1024] parameter(0)
+  zero = f32[] constant(0)
+  ROOT reduce = f32[4096] reduce(p0, zero), dimensions={1}, to_apply=Sum
+}
+)",
+    // Vectorized reduction over a major dimension.
+    R"(
+HloModule ColumnReduce
+
+Sum {
+  x = f32[] parameter(0)
+  y = f32[] parameter(1)
+  ROOT add = f32[] add(x, y)
+}
+
+ENTRY main {
+  p0 = f32[64,256,1024] parameter(0)
+  zero = f32[] constant(0)
+  ROOT reduce = f32[64,1024] reduce(p0, zero), dimensions={1}, to_apply=Sum
+}
+)",
+    // Bias add.
+    R"(
+HloModule BroadcastAdd
+
+ENTRY main {
+  p0 = f32[2048,1024] parameter(0)
+  p1 = f32[1024] parameter(1)
+  bias = f32[2048,1024] broadcast(p1), dimensions={1}
+  ROOT add = f32[2048,1024] add(p0, bias)
+}
+)",
+};
+
+// Times the executions of the module parsed from "hlo_string" on fake
+// arguments.
+void RunHloBenchmark(int num_iters, const string& hlo_string) {
+  tensorflow::testing::StopTiming();
+
+  se::Platform* platform = PlatformUtil::GetDefaultPlatform().ValueOrDie();
+  auto executors = PlatformUtil::GetStreamExecutors(platform).ValueOrDie();
+  StreamExecutorMemoryAllocator allocator(platform, executors);
+
+  const int64 intra_op_parallelism_threads =
+      tensorflow::port::NumSchedulableCPUs();
+  xla::LocalClientOptions client_options;
+  client_options.set_platform(platform);
+  client_options.set_intra_op_parallelism_threads(intra_op_parallelism_threads);
+  auto client =
+      ClientLibrary::GetOrCreateLocalClient(client_options).ValueOrDie();
+  int device_ordinal = client->default_device_ordinal();
+
+  // Build executable. The module is compiled through the client, which reads
+  // the backend options from XLA_FLAGS.
+  std::unique_ptr<HloModule> module = ParseHloString(hlo_string).ValueOrDie();
+  std::vector<Literal> arguments =
+      MakeFakeArguments(module.get()).ValueOrDie();
+  std::vector<ScopedShapedBuffer> buffers;
+  std::vector<const Shape*> argument_shapes;
+  std::vector<const ShapedBuffer*> argument_buffers;
+  int64 total_bytes = 0;
+  for (const Literal& argument : arguments) {
+    buffers.push_back(client->LiteralToShapedBuffer(argument, device_ordinal)
+                          .ConsumeValueOrDie());
+    total_bytes += argument.size_bytes();
+  }
+  for (const ScopedShapedBuffer& buffer : buffers) {
+    argument_shapes.push_back(&buffer.on_host_shape());
+    argument_buffers.push_back(&buffer);
+  }
+  std::unique_ptr<LocalExecutable> executable =
+      client
+          ->Compile(XlaComputation(module->ToProto()), argument_shapes,
+                    ExecutableBuildOptions())
+          .ConsumeValueOrDie();
+
+  se::Stream stream(executors[device_ordinal]);
+  stream.Init();
+
+  // Initialize thread pool.
+  tensorflow::thread::ThreadPool pool(tensorflow::Env::Default(), "XLAEigen",
+                                      intra_op_parallelism_threads);
+  tensorflow::EigenThreadPoolWrapper tp(&pool);
+  Eigen::ThreadPoolDevice device(&tp, tp.NumThreads());
+
+  // Initialize ExecutableRunOptions.
+  ExecutableRunOptions options;
+  options.set_allocator(&allocator).set_stream(&stream);
+  options.set_intra_op_thread_pool(&device);
+
+  // Run some warm-up executions.
+  const int kWarmups = 2;
+  for (int i = 0; i < kWarmups; ++i) {
+    auto result = executable->Run(argument_buffers, options);
+    ASSERT_TRUE(result.ok());
+  }
+
+  // Run benchmark.
+  tensorflow::testing::BytesProcessed(static_cast<int64>(num_iters) *
+                                      total_bytes);
+  tensorflow::testing::UseRealTime();
+  tensorflow::testing::StartTiming();
+  for (int i = 0; i < num_iters; ++i) {
+    auto result = executable->Run(argument_buffers, options);
+    ASSERT_TRUE(result.ok());
+  }
+}
+
+void BM_ParallelTasks(int num_iters, int module_index) {
+  RunHloBenchmark(num_iters, kParallelTasksModules[module_index]);
+}
+
+BENCHMARK(BM_ParallelTasks)->Arg(0)->Arg(1)->Arg(2)->Arg(3)->Arg(4);
+
+// Sums of the rows and of the columns of f32[num_x,num_y], to compare with
+// BM_Sum2DRowReduceCPU and BM_Sum2DColumnReduceCPU of the Eigen kernels in
+// core/kernels/reduction_ops_test.cc.
+string Sum2DHloString(int num_x, int num_y, int dimension) {
+  return absl::StrFormat(R"(
+HloModule Sum2D
+
+Sum {
+  x = f32[] parameter(0)
+  y = f32[] parameter(1)
+  ROOT add = f32[] add(x, y)
+}
+
+ENTRY main {
+  p0 = f32[%d,%d] parameter(0)
+  zero = f32[] constant(0)
+  ROOT reduce = f32[%d] reduce(p0, zero), dimensions={%d}, to_apply=Sum
+}
+)",
+                         num_x, num_y, dimension == 0 ? num_y : num_x,
+                         dimension);
+}
+
+void BM_Sum2DRowReduce(int num_iters, int num_x, int num_y) {
+  RunHloBenchmark(num_iters, Sum2DHloString(num_x, num_y, 1));
+}
+
+void BM_Sum2DColumnReduce(int num_iters, int num_x, int num_y) {
+  RunHloBenchmark(num_iters, Sum2DHloString(num_x, num_y, 0));
+}
+
+BENCHMARK(BM_Sum2DRowReduce)->RangePair(1, 8192, 1, 8192);
+BENCHMARK(BM_Sum2DColumnReduce)->RangePair(1, 8192, 1, 8192);
+
 }  // namespace
 }  // namespace xla
@@ -125,5 +125,100 @@ INSTANTIATE_TEST_CASE_P(ReduceWithLayoutTest_Instantiation,
                             ReduceLayout{{0, 2, 1, 3}, {2, 0, 1}}),  //
                         PrintReduceLayout);
 
+class ReduceHloTest : public HloTestBase {};
+
+// Reduces a middle dimension of an operand large enough for the CPU backend to
+// split the reduction into parallel tasks over the outer output dimension.
+XLA_TEST_F(ReduceHloTest, PartitionedVectorizedReduce) {
+  const char* const hlo_string = R"(
+HloModule PartitionedReduce
+
+Sum {
+  x = f32[] parameter(0)
+  y = f32[] parameter(1)
+  ROOT add = f32[] add(x, y)
+}
+
+ENTRY reduce {
+  parameter = f32[64,64,256]{2,1,0} parameter(0)
+  init_value = f32[] constant(0)
+  ROOT reduce = f32[64,256]{1,0} reduce(parameter, init_value),
+    dimensions={1}, to_apply=Sum
+}
+)";
+
+  // Assign memory bound instructions a task per 4KB of output.
+  HloModuleConfig config = GetModuleConfigForTest();
+  DebugOptions debug_options = config.debug_options();
+  (*debug_options.mutable_xla_backend_extra_options())
+      ["xla_cpu_parallel_memory_bound_tasks"] = "8:4096";
+  config.set_debug_options(debug_options);
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<HloModule> module,
+                          ParseHloString(hlo_string, config));
+  EXPECT_TRUE(RunAndCompare(std::move(module), ErrorSpec(1e-4)));
+}
+
+// Reduces the most minor dimensions, with rows of lengths that are not
+// multiples of the vector register size.
+XLA_TEST_F(ReduceHloTest, RowReduceAdd) {
+  const char* const hlo_string = R"(
+HloModule RowReduceAdd
+
+Sum {
+  x = f32[] parameter(0)
+  y = f32[] parameter(1)
+  ROOT add = f32[] add(x, y)
+}
+
+ENTRY reduce {
+  parameter = f32[37,1027]{1,0} parameter(0)
+  init_value = f32[] constant(1)
+  ROOT reduce = f32[37]{0} reduce(parameter, init_value), dimensions={1},
+    to_apply=Sum
+}
+)";
+  EXPECT_TRUE(RunAndCompare(hlo_string, ErrorSpec(1e-3, 1e-3)));
+}
+
+XLA_TEST_F(ReduceHloTest, RowReduceMaxOverTwoDimensions) {
+  const char* const hlo_string = R"(
+HloModule RowReduceMax
+
+Max {
+  x = f32[] parameter(0)
+  y = f32[] parameter(1)
+  ROOT max = f32[] maximum(x, y)
+}
+
+ENTRY reduce {
+  parameter = f32[6,5,3,43]{3,2,1,0} parameter(0)
+  init_value = f32[] constant(-inf)
+  ROOT reduce = f32[6,5]{1,0} reduce(parameter, init_value),
+    dimensions={2,3}, to_apply=Max
+}
+)";
+  EXPECT_TRUE(RunAndCompare(hlo_string, ErrorSpec(1e-5)));
+}
+
+XLA_TEST_F(ReduceHloTest, RowReduceIntegerAdd) {
+  const char* const hlo_string = R"(
+HloModule RowReduceIntegerAdd
+
+Sum {
+  x = s32[] parameter(0)
+  y = s32[] parameter(1)
+  ROOT add = s32[] add(x, y)
+}
+
+ENTRY reduce {
+  parameter = s32[3,4,21]{2,1,0} parameter(0)
+  init_value = s32[] constant(0)
+  ROOT reduce = s32[3,4]{1,0} reduce(parameter, init_value), dimensions={2},
+    to_apply=Sum
+}
+)";
+  EXPECT_TRUE(RunAndCompare(hlo_string, absl::nullopt));
+}
+
 }  // namespace
 }  // namespace xla
@@ -148,6 +148,10 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
     }
   }
   // Go through the graph in execution order.
+  // The inputs no longer needed once the current step is done. They are only
+  // queued for deallocation with the last node of the step, so that they
+  // don't share memory with the outputs of nodes executed concurrently.
+  std::vector<int> step_deallocations;
   for (int i = 0; i < graph_info_->num_nodes(); ++i) {
     const TfLiteNode& node = graph_info_->node(i);
 
@@ -167,11 +171,19 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
         if (tensor_index != kOptionalTensor) {
           refcounts[tensor_index]--;
           if (refcounts[tensor_index] == 0) {
-            TF_LITE_ENSURE_STATUS(deallocate(i, tensor_index));
+            step_deallocations.push_back(tensor_index);
           }
         }
       }
     }
+
+    if (i + 1 == graph_info_->num_nodes() ||
+        graph_info_->node_step(i + 1) != graph_info_->node_step(i)) {
+      for (int tensor_index : step_deallocations) {
+        TF_LITE_ENSURE_STATUS(deallocate(i, tensor_index));
+      }
+      step_deallocations.clear();
+    }
   }
 
   // Note that graph outputs will never be scheduled for deallocation. We
@@ -206,6 +218,11 @@ TfLiteStatus ArenaPlanner::Commit() {
 }
 
 TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
+  // The temporaries of all the nodes of a step are allocated when the step
+  // starts and deallocated when it ends, since the nodes may be executed
+  // concurrently. `step_first_node` is the first node of the current step
+  // whose temporaries are allocated.
+  int step_first_node = first_node;
   int active_node = first_node;
   // When dynamic tensors are present this method is called multiple times.
   // The items in the alloc_queue_ referring to nodes before first_node were
@@ -214,15 +231,19 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
   for (const auto& alloc_info : alloc_queue_) {
     if (alloc_info.node < first_node) continue;
     if (alloc_info.node > last_node) break;
-    if (alloc_info.node == active_node) {
-      // This is the first allocation/deallocation for a given node.  It is
-      // time to deallocate the previous temporaries and allocate new ones.
-      if (active_node != first_node) {
+    for (; active_node <= alloc_info.node; ++active_node) {
+      // This is the first allocation/deallocation for a given node. If it
+      // starts a new step, it is time to deallocate the temporaries of the
+      // previous step. Then allocate its own temporaries.
+      if (active_node != first_node &&
+          graph_info_->node_step(active_node) !=
+              graph_info_->node_step(active_node - 1)) {
         TF_LITE_ENSURE_STATUS(
-            CalculateDeallocationOfInternalTensors(active_node - 1));
+            CalculateDeallocationOfInternalTensors(step_first_node,
+                                                   active_node - 1));
+        step_first_node = active_node;
       }
       TF_LITE_ENSURE_STATUS(CalculateAllocationOfInternalTensors(active_node));
-      ++active_node;
     }
     // Handle the current item.
     if (alloc_info.type == AllocationInfo::ALLOC) {
@@ -232,9 +253,9 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(int first_node, int last_node) {
     }
   }
 
-  // Don't forget to deallocate temporaries of last node.
+  // Don't forget to deallocate temporaries of the last step.
   TF_LITE_ENSURE_STATUS(
-      CalculateDeallocationOfInternalTensors(active_node - 1));
+      CalculateDeallocationOfInternalTensors(step_first_node, active_node - 1));
 
   return kTfLiteOk;
 }
@@ -291,13 +312,15 @@ TfLiteStatus ArenaPlanner::CalculateAllocationOfInternalTensors(
 }
 
 TfLiteStatus ArenaPlanner::CalculateDeallocationOfInternalTensors(
-    int node_index) {
-  if (node_index < graph_info_->num_nodes()) {
-    const TfLiteNode& node = graph_info_->node(node_index);
-    TfLiteIntArray* node_temporaries = node.temporaries;
-    for (int i = 0; i < node_temporaries->size; ++i) {
-      int tensor_index = node_temporaries->data[i];
-      TF_LITE_ENSURE_STATUS(CalculateTensorDeallocation(tensor_index));
+    int first_node, int last_node) {
+  for (int node_index = first_node; node_index <= last_node; ++node_index) {
+    if (node_index < graph_info_->num_nodes()) {
+      const TfLiteNode& node = graph_info_->node(node_index);
+      TfLiteIntArray* node_temporaries = node.temporaries;
+      for (int i = 0; i < node_temporaries->size; ++i) {
+        int tensor_index = node_temporaries->data[i];
+        TF_LITE_ENSURE_STATUS(CalculateTensorDeallocation(tensor_index));
+      }
     }
   }
   return kTfLiteOk;
@@ -44,6 +44,11 @@ struct AllocationInfo;
 // execution. Since dynamic tensors don't have sizes until after the
 // corresponding operation is executed, this class supports incremental
 // planning.
+//
+// If the graph groups nodes into steps that may be executed concurrently (see
+// GraphInfo::node_step()), the tensors used by the nodes of a step never share
+// memory: the outputs and temporaries of all the nodes of a step are allocated
+// before anything the step consumes is deallocated.
 class ArenaPlanner : public MemoryPlanner {
  public:
   // Ownership of 'context' is not taken and it must remain util the
@@ -87,9 +92,10 @@ class ArenaPlanner : public MemoryPlanner {
   // 'node_index'.
   TfLiteStatus CalculateAllocationOfInternalTensors(int node_index);
 
-  // Register a deallocation for all internal (temporary) tensors of
-  // 'node_index'.
-  TfLiteStatus CalculateDeallocationOfInternalTensors(int node_index);
+  // Register a deallocation for all internal (temporary) tensors of the nodes
+  // in the interval [first_node, last_node].
+  TfLiteStatus CalculateDeallocationOfInternalTensors(int first_node,
+                                                      int last_node);
 
   TfLiteContext* context_;
   std::unique_ptr<GraphInfo> graph_info_;
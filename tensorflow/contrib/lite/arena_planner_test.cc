@@ -108,12 +108,19 @@ class TestGraph {
     variables_ = variables;
   }
 
+  const std::vector<int>& node_steps() { return node_steps_; }
+
+  void SetNodeSteps(const std::vector<int>& node_steps) {
+    node_steps_ = node_steps;
+  }
+
  private:
   std::vector<TfLiteNode> nodes_;
   std::vector<TfLiteTensor> tensors_;
   std::vector<int> inputs_;
   std::vector<int> outputs_;
   std::vector<int> variables_;
+  std::vector<int> node_steps_;
 };
 
 // The GraphInfo for a TestGraph.
@@ -134,6 +141,9 @@ class TestGraphInfo : public GraphInfo {
   const std::vector<int>& variables() const override {
     return graph_->variables();
   }
+  int node_step(size_t index) const override {
+    return graph_->node_steps().empty() ? index : graph_->node_steps()[index];
+  }
 
  private:
   TestGraph* graph_;
@@ -394,6 +404,59 @@ TEST_F(ArenaPlannerTest, SimpleGraphWithDynamicTensor) {
   EXPECT_EQ(GetOffset(3), 0);
 }
 
+TEST_F(ArenaPlannerTest, ConcurrentSteps) {
+  TestGraph graph({4, 5},
+                  {
+                      /* in, out, tmp */
+                      {{4}, {0}, {}},     // First op
+                      {{5}, {1}, {}},     // Second op
+                      {{0, 1}, {2}, {}},  // Third op
+                  },
+                  {2});
+  SetGraph(&graph);
+  Execute(0, 10);
+
+  // Alloc(+) and dealloc(-) order: +4 +5 +0 -4 +1 -5 +2 -0 -1
+  EXPECT_EQ(GetOffset(0), GetOffsetAfter(5));
+  EXPECT_EQ(GetOffset(1), 0);
+
+  // With the first two ops in the same step, #1 can't reuse the memory of #4.
+  graph.SetNodeSteps({0, 0, 1});
+  SetGraph(&graph);
+  Execute(0, 10);
+
+  // Alloc(+) and dealloc(-) order: +4 +5 +0 +1 -4 -5 +2 -0 -1
+  EXPECT_EQ(GetOffset(0), GetOffsetAfter(5));
+  EXPECT_EQ(GetOffset(1), GetOffsetAfter(0));
+  EXPECT_EQ(GetOffset(2), 0);
+}
+
+TEST_F(ArenaPlannerTest, ConcurrentStepsWithTemporaries) {
+  TestGraph graph({4, 5},
+                  {
+                      /* in, out, tmp */
+                      {{4}, {0}, {6}},    // First op, with temporary
+                      {{5}, {1}, {3}},    // Second op, with temporary
+                      {{0, 1}, {2}, {}},  // Third op
+                  },
+                  {2});
+  graph.SetNodeSteps({0, 0, 1});
+  SetGraph(&graph);
+  Execute(0, 10);
+
+  // None of the tensors used by the first step share memory.
+  std::vector<int> step_tensors = {4, 5, 0, 1, 6, 3};
+  for (int a : step_tensors) {
+    for (int b : step_tensors) {
+      if (a != b) {
+        EXPECT_TRUE(GetOffsetAfter(a) <= GetOffset(b) ||
+                    GetOffsetAfter(b) <= GetOffset(a))
+            << a << " and " << b << " overlap";
+      }
+    }
+  }
+}
+
 TEST_F(ArenaPlannerTest, LargerGraphAndStepwiseAllocation) {
   TestGraph graph({0, 1},
                   {
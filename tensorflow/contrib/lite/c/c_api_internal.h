@@ -44,10 +44,11 @@ typedef enum { kTfLiteOk = 0, kTfLiteError = 1 } TfLiteStatus;
 // need. Access to the external contexts is controled by one of the
 // corresponding support files.
 typedef enum {
-  kTfLiteEigenContext = 0,     // include eigen_support.h to use.
-  kTfLiteGemmLowpContext = 1,  // include gemm_support.h to use.
-  kTfLiteEdgeTpuContext = 2,   // Placeholder for Edge TPU support.
-  kTfLiteMaxExternalContexts = 3
+  kTfLiteEigenContext = 0,            // include eigen_support.h to use.
+  kTfLiteGemmLowpContext = 1,         // include gemm_support.h to use.
+  kTfLiteEdgeTpuContext = 2,          // Placeholder for Edge TPU support.
+  kTfLitePreparedWeightsContext = 3,  // include prepared_weights_cache.h.
+  kTfLiteMaxExternalContexts = 4
 } TfLiteExternalContextType;
 
 // An external context is a collection of information unrelated to the TF Lite
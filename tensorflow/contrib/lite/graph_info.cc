@@ -221,4 +221,37 @@ TfLiteStatus PartitionGraphIntoIndependentSubgraphs(
   return kTfLiteOk;
 }
 
+std::vector<int> AssignNodesToConcurrentSteps(GraphInfo* info) {
+  // The step of the node producing each tensor, or of the last node using it
+  // for variable tensors. -1 for inputs and constants.
+  std::vector<int> tensor_steps(info->num_tensors(), -1);
+  std::vector<int> node_steps(info->num_nodes(), 0);
+  for (int i = 0; i < info->num_nodes(); ++i) {
+    const TfLiteNode& node = info->node(i);
+    int step = 0;
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index != kOptionalTensor) {
+        step = std::max(step, tensor_steps[tensor_index] + 1);
+      }
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+      if (info->tensor(tensor_index)->is_variable) {
+        step = std::max(step, tensor_steps[tensor_index] + 1);
+      }
+    }
+    node_steps[i] = step;
+
+    for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+      tensor_steps[tensor_index] = step;
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index != kOptionalTensor &&
+          info->tensor(tensor_index)->is_variable) {
+        tensor_steps[tensor_index] = step;
+      }
+    }
+  }
+  return node_steps;
+}
+
 }  // namespace tflite
@@ -49,6 +49,12 @@ class GraphInfo {
 
   // Returns the indices of the variable tensors.
   virtual const std::vector<int>& variables() const = 0;
+
+  // Returns the step in which the node at `index` is executed. Steps are
+  // executed in order, but the nodes of a step may be executed concurrently.
+  // Steps are non-decreasing with the node index. By default, each node is
+  // executed in a step of its own.
+  virtual int node_step(size_t index) const { return index; }
 };
 
 // Represents a subgraph of a TensorFlow Lite graph.
@@ -77,6 +83,13 @@ TfLiteStatus PartitionGraphIntoIndependentSubgraphs(
     const GraphInfo* info, const TfLiteIntArray* nodes_to_partition,
     std::vector<Subgraph>* subgraphs);
 
+// Assigns each node of `info`, which must be in dependency order, to the
+// earliest step in which it can be executed if the nodes of a step are
+// executed concurrently: after the steps of the nodes producing its inputs,
+// and after the steps of the earlier nodes using the same variable tensors.
+// Returns the step of each node.
+std::vector<int> AssignNodesToConcurrentSteps(GraphInfo* info);
+
 }  // namespace tflite
 
 #endif  // TENSORFLOW_CONTRIB_LITE_GRAPH_INFO_H_
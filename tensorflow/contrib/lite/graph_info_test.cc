@@ -262,6 +262,33 @@ TEST(PartitionTest, Nodes3PartitionNodes2) {
       {expected_subgraph0, expected_subgraph1, expected_subgraph2});
 }
 
+TEST(ConcurrentStepsTest, IndependentBranches) {
+  SimpleTestGraph graph;
+  graph.AddTensors(7);
+  graph.AddNode({0}, {1});
+  graph.AddNode({1}, {2});
+  graph.AddNode({0}, {3});
+  graph.AddNode({3}, {4});
+  graph.AddNode({2, 4}, {5});
+  graph.AddNode({kOptionalTensor, 0}, {6});
+  graph.SetInputsAndOutputs({0}, {5, 6});
+  EXPECT_EQ(AssignNodesToConcurrentSteps(&graph),
+            std::vector<int>({0, 1, 0, 1, 2, 0}));
+}
+
+TEST(ConcurrentStepsTest, OrdersUsesOfVariables) {
+  SimpleTestGraph graph;
+  graph.AddTensors(4);
+  graph.tensor(1)->is_variable = true;
+  // Reads the variable, then writes it, then reads it again.
+  graph.AddNode({0, 1}, {2});
+  graph.AddNode({0}, {1});
+  graph.AddNode({1}, {3});
+  graph.SetInputsAndOutputs({0}, {2, 3});
+  EXPECT_EQ(AssignNodesToConcurrentSteps(&graph),
+            std::vector<int>({0, 1, 2}));
+}
+
 }  // namespace
 }  // namespace tflite
 
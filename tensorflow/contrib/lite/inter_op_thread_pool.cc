@@ -0,0 +1,77 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/lite/inter_op_thread_pool.h"
+
+namespace tflite {
+
+InterOpThreadPool::InterOpThreadPool(int num_threads) {
+  for (int i = 1; i < num_threads; ++i) {
+    threads_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+InterOpThreadPool::~InterOpThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  tasks_available_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void InterOpThreadPool::Run(int num_tasks,
+                            const std::function<void(int)>& task) {
+  if (num_tasks <= 0) return;
+  std::unique_lock<std::mutex> lock(mutex_);
+  task_ = &task;
+  num_tasks_ = num_tasks;
+  next_task_ = 0;
+  num_unfinished_tasks_ = num_tasks;
+  if (num_tasks > 1) {
+    tasks_available_.notify_all();
+  }
+  RunTasks(&lock);
+  tasks_done_.wait(lock, [this] { return num_unfinished_tasks_ == 0; });
+  task_ = nullptr;
+}
+
+void InterOpThreadPool::RunTasks(std::unique_lock<std::mutex>* lock) {
+  while (task_ != nullptr && next_task_ < num_tasks_) {
+    const std::function<void(int)>& task = *task_;
+    int i = next_task_++;
+    lock->unlock();
+    task(i);
+    lock->lock();
+    if (--num_unfinished_tasks_ == 0) {
+      tasks_done_.notify_one();
+    }
+  }
+}
+
+void InterOpThreadPool::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    tasks_available_.wait(lock, [this] {
+      return stopping_ || (task_ != nullptr && next_task_ < num_tasks_);
+    });
+    if (stopping_) return;
+    RunTasks(&lock);
+  }
+}
+
+}  // namespace tflite
@@ -0,0 +1,69 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CONTRIB_LITE_INTER_OP_THREAD_POOL_H_
+#define TENSORFLOW_CONTRIB_LITE_INTER_OP_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tflite {
+
+// The threads on which the Interpreter executes the nodes of a step
+// concurrently (see Interpreter::SetNumInterOpThreads()).
+class InterOpThreadPool {
+ public:
+  // Starts num_threads - 1 threads: the thread calling Run() is the last one.
+  explicit InterOpThreadPool(int num_threads);
+  ~InterOpThreadPool();
+  InterOpThreadPool(const InterOpThreadPool&) = delete;
+  InterOpThreadPool& operator=(const InterOpThreadPool&) = delete;
+
+  int num_threads() const { return threads_.size() + 1; }
+
+  // Calls task(i) for each i in [0, num_tasks) on the threads of the pool and
+  // the calling thread, and returns once all the calls have returned. Must not
+  // be called concurrently.
+  void Run(int num_tasks, const std::function<void(int)>& task);
+
+ private:
+  // Runs tasks of the current Run() until there are none left to start.
+  // `lock` must hold mutex_.
+  void RunTasks(std::unique_lock<std::mutex>* lock);
+
+  void WorkerLoop();
+
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  // Signaled when tasks are available to the workers, or when stopping.
+  std::condition_variable tasks_available_;
+  // Signaled when the last task of the current Run() returns.
+  std::condition_variable tasks_done_;
+
+  // The current Run(), guarded by mutex_.
+  const std::function<void(int)>* task_ = nullptr;
+  int num_tasks_ = 0;
+  int next_task_ = 0;
+  int num_unfinished_tasks_ = 0;
+  bool stopping_ = false;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_CONTRIB_LITE_INTER_OP_THREAD_POOL_H_
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/contrib/lite/interpreter.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
 #include <cstdint>
@@ -25,6 +26,7 @@ limitations under the License.
 #include "tensorflow/contrib/lite/context_util.h"
 #include "tensorflow/contrib/lite/core/api/error_reporter.h"
 #include "tensorflow/contrib/lite/graph_info.h"
+#include "tensorflow/contrib/lite/inter_op_thread_pool.h"
 #include "tensorflow/contrib/lite/memory_planner.h"
 #include "tensorflow/contrib/lite/nnapi_delegate.h"
 #include "tensorflow/contrib/lite/profiling/profiler.h"
@@ -84,10 +86,14 @@ bool HasDynamicTensorImpl(const TfLiteContext& context,
 // graph that is executed according to execution plan. Thus,
 // the indices are execution plan indices rather than raw node
 // indices.
+//
+// `node_steps` are the steps of the nodes of the execution plan, if it was
+// scheduled in concurrent steps.
 class InterpreterInfo : public GraphInfo {
  public:
-  explicit InterpreterInfo(Interpreter* interpreter)
-      : interpreter_(interpreter) {}
+  explicit InterpreterInfo(Interpreter* interpreter,
+                           std::vector<int> node_steps = {})
+      : interpreter_(interpreter), node_steps_(std::move(node_steps)) {}
 
   size_t num_tensors() const override { return interpreter_->tensors_size(); }
   TfLiteTensor* tensor(size_t index) override {
@@ -109,9 +115,13 @@ class InterpreterInfo : public GraphInfo {
   const std::vector<int>& variables() const override {
     return interpreter_->variables();
   }
+  int node_step(size_t index) const override {
+    return node_steps_.size() == num_nodes() ? node_steps_[index] : index;
+  }
 
  public:
   Interpreter* interpreter_;
+  std::vector<int> node_steps_;
 };
 
 Interpreter::Interpreter(ErrorReporter* error_reporter)
@@ -259,6 +269,7 @@ TfLiteStatus Interpreter::ReplaceSubgraphsWithDelegateKernels(
   PartitionGraphIntoIndependentSubgraphs(&info, nodes_to_replace, &subgraphs);
 
   execution_plan_.clear();
+  execution_plan_steps_.clear();
   for (auto& subgraph : subgraphs) {
     // Subgraphs calimed by the delegate should have a "macro" op created, the
     // other subgraphs (kTfNonPartition) just have their nodes added back to
@@ -391,40 +402,7 @@ TfLiteStatus Interpreter::CheckTensorIndices(const char* label,
 
 TfLiteStatus Interpreter::BytesRequired(TfLiteType type, const int* dims,
                                         size_t dims_size, size_t* bytes) {
-  // TODO(aselle): Check for overflow here using overflow.h in TensorFlow
-  // MultiplyWithoutOverflow.
-  TF_LITE_ENSURE(&context_, bytes != nullptr);
-  size_t count = 1;
-  for (int k = 0; k < dims_size; k++) count *= dims[k];
-  switch (type) {
-    case kTfLiteFloat32:
-      *bytes = sizeof(float) * count;
-      break;
-    case kTfLiteInt16:
-      *bytes = sizeof(int16_t) * count;
-      break;
-    case kTfLiteInt32:
-      *bytes = sizeof(int32_t) * count;
-      break;
-    case kTfLiteUInt8:
-      *bytes = sizeof(uint8_t) * count;
-      break;
-    case kTfLiteInt64:
-      *bytes = sizeof(int64_t) * count;
-      break;
-    case kTfLiteBool:
-      *bytes = sizeof(bool) * count;
-      break;
-    case kTfLiteComplex64:
-      *bytes = sizeof(std::complex<float>) * count;
-      break;
-    default:
-      ReportError(&context_,
-                  "Only float32, int16, int32, int64, uint8, bool, complex64 "
-                  "supported currently.");
-      return kTfLiteError;
-  }
-  return kTfLiteOk;
+  return tflite::BytesRequired(&context_, type, dims, dims_size, bytes);
 }
 
 TfLiteStatus Interpreter::AllocateTensors() {
@@ -600,8 +578,13 @@ TfLiteStatus Interpreter::PrepareOpsStartingAt(
 
 TfLiteStatus Interpreter::PrepareOpsAndTensors() {
   if (!memory_planner_) {
+    std::vector<int> node_steps;
+    if (inter_op_thread_pool_) {
+      node_steps = ScheduleExecutionPlanInConcurrentSteps();
+    }
     memory_planner_.reset(new ArenaPlanner(
-        &context_, std::unique_ptr<GraphInfo>(new InterpreterInfo(this)),
+        &context_,
+        std::unique_ptr<GraphInfo>(new InterpreterInfo(this, node_steps)),
         /*preserve_inputs=*/true, /*preserve_intermediates*/ false));
     memory_planner_->PlanAllocations();
   }
@@ -642,6 +625,10 @@ TfLiteStatus Interpreter::Invoke() {
     }
   }
 
+  if (CanInvokeConcurrently()) {
+    return InvokeConcurrently();
+  }
+
   // Invocations are always done in node order.
   // Note that calling Invoke repeatedly will cause the original memory plan to
   // be reused, unless either ResizeInputTensor() or AllocateTensors() has been
@@ -702,6 +689,82 @@ TfLiteStatus Interpreter::Invoke() {
   return status;
 }
 
+std::vector<int> Interpreter::ScheduleExecutionPlanInConcurrentSteps() {
+  InterpreterInfo info(this);
+  std::vector<int> steps = AssignNodesToConcurrentSteps(&info);
+
+  // Ordering the nodes by step keeps the plan in dependency order.
+  std::vector<int> order(execution_plan_.size());
+  for (int i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&steps](int a, int b) { return steps[a] < steps[b]; });
+  std::vector<int> plan(execution_plan_.size());
+  execution_plan_steps_.resize(execution_plan_.size());
+  for (int i = 0; i < order.size(); ++i) {
+    plan[i] = execution_plan_[order[i]];
+    execution_plan_steps_[i] = steps[order[i]];
+  }
+  execution_plan_ = plan;
+  return execution_plan_steps_;
+}
+
+bool Interpreter::CanInvokeConcurrently() const {
+  if (!inter_op_thread_pool_ || profiler_ != nullptr ||
+      execution_plan_steps_.size() != execution_plan_.size() ||
+      next_execution_plan_index_to_prepare_ != execution_plan_.size()) {
+    return false;
+  }
+  for (int node_index : execution_plan_) {
+    const TfLiteNode& node = nodes_and_registration_[node_index].first;
+    if (node.delegate != nullptr || HasDynamicTensor(context_, node.outputs)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TfLiteStatus Interpreter::InvokeConcurrently() {
+  TfLiteStatus status = kTfLiteOk;
+  std::vector<TfLiteStatus> node_statuses;
+  int step_begin = 0;
+  while (step_begin < execution_plan_.size()) {
+    int step_end = step_begin + 1;
+    while (step_end < execution_plan_.size() &&
+           execution_plan_steps_[step_end] ==
+               execution_plan_steps_[step_begin]) {
+      ++step_end;
+    }
+
+    EnsureTensorsVectorCapacity();
+    node_statuses.assign(step_end - step_begin, kTfLiteOk);
+    auto invoke_node = [this, step_begin, &node_statuses](int i) {
+      int node_index = execution_plan_[step_begin + i];
+      node_statuses[i] =
+          OpInvoke(nodes_and_registration_[node_index].second,
+                   &nodes_and_registration_[node_index].first);
+    };
+    if (step_end - step_begin == 1) {
+      invoke_node(0);
+    } else {
+      inter_op_thread_pool_->Run(step_end - step_begin, invoke_node);
+    }
+
+    for (int i = 0; i < node_statuses.size(); ++i) {
+      if (node_statuses[i] == kTfLiteError) {
+        int node_index = execution_plan_[step_begin + i];
+        status = ReportOpError(
+            &context_, nodes_and_registration_[node_index].first,
+            nodes_and_registration_[node_index].second, node_index,
+            "failed to invoke");
+      }
+    }
+    step_begin = step_end;
+  }
+  return status;
+}
+
 TfLiteStatus Interpreter::ResizeTensor(TfLiteContext* context,
                                        TfLiteTensor* tensor,
                                        TfLiteIntArray* new_size) {
@@ -857,6 +920,7 @@ TfLiteStatus Interpreter::SetExecutionPlan(const std::vector<int>& new_plan) {
     TF_LITE_ENSURE(&context_, node_index >= 0 && node_index < nodes_size());
   }
   execution_plan_ = new_plan;
+  execution_plan_steps_.clear();
   return kTfLiteOk;
 }
 
@@ -920,6 +984,27 @@ void Interpreter::SetNumThreads(int num_threads) {
   }
 }
 
+TfLiteStatus Interpreter::SetNumInterOpThreads(int num_threads) {
+  if (state_ == kStateInvokableAndImmutable) {
+    ReportError(&context_,
+                "SetNumInterOpThreads is disallowed when graph is immutable.");
+    return kTfLiteError;
+  }
+  TF_LITE_ENSURE(&context_, num_threads >= 1);
+  if (num_threads == 1) {
+    inter_op_thread_pool_.reset();
+  } else if (!inter_op_thread_pool_ ||
+             inter_op_thread_pool_->num_threads() != num_threads) {
+    inter_op_thread_pool_.reset(new InterOpThreadPool(num_threads));
+  }
+
+  // Plan the execution and the memory again at the next AllocateTensors().
+  execution_plan_steps_.clear();
+  memory_planner_.reset();
+  state_ = kStateUninvokable;
+  return kTfLiteOk;
+}
+
 void Interpreter::SwitchToDelegateContext() {
   context_.GetNodeAndRegistration = GetNodeAndRegistration;
   context_.ReplaceSubgraphsWithDelegateKernels =
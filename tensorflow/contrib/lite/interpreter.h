@@ -72,6 +72,8 @@ constexpr TfLiteType typeToTfLiteType<string>() {
 // Forward declare since NNAPIDelegate uses Interpreter.
 class NNAPIDelegate;
 
+class InterOpThreadPool;
+
 // An interpreter for a graph of nodes that input and output from tensors.
 // Each node of the graph processes a set of input tensors and produces a
 // set of output Tensors. All inputs/output tensors are referenced by index.
@@ -336,6 +338,19 @@ class Interpreter {
   // Set the number of threads available to the interpreter.
   void SetNumThreads(int num_threads);
 
+  // Set the number of threads on which Invoke() executes nodes that don't
+  // depend on each other concurrently, including the calling thread. The
+  // default, 1, executes one node at a time.
+  //
+  // The next AllocateTensors() groups the nodes of the execution plan into
+  // steps of nodes that neither use each other's outputs nor the same
+  // variable tensors, reorders the plan step by step, and plans the memory so
+  // that the tensors of the nodes of a step never overlap. Nodes are still
+  // executed one at a time if the graph has dynamic tensors or delegated
+  // nodes, or if a profiler is set. Ops may report errors concurrently.
+  // WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetNumInterOpThreads(int num_threads);
+
   // Allow float16 precision for FP32 calculation when possible.
   // default: not allow.
   // WARNING: This is an experimental API and subject to change.
@@ -594,6 +609,18 @@ class Interpreter {
                                    allow_dynamic_tensors);
   }
 
+  // Reorders the execution plan so that the nodes that can be executed
+  // concurrently are adjacent, and returns the step of each of its nodes.
+  std::vector<int> ScheduleExecutionPlanInConcurrentSteps();
+
+  // Returns true if Invoke() can execute the steps of the execution plan
+  // concurrently.
+  bool CanInvokeConcurrently() const;
+
+  // Executes the execution plan step by step, executing the nodes of a step
+  // concurrently.
+  TfLiteStatus InvokeConcurrently();
+
   // Ensures that `tensors_` has at least `kTensorsCapacityHeadroom` extra
   // capacity. Calling this function may invalidate existing pointers to
   // tensors. After calling this function, adding `kTensorsCapacityHeadroom`
@@ -680,6 +707,14 @@ class Interpreter {
 
   std::unique_ptr<MemoryPlanner> memory_planner_;
 
+  // The threads executing independent nodes concurrently, if there are more
+  // than one (see SetNumInterOpThreads()).
+  std::unique_ptr<InterOpThreadPool> inter_op_thread_pool_;
+
+  // The step of each node of the execution plan, if it was scheduled in
+  // concurrent steps. Empty otherwise.
+  std::vector<int> execution_plan_steps_;
+
   bool allow_buffer_handle_output_ = false;
 
   // Tracking bit for whether a tensor was resized in the course of an op
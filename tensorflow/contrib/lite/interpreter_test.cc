@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/contrib/lite/interpreter.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <gtest/gtest.h>
 #include "tensorflow/contrib/lite/core/api/error_reporter.h"
 #include "tensorflow/contrib/lite/kernels/internal/compatibility.h"
@@ -1007,6 +1010,96 @@ TfLiteRegistration AddOpRegistration() {
   return reg;
 }
 
+// The number of times RendezvousOpRegistration() ops were invoked.
+std::atomic<int> rendezvous_count(0);
+
+// An op adding one to its input, which fails unless another such op is
+// invoked concurrently.
+TfLiteRegistration RendezvousOpRegistration() {
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    TfLiteTensor* input = &context->tensors[node->inputs->data[0]];
+    TfLiteTensor* output = &context->tensors[node->outputs->data[0]];
+    return context->ResizeTensor(context, output,
+                                 TfLiteIntArrayCopy(input->dims));
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    // Wait for the other op of the pair.
+    const int count = ++rendezvous_count;
+    const int expected_count = count + count % 2;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (rendezvous_count < expected_count) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        context->ReportError(context, "No concurrent op.");
+        return kTfLiteError;
+      }
+      std::this_thread::yield();
+    }
+
+    TfLiteTensor* input = &context->tensors[node->inputs->data[0]];
+    TfLiteTensor* output = &context->tensors[node->outputs->data[0]];
+    for (int i = 0; i < input->dims->data[0]; i++) {
+      output->data.f[i] = input->data.f[i] + 1;
+    }
+    return kTfLiteOk;
+  };
+  return reg;
+}
+
+TEST(InterOpParallelismTest, InvokesIndependentNodesConcurrently) {
+  Interpreter interpreter;
+  ASSERT_EQ(interpreter.AddTensors(7), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({6}), kTfLiteOk);
+  TfLiteQuantizationParams quant;
+  for (int i = 0; i < 7; ++i) {
+    ASSERT_EQ(interpreter.SetTensorParametersReadWrite(i, kTfLiteFloat32, "",
+                                                       {4}, quant),
+              kTfLiteOk);
+  }
+
+  // Two branches of two ops, the first of which are executed concurrently,
+  // then an op joining them.
+  TfLiteRegistration rendezvous_reg = RendezvousOpRegistration();
+  TfLiteRegistration add_reg = AddOpRegistration();
+  ASSERT_EQ(interpreter.AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr,
+                                              &rendezvous_reg),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.AddNodeWithParameters({1, 1}, {2}, nullptr, 0,
+                                              nullptr, &add_reg),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.AddNodeWithParameters({0}, {3}, nullptr, 0, nullptr,
+                                              &rendezvous_reg),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.AddNodeWithParameters({3, 0}, {4}, nullptr, 0,
+                                              nullptr, &add_reg),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.AddNodeWithParameters({2, 4}, {5}, nullptr, 0,
+                                              nullptr, &add_reg),
+            kTfLiteOk);
+  ASSERT_EQ(interpreter.AddNodeWithParameters({5, 0}, {6}, nullptr, 0,
+                                              nullptr, &add_reg),
+            kTfLiteOk);
+
+  EXPECT_EQ(interpreter.SetNumInterOpThreads(0), kTfLiteError);
+  ASSERT_EQ(interpreter.SetNumInterOpThreads(2), kTfLiteOk);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  EXPECT_EQ(interpreter.execution_plan(), std::vector<int>({0, 2, 1, 3, 4, 5}));
+
+  for (int run = 0; run < 2; ++run) {
+    for (int i = 0; i < 4; ++i) {
+      interpreter.typed_tensor<float>(0)[i] = i + run;
+    }
+    ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+    for (int i = 0; i < 4; ++i) {
+      float x = i + run;
+      EXPECT_EQ(interpreter.typed_tensor<float>(6)[i],
+                2 * (x + 1) + (x + 1 + x) + x);
+    }
+  }
+}
+
 class TestDelegate : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/contrib/lite/kernels/kernel_util.h"
 #include "tensorflow/contrib/lite/kernels/op_macros.h"
 #include "tensorflow/contrib/lite/kernels/padding.h"
+#include "tensorflow/contrib/lite/prepared_weights_cache.h"
 
 namespace tflite {
 namespace ops {
@@ -357,15 +358,29 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
     TfLiteTensor* hwcn_weights =
         &context->tensors[node->temporaries->data[data->hwcn_weights_index]];
     hwcn_weights->type = input_type;
-    hwcn_weights->allocation_type = kTfLiteArenaRwPersistent;
 
-    auto hwcn_weights_status =
-        context->ResizeTensor(context, hwcn_weights, hwcn_weights_size);
-    if (hwcn_weights_status != kTfLiteOk) return hwcn_weights_status;
+    // Interpreters sharing a PreparedWeightsCache share the transposed
+    // weights of constant filters.
+    if (CanSharePreparedWeights(context, filter)) {
+      TF_LITE_ENSURE_OK(
+          context,
+          SharePreparedWeights(context, filter, "conv/hwcn_weights",
+                               hwcn_weights_size, hwcn_weights,
+                               [filter](TfLiteTensor* transposed) {
+                                 TransposeFloatTensor(filter, transposed);
+                               }));
+      data->have_weights_been_transposed = true;
+    } else {
+      hwcn_weights->allocation_type = kTfLiteArenaRwPersistent;
 
-    // TODO(petewarden): If Resize() is called when the size hasn't actually
-    // changed, this will do extra redundant work.
-    data->have_weights_been_transposed = false;
+      auto hwcn_weights_status =
+          context->ResizeTensor(context, hwcn_weights, hwcn_weights_size);
+      if (hwcn_weights_status != kTfLiteOk) return hwcn_weights_status;
+
+      // TODO(petewarden): If Resize() is called when the size hasn't actually
+      // changed, this will do extra redundant work.
+      data->have_weights_been_transposed = false;
+    }
   }
 
   if (is_hybrid) {
@@ -407,7 +422,8 @@ void EvalQuantized(TfLiteContext* context, TfLiteNode* node,
                    TfLiteTensor* filter, TfLiteTensor* bias,
                    TfLiteTensor* im2col, TfLiteTensor* hwcn_weights,
                    TfLiteTensor* output) {
-  gemmlowp::GemmContext* gemm_context = gemm_support::GetFromContext(context);
+  gemm_support::ScopedGemmContext scoped_gemm_context(context);
+  gemmlowp::GemmContext* gemm_context = scoped_gemm_context.get();
 
   auto input_offset = -input->params.zero_point;
   auto filter_offset = -filter->params.zero_point;
@@ -12,7 +12,9 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#include <algorithm>
 #include <cstdarg>
+#include <iterator>
 
 #include <gtest/gtest.h>
 #include "absl/memory/memory.h"
@@ -20,6 +22,7 @@ limitations under the License.
 #include "tensorflow/contrib/lite/kernels/register.h"
 #include "tensorflow/contrib/lite/kernels/test_util.h"
 #include "tensorflow/contrib/lite/model.h"
+#include "tensorflow/contrib/lite/prepared_weights_cache.h"
 
 namespace tflite {
 
@@ -551,6 +554,64 @@ TEST_P(ConvolutionOpTest, SimpleTestFloatWithDilation) {
   EXPECT_THAT(m.GetOutput(), ElementsAreArray({5, 5, 5, 5, 5, 5, 5, 5, 5}));
 }
 
+// A float convolution with a constant filter and bias, whose interpreters
+// share the prepared weights through 'cache'.
+class ConstFilterConvolutionOpModel : public SingleOpModel {
+ public:
+  ConstFilterConvolutionOpModel(TfLiteRegistration* registration,
+                                PreparedWeightsCache* cache) {
+    input_ = AddInput({TensorType_FLOAT32, {1, 2, 2, 1}});
+    AddConstInput(TensorType_FLOAT32,
+                  {
+                      1, 2, 3, 4,    // first 2x2 filter
+                      -1, 1, -1, 1,  // second 2x2 filter
+                  },
+                  {2, 2, 2, 1});
+    AddConstInput(TensorType_FLOAT32, {1, 2}, {2});
+    output_ = AddOutput({TensorType_FLOAT32, {}});
+
+    SetBuiltinOp(BuiltinOperator_CONV_2D, BuiltinOptions_Conv2DOptions,
+                 CreateConv2DOptions(builder_, Padding_VALID, 1, 1).Union());
+
+    resolver_ = absl::make_unique<SingleOpResolver>(BuiltinOperator_CONV_2D,
+                                                    registration);
+    SetApplyDelegate([cache](Interpreter* interpreter) {
+      interpreter->SetExternalContext(kTfLitePreparedWeightsContext, cache);
+    });
+    BuildInterpreter({GetShape(input_)});
+  }
+
+  void SetInput(std::initializer_list<float> data) {
+    PopulateTensor(input_, data);
+  }
+  std::vector<float> GetOutput() { return ExtractVector<float>(output_); }
+
+ private:
+  int input_;
+  int output_;
+};
+
+TEST_P(ConvolutionOpTest, SharesPreparedWeightsBetweenInterpreters) {
+  PreparedWeightsCache cache;
+  ConstFilterConvolutionOpModel m(GetRegistration(), &cache);
+  std::unique_ptr<Interpreter> other = m.BuildOtherInterpreter();
+
+  m.SetInput({1, 2, 3, 4});
+  m.Invoke();
+  const float other_input[] = {4, 3, 2, 1};
+  std::copy(std::begin(other_input), std::end(other_input),
+            other->typed_input_tensor<float>(0));
+  ASSERT_EQ(other->Invoke(), kTfLiteOk);
+
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray({31, 4}));
+  const float* other_output = other->typed_output_tensor<float>(0);
+  EXPECT_THAT(std::vector<float>(other_output, other_output + 2),
+              ElementsAreArray({21, 0}));
+  // The transposed filter is only prepared once.
+  EXPECT_EQ(cache.num_entries(), 1);
+  EXPECT_EQ(cache.num_bytes(), 8 * sizeof(float));
+}
+
 class QuantizedConvolutionOpModel : public BaseConvolutionOpModel {
  public:
   using BaseConvolutionOpModel::BaseConvolutionOpModel;
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/contrib/lite/kernels/internal/tensor.h"
 #include "tensorflow/contrib/lite/kernels/kernel_util.h"
 #include "tensorflow/contrib/lite/kernels/op_macros.h"
+#include "tensorflow/contrib/lite/prepared_weights_cache.h"
 
 namespace tflite {
 namespace ops {
@@ -51,6 +52,16 @@ void Free(TfLiteContext* context, void* buffer) {
   delete reinterpret_cast<OpData*>(buffer);
 }
 
+void DequantizeTensor(const TfLiteTensor* input, TfLiteTensor* output) {
+  tflite::DequantizationParams op_params;
+  op_params.zero_point = input->params.zero_point;
+  op_params.scale = input->params.scale;
+  optimized_ops::Dequantize(op_params, GetTensorShape(input),
+                            GetTensorData<uint8_t>(input),
+                            GetTensorShape(output),
+                            GetTensorData<float>(output));
+}
+
 TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_EQ(context, NumInputs(node), 1);
   TF_LITE_ENSURE_EQ(context, NumOutputs(node), 1);
@@ -60,6 +71,19 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE(context, op_context.input->type == kTfLiteUInt8);
 
   op_context.output->type = kTfLiteFloat32;
+  // Interpreters sharing a PreparedWeightsCache share the dequantized values
+  // of constant inputs.
+  if (CanSharePreparedWeights(context, op_context.input)) {
+    OpData* op_data = reinterpret_cast<OpData*>(node->user_data);
+    op_data->float_dequantized_weights_initialized = true;
+    const TfLiteTensor* input = op_context.input;
+    return SharePreparedWeights(context, input, "dequantize",
+                                TfLiteIntArrayCopy(input->dims),
+                                op_context.output,
+                                [input](TfLiteTensor* output) {
+                                  DequantizeTensor(input, output);
+                                });
+  }
   // If the input tensor is constant, we can persist the dequantized value in
   // the output tensor. Otherwise we run dequantize upon each eval.
   if (IsConstantTensor(op_context.input)) {
@@ -77,13 +101,7 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
     return kTfLiteOk;
   }
 
-  tflite::DequantizationParams op_params;
-  op_params.zero_point = op_context.input->params.zero_point;
-  op_params.scale = op_context.input->params.scale;
-  optimized_ops::Dequantize(op_params, GetTensorShape(op_context.input),
-                            GetTensorData<uint8_t>(op_context.input),
-                            GetTensorShape(op_context.output),
-                            GetTensorData<float>(op_context.output));
+  DequantizeTensor(op_context.input, op_context.output);
 
   if (IsConstantTensor(op_context.input)) {
     op_data->float_dequantized_weights_initialized = true;
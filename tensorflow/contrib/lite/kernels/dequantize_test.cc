@@ -17,6 +17,7 @@ limitations under the License.
 #include "tensorflow/contrib/lite/kernels/register.h"
 #include "tensorflow/contrib/lite/kernels/test_util.h"
 #include "tensorflow/contrib/lite/model.h"
+#include "tensorflow/contrib/lite/prepared_weights_cache.h"
 
 namespace tflite {
 namespace {
@@ -55,6 +56,54 @@ TEST(SplitOpTest, FourDimensional) {
                   {-63.5, -63, -62.5, -62, -61.5, 62, 62.5, 63, 63.5, 64})));
 }
 
+// Dequantizes constant weights, sharing them between interpreters through
+// 'cache'.
+class ConstDequantizeOpModel : public SingleOpModel {
+ public:
+  ConstDequantizeOpModel(std::initializer_list<int> shape, float min,
+                         float max, std::initializer_list<uint8_t> data,
+                         PreparedWeightsCache* cache) {
+    AddConstInput(TensorData{TensorType_UINT8, shape, min, max}, data);
+    output_ = AddOutput({TensorType_FLOAT32, shape});
+    SetBuiltinOp(BuiltinOperator_DEQUANTIZE, BuiltinOptions_DequantizeOptions,
+                 CreateDequantizeOptions(builder_).Union());
+
+    SetApplyDelegate([cache](Interpreter* interpreter) {
+      interpreter->SetExternalContext(kTfLitePreparedWeightsContext, cache);
+    });
+    BuildInterpreter({});
+  }
+
+  const float* GetOutputData() {
+    return interpreter_->typed_tensor<float>(output_);
+  }
+  std::vector<float> GetOutput() { return ExtractVector<float>(output_); }
+
+ private:
+  int output_;
+};
+
+TEST(DequantizeOpTest, SharesConstantWeightsBetweenInterpreters) {
+  PreparedWeightsCache cache;
+  ConstDequantizeOpModel m({2, 5}, -63.5, 64,
+                           {0, 1, 2, 3, 4, 251, 252, 253, 254, 255}, &cache);
+  std::unique_ptr<Interpreter> other = m.BuildOtherInterpreter();
+
+  m.Invoke();
+  ASSERT_EQ(other->Invoke(), kTfLiteOk);
+
+  const std::vector<float> expected = {-63.5, -63, -62.5, -62, -61.5,
+                                       62,    62.5, 63,   63.5, 64};
+  EXPECT_THAT(m.GetOutput(), ElementsAreArray(ArrayFloatNear(expected)));
+  const float* other_output = other->typed_output_tensor<float>(0);
+  EXPECT_THAT(std::vector<float>(other_output, other_output + 10),
+              ElementsAreArray(ArrayFloatNear(expected)));
+  // Both outputs are the one dequantized copy of the weights.
+  EXPECT_EQ(other_output, m.GetOutputData());
+  EXPECT_EQ(cache.num_entries(), 1);
+  EXPECT_EQ(cache.num_bytes(), 10 * sizeof(float));
+}
+
 }  // namespace
 }  // namespace tflite
 
@@ -276,7 +276,8 @@ TfLiteStatus EvalQuantized(TfLiteContext* context, TfLiteNode* node,
                            const TfLiteTensor* input,
                            const TfLiteTensor* filter, const TfLiteTensor* bias,
                            TfLiteTensor* output) {
-  gemmlowp::GemmContext* gemm_context = gemm_support::GetFromContext(context);
+  gemm_support::ScopedGemmContext scoped_gemm_context(context);
+  gemmlowp::GemmContext* gemm_context = scoped_gemm_context.get();
 
   int32_t input_offset = -input->params.zero_point;
   int32_t filter_offset = -filter->params.zero_point;
@@ -346,7 +347,8 @@ TfLiteStatus EvalShuffledQuantized(TfLiteContext* context, TfLiteNode* node,
                                    const TfLiteTensor* bias,
                                    TfLiteTensor* output,
                                    TfLiteTensor* shuffled_input_workspace) {
-  gemmlowp::GemmContext* gemm_context = gemm_support::GetFromContext(context);
+  gemm_support::ScopedGemmContext scoped_gemm_context(context);
+  gemmlowp::GemmContext* gemm_context = scoped_gemm_context.get();
 
   // TODO(b/110697972) decide more consistently if / how / where we want
   // to perform this kind of runtime data type checks.
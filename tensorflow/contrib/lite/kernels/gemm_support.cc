@@ -24,6 +24,8 @@ namespace {
 
 struct RefCountedGemmContext : public TfLiteExternalContext {
   std::unique_ptr<gemmlowp::GemmContext> gemm_context;
+  // Held by the ScopedGemmContexts using gemm_context.
+  std::mutex mutex;
   int num_references = 0;
 };
 
@@ -80,5 +82,10 @@ gemmlowp::GemmContext* GetFromContext(TfLiteContext* context) {
   return ptr->gemm_context.get();
 }
 
+ScopedGemmContext::ScopedGemmContext(TfLiteContext* context)
+    : gemm_context_(GetFromContext(context)) {
+  lock_ = std::unique_lock<std::mutex>(GetGemmLowpContext(context)->mutex);
+}
+
 }  // namespace gemm_support
 }  // namespace tflite
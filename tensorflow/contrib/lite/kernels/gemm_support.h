@@ -15,6 +15,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CONTRIB_LITE_KERNELS_GEMM_SUPPORT_H_
 #define TENSORFLOW_CONTRIB_LITE_KERNELS_GEMM_SUPPORT_H_
 
+#include <mutex>
+
 #include "public/gemmlowp.h"
 #include "tensorflow/contrib/lite/c/c_api_internal.h"
 
@@ -37,6 +39,25 @@ namespace gemm_support {
 //   }
 gemmlowp::GemmContext* GetFromContext(TfLiteContext* context);
 
+// Holds the GemmContext stored in 'context' for the lifetime of the object.
+// GemmContext isn't thread-safe, and the interpreter may execute several ops
+// at once (see Interpreter::SetNumInterOpThreads()), so ops should use it
+// through this class, under the same conditions as GetFromContext():
+//   TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
+//     gemm_support::ScopedGemmContext scoped_gemm_context(context);
+//     auto* gemm_context = scoped_gemm_context.get();
+//   }
+class ScopedGemmContext {
+ public:
+  explicit ScopedGemmContext(TfLiteContext* context);
+
+  gemmlowp::GemmContext* get() const { return gemm_context_; }
+
+ private:
+  std::unique_lock<std::mutex> lock_;
+  gemmlowp::GemmContext* gemm_context_;
+};
+
 // Let the framework know that the GemmContext stored in 'context' will be used
 // by an op. If necessary a new GemmContext is created and placed in 'context'.
 void IncrementUsageCounter(TfLiteContext* context);
@@ -125,6 +125,21 @@ void SingleOpModel::BuildInterpreter(std::vector<std::vector<int>> input_shapes,
   interpreter_->ResetVariableTensors();
 }
 
+std::unique_ptr<Interpreter> SingleOpModel::BuildOtherInterpreter() {
+  CHECK(resolver_ != nullptr) << "BuildInterpreter() must be called first";
+  std::unique_ptr<Interpreter> interpreter;
+  CHECK(InterpreterBuilder(GetModel(builder_.GetBufferPointer()),
+                           *resolver_)(&interpreter) == kTfLiteOk);
+  CHECK(interpreter != nullptr);
+  if (apply_delegate_fn_) {
+    apply_delegate_fn_(interpreter.get());
+  }
+  CHECK(interpreter->AllocateTensors() == kTfLiteOk)
+      << "Cannot allocate tensors";
+  interpreter->ResetVariableTensors();
+  return interpreter;
+}
+
 void SingleOpModel::Invoke() { CHECK(interpreter_->Invoke() == kTfLiteOk); }
 
 int32_t SingleOpModel::GetTensorSize(int index) const {
@@ -140,6 +140,14 @@ class SingleOpModel {
     return id;
   }
 
+  // Add a constant input tensor of 't' holding 'data', e.g. quantized weights.
+  template <typename T>
+  int AddConstInput(const TensorData& t, std::initializer_list<T> data) {
+    int id = AddTensor(t, data);
+    inputs_.push_back(id);
+    return id;
+  }
+
   // Add a null input tensor (optional input) and return kOptionalTensor.
   int AddNullInput();
 
@@ -185,6 +193,11 @@ class SingleOpModel {
   void BuildInterpreter(std::vector<std::vector<int>> input_shapes,
                         bool allow_fp32_relax_to_fp16 = false);
 
+  // Build another interpreter for the model built by BuildInterpreter(),
+  // sharing its constant tensors, and allocate its tensors with the shapes
+  // of the model after running the function set by SetApplyDelegate().
+  std::unique_ptr<Interpreter> BuildOtherInterpreter();
+
   void Invoke();
 
   void PopulateStringTensor(int index, const std::vector<string>& content) {
@@ -0,0 +1,112 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/lite/prepared_weights_cache.h"
+
+#include <tuple>
+
+#include "tensorflow/contrib/lite/util.h"
+
+namespace tflite {
+
+PreparedWeightsCache::PreparedWeightsCache() {
+  type = kTfLitePreparedWeightsContext;
+  // Prepared weights don't depend on the number of threads.
+  Refresh = [](TfLiteContext* context) { return kTfLiteOk; };
+}
+
+PreparedWeightsCache* PreparedWeightsCache::Get(TfLiteContext* context) {
+  return static_cast<PreparedWeightsCache*>(
+      context->GetExternalContext(context, kTfLitePreparedWeightsContext));
+}
+
+bool PreparedWeightsCache::Key::operator<(const Key& other) const {
+  return std::tie(data, kind, type, dims, scale, zero_point) <
+         std::tie(other.data, other.kind, other.type, other.dims, other.scale,
+                  other.zero_point);
+}
+
+const void* PreparedWeightsCache::GetOrPrepare(
+    const TfLiteTensor* source, const std::string& kind, size_t bytes,
+    const std::function<void(void* data)>& prepare) {
+  Key key{source->data.raw_const, kind, source->type, std::vector<int>(),
+          source->params.scale, source->params.zero_point};
+  if (source->dims != nullptr) {
+    key.dims.assign(source->dims->data,
+                    source->dims->data + source->dims->size);
+  }
+  // Preparations are done while holding the lock, so that no entry is ever
+  // prepared twice. They only happen while the interpreters are prepared.
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto inserted = entries_.emplace(std::move(key), Entry());
+  Entry& entry = inserted.first->second;
+  if (inserted.second) {
+    entry.data.reset(new char[bytes]);
+    entry.bytes = bytes;
+    num_bytes_ += bytes;
+    prepare(entry.data.get());
+  }
+  if (entry.bytes != bytes) return nullptr;
+  return entry.data.get();
+}
+
+int PreparedWeightsCache::num_entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+size_t PreparedWeightsCache::num_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_bytes_;
+}
+
+bool CanSharePreparedWeights(TfLiteContext* context,
+                             const TfLiteTensor* source) {
+  return source->allocation_type == kTfLiteMmapRo &&
+         source->data.raw != nullptr &&
+         PreparedWeightsCache::Get(context) != nullptr;
+}
+
+TfLiteStatus SharePreparedWeights(
+    TfLiteContext* context, const TfLiteTensor* source,
+    const std::string& kind, TfLiteIntArray* dims, TfLiteTensor* tensor,
+    const std::function<void(TfLiteTensor* tensor)>& prepare) {
+  size_t bytes;
+  if (!CanSharePreparedWeights(context, source) ||
+      BytesRequired(context, tensor->type, dims->data, dims->size, &bytes) !=
+          kTfLiteOk) {
+    TfLiteIntArrayFree(dims);
+    return kTfLiteError;
+  }
+
+  TfLiteTensorFree(tensor);
+  tensor->dims = dims;
+  tensor->bytes = bytes;
+  tensor->allocation_type = kTfLiteMmapRo;
+  const void* data = PreparedWeightsCache::Get(context)->GetOrPrepare(
+      source, kind, bytes, [tensor, &prepare](void* data) {
+        tensor->data.raw = static_cast<char*>(data);
+        prepare(tensor);
+      });
+  if (data == nullptr) {
+    context->ReportError(context, "Prepared weights '%s' changed size.",
+                         kind.c_str());
+    return kTfLiteError;
+  }
+  tensor->data.raw_const = static_cast<const char*>(data);
+  return kTfLiteOk;
+}
+
+}  // namespace tflite
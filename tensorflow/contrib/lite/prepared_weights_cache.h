@@ -0,0 +1,111 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CONTRIB_LITE_PREPARED_WEIGHTS_CACHE_H_
+#define TENSORFLOW_CONTRIB_LITE_PREPARED_WEIGHTS_CACHE_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/contrib/lite/c/c_api_internal.h"
+
+namespace tflite {
+
+// A cache of the weights that kernels derive from read-only tensors when
+// they are prepared, like transposed or dequantized filters. Interpreters
+// built from the same FlatBufferModel share the read-only tensors of the
+// model, so sharing one cache between them also shares the prepared weights,
+// instead of keeping a copy in the arena of each interpreter:
+//
+//   PreparedWeightsCache cache;
+//   for (auto& interpreter : interpreters) {
+//     interpreter->SetExternalContext(kTfLitePreparedWeightsContext, &cache);
+//     interpreter->AllocateTensors();
+//   }
+//
+// Entries are keyed by the address of the read-only data they are derived
+// from, along with the type, shape and quantization of the tensor holding it,
+// so a cache must only be used with the interpreters of one model, and must
+// outlive them. It must be set before the interpreters are prepared.
+// Entries are immutable once prepared, and the cache can be used by several
+// interpreters concurrently.
+class PreparedWeightsCache : public TfLiteExternalContext {
+ public:
+  PreparedWeightsCache();
+
+  PreparedWeightsCache(const PreparedWeightsCache&) = delete;
+  PreparedWeightsCache& operator=(const PreparedWeightsCache&) = delete;
+
+  // Returns the cache set in 'context', or nullptr.
+  static PreparedWeightsCache* Get(TfLiteContext* context);
+
+  // Returns the 'bytes' bytes holding the preparation named 'kind' of the
+  // read-only tensor 'source'. The first request for an entry calls 'prepare'
+  // to fill it. Returns nullptr if the entry exists with another size.
+  const void* GetOrPrepare(const TfLiteTensor* source, const std::string& kind,
+                           size_t bytes,
+                           const std::function<void(void* data)>& prepare);
+
+  // The number of entries, and the number of bytes they hold.
+  int num_entries() const;
+  size_t num_bytes() const;
+
+ private:
+  // Tensors of different shapes or quantizations may alias the same data,
+  // and their preparations differ.
+  struct Key {
+    const void* data;
+    std::string kind;
+    TfLiteType type;
+    std::vector<int> dims;
+    float scale;
+    int32_t zero_point;
+
+    bool operator<(const Key& other) const;
+  };
+
+  struct Entry {
+    std::unique_ptr<char[]> data;
+    size_t bytes;
+  };
+
+  mutable std::mutex mutex_;
+  std::map<Key, Entry> entries_;
+  size_t num_bytes_ = 0;
+};
+
+// Returns whether 'context' has a PreparedWeightsCache able to hold
+// preparations of 'source', which is the case if 'source' is read-only.
+bool CanSharePreparedWeights(TfLiteContext* context,
+                             const TfLiteTensor* source);
+
+// Makes 'tensor' a read-only tensor of shape 'dims' (taking ownership of
+// them) holding the preparation named 'kind' of 'source', as cached in the
+// PreparedWeightsCache of 'context'. The type of 'tensor' must be set, and
+// 'prepare' is called to fill it if the cache has no such entry yet.
+// Requires CanSharePreparedWeights(context, source).
+TfLiteStatus SharePreparedWeights(
+    TfLiteContext* context, const TfLiteTensor* source,
+    const std::string& kind, TfLiteIntArray* dims, TfLiteTensor* tensor,
+    const std::function<void(TfLiteTensor* tensor)>& prepare);
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_CONTRIB_LITE_PREPARED_WEIGHTS_CACHE_H_
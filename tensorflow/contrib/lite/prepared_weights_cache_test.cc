@@ -0,0 +1,163 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/lite/prepared_weights_cache.h"
+
+#include <cstring>
+#include <memory>
+#include <gtest/gtest.h>
+#include "tensorflow/contrib/lite/interpreter.h"
+#include "tensorflow/contrib/lite/testing/util.h"
+
+namespace tflite {
+namespace {
+
+// Returns a read-only float tensor of 'data' with the dims 'dims'.
+TfLiteTensor WeightsTensor(const float* data, TfLiteIntArray* dims) {
+  TfLiteTensor tensor;
+  std::memset(&tensor, 0, sizeof(tensor));
+  tensor.type = kTfLiteFloat32;
+  tensor.allocation_type = kTfLiteMmapRo;
+  tensor.data.raw_const = reinterpret_cast<const char*>(data);
+  tensor.dims = dims;
+  return tensor;
+}
+
+TEST(PreparedWeightsCacheTest, PreparesEntriesOnce) {
+  PreparedWeightsCache cache;
+  const float weights[] = {1.f, 2.f};
+  int num_preparations = 0;
+  auto prepare = [&num_preparations](void* data) {
+    ++num_preparations;
+    std::memset(data, 1, 4);
+  };
+  std::unique_ptr<TfLiteIntArray, void (*)(TfLiteIntArray*)> dims(
+      TfLiteIntArrayCreate(1), TfLiteIntArrayFree);
+  dims->data[0] = 2;
+  std::unique_ptr<TfLiteIntArray, void (*)(TfLiteIntArray*)> other_dims(
+      TfLiteIntArrayCreate(2), TfLiteIntArrayFree);
+  other_dims->data[0] = 1;
+  other_dims->data[1] = 2;
+  const TfLiteTensor source = WeightsTensor(weights, dims.get());
+
+  const void* transposed =
+      cache.GetOrPrepare(&source, "transposed", 4, prepare);
+  ASSERT_NE(transposed, nullptr);
+  EXPECT_EQ(static_cast<const char*>(transposed)[3], 1);
+  EXPECT_EQ(cache.GetOrPrepare(&source, "transposed", 4, prepare),
+            transposed);
+  const TfLiteTensor same_source = WeightsTensor(weights, dims.get());
+  EXPECT_EQ(cache.GetOrPrepare(&same_source, "transposed", 4, prepare),
+            transposed);
+  EXPECT_EQ(num_preparations, 1);
+
+  // Other preparations, and preparations of other data, are other entries.
+  EXPECT_NE(cache.GetOrPrepare(&source, "dequantized", 4, prepare),
+            transposed);
+  const TfLiteTensor other_data = WeightsTensor(weights + 1, dims.get());
+  EXPECT_NE(cache.GetOrPrepare(&other_data, "transposed", 4, prepare),
+            transposed);
+  EXPECT_EQ(num_preparations, 3);
+
+  // So are the preparations of tensors aliasing the data with another shape
+  // or quantization.
+  const TfLiteTensor reshaped = WeightsTensor(weights, other_dims.get());
+  EXPECT_NE(cache.GetOrPrepare(&reshaped, "transposed", 4, prepare),
+            transposed);
+  TfLiteTensor requantized = WeightsTensor(weights, dims.get());
+  requantized.params.scale = 0.5f;
+  EXPECT_NE(cache.GetOrPrepare(&requantized, "transposed", 4, prepare),
+            transposed);
+  EXPECT_EQ(num_preparations, 5);
+  EXPECT_EQ(cache.num_entries(), 5);
+  EXPECT_EQ(cache.num_bytes(), 20);
+
+  EXPECT_EQ(cache.GetOrPrepare(&source, "transposed", 8, prepare), nullptr);
+  EXPECT_EQ(num_preparations, 5);
+}
+
+// An op whose output is its negated read-only input, shared through the
+// PreparedWeightsCache.
+TfLiteRegistration NegateWeightsOpRegistration() {
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    const TfLiteTensor* input = &context->tensors[node->inputs->data[0]];
+    TfLiteTensor* output = &context->tensors[node->outputs->data[0]];
+    TF_LITE_ENSURE(context, CanSharePreparedWeights(context, input));
+    return SharePreparedWeights(
+        context, input, "negated", TfLiteIntArrayCopy(input->dims), output,
+        [input](TfLiteTensor* output) {
+          for (int i = 0; i < input->dims->data[0]; ++i) {
+            output->data.f[i] = -input->data.f[i];
+          }
+        });
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    return kTfLiteOk;
+  };
+  return reg;
+}
+
+std::unique_ptr<Interpreter> NewInterpreter(const float* weights,
+                                            PreparedWeightsCache* cache) {
+  std::unique_ptr<Interpreter> interpreter(new Interpreter);
+  interpreter->AddTensors(2);
+  interpreter->SetInputs({});
+  interpreter->SetOutputs({1});
+  TfLiteQuantizationParams quant;
+  interpreter->SetTensorParametersReadOnly(
+      0, kTfLiteFloat32, "weights", {3}, quant,
+      reinterpret_cast<const char*>(weights), 3 * sizeof(float));
+  interpreter->SetTensorParametersReadWrite(1, kTfLiteFloat32, "negated", {3},
+                                            quant);
+  TfLiteRegistration reg = NegateWeightsOpRegistration();
+  interpreter->AddNodeWithParameters({0}, {1}, nullptr, 0, nullptr, &reg);
+  interpreter->SetExternalContext(kTfLitePreparedWeightsContext, cache);
+  return interpreter;
+}
+
+TEST(PreparedWeightsCacheTest, SharedBetweenInterpreters) {
+  PreparedWeightsCache cache;
+  const float weights[] = {1.f, 2.f, 3.f};
+  auto interpreter = NewInterpreter(weights, &cache);
+  auto other_interpreter = NewInterpreter(weights, &cache);
+
+  ASSERT_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(other_interpreter->AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(interpreter->Invoke(), kTfLiteOk);
+  ASSERT_EQ(other_interpreter->Invoke(), kTfLiteOk);
+
+  const TfLiteTensor* negated = interpreter->tensor(1);
+  EXPECT_EQ(negated->allocation_type, kTfLiteMmapRo);
+  EXPECT_EQ(negated->bytes, 3 * sizeof(float));
+  EXPECT_EQ(negated->data.f[2], -3.f);
+  EXPECT_EQ(other_interpreter->tensor(1)->data.raw, negated->data.raw);
+  EXPECT_EQ(cache.num_entries(), 1);
+}
+
+TEST(PreparedWeightsCacheTest, RequiresCache) {
+  const float weights[] = {1.f, 2.f, 3.f};
+  auto interpreter = NewInterpreter(weights, nullptr);
+  EXPECT_EQ(interpreter->AllocateTensors(), kTfLiteError);
+}
+
+}  // namespace
+}  // namespace tflite
+
+int main(int argc, char** argv) {
+  ::tflite::LogToStderr();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -52,6 +52,12 @@ bool EqualArrayAndTfLiteIntArray(const TfLiteIntArray* a, const int b_size,
 
 size_t CombineHashes(std::initializer_list<size_t> hashes);
 
+// Computes the number of bytes required to represent a tensor of type 'type'
+// with dimensions specified by the array dims (of length dims_size). Reports
+// an error in 'context' if 'type' is not supported.
+TfLiteStatus BytesRequired(TfLiteContext* context, TfLiteType type,
+                           const int* dims, size_t dims_size, size_t* bytes);
+
 }  // namespace tflite
 
 #endif  // TENSORFLOW_CONTRIB_LITE_UTIL_H_
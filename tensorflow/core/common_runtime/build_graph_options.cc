@@ -35,6 +35,13 @@ string BuildGraphOptions::DebugString() const {
   if (collective_graph_key != kNoCollectiveGraphKey) {
     strings::StrAppend(&rv, "\ncollective_graph_key: ", collective_graph_key);
   }
+  if (!feed_shapes.empty()) {
+    strings::StrAppend(&rv, "\nFeed shapes: ");
+    for (const auto& feed_shape : feed_shapes) {
+      strings::StrAppend(&rv, feed_shape.first, " ",
+                         feed_shape.second.DebugString(), ", ");
+    }
+  }
   return rv;
 }
 
@@ -731,6 +731,7 @@ Status DirectSession::Run(const RunOptions& run_options,
   RunStateArgs run_state_args(run_options.debug_options());
   run_state_args.collective_graph_key =
       run_options.experimental().collective_graph_key();
+  run_state_args.shape_bucket = FindShapeBucket(inputs);
 
   TF_RETURN_IF_ERROR(GetOrCreateExecutors(input_tensor_names, output_names,
                                           target_nodes, &executors_and_keys,
@@ -1185,6 +1186,14 @@ Status DirectSession::CreateExecutors(
   options.use_function_convention = !run_state_args->is_partial_run;
   options.collective_graph_key =
       callable_options.run_options().experimental().collective_graph_key();
+  if (run_state_args->shape_bucket >= 0) {
+    const ConfigProto::Experimental::ShapeBucket& bucket =
+        options_.config.experimental().shape_buckets(
+            run_state_args->shape_bucket);
+    for (const auto& feed_shape : bucket.feed_shapes()) {
+      options.feed_shapes[feed_shape.first] = TensorShape(feed_shape.second);
+    }
+  }
 
   std::unique_ptr<FunctionInfo> func_info(new FunctionInfo);
   std::unique_ptr<ExecutorsAndKeys> ek(new ExecutorsAndKeys);
@@ -1331,6 +1340,33 @@ Status DirectSession::CreateExecutors(
   return Status::OK();
 }
 
+int DirectSession::FindShapeBucket(const NamedTensorList& inputs) const {
+  const auto& buckets = options_.config.experimental().shape_buckets();
+  for (int i = 0; i < buckets.size(); ++i) {
+    const auto& feed_shapes = buckets.Get(i).feed_shapes();
+    int matched = 0;
+    for (const auto& input : inputs) {
+      const TensorId id = ParseTensorName(input.first);
+      if (id.second != 0) {
+        continue;
+      }
+      auto it = feed_shapes.find(string(id.first));
+      if (it == feed_shapes.end()) {
+        continue;
+      }
+      if (!TensorShape::IsValid(it->second) ||
+          TensorShape(it->second) != input.second.shape()) {
+        break;
+      }
+      ++matched;
+    }
+    if (!feed_shapes.empty() && matched == feed_shapes.size()) {
+      return i;
+    }
+  }
+  return -1;
+}
+
 Status DirectSession::GetOrCreateExecutors(
     gtl::ArraySlice<string> inputs, gtl::ArraySlice<string> outputs,
     gtl::ArraySlice<string> target_nodes, ExecutorsAndKeys** executors_and_keys,
@@ -1350,7 +1386,7 @@ Status DirectSession::GetOrCreateExecutors(
   const string key = strings::StrCat(
       str_util::Join(inputs, ","), "->", str_util::Join(outputs, ","), "/",
       str_util::Join(target_nodes, ","), "/", run_state_args->is_partial_run,
-      "/", debug_tensor_watches_summary);
+      "/", debug_tensor_watches_summary, "/", run_state_args->shape_bucket);
   // Set the handle, if it's needed to log memory or for partial run.
   if (handle_name_counter_value >= 0) {
     run_state_args->handle =
@@ -1383,7 +1419,8 @@ Status DirectSession::GetOrCreateExecutors(
   const string sorted_key = strings::StrCat(
       str_util::Join(inputs_sorted, ","), "->",
       str_util::Join(outputs_sorted, ","), "/", str_util::Join(tn_sorted, ","),
-      "/", run_state_args->is_partial_run, "/", debug_tensor_watches_summary);
+      "/", run_state_args->is_partial_run, "/", debug_tensor_watches_summary,
+      "/", run_state_args->shape_bucket);
   LOG(INFO) << __func__ << " sorted_key = " << sorted_key;
   // Set the handle, if its needed to log memory or for partial run.
   if (handle_name_counter_value >= 0) {
@@ -209,6 +209,9 @@ class DirectSession : public Session {
     std::unique_ptr<Graph> graph;
     const DebugOptions& debug_options;
     int64 collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+    // Index of the ConfigProto.Experimental.shape_buckets entry matching the
+    // fed tensors, or -1.
+    int shape_bucket = -1;
   };
 
   // Initializes the base execution state given the 'graph',
@@ -217,6 +220,10 @@ class DirectSession : public Session {
                                        bool* out_already_initialized)
       EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
 
+  // Returns the index of the first shape bucket of the session config
+  // matching the shapes of 'inputs', or -1 if none does.
+  int FindShapeBucket(const NamedTensorList& inputs) const;
+
   // Retrieves an already existing set of executors to run 'inputs' and
   // 'outputs', or creates and caches them for future use.
   ::tensorflow::Status GetOrCreateExecutors(
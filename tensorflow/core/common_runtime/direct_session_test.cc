@@ -1870,6 +1870,74 @@ TEST(DirectSessionTest, LocalDeviceManager) {
   EXPECT_GT(mgr->ListDevices().size(), 0);
 }
 
+TEST(DirectSessionTest, SpecializesShapeBuckets) {
+  GraphDef def;
+  const char* text_proto = R"EOF(
+node {
+  name: "x"
+  op: "Placeholder"
+  attr { key: "dtype" value { type: DT_FLOAT } }
+  attr { key: "shape" value { shape { dim { size: -1 } dim { size: 3 } } } }
+}
+node {
+  name: "y"
+  op: "Size"
+  input: "x"
+  attr { key: "T" value { type: DT_FLOAT } }
+  attr { key: "out_type" value { type: DT_INT32 } }
+}
+versions {
+  producer: 26
+}
+  )EOF";
+  ASSERT_TRUE(protobuf::TextFormat::ParseFromString(text_proto, &def));
+
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 1;
+  TensorShape({2, 3}).AsProto(
+      &(*options.config.mutable_experimental()
+             ->add_shape_buckets()
+             ->mutable_feed_shapes())["x"]);
+  // A bucket that doesn't fit the declared shape of "x".
+  TensorShape({2, 4}).AsProto(
+      &(*options.config.mutable_experimental()
+             ->add_shape_buckets()
+             ->mutable_feed_shapes())["x"]);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  RunOptions run_options;
+  run_options.set_output_partition_graphs(true);
+  auto run = [&](const TensorShape& shape, bool* has_size) {
+    RunMetadata run_metadata;
+    std::vector<Tensor> outputs;
+    TF_EXPECT_OK(session->Run(run_options, {{"x", Tensor(DT_FLOAT, shape)}},
+                              {"y:0"}, {}, &outputs, &run_metadata));
+    *has_size = false;
+    for (const GraphDef& graph : run_metadata.partition_graphs()) {
+      for (const NodeDef& node : graph.node()) {
+        if (node.op() == "Size") *has_size = true;
+      }
+    }
+    EXPECT_EQ(1, outputs.size());
+    return outputs.empty() ? -1 : outputs[0].scalar<int32>()();
+  };
+
+  // The bucketed shape runs a graph in which the size was folded.
+  bool has_size = true;
+  EXPECT_EQ(6, run(TensorShape({2, 3}), &has_size));
+  EXPECT_FALSE(has_size);
+
+  // Other shapes run the generic graph.
+  EXPECT_EQ(12, run(TensorShape({4, 3}), &has_size));
+  EXPECT_TRUE(has_size);
+
+  // So do the shapes of the buckets that can't be specialized.
+  EXPECT_EQ(8, run(TensorShape({2, 4}), &has_size));
+  EXPECT_TRUE(has_size);
+}
+
 // y = tf.square(x)
 GraphDef CreateGraphForYEqualsXSquared() {
   GraphDef graph_def;
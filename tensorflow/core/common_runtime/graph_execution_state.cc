@@ -15,9 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/graph_execution_state.h"
 
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -28,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/framework/graph.pb_text.h"
 #include "tensorflow/core/framework/graph_def_util.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/graph.h"
@@ -37,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/graph/validate.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
@@ -47,6 +51,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
 #endif  // IS_MOBILE_PLATFORM
 
 namespace tensorflow {
@@ -581,6 +586,7 @@ Status GraphExecutionState::OptimizeGraph(
     if (!(options.callable_options.feed().empty() &&
           options.callable_options.tensor_connection().empty())) {
       std::unordered_set<string> feeds;
+      std::unordered_map<string, TensorShapeProto> specialized_shapes;
       for (const string& feed : options.callable_options.feed()) {
         TensorId id = ParseTensorName(feed);
         if (id.second != 0) {
@@ -606,6 +612,22 @@ Status GraphExecutionState::OptimizeGraph(
           return errors::InvalidArgument("Missing node shape or type");
         }
         TensorShapeProto shape_proto(node.attr().at("shape").shape());
+        // Specialize the graph for the shape the fed tensors are known to
+        // have, if any. A shape that doesn't fit the declared one leaves the
+        // node generic, as does any feed outside the bucket.
+        auto feed_shape = options.feed_shapes.find(node.name());
+        if (feed_shape != options.feed_shapes.end()) {
+          if (PartialTensorShape(shape_proto)
+                  .IsCompatibleWith(
+                      PartialTensorShape(feed_shape->second.dim_sizes()))) {
+            feed_shape->second.AsProto(&shape_proto);
+            specialized_shapes[node.name()] = shape_proto;
+          } else {
+            VLOG(1) << "Not specializing " << node.name() << " of shape "
+                    << PartialTensorShape::DebugString(shape_proto)
+                    << " for shape " << feed_shape->second.DebugString();
+          }
+        }
         // If the shape of the placeholder value is only partially known,
         // we're free to use any dimension we want to feed the placeholder. We
         // choose 1 to minimize the memory impact. Note that this only matters
@@ -624,6 +646,12 @@ Status GraphExecutionState::OptimizeGraph(
         Tensor fake_input(type, shape);
         item.feed.emplace_back(node.name(), fake_input);
       }
+      for (NodeDef& node : *item.graph.mutable_node()) {
+        auto it = specialized_shapes.find(node.name());
+        if (it != specialized_shapes.end()) {
+          *(*node.mutable_attr())["shape"].mutable_shape() = it->second;
+        }
+      }
     }
 
     Device* cpu_device = nullptr;
@@ -634,10 +662,45 @@ Status GraphExecutionState::OptimizeGraph(
         cpu_device = device;
       }
     }
-    grappler::VirtualCluster cluster(device_set_);
     GraphDef new_graph;
-    TF_RETURN_IF_ERROR(grappler::RunMetaOptimizer(
-        item, rewrite_options, cpu_device, &cluster, &new_graph));
+    std::unique_ptr<grappler::OptimizedGraphCache> cache;
+    string cache_key;
+    bool cache_hit = false;
+    if (!rewrite_options.optimized_graph_cache_dir().empty()) {
+      cache.reset(new grappler::OptimizedGraphCache(
+          Env::Default(), rewrite_options.optimized_graph_cache_dir()));
+      std::vector<string> devices;
+      for (const Device* device : device_set_->devices()) {
+        const DeviceAttributes& attributes = device->attributes();
+        devices.push_back(strings::StrCat(attributes.name(), ";",
+                                          attributes.device_type(), ";",
+                                          attributes.memory_limit()));
+      }
+      std::sort(devices.begin(), devices.end());
+      cache_key =
+          grappler::OptimizedGraphCache::Key(item, rewrite_options, devices);
+      Status s = cache->Lookup(cache_key, &new_graph);
+      if (s.ok()) {
+        VLOG(1) << "Using the cached optimized graph " << cache_key;
+        cache_hit = true;
+      } else if (!errors::IsNotFound(s)) {
+        LOG(WARNING) << "Failed to read the cached optimized graph "
+                     << cache_key << ": " << s;
+      }
+    }
+    if (!cache_hit) {
+      grappler::VirtualCluster cluster(device_set_);
+      new_graph.Clear();
+      TF_RETURN_IF_ERROR(grappler::RunMetaOptimizer(
+          item, rewrite_options, cpu_device, &cluster, &new_graph));
+      if (cache != nullptr) {
+        Status s = cache->Insert(cache_key, new_graph);
+        if (!s.ok()) {
+          LOG(WARNING) << "Failed to cache the optimized graph " << cache_key
+                       << ": " << s;
+        }
+      }
+    }
 
     // Merge optimized graph function library with an original library.
     // Optimized graph might have new functions specialized for it's
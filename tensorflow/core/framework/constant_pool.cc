@@ -0,0 +1,88 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/constant_pool.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+constexpr size_t kMinSweepSize = 64;
+
+}  // namespace
+
+/* static */ ConstantPool* ConstantPool::Global() {
+  static ConstantPool* pool = [] {
+    int64 min_bytes;
+    TF_CHECK_OK(
+        ReadInt64FromEnvVar("TF_CONSTANT_POOL_MIN_BYTES", -1, &min_bytes));
+    return new ConstantPool(min_bytes);
+  }();
+  return pool;
+}
+
+Tensor ConstantPool::Intern(const Tensor& tensor) {
+  if (min_bytes_ < 0 || !DataTypeCanUseMemcpy(tensor.dtype()) ||
+      !tensor.IsInitialized() || tensor.NumElements() == 0 ||
+      tensor.TotalBytes() < min_bytes_) {
+    return tensor;
+  }
+  const StringPiece data = tensor.tensor_data();
+  const uint64 fingerprint = FingerprintCat64(
+      Fingerprint64(strings::StrCat(DataTypeString(tensor.dtype()),
+                                    tensor.shape().DebugString())),
+      Fingerprint64(data));
+
+  mutex_lock l(mu_);
+  auto range = tensors_.equal_range(fingerprint);
+  for (auto it = range.first; it != range.second; ++it) {
+    const Tensor& pooled = it->second;
+    if (pooled.dtype() == tensor.dtype() && pooled.shape() == tensor.shape() &&
+        pooled.tensor_data() == data) {
+      return pooled;
+    }
+  }
+  if (tensors_.size() >= sweep_size_) {
+    SweepLocked();
+    sweep_size_ = std::max(kMinSweepSize, 2 * tensors_.size());
+  }
+  tensors_.emplace(fingerprint, tensor);
+  return tensor;
+}
+
+size_t ConstantPool::size() const {
+  mutex_lock l(mu_);
+  return tensors_.size();
+}
+
+void ConstantPool::SweepLocked() {
+  for (auto it = tensors_.begin(); it != tensors_.end();) {
+    if (it->second.RefCountIsOne()) {
+      it = tensors_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace tensorflow
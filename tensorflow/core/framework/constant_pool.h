@@ -0,0 +1,72 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_CONSTANT_POOL_H_
+#define TENSORFLOW_CORE_FRAMEWORK_CONSTANT_POOL_H_
+
+#include <unordered_map>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A content-addressed pool of constant tensors, through which the identical
+// constants of different graphs, sessions or models loaded by a process share
+// their buffer. Serving several versions of a model which share, say, an
+// embedding table then only keeps one copy of the table in memory.
+//
+// Pooled tensors must never be modified. The pool only holds tensors which
+// are still referenced outside of it: the others are dropped as new tensors
+// are interned.
+class ConstantPool {
+ public:
+  // Only tensors of at least "min_bytes" are pooled. A negative value
+  // disables the pool.
+  explicit ConstantPool(int64 min_bytes) : min_bytes_(min_bytes) {}
+
+  // The pool shared by the Const kernels of all sessions on CPU devices. It
+  // pools the tensors of at least TF_CONSTANT_POOL_MIN_BYTES bytes, and is
+  // disabled if the environment variable isn't set.
+  static ConstantPool* Global();
+
+  // Returns a tensor sharing its buffer with a pooled tensor of the same
+  // type, shape and contents as "tensor", if any. Otherwise adds "tensor" to
+  // the pool and returns it. Tensors whose contents can't be compared
+  // bytewise (e.g. strings) are returned as is.
+  Tensor Intern(const Tensor& tensor);
+
+  // Returns the number of tensors in the pool.
+  size_t size() const;
+
+ private:
+  // Drops the tensors which are only referenced by the pool.
+  void SweepLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64 min_bytes_;
+  mutable mutex mu_;
+  // Keyed by fingerprint of the type, shape and contents of the tensors.
+  std::unordered_multimap<uint64, Tensor> tensors_ GUARDED_BY(mu_);
+  // Size of the pool beyond which the next insertion sweeps it.
+  size_t sweep_size_ GUARDED_BY(mu_) = 64;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ConstantPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_CONSTANT_POOL_H_
@@ -0,0 +1,75 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/constant_pool.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(ConstantPoolTest, SharesIdenticalTensors) {
+  ConstantPool pool(0);
+  const Tensor a = test::AsTensor<float>({1, 2, 3, 4}, {2, 2});
+  const Tensor pooled_a = pool.Intern(a);
+  EXPECT_TRUE(pooled_a.SharesBufferWith(a));
+
+  const Tensor a_copy = test::AsTensor<float>({1, 2, 3, 4}, {2, 2});
+  const Tensor pooled_copy = pool.Intern(a_copy);
+  EXPECT_TRUE(pooled_copy.SharesBufferWith(a));
+  test::ExpectTensorEqual<float>(a_copy, pooled_copy);
+  EXPECT_EQ(1, pool.size());
+
+  // Differing in contents, shape or type.
+  EXPECT_FALSE(pool.Intern(test::AsTensor<float>({1, 2, 3, 5}, {2, 2}))
+                   .SharesBufferWith(a));
+  const Tensor reshaped = test::AsTensor<float>({1, 2, 3, 4}, {4});
+  EXPECT_TRUE(pool.Intern(reshaped).SharesBufferWith(reshaped));
+  const Tensor ints = test::AsTensor<int32>({1, 2, 3, 4}, {2, 2});
+  EXPECT_TRUE(pool.Intern(ints).SharesBufferWith(ints));
+  EXPECT_EQ(4, pool.size());
+}
+
+TEST(ConstantPoolTest, SkipsSmallAndUncomparableTensors) {
+  ConstantPool pool(16);
+  const Tensor small = test::AsTensor<float>({1, 2});
+  pool.Intern(small);
+  EXPECT_FALSE(
+      pool.Intern(test::AsTensor<float>({1, 2})).SharesBufferWith(small));
+  const Tensor strings = test::AsTensor<string>({"a", "b", "c", "d", "e"});
+  pool.Intern(strings);
+  EXPECT_EQ(0, pool.size());
+
+  ConstantPool disabled(-1);
+  disabled.Intern(test::AsTensor<float>({1, 2, 3, 4, 5}));
+  EXPECT_EQ(0, disabled.size());
+}
+
+TEST(ConstantPoolTest, DropsUnreferencedTensors) {
+  ConstantPool pool(0);
+  const Tensor kept = test::AsTensor<int64>({-1});
+  pool.Intern(kept);
+  for (int64 i = 0; i < 100; ++i) {
+    pool.Intern(test::AsTensor<int64>({i}));
+  }
+  // Swept once the pool reached 64 tensors, keeping the referenced one.
+  EXPECT_GT(64, pool.size());
+  EXPECT_TRUE(
+      pool.Intern(test::AsTensor<int64>({-1})).SharesBufferWith(kept));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -503,6 +503,7 @@ class Tensor {
   friend class AutoReloadVariableOp;  // For access to set_shape
   friend class TensorTestHelper;      // For access to set_shape
   friend class CastOpBase;            // For access to set_dtype;
+  friend class ConstantPool;          // For access to RefCountIsOne().
   friend class OpKernelContext;       // For access to RefCountIsOne().
   friend class ScopedAllocator;       // For access to buf_.
   friend class XlaTensor;             // For access to RefCountIsOne().
@@ -522,6 +523,8 @@ class Tensor {
 
   friend class NumpyTensorBuffer;  // For access to the private constructor
                                    // taking the buffer.
+  friend class MappedTensorBuffer;  // For access to the private constructor
+                                    // taking the buffer.
 
   // Creates a tensor with the input datatype, shape and buf.
   //
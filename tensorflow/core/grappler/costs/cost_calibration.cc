@@ -0,0 +1,113 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/cost_calibration.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+string PointsKey(const string& op, const string& device_type) {
+  return strings::StrCat(device_type, "/", op);
+}
+
+}  // namespace
+
+CostCalibration::CostCalibration(const OpCostCalibration& calibration) {
+  for (const auto& entry : calibration.entries()) {
+    auto& points = points_[PointsKey(entry.op(), entry.device_type())];
+    for (const auto& point : entry.points()) {
+      if (point.estimated_ns() > 0 && point.measured_ns() > 0) {
+        points.emplace_back(std::log(point.estimated_ns()),
+                            std::log(point.measured_ns()));
+      }
+    }
+    std::sort(points.begin(), points.end());
+  }
+  for (auto it = points_.begin(); it != points_.end();) {
+    if (it->second.empty()) {
+      it = points_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/* static */ const CostCalibration* CostCalibration::Global() {
+  static const CostCalibration* calibration = []() -> CostCalibration* {
+    string path;
+    TF_CHECK_OK(
+        ReadStringFromEnvVar("TF_GRAPPLER_COST_CALIBRATION", "", &path));
+    if (path.empty()) {
+      return nullptr;
+    }
+    OpCostCalibration proto;
+    const Status s = ReadOpCostCalibration(Env::Default(), path, &proto);
+    if (!s.ok()) {
+      LOG(WARNING) << "Ignoring the op cost calibration in " << path << ": "
+                   << s;
+      return nullptr;
+    }
+    VLOG(1) << "Calibrating op costs with " << path;
+    return new CostCalibration(proto);
+  }();
+  return calibration;
+}
+
+bool CostCalibration::Calibrate(const string& op, const string& device_type,
+                                double estimated_ns,
+                                double* calibrated_ns) const {
+  auto it = points_.find(PointsKey(op, device_type));
+  if (it == points_.end() || estimated_ns <= 0) {
+    return false;
+  }
+  const auto& points = it->second;
+  const double x = std::log(estimated_ns);
+  // The first point estimated to take at least as long.
+  auto upper = std::lower_bound(points.begin(), points.end(),
+                                std::make_pair(x, -HUGE_VAL));
+  double log_ratio;
+  if (upper == points.begin()) {
+    log_ratio = upper->second - upper->first;
+  } else if (upper == points.end()) {
+    log_ratio = points.back().second - points.back().first;
+  } else {
+    auto lower = upper - 1;
+    const double t = (x - lower->first) / (upper->first - lower->first);
+    const double y = lower->second + t * (upper->second - lower->second);
+    log_ratio = y - x;
+  }
+  *calibrated_ns = estimated_ns * std::exp(log_ratio);
+  return true;
+}
+
+Status ReadOpCostCalibration(Env* env, const string& path,
+                             OpCostCalibration* calibration) {
+  if (ReadTextProto(env, path, calibration).ok()) {
+    return Status::OK();
+  }
+  return ReadBinaryProto(env, path, calibration);
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,66 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_COST_CALIBRATION_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_COST_CALIBRATION_H_
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Corrects the analytical execution time of ops with the times measured on
+// the local machine (see CalibrateOpCosts() in op_cost_calibrator.h).
+//
+// The measurements of an op are interpolated piecewise linearly in log-log
+// space over the estimated times, so that an op whose estimate falls between
+// two benchmarks is given a time between the two measurements. Beyond the
+// benchmarks, the ratio of the closest measurement to its estimate is
+// applied.
+class CostCalibration {
+ public:
+  explicit CostCalibration(const OpCostCalibration& calibration);
+
+  // The calibration read from the file named by the
+  // TF_GRAPPLER_COST_CALIBRATION environment variable, or null if the
+  // variable isn't set or the file can't be read. Read once.
+  static const CostCalibration* Global();
+
+  // Returns the execution time of an "op" estimated to take "estimated_ns" on
+  // a device of type "device_type". Returns false, and leaves
+  // "calibrated_ns" unchanged, if the op wasn't measured on such a device.
+  bool Calibrate(const string& op, const string& device_type,
+                 double estimated_ns, double* calibrated_ns) const;
+
+ private:
+  // Pairs of log(estimated_ns), log(measured_ns), sorted by estimate, keyed
+  // by device type and op.
+  std::unordered_map<string, std::vector<std::pair<double, double>>> points_;
+};
+
+// Reads an OpCostCalibration from a binary or text proto file.
+Status ReadOpCostCalibration(Env* env, const string& path,
+                             OpCostCalibration* calibration);
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_COST_CALIBRATION_H_
@@ -0,0 +1,97 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/cost_calibration.h"
+
+#include <cmath>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+OpCostCalibration MakeCalibration() {
+  OpCostCalibration calibration;
+  CHECK(protobuf::TextFormat::ParseFromString(
+      R"(entries {
+           op: "MatMul" device_type: "CPU"
+           points { estimated_ns: 1000 measured_ns: 4000 }
+           points { estimated_ns: 100 measured_ns: 1000 }
+           points { estimated_ns: 10000 measured_ns: 20000 }
+         }
+         entries {
+           op: "Relu" device_type: "CPU"
+           points { estimated_ns: 0 measured_ns: 10 }
+         })",
+      &calibration));
+  return calibration;
+}
+
+TEST(CostCalibrationTest, InterpolatesMeasurements) {
+  CostCalibration calibration(MakeCalibration());
+  double ns = -1;
+  EXPECT_TRUE(calibration.Calibrate("MatMul", "CPU", 1000, &ns));
+  EXPECT_NEAR(4000, ns, 1e-6);
+  EXPECT_TRUE(calibration.Calibrate("MatMul", "CPU", 100, &ns));
+  EXPECT_NEAR(1000, ns, 1e-6);
+
+  // Linear in log-log space between the measurements.
+  EXPECT_TRUE(calibration.Calibrate("MatMul", "CPU", std::sqrt(1e5), &ns));
+  EXPECT_NEAR(2000, ns, 1e-6);
+  EXPECT_TRUE(calibration.Calibrate("MatMul", "CPU", std::sqrt(1e7), &ns));
+  EXPECT_NEAR(std::sqrt(8e7), ns, 1e-6);
+
+  // Beyond them, the ratio of the closest measurement is applied.
+  EXPECT_TRUE(calibration.Calibrate("MatMul", "CPU", 10, &ns));
+  EXPECT_NEAR(100, ns, 1e-6);
+  EXPECT_TRUE(calibration.Calibrate("MatMul", "CPU", 1e6, &ns));
+  EXPECT_NEAR(2e6, ns, 1e-3);
+}
+
+TEST(CostCalibrationTest, IgnoresUncalibratedOps) {
+  CostCalibration calibration(MakeCalibration());
+  double ns = -1;
+  EXPECT_FALSE(calibration.Calibrate("MatMul", "GPU", 1000, &ns));
+  EXPECT_FALSE(calibration.Calibrate("Conv2D", "CPU", 1000, &ns));
+  // Only had an invalid measurement.
+  EXPECT_FALSE(calibration.Calibrate("Relu", "CPU", 1000, &ns));
+  EXPECT_FALSE(calibration.Calibrate("MatMul", "CPU", 0, &ns));
+  EXPECT_EQ(-1, ns);
+}
+
+TEST(CostCalibrationTest, ReadsTextAndBinaryProtos) {
+  const OpCostCalibration expected = MakeCalibration();
+  const string text_path =
+      io::JoinPath(testing::TmpDir(), "calibration.pbtxt");
+  const string binary_path = io::JoinPath(testing::TmpDir(), "calibration.pb");
+  TF_ASSERT_OK(WriteTextProto(Env::Default(), text_path, expected));
+  TF_ASSERT_OK(WriteBinaryProto(Env::Default(), binary_path, expected));
+
+  OpCostCalibration calibration;
+  TF_ASSERT_OK(ReadOpCostCalibration(Env::Default(), text_path, &calibration));
+  EXPECT_EQ(expected.DebugString(), calibration.DebugString());
+  calibration.Clear();
+  TF_ASSERT_OK(
+      ReadOpCostCalibration(Env::Default(), binary_path, &calibration));
+  EXPECT_EQ(expected.DebugString(), calibration.DebugString());
+}
+
+}  // namespace
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,196 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_calibrator.h"
+
+#include <unordered_map>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/costs/op_level_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/robust_stats.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+const char kOpCostBenchmarkNode[] = "op";
+
+namespace {
+
+// Returns a benchmark of a float "op" applied to inputs of the given shapes.
+GrapplerItem OpBenchmark(const string& op,
+                         const std::vector<std::vector<int64>>& input_dims) {
+  GrapplerItem item;
+  item.id = op;
+  NodeDef* node = item.graph.add_node();
+  node->set_name(kOpCostBenchmarkNode);
+  node->set_op(op);
+  AddNodeAttr("T", DT_FLOAT, node);
+  for (int i = 0; i < input_dims.size(); ++i) {
+    const string input = strings::StrCat("input", i);
+    NodeDef* placeholder = item.graph.add_node();
+    placeholder->set_name(input);
+    placeholder->set_op("Placeholder");
+    AddNodeAttr("dtype", DT_FLOAT, placeholder);
+    AddNodeAttr("shape", PartialTensorShape(input_dims[i]), placeholder);
+    node->add_input(input);
+
+    Tensor value(DT_FLOAT, TensorShape(input_dims[i]));
+    value.flat<float>().setRandom();
+    item.feed.emplace_back(input, value);
+    strings::StrAppend(&item.id, "_",
+                       str_util::Join(input_dims[i], "x"));
+  }
+  item.fetch.push_back(kOpCostBenchmarkNode);
+  return item;
+}
+
+// Returns the time "node_stats" spent running its op, in nanoseconds.
+double OpTimeNs(const NodeExecStats& node_stats) {
+  if (node_stats.op_end_rel_nanos() > 0) {
+    return node_stats.op_end_rel_nanos() - node_stats.op_start_rel_nanos();
+  }
+  return (node_stats.op_end_rel_micros() - node_stats.op_start_rel_micros()) *
+         1e3;
+}
+
+OpCostCalibration::Entry* FindOrAddEntry(const string& op,
+                                         const string& device_type,
+                                         OpCostCalibration* calibration) {
+  for (auto& entry : *calibration->mutable_entries()) {
+    if (entry.op() == op && entry.device_type() == device_type) {
+      return &entry;
+    }
+  }
+  OpCostCalibration::Entry* entry = calibration->add_entries();
+  entry->set_op(op);
+  entry->set_device_type(device_type);
+  return entry;
+}
+
+}  // namespace
+
+std::vector<GrapplerItem> DefaultOpCostBenchmarks() {
+  std::vector<GrapplerItem> benchmarks;
+  for (int64 n : {32, 64, 128, 256, 512, 1024}) {
+    GrapplerItem item = OpBenchmark("MatMul", {{n, n}, {n, n}});
+    AddNodeAttr("transpose_a", false, item.graph.mutable_node(0));
+    AddNodeAttr("transpose_b", false, item.graph.mutable_node(0));
+    benchmarks.push_back(std::move(item));
+  }
+  for (int64 size : {8, 16, 32, 64}) {
+    GrapplerItem item =
+        OpBenchmark("Conv2D", {{8, size, size, 64}, {3, 3, 64, 64}});
+    AddNodeAttr("strides", std::vector<int32>{1, 1, 1, 1},
+                item.graph.mutable_node(0));
+    AddNodeAttr("padding", "SAME", item.graph.mutable_node(0));
+    benchmarks.push_back(std::move(item));
+  }
+  for (int64 size : {1 << 10, 1 << 14, 1 << 18, 1 << 22}) {
+    for (const char* op : {"Add", "Mul"}) {
+      benchmarks.push_back(OpBenchmark(op, {{size}, {size}}));
+    }
+    for (const char* op : {"Relu", "Tanh"}) {
+      benchmarks.push_back(OpBenchmark(op, {{size}}));
+    }
+  }
+  return benchmarks;
+}
+
+Status CalibrateOpCosts(Cluster* cluster,
+                        const std::vector<GrapplerItem>& benchmarks,
+                        int num_runs, OpCostCalibration* calibration) {
+  OpLevelCostEstimator estimator;
+  estimator.set_calibration(nullptr);
+
+  for (const GrapplerItem& item : benchmarks) {
+    std::unordered_map<string, const NodeDef*> name_to_node;
+    for (const NodeDef& node : item.graph.node()) {
+      name_to_node[node.name()] = &node;
+    }
+    auto node_it = name_to_node.find(kOpCostBenchmarkNode);
+    if (node_it == name_to_node.end()) {
+      return errors::InvalidArgument("Benchmark ", item.id, " has no node ",
+                                     kOpCostBenchmarkNode);
+    }
+    const NodeDef& node = *node_it->second;
+
+    // The first run warms up the session.
+    TF_RETURN_IF_ERROR(cluster->Initialize(item));
+    std::vector<double> times;
+    string device;
+    for (int run = -1; run < num_runs; ++run) {
+      RunMetadata metadata;
+      TF_RETURN_IF_ERROR(
+          cluster->Run(item.graph, item.feed, item.fetch, &metadata));
+      if (run < 0) {
+        continue;
+      }
+      bool found = false;
+      for (const auto& dev_stats : metadata.step_stats().dev_stats()) {
+        for (const auto& node_stats : dev_stats.node_stats()) {
+          if (!found && node_stats.node_name() == node.name()) {
+            found = true;
+            device = dev_stats.device();
+            times.push_back(OpTimeNs(node_stats));
+          }
+        }
+      }
+    }
+    if (times.empty()) {
+      return errors::Internal("No execution time was recorded for ",
+                              item.id);
+    }
+    const double measured_ns = RobustStats(times).mean();
+
+    GraphProperties properties(item);
+    TF_RETURN_IF_ERROR(properties.InferStatically(false));
+    OpContext op_context;
+    op_context.name = node.name();
+    op_context.op_info = BuildOpInfoWithoutDevice(
+        node, name_to_node, properties.GetInputProperties(node.name()));
+    for (const auto& output : properties.GetOutputProperties(node.name())) {
+      *op_context.op_info.add_outputs() = output;
+    }
+    auto device_it = cluster->GetDevices().find(device);
+    *op_context.op_info.mutable_device() =
+        device_it != cluster->GetDevices().end() ? device_it->second
+                                                 : GetDeviceInfo(device);
+    const double estimated_ns =
+        estimator.PredictCosts(op_context).execution_time.count();
+
+    VLOG(1) << item.id << " on " << device << ": estimated " << estimated_ns
+            << " ns, measured " << measured_ns << " ns.";
+    OpCostCalibration::Point* point =
+        FindOrAddEntry(node.op(), op_context.op_info.device().type(),
+                       calibration)
+            ->add_points();
+    point->set_estimated_ns(estimated_ns);
+    point->set_measured_ns(measured_ns);
+  }
+  return Status::OK();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
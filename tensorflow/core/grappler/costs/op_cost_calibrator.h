@@ -0,0 +1,52 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATOR_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATOR_H_
+
+#include <vector>
+
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// The name of the node whose execution time an op cost benchmark measures.
+extern const char kOpCostBenchmarkNode[];
+
+// Microbenchmarks of MatMul, Conv2D and of common element-wise ops, at sizes
+// spanning the compute and memory bound regimes. The inputs of the
+// benchmarked op are placeholders fed with random values.
+std::vector<GrapplerItem> DefaultOpCostBenchmarks();
+
+// Runs each of the "benchmarks" "num_runs" times on "cluster" (typically a
+// SingleMachine of the local host), and adds to "calibration" the robust mean
+// of the execution time of its kOpCostBenchmarkNode along with the time the
+// uncalibrated OpLevelCostEstimator predicts for it.
+//
+// The resulting calibration, saved and named by the
+// TF_GRAPPLER_COST_CALIBRATION environment variable, corrects the estimates
+// of the cost models of grappler on the same machine.
+Status CalibrateOpCosts(Cluster* cluster,
+                        const std::vector<GrapplerItem>& benchmarks,
+                        int num_runs, OpCostCalibration* calibration);
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_CALIBRATOR_H_
@@ -0,0 +1,85 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_calibrator.h"
+#include "tensorflow/core/grappler/clusters/single_machine.h"
+#include "tensorflow/core/grappler/costs/cost_calibration.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class OpCostCalibratorTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    cluster_.reset(
+        new SingleMachine(60 /* timeout_s */, 2 /* num_cpu_cores */, 0));
+    TF_CHECK_OK(cluster_->Provision());
+  }
+
+  void TearDown() override {
+    TF_CHECK_OK(cluster_->Shutdown());
+    cluster_.reset();
+  }
+
+ protected:
+  std::unique_ptr<SingleMachine> cluster_;
+};
+
+TEST_F(OpCostCalibratorTest, MeasuresBenchmarks) {
+  std::vector<GrapplerItem> benchmarks;
+  for (const GrapplerItem& item : DefaultOpCostBenchmarks()) {
+    if (item.id == "MatMul_32x32_32x32" || item.id == "MatMul_64x64_64x64" ||
+        item.id == "Relu_1024") {
+      benchmarks.push_back(item);
+    }
+  }
+  ASSERT_EQ(3, benchmarks.size());
+
+  OpCostCalibration calibration;
+  TF_ASSERT_OK(CalibrateOpCosts(cluster_.get(), benchmarks, 3, &calibration));
+  ASSERT_EQ(2, calibration.entries_size());
+  const auto& matmul = calibration.entries(0);
+  EXPECT_EQ("MatMul", matmul.op());
+  EXPECT_EQ("CPU", matmul.device_type());
+  ASSERT_EQ(2, matmul.points_size());
+  for (const auto& point : matmul.points()) {
+    EXPECT_GT(point.estimated_ns(), 0);
+    EXPECT_GT(point.measured_ns(), 0);
+  }
+  EXPECT_LT(matmul.points(0).estimated_ns(), matmul.points(1).estimated_ns());
+  EXPECT_EQ("Relu", calibration.entries(1).op());
+
+  // The measurements are reproduced by the calibration.
+  double ns;
+  EXPECT_TRUE(CostCalibration(calibration)
+                  .Calibrate("MatMul", "CPU", matmul.points(0).estimated_ns(),
+                             &ns));
+  EXPECT_NEAR(matmul.points(0).measured_ns(), ns, 1e-3);
+}
+
+TEST_F(OpCostCalibratorTest, RejectsBenchmarksWithoutOp) {
+  GrapplerItem item = DefaultOpCostBenchmarks()[0];
+  item.graph.mutable_node(0)->set_name("other");
+  OpCostCalibration calibration;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      CalibrateOpCosts(cluster_.get(), {item}, 1, &calibration)));
+}
+
+}  // namespace
+}  // end namespace grappler
+}  // end namespace tensorflow
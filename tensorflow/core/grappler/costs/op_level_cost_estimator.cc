@@ -350,6 +350,7 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
 
   // By default, use sum of memory_time and compute_time for execution_time.
   compute_memory_overlap_ = false;
+  calibration_ = CostCalibration::Global();
 }
 
 Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
@@ -357,7 +358,9 @@ Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
   auto it = device_cost_impl_.find(op_features.op());
   if (it == device_cost_impl_.end()) {
     if (elementwise_ops_.find(op_features.op()) != elementwise_ops_.end()) {
-      return PredictCwiseOp(op_context);
+      Costs costs = PredictCwiseOp(op_context);
+      CalibrateCosts(op_features, &costs);
+      return costs;
     }
 
     VLOG(1) << "Missing accurate estimator for op: " << op_features.op();
@@ -367,11 +370,31 @@ Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
 
   std::function<Costs(const OpContext&)> estimator = it->second;
   Costs costs = estimator(op_context);
+  CalibrateCosts(op_features, &costs);
   VLOG(1) << "Operation " << op_features.op() << " takes "
           << costs.execution_time.count() << " ns.";
   return costs;
 }
 
+void OpLevelCostEstimator::CalibrateCosts(const OpInfo& op_info,
+                                          Costs* costs) const {
+  const double estimated_ns = costs->execution_time.count();
+  double calibrated_ns;
+  if (calibration_ == nullptr ||
+      !calibration_->Calibrate(op_info.op(), op_info.device().type(),
+                               estimated_ns, &calibrated_ns)) {
+    return;
+  }
+  const double ratio = calibrated_ns / estimated_ns;
+  costs->execution_time = Costs::Duration(std::ceil(calibrated_ns));
+  costs->compute_time =
+      Costs::Duration(std::ceil(costs->compute_time.count() * ratio));
+  costs->memory_time =
+      Costs::Duration(std::ceil(costs->memory_time.count() * ratio));
+  VLOG(2) << "Calibrated " << op_info.op() << " from " << estimated_ns
+          << " to " << calibrated_ns << " ns.";
+}
+
 OpLevelCostEstimator::DeviceInfo OpLevelCostEstimator::GetDeviceInfo(
     const DeviceProperties& device) const {
   double gflops = -1;
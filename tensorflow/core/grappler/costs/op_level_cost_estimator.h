@@ -20,6 +20,7 @@ limitations under the License.
 #include <map>
 #include <string>
 
+#include "tensorflow/core/grappler/costs/cost_calibration.h"
 #include "tensorflow/core/grappler/costs/cost_estimator.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
@@ -49,6 +50,13 @@ class OpLevelCostEstimator {
   // Returns basic device performance info.
   virtual DeviceInfo GetDeviceInfo(const DeviceProperties& device) const;
 
+  // Sets the measurements correcting the estimates, CostCalibration::Global()
+  // by default. The calibration must outlive the estimator. Null disables
+  // the correction.
+  void set_calibration(const CostCalibration* calibration) {
+    calibration_ = calibration;
+  }
+
  protected:
   // Predict cost of an op for which no accurate estimator is defined.
   Costs PredictCostOfAnUnknownOp(const OpContext& op_context) const;
@@ -196,6 +204,10 @@ class OpLevelCostEstimator {
   // already been calculated.
   void CombineCostsAndUpdateExecutionTime(Costs* costs) const;
 
+  // Scales "costs" of the op described by "op_info" by the ratio of its
+  // measured to estimated execution time, if the op was calibrated.
+  void CalibrateCosts(const OpInfo& op_info, Costs* costs) const;
+
  protected:
   std::map<string, int> elementwise_ops_;
   typedef std::function<Costs(const OpContext& op_context)> CostImpl;
@@ -203,6 +215,7 @@ class OpLevelCostEstimator {
   // If true, assume compute and memory overlap; hence, the op cost is max of
   // compute_time and memory_time, insteaf of sum of those two.
   bool compute_memory_overlap_;
+  const CostCalibration* calibration_;
 
  private:
   friend class OpLevelCostEstimatorTest;
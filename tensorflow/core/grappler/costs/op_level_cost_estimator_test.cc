@@ -1199,5 +1199,34 @@ TEST_F(OpLevelCostEstimatorTest, MaybeGetMinimumShape) {
     ExpectTensorShape({10, 20}, y);
   }
 }
+
+TEST_F(OpLevelCostEstimatorTest, AppliesCalibration) {
+  const OpContext matmul = DescribeMatMul(256, 256, 256, 256);
+  const OpContext conv = DescribeConvolution(16, 19, 19, 48, 48, 5, 5, 256);
+  estimator_.set_calibration(nullptr);
+  const Costs matmul_costs = PredictCosts(matmul);
+  const Costs conv_costs = PredictCosts(conv);
+  ASSERT_GT(matmul_costs.execution_time.count(), 0);
+
+  OpCostCalibration proto;
+  auto* entry = proto.add_entries();
+  entry->set_op("MatMul");
+  entry->set_device_type("CPU");
+  auto* point = entry->add_points();
+  point->set_estimated_ns(matmul_costs.execution_time.count());
+  point->set_measured_ns(3 * matmul_costs.execution_time.count());
+  CostCalibration calibration(proto);
+  estimator_.set_calibration(&calibration);
+
+  const Costs calibrated = PredictCosts(matmul);
+  EXPECT_EQ(3 * matmul_costs.execution_time.count(),
+            calibrated.execution_time.count());
+  EXPECT_NEAR(3 * matmul_costs.compute_time.count(),
+              calibrated.compute_time.count(), 1);
+  EXPECT_NEAR(3 * matmul_costs.memory_time.count(),
+              calibrated.memory_time.count(), 1);
+  EXPECT_EQ(conv_costs.execution_time, PredictCosts(conv).execution_time);
+  estimator_.set_calibration(nullptr);
+}
 }  // end namespace grappler
 }  // end namespace tensorflow
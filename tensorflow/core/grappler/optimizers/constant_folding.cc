@@ -1655,6 +1655,11 @@ Status ConstantFolding::SimplifyNode(bool use_shape_info, NodeDef* node,
     return Status::OK();
   }
 
+  if (SimplifyBroadcastTo(*properties, use_shape_info, optimized_graph,
+                          node)) {
+    return Status::OK();
+  }
+
   if (SimplifyPack(optimized_graph, node)) {
     graph_modified_ = true;
     return Status::OK();
@@ -2099,6 +2104,25 @@ bool ConstantFolding::SimplifySqueeze(const GraphProperties& properties,
   return false;
 }
 
+bool ConstantFolding::SimplifyBroadcastTo(const GraphProperties& properties,
+                                          bool use_shape_info,
+                                          GraphDef* optimized_graph,
+                                          NodeDef* node) {
+  if (use_shape_info && IsBroadcastTo(*node) &&
+      !properties.GetInputProperties(node->name()).empty() &&
+      !properties.GetOutputProperties(node->name()).empty()) {
+    // The shapes may be symbolic, e.g. when broadcasting to the shape of the
+    // input itself.
+    const auto& input = properties.GetInputProperties(node->name())[0];
+    const auto& output = properties.GetOutputProperties(node->name())[0];
+    if (ShapesSymbolicallyEqual(input, output)) {
+      ReplaceOperationWithIdentity(0, properties, node, optimized_graph);
+      return true;
+    }
+  }
+  return false;
+}
+
 bool ConstantFolding::SimplifyPack(GraphDef* optimized_graph, NodeDef* node) {
   if (IsPack(*node) && NumNonControlInputs(*node) == 1 &&
       !OptimizedNodeExists(*node, "_const_axis")) {
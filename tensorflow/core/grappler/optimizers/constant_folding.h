@@ -170,6 +170,12 @@ class ConstantFolding : public GraphOptimizer {
   // Simplifies Pack operation if applicable.
   bool SimplifyPack(GraphDef* optimized_graph, NodeDef* node);
 
+  // Simplifies a BroadcastTo operation to an Identity operation if its input
+  // already has the target shape.
+  bool SimplifyBroadcastTo(const GraphProperties& properties,
+                           bool use_shape_info, GraphDef* optimized_graph,
+                           NodeDef* node);
+
   // Simplifies a Squeeze operation to an Identity operation if applicable.
   bool SimplifySqueeze(const GraphProperties& properties, bool use_shape_info,
                        GraphDef* optimized_graph, NodeDef* node);
@@ -2206,6 +2206,43 @@ TEST_F(ConstantFoldingTest, PaddingWithZeroSize) {
   test::ExpectTensorEqual<int>(tensors_expected[0], tensors[0]);
 }
 
+TEST_F(ConstantFoldingTest, BroadcastToInputShape) {
+  tensorflow::Scope scope = tensorflow::Scope::NewRootScope();
+
+  Output in1 = ops::Placeholder(
+      scope.WithOpName("in1"), DT_FLOAT,
+      ops::Placeholder::Shape(PartialTensorShape({-1, 3})));
+  Output in2 = ops::Variable(scope.WithOpName("in2"), {1, 3}, DT_FLOAT);
+  Output shape1 = ops::Shape(scope.WithOpName("shape1"), in1);
+  Output shape2 = ops::Const(scope.WithOpName("shape2"), {4, 3}, {2});
+  // A no-op, though the shape is only known symbolically.
+  ops::BroadcastTo b1(scope.WithOpName("b1"), in1, shape1);
+  ops::BroadcastTo b2(scope.WithOpName("b2"), in2, shape2);
+
+  GrapplerItem item;
+  item.fetch = {"b1", "b2"};
+  TF_CHECK_OK(scope.ToGraphDef(&item.graph));
+
+  ConstantFolding optimizer(nullptr /* cpu_device */);
+  GraphDef got;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &got));
+
+  int found = 0;
+  for (const NodeDef& node : got.node()) {
+    if (node.name() == "b1") {
+      ++found;
+      EXPECT_EQ("Identity", node.op());
+      ASSERT_EQ(2, node.input_size());
+      EXPECT_EQ("in1", node.input(0));
+      EXPECT_EQ("^shape1", node.input(1));
+    } else if (node.name() == "b2") {
+      ++found;
+      EXPECT_EQ("BroadcastTo", node.op());
+    }
+  }
+  EXPECT_EQ(2, found);
+}
+
 TEST_F(ConstantFoldingTest, SqueezeWithAllDimesionsGreaterThanOne) {
   tensorflow::Scope scope = tensorflow::Scope::NewRootScope();
 
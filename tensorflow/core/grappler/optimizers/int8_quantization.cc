@@ -0,0 +1,452 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/int8_quantization.h"
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/frame.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+constexpr char kQuantizationPrefix[] = "Int8Quantization";
+
+// A quint8 tensor and the range of its values, as tensor names.
+struct QuantizedTensor {
+  string value;
+  string min;
+  string max;
+};
+
+struct Range {
+  float min = 0;
+  float max = 0;
+};
+
+// Returns the name of the tensor "input" refers to, without the port for the
+// first output.
+string TensorName(const string& input) {
+  int port;
+  const string node = ParseNodeName(input, &port);
+  return port == 0 ? node : strings::StrCat(node, ":", port);
+}
+
+bool IsFloat(const NodeDef& node, const string& type_attr) {
+  return node.attr().count(type_attr) > 0 &&
+         node.attr().at(type_attr).type() == DT_FLOAT;
+}
+
+bool HasDefaultDataFormat(const NodeDef& node) {
+  return node.attr().count("data_format") == 0 ||
+         node.attr().at("data_format").s() == "NHWC";
+}
+
+bool IsOnCpu(const NodeDef& node) {
+  if (node.device().empty()) return true;
+  DeviceNameUtils::ParsedName parsed;
+  return DeviceNameUtils::ParseFullName(node.device(), &parsed) &&
+         (!parsed.has_type || parsed.type == "CPU");
+}
+
+bool IsQuantizableMatMul(const NodeDef& node) {
+  return IsMatMul(node) && node.op() == "MatMul" && IsFloat(node, "T");
+}
+
+bool IsQuantizableConv2D(const NodeDef& node) {
+  if (!IsConv2D(node) || !IsFloat(node, "T") || !HasDefaultDataFormat(node)) {
+    return false;
+  }
+  if (node.attr().count("dilations") > 0) {
+    for (int64 dilation : node.attr().at("dilations").list().i()) {
+      if (dilation != 1) return false;
+    }
+  }
+  // QuantizedConv2D only supports equal row and column strides.
+  if (node.attr().count("strides") == 0) return false;
+  const auto& strides = node.attr().at("strides").list().i();
+  return strides.size() == 4 && strides.Get(1) == strides.Get(2);
+}
+
+// Rewrites the quantizable chains of a graph, in topological order so that
+// the chains can read the quantized outputs of the chains they consume.
+class ChainRewriter {
+ public:
+  ChainRewriter(const Int8QuantizationOptions& opts,
+                const std::unordered_set<string>& nodes_to_preserve,
+                GraphDef* graph)
+      : opts_(opts),
+        nodes_to_preserve_(nodes_to_preserve),
+        graph_(graph),
+        node_map_(graph) {}
+
+  Status Rewrite(int* num_quantized_nodes);
+
+ private:
+  // Returns the nodes of the chain starting at "head", or an empty vector if
+  // "head" can't start a chain.
+  std::vector<NodeDef*> GetChain(NodeDef* head) const;
+  // Returns the consumer of "node" that can extend its chain, or nullptr.
+  NodeDef* GetChainConsumer(const NodeDef& node) const;
+  bool GetRange(const string& tensor, Range* range) const;
+  bool GetOutputRange(const NodeDef& node, Range* range) const;
+  bool CanQuantize(const string& tensor) const;
+
+  NodeDef* AddNode(const string& name, const string& op,
+                   const string& device);
+  string AddScalar(const string& name, float value, const string& device);
+  QuantizedTensor Quantize(const string& tensor, const string& name,
+                           const string& device);
+  QuantizedTensor Requantize(const QuantizedTensor& input, const Range& range,
+                             const string& name, const string& device);
+  void RewriteChain(const std::vector<NodeDef*>& chain);
+
+  const Int8QuantizationOptions& opts_;
+  const std::unordered_set<string> nodes_to_preserve_;
+  GraphDef* graph_;  // Not owned.
+  NodeMap node_map_;
+  // The quantized version of the float tensors, by tensor name.
+  std::unordered_map<string, QuantizedTensor> quantized_;
+  // The last nodes of the chains, turned into Dequantize nodes.
+  std::vector<string> dequantized_;
+  std::set<string> nodes_to_delete_;
+};
+
+bool ChainRewriter::GetRange(const string& tensor, Range* range) const {
+  const NodeDef* producer = node_map_.GetNode(tensor);
+  if (producer != nullptr && IsConstant(*producer) &&
+      producer->attr().count("value") > 0) {
+    // The range of constants is known.
+    Tensor value;
+    if (!value.FromProto(producer->attr().at("value").tensor()) ||
+        value.dtype() != DT_FLOAT || value.NumElements() == 0) {
+      return false;
+    }
+    auto flat = value.flat<float>();
+    range->min = *std::min_element(flat.data(), flat.data() + flat.size());
+    range->max = *std::max_element(flat.data(), flat.data() + flat.size());
+    return true;
+  }
+  const string name = TensorName(tensor);
+  auto it = opts_.ranges().find(name);
+  if (it == opts_.ranges().end() && name == NodeName(tensor)) {
+    it = opts_.ranges().find(strings::StrCat(name, ":0"));
+  }
+  if (it == opts_.ranges().end()) {
+    return false;
+  }
+  range->min = it->second.min();
+  range->max = it->second.max();
+  return range->min < range->max;
+}
+
+// Returns the range the output of the chain ending with "node" is requantized
+// to. Activations clamp it.
+bool ChainRewriter::GetOutputRange(const NodeDef& node, Range* range) const {
+  if (!GetRange(node.name(), range)) {
+    return false;
+  }
+  if (IsRelu(node) || IsRelu6(node)) {
+    range->min = std::max(range->min, 0.0f);
+  }
+  if (IsRelu6(node)) {
+    range->max = std::min(range->max, 6.0f);
+  }
+  return range->min < range->max;
+}
+
+bool ChainRewriter::CanQuantize(const string& tensor) const {
+  Range range;
+  return quantized_.count(TensorName(tensor)) > 0 || GetRange(tensor, &range);
+}
+
+NodeDef* ChainRewriter::GetChainConsumer(const NodeDef& node) const {
+  if (nodes_to_preserve_.count(node.name()) > 0) {
+    return nullptr;
+  }
+  const std::set<NodeDef*>& outputs = node_map_.GetOutputs(node.name());
+  if (outputs.size() != 1) {
+    return nullptr;
+  }
+  NodeDef* consumer = *outputs.begin();
+  if (consumer->input_size() == 0 || consumer->input(0) != node.name()) {
+    return nullptr;
+  }
+  for (int i = 1; i < consumer->input_size(); ++i) {
+    if (NodeName(consumer->input(i)) == node.name()) return nullptr;
+  }
+  return consumer;
+}
+
+std::vector<NodeDef*> ChainRewriter::GetChain(NodeDef* head) const {
+  std::vector<NodeDef*> chain;
+  if (!(IsQuantizableMatMul(*head) || IsQuantizableConv2D(*head)) ||
+      !IsOnCpu(*head) || !CanQuantize(head->input(0)) ||
+      !CanQuantize(head->input(1))) {
+    return chain;
+  }
+  chain.push_back(head);
+  NodeDef* consumer = GetChainConsumer(*head);
+  Range range;
+  if (consumer != nullptr && IsBiasAdd(*consumer) &&
+      consumer->op() == "BiasAdd" && IsFloat(*consumer, "T") &&
+      HasDefaultDataFormat(*consumer) && GetRange(head->name(), &range) &&
+      CanQuantize(consumer->input(1))) {
+    chain.push_back(consumer);
+    consumer = GetChainConsumer(*consumer);
+  }
+  if (consumer != nullptr && (IsRelu(*consumer) || IsRelu6(*consumer)) &&
+      IsFloat(*consumer, "T")) {
+    chain.push_back(consumer);
+  }
+  // The output of the chain is requantized to the range of its last node.
+  while (!chain.empty() && !GetOutputRange(*chain.back(), &range)) {
+    chain.pop_back();
+  }
+  return chain;
+}
+
+NodeDef* ChainRewriter::AddNode(const string& name, const string& op,
+                                const string& device) {
+  NodeDef* node = graph_->add_node();
+  node->set_name(name);
+  node->set_op(op);
+  node->set_device(device);
+  node_map_.AddNode(name, node);
+  return node;
+}
+
+string ChainRewriter::AddScalar(const string& name, float value,
+                                const string& device) {
+  NodeDef* node = AddNode(name, "Const", device);
+  (*node->mutable_attr())["dtype"].set_type(DT_FLOAT);
+  Tensor tensor(value);
+  tensor.AsProtoTensorContent(
+      (*node->mutable_attr())["value"].mutable_tensor());
+  return name;
+}
+
+QuantizedTensor ChainRewriter::Quantize(const string& tensor,
+                                        const string& name,
+                                        const string& device) {
+  const string tensor_name = TensorName(tensor);
+  auto it = quantized_.find(tensor_name);
+  if (it != quantized_.end()) {
+    return it->second;
+  }
+  Range range;
+  GetRange(tensor, &range);
+  NodeDef* node = AddNode(name, "QuantizeV2", device);
+  node->add_input(tensor);
+  node->add_input(AddScalar(strings::StrCat(name, "/min"), range.min, device));
+  node->add_input(AddScalar(strings::StrCat(name, "/max"), range.max, device));
+  (*node->mutable_attr())["T"].set_type(DT_QUINT8);
+  (*node->mutable_attr())["mode"].set_s("MIN_FIRST");
+  QuantizedTensor quantized = {name, strings::StrCat(name, ":1"),
+                               strings::StrCat(name, ":2")};
+  // Shared by all the consumers of the tensor.
+  quantized_[tensor_name] = quantized;
+  return quantized;
+}
+
+QuantizedTensor ChainRewriter::Requantize(const QuantizedTensor& input,
+                                          const Range& range,
+                                          const string& name,
+                                          const string& device) {
+  NodeDef* node = AddNode(name, "Requantize", device);
+  node->add_input(input.value);
+  node->add_input(input.min);
+  node->add_input(input.max);
+  // Requantize requires a range that includes zero.
+  node->add_input(AddScalar(strings::StrCat(name, "/min"),
+                            std::min(range.min, 0.0f), device));
+  node->add_input(AddScalar(strings::StrCat(name, "/max"),
+                            std::max(range.max, 0.0f), device));
+  (*node->mutable_attr())["Tinput"].set_type(DT_QINT32);
+  (*node->mutable_attr())["out_type"].set_type(DT_QUINT8);
+  return {name, strings::StrCat(name, ":1"), strings::StrCat(name, ":2")};
+}
+
+void ChainRewriter::RewriteChain(const std::vector<NodeDef*>& chain) {
+  NodeDef* head = chain.front();
+  NodeDef* last = chain.back();
+  const string& device = head->device();
+  const string prefix = AddPrefixToNodeName(head->name(), kQuantizationPrefix);
+  VLOG(1) << "Quantizing " << head->name() << " to " << last->name();
+
+  const QuantizedTensor input =
+      Quantize(head->input(0), strings::StrCat(prefix, "/input"), device);
+  const QuantizedTensor weights =
+      Quantize(head->input(1), strings::StrCat(prefix, "/weights"), device);
+  NodeDef* op;
+  if (IsMatMul(*head)) {
+    op = AddNode(strings::StrCat(prefix, "/matmul"), "QuantizedMatMul",
+                 device);
+    (*op->mutable_attr())["T1"].set_type(DT_QUINT8);
+    (*op->mutable_attr())["T2"].set_type(DT_QUINT8);
+    (*op->mutable_attr())["Toutput"].set_type(DT_QINT32);
+    for (const char* attr : {"transpose_a", "transpose_b"}) {
+      if (head->attr().count(attr) > 0) {
+        (*op->mutable_attr())[attr] = head->attr().at(attr);
+      }
+    }
+  } else {
+    op = AddNode(strings::StrCat(prefix, "/conv"), "QuantizedConv2D", device);
+    (*op->mutable_attr())["Tinput"].set_type(DT_QUINT8);
+    (*op->mutable_attr())["Tfilter"].set_type(DT_QUINT8);
+    (*op->mutable_attr())["out_type"].set_type(DT_QINT32);
+    for (const char* attr : {"strides", "padding", "dilations"}) {
+      if (head->attr().count(attr) > 0) {
+        (*op->mutable_attr())[attr] = head->attr().at(attr);
+      }
+    }
+  }
+  for (const string& tensor : {input.value, weights.value, input.min,
+                               input.max, weights.min, weights.max}) {
+    op->add_input(tensor);
+  }
+  // The control dependencies of the chain now apply to the quantized op.
+  for (const NodeDef* node : chain) {
+    for (const string& tensor : node->input()) {
+      if (IsControlInput(tensor)) op->add_input(tensor);
+    }
+  }
+  QuantizedTensor output = {op->name(), strings::StrCat(op->name(), ":1"),
+                            strings::StrCat(op->name(), ":2")};
+
+  Range range;
+  if (chain.size() > 1 && IsBiasAdd(*chain[1])) {
+    GetRange(head->name(), &range);
+    output = Requantize(output, range, strings::StrCat(prefix, "/requantize"),
+                        device);
+    const QuantizedTensor bias =
+        Quantize(chain[1]->input(1), strings::StrCat(prefix, "/bias"), device);
+    NodeDef* bias_add =
+        AddNode(strings::StrCat(prefix, "/bias_add"), "QuantizedBiasAdd",
+                device);
+    for (const string& tensor :
+         {output.value, bias.value, output.min, output.max, bias.min,
+          bias.max}) {
+      bias_add->add_input(tensor);
+    }
+    (*bias_add->mutable_attr())["T1"].set_type(DT_QUINT8);
+    (*bias_add->mutable_attr())["T2"].set_type(DT_QUINT8);
+    (*bias_add->mutable_attr())["out_type"].set_type(DT_QINT32);
+    output = {bias_add->name(), strings::StrCat(bias_add->name(), ":1"),
+              strings::StrCat(bias_add->name(), ":2")};
+  }
+  GetOutputRange(*last, &range);
+  output = Requantize(output, range,
+                      strings::StrCat(prefix, "/requantize_output"), device);
+
+  for (NodeDef* node : chain) {
+    if (node != last) nodes_to_delete_.insert(node->name());
+  }
+  last->set_op("Dequantize");
+  last->clear_input();
+  last->add_input(output.value);
+  last->add_input(output.min);
+  last->add_input(output.max);
+  last->mutable_attr()->clear();
+  (*last->mutable_attr())["T"].set_type(DT_QUINT8);
+  (*last->mutable_attr())["mode"].set_s("MIN_FIRST");
+  quantized_[last->name()] = output;
+  dequantized_.push_back(last->name());
+}
+
+Status ChainRewriter::Rewrite(int* num_quantized_nodes) {
+  std::unordered_map<const NodeDef*, int> topo_order;
+  TF_RETURN_IF_ERROR(ComputeTopologicalOrder(*graph_, &topo_order, nullptr));
+  FrameMap frames;
+  int num_frames;
+  TF_RETURN_IF_ERROR(
+      IdentifyFramesWithNodeMap(*graph_, node_map_, &frames, &num_frames));
+  std::vector<NodeDef*> nodes(graph_->node_size());
+  for (int i = 0; i < graph_->node_size(); ++i) {
+    nodes[topo_order.at(&graph_->node(i))] = graph_->mutable_node(i);
+  }
+
+  for (NodeDef* node : nodes) {
+    // Nodes in loops would need their constants to be in the loop too.
+    if (!frames[node].empty()) continue;
+    const std::vector<NodeDef*> chain = GetChain(node);
+    if (chain.empty()) continue;
+    RewriteChain(chain);
+    *num_quantized_nodes += chain.size();
+  }
+
+  // Remove the Dequantize nodes only consumed by other chains.
+  NodeMap node_map(graph_);
+  for (const string& name : dequantized_) {
+    bool used = nodes_to_preserve_.count(name) > 0;
+    for (const NodeDef* output : node_map.GetOutputs(name)) {
+      used |= nodes_to_delete_.count(output->name()) == 0;
+    }
+    if (!used) nodes_to_delete_.insert(name);
+  }
+  EraseNodesFromGraph(nodes_to_delete_, graph_);
+  return Status::OK();
+}
+
+}  // namespace
+
+/* static */ void Int8Quantization::RecordCalibrationRanges(
+    const std::vector<string>& names, const std::vector<Tensor>& tensors,
+    Int8QuantizationOptions* opts) {
+  for (int i = 0; i < names.size() && i < tensors.size(); ++i) {
+    const Tensor& tensor = tensors[i];
+    if (tensor.dtype() != DT_FLOAT || tensor.NumElements() == 0) continue;
+    auto flat = tensor.flat<float>();
+    const float min = *std::min_element(flat.data(), flat.data() + flat.size());
+    const float max = *std::max_element(flat.data(), flat.data() + flat.size());
+    const string name = TensorName(names[i]);
+    auto* ranges = opts->mutable_ranges();
+    if (ranges->count(name) == 0) {
+      (*ranges)[name].set_min(min);
+      (*ranges)[name].set_max(max);
+    } else {
+      Int8QuantizationOptions::Range& range = (*ranges)[name];
+      range.set_min(std::min(range.min(), min));
+      range.set_max(std::max(range.max(), max));
+    }
+  }
+}
+
+Status Int8Quantization::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                  GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  num_quantized_nodes_ = 0;
+  ChainRewriter rewriter(opts_, item.NodesToPreserve(), optimized_graph);
+  return rewriter.Rewrite(&num_quantized_nodes_);
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,80 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INT8_QUANTIZATION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INT8_QUANTIZATION_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Runs the float MatMul and Conv2D nodes of inference graphs, along with the
+// BiasAdd and Relu/Relu6 nodes following them, on the 8-bit quantized CPU
+// kernels:
+//
+//   QuantizeV2 -> QuantizedMatMul -> Requantize -> QuantizedBiasAdd
+//              -> Requantize -> Dequantize
+//
+// The Dequantize takes over the name of the last node of the chain. The ranges
+// of the activations come from a calibration run (see
+// Int8QuantizationOptions and RecordCalibrationRanges()), the ranges of the
+// constant weights and biases from their values. The activations are folded
+// into the last Requantize, which clamps its output to their range. Chains
+// feeding each other exchange the quantized tensors directly, without a
+// Dequantize/QuantizeV2 pair in between.
+//
+// Chains in loops, on other devices than CPUs, or with a tensor whose range
+// is unknown are left alone.
+class Int8Quantization : public GraphOptimizer {
+ public:
+  Int8Quantization() : opt_level_(RewriterConfig::DEFAULT) {}
+  Int8Quantization(RewriterConfig::Toggle opt_level,
+                   const Int8QuantizationOptions& opts)
+      : opt_level_(opt_level), opts_(opts) {}
+
+  ~Int8Quantization() override {}
+
+  string name() const override { return "int8_quantization"; };
+
+  // Widens the ranges of "opts" to cover the values of the float tensors
+  // "tensors", fetched from the tensors "names" on calibration data.
+  static void RecordCalibrationRanges(const std::vector<string>& names,
+                                      const std::vector<Tensor>& tensors,
+                                      Int8QuantizationOptions* opts);
+
+  // Number of nodes quantized by the last call to Optimize().
+  int num_quantized_nodes() const { return num_quantized_nodes_; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+
+ private:
+  RewriterConfig::Toggle opt_level_;
+  Int8QuantizationOptions opts_;
+  int num_quantized_nodes_ = 0;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INT8_QUANTIZATION_H_
@@ -0,0 +1,260 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/int8_quantization.h"
+
+#include <cmath>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+Tensor MakeTensor(const TensorShape& shape, float scale, float phase) {
+  Tensor tensor(DT_FLOAT, shape);
+  test::FillFn<float>(&tensor, [scale, phase](int i) -> float {
+    return scale * std::sin(0.37f * i + phase);
+  });
+  return tensor;
+}
+
+// Builds a two layer perceptron: out = relu(x * w1 + b1) * w2 + b2.
+GrapplerItem MakeMlp(int batch_size, int input_size, int hidden_size,
+                     int output_size) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT);
+  Output w1 = ops::Const(s.WithOpName("w1"),
+                         Input::Initializer(MakeTensor(
+                             {input_size, hidden_size}, 0.1f, 0.0f)));
+  Output b1 = ops::Const(
+      s.WithOpName("b1"),
+      Input::Initializer(MakeTensor({hidden_size}, 0.05f, 1.0f)));
+  Output w2 = ops::Const(s.WithOpName("w2"),
+                         Input::Initializer(MakeTensor(
+                             {hidden_size, output_size}, 0.1f, 2.0f)));
+  Output b2 = ops::Const(
+      s.WithOpName("b2"),
+      Input::Initializer(MakeTensor({output_size}, 0.05f, 3.0f)));
+  Output mm1 = ops::MatMul(s.WithOpName("mm1"), x, w1);
+  Output bias1 = ops::BiasAdd(s.WithOpName("bias1"), mm1, b1);
+  Output relu1 = ops::Relu(s.WithOpName("relu1"), bias1);
+  Output mm2 = ops::MatMul(s.WithOpName("mm2"), relu1, w2);
+  Output out = ops::BiasAdd(s.WithOpName("out"), mm2, b2);
+
+  GrapplerItem item;
+  item.fetch = {"out"};
+  item.feed.emplace_back(
+      "x", MakeTensor({batch_size, input_size}, 1.0f, 0.5f));
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  return item;
+}
+
+class Int8QuantizationTest : public GrapplerTest {
+ protected:
+  // Records the ranges of the tensors of the perceptron on two batches of
+  // calibration data.
+  Int8QuantizationOptions Calibrate(const GrapplerItem& item) {
+    const std::vector<string> names = {"x",     "mm1", "bias1",
+                                       "relu1", "mm2", "out"};
+    const TensorShape& shape = item.feed[0].second.shape();
+    Int8QuantizationOptions opts;
+    for (float phase : {1.5f, 2.5f}) {
+      std::vector<Tensor> tensors =
+          EvaluateNodes(item.graph, names, {{"x", MakeTensor(shape, 1.0f,
+                                                             phase)}});
+      Int8Quantization::RecordCalibrationRanges(names, tensors, &opts);
+    }
+    return opts;
+  }
+
+  int CountOps(const GraphDef& graph, const string& op) {
+    int count = 0;
+    for (const NodeDef& node : graph.node()) {
+      count += node.op() == op;
+    }
+    return count;
+  }
+};
+
+TEST_F(Int8QuantizationTest, RecordsCalibrationRanges) {
+  Int8QuantizationOptions opts;
+  Int8Quantization::RecordCalibrationRanges(
+      {"a", "b:1"}, {test::AsTensor<float>({1, -2, 3}), test::AsScalar(1)},
+      &opts);
+  Int8Quantization::RecordCalibrationRanges(
+      {"a:0"}, {test::AsTensor<float>({-1, 5})}, &opts);
+  ASSERT_EQ(1, opts.ranges_size());
+  EXPECT_EQ(-2, opts.ranges().at("a").min());
+  EXPECT_EQ(5, opts.ranges().at("a").max());
+}
+
+TEST_F(Int8QuantizationTest, QuantizesMlp) {
+  GrapplerItem item = MakeMlp(8, 16, 32, 4);
+  Int8Quantization optimizer(RewriterConfig::ON, Calibrate(item));
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_EQ(5, optimizer.num_quantized_nodes());
+
+  EXPECT_EQ(2, CountOps(output, "QuantizedMatMul"));
+  EXPECT_EQ(2, CountOps(output, "QuantizedBiasAdd"));
+  EXPECT_EQ(0, CountOps(output, "MatMul"));
+  EXPECT_EQ(0, CountOps(output, "BiasAdd"));
+  EXPECT_EQ(0, CountOps(output, "Relu"));
+  // The input and the constants are quantized, but the hidden layer is passed
+  // between the layers as is.
+  EXPECT_EQ(5, CountOps(output, "QuantizeV2"));
+  EXPECT_EQ(1, CountOps(output, "Dequantize"));
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "out") {
+      EXPECT_EQ("Dequantize", node.op());
+      EXPECT_EQ("Int8Quantization/mm2/requantize_output", node.input(0));
+    } else if (node.name() == "Int8Quantization/mm2/matmul") {
+      EXPECT_EQ("Int8Quantization/mm1/requantize_output", node.input(0));
+    } else if (node.name() == "Int8Quantization/mm1/requantize_output/min") {
+      // The Relu clamps the output of the first layer.
+      Tensor min;
+      ASSERT_TRUE(min.FromProto(node.attr().at("value").tensor()));
+      EXPECT_EQ(0.0f, min.scalar<float>()());
+    }
+  }
+
+  // The error stays within a few steps of the 8-bit quantization.
+  auto expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  auto quantized = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(1, quantized.size());
+  auto flat = expected[0].flat<float>();
+  const float range =
+      *std::max_element(flat.data(), flat.data() + flat.size()) -
+      *std::min_element(flat.data(), flat.data() + flat.size());
+  test::ExpectTensorNear<float>(expected[0], quantized[0], 0.05f * range);
+}
+
+TEST_F(Int8QuantizationTest, KeepsNodesWithoutRanges) {
+  GrapplerItem item = MakeMlp(8, 16, 32, 4);
+  Int8QuantizationOptions opts = Calibrate(item);
+  // Without the range of the input, the first layer stays in float, and the
+  // second layer quantizes its output.
+  opts.mutable_ranges()->erase("x");
+  Int8Quantization optimizer(RewriterConfig::ON, opts);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_EQ(2, optimizer.num_quantized_nodes());
+  EXPECT_EQ(1, CountOps(output, "QuantizedMatMul"));
+  EXPECT_EQ(1, CountOps(output, "MatMul"));
+  EXPECT_EQ(1, CountOps(output, "Relu"));
+
+  Int8Quantization uncalibrated(RewriterConfig::ON, Int8QuantizationOptions());
+  TF_EXPECT_OK(uncalibrated.Optimize(nullptr, item, &output));
+  EXPECT_EQ(0, uncalibrated.num_quantized_nodes());
+  CompareGraphs(item.graph, output);
+}
+
+TEST_F(Int8QuantizationTest, RequantizesToRangesIncludingZero) {
+  GrapplerItem item = MakeMlp(8, 16, 32, 4);
+  Int8QuantizationOptions opts = Calibrate(item);
+  // Calibration only saw positive outputs.
+  Int8QuantizationOptions::Range& range = (*opts.mutable_ranges())["out"];
+  range.set_min(range.max() / 2);
+  Int8Quantization optimizer(RewriterConfig::ON, opts);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_EQ(2, CountOps(output, "QuantizedMatMul"));
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "Int8Quantization/mm2/requantize_output/min") {
+      Tensor min;
+      ASSERT_TRUE(min.FromProto(node.attr().at("value").tensor()));
+      EXPECT_EQ(0.0f, min.scalar<float>()());
+    }
+  }
+
+  // Requantize accepts the range.
+  auto quantized = EvaluateNodes(output, item.fetch, item.feed);
+  EXPECT_EQ(1, quantized.size());
+}
+
+TEST_F(Int8QuantizationTest, KeepsConv2DWithUnequalStrides) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT);
+  Output filter = ops::Const(
+      s.WithOpName("filter"),
+      Input::Initializer(MakeTensor({3, 3, 2, 4}, 0.1f, 0.0f)));
+  ops::Conv2D(s.WithOpName("conv"), x, filter, {1, 2, 1, 1}, "SAME");
+  GrapplerItem item;
+  item.fetch = {"conv"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  Int8QuantizationOptions opts;
+  for (const string& name : {"x", "conv"}) {
+    Int8QuantizationOptions::Range& range = (*opts.mutable_ranges())[name];
+    range.set_min(-1.0f);
+    range.set_max(1.0f);
+  }
+  Int8Quantization optimizer(RewriterConfig::ON, opts);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_EQ(0, optimizer.num_quantized_nodes());
+  EXPECT_EQ(0, CountOps(output, "QuantizedConv2D"));
+  EXPECT_EQ(1, CountOps(output, "Conv2D"));
+}
+
+static void BM_Mlp(int iters, int quantized) {
+  testing::StopTiming();
+  GrapplerItem item = MakeMlp(64, 512, 1024, 256);
+  GraphDef graph = item.graph;
+  if (quantized) {
+    Int8QuantizationOptions opts;
+    const std::vector<string> names = {"x",     "mm1", "bias1",
+                                       "relu1", "mm2", "out"};
+    std::unique_ptr<Session> session(NewSession(SessionOptions()));
+    TF_CHECK_OK(session->Create(item.graph));
+    std::vector<Tensor> tensors;
+    TF_CHECK_OK(session->Run(item.feed, names, {}, &tensors));
+    Int8Quantization::RecordCalibrationRanges(names, tensors, &opts);
+    Int8Quantization optimizer(RewriterConfig::ON, opts);
+    TF_CHECK_OK(optimizer.Optimize(nullptr, item, &graph));
+  }
+
+  SessionOptions options;
+  GraphOptions* graph_options = options.config.mutable_graph_options();
+  graph_options->mutable_optimizer_options()->set_opt_level(
+      OptimizerOptions::L0);
+  // Constant folding still quantizes the weights ahead of time.
+  graph_options->mutable_rewrite_options()->set_min_graph_nodes(-1);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_CHECK_OK(session->Create(graph));
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(session->Run(item.feed, item.fetch, {}, &outputs));
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(session->Run(item.feed, item.fetch, {}, &outputs));
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(session->Close());
+}
+BENCHMARK(BM_Mlp)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
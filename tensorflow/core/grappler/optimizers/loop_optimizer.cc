@@ -18,6 +18,8 @@ limitations under the License.
 #include <algorithm>
 #include <deque>
 #include <limits>
+#include <map>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -27,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/grappler/graph_view.h"
@@ -55,8 +58,11 @@ using TensorVector = gtl::InlinedVector<TensorValue, 4>;
 
 class LoopInvariantNodeMotionOptimizer {
  public:
-  explicit LoopInvariantNodeMotionOptimizer(GraphDef* optimized_graph)
-      : optimized_graph_(optimized_graph) {}
+  LoopInvariantNodeMotionOptimizer(
+      const std::unordered_set<string>& nodes_to_preserve,
+      GraphDef* optimized_graph)
+      : nodes_to_preserve_(nodes_to_preserve),
+        optimized_graph_(optimized_graph) {}
   virtual ~LoopInvariantNodeMotionOptimizer() = default;
   Status Optimize();
 
@@ -68,7 +74,9 @@ class LoopInvariantNodeMotionOptimizer {
                              const int frame_id);
   Status HandleConst(NodeDef* node, const int num_outputs, const int frame_id);
   Status HandleInvariantEnter(NodeDef* node, const int num_outputs);
+  bool CanMoveOutOfLoop(const NodeDef& node) const;
 
+  const std::unordered_set<string> nodes_to_preserve_;
   GraphDef* optimized_graph_;  // Not owned.
   std::unique_ptr<NodeMap> node_map_;
   std::map<NodeDef*, int> invariant_nodes_;
@@ -188,8 +196,9 @@ Status LoopInvariantNodeMotionOptimizer::HandleInvariantNode(
     NodeDef* node, const int num_outputs, const int frame_id) {
   // have to remove control inputs to the invariant node from the same frame
   // when moving this node out of this frame
-  for (int i = 0; i < node->input_size(); ++i) {
+  for (int i = node->input_size() - 1; i >= 0; --i) {
     if (IsControlInput(node->input(i))) {
+      node_map_->RemoveOutput(NodeName(node->input(i)), node->name());
       node->mutable_input()->SwapElements(i, node->input_size() - 1);
       node->mutable_input()->RemoveLast();
     }
@@ -328,6 +337,16 @@ Status LoopInvariantNodeMotionOptimizer::RevertInvariantNodes() {
   return Status::OK();
 }
 
+bool LoopInvariantNodeMotionOptimizer::CanMoveOutOfLoop(
+    const NodeDef& node) const {
+  // Nodes with side effects must run at every iteration, and control flow
+  // nodes define the structure of the loop.
+  return !ModifiesFrameInfo(node) && !IsSwitch(node) && !IsMerge(node) &&
+         node.op() != "LoopCond" && node.op() != "ControlTrigger" &&
+         IsFreeOfSideEffect(node) &&
+         nodes_to_preserve_.find(node.name()) == nodes_to_preserve_.end();
+}
+
 Status LoopInvariantNodeMotionOptimizer::FindInvariantNodes(
     NodeDef* start_node) {
   std::vector<NodeDef*> stack;
@@ -339,7 +358,7 @@ Status LoopInvariantNodeMotionOptimizer::FindInvariantNodes(
     auto consumers = node_map_->GetOutputs(node->name());
     invariant_nodes_.emplace(node, consumers.size());
     for (auto* consumer : consumers) {
-      if (invariant_nodes_.count(consumer) || ModifiesFrameInfo(*consumer)) {
+      if (invariant_nodes_.count(consumer) || !CanMoveOutOfLoop(*consumer)) {
         continue;
       }
       bool is_invariant = true;
@@ -500,6 +519,20 @@ std::vector<int> GetStackPushNodesToConvert(
   return nodes_to_convert;
 }
 
+// Converts a stack push into an Identity passing the data through, with a
+// control dependency on the op supplying the stack handle.
+void ConvertStackPushToIdentity(NodeDef* push_node, GraphDef* optimized_graph,
+                                NodeMap* node_map) {
+  if (push_node->attr().count("swap_memory") != 0) {
+    push_node->mutable_attr()->erase("swap_memory");
+  }
+  push_node->set_op("Identity");
+  push_node->mutable_input()->SwapElements(0, 1);
+  const string ctrl_dep = ConstantFolding::AddControlDependency(
+      push_node->input(1), optimized_graph, node_map);
+  push_node->set_input(1, ctrl_dep);
+}
+
 Status RemoveStackOps(const std::unordered_set<string>& nodes_to_preserve,
                       GraphDef* optimized_graph) {
   NodeMap node_map(optimized_graph);
@@ -515,14 +548,7 @@ Status RemoveStackOps(const std::unordered_set<string>& nodes_to_preserve,
         NodeDef* push_node = optimized_graph->mutable_node(push_node_idx);
         VLOG(1) << "Converting " << push_node_idx << " : "
                 << push_node->DebugString();
-        if (push_node->attr().count("swap_memory") != 0) {
-          push_node->mutable_attr()->erase("swap_memory");
-        }
-        push_node->set_op("Identity");
-        push_node->mutable_input()->SwapElements(0, 1);
-        const string ctrl_dep = ConstantFolding::AddControlDependency(
-            push_node->input(1), optimized_graph, &node_map);
-        push_node->set_input(1, ctrl_dep);
+        ConvertStackPushToIdentity(push_node, optimized_graph, &node_map);
         VLOG(1) << "After converting: " << push_node->DebugString();
       }
     }
@@ -530,6 +556,532 @@ Status RemoveStackOps(const std::unordered_set<string>& nodes_to_preserve,
   return Status::OK();
 }
 
+bool IsConstantEnter(const NodeDef& node) {
+  return IsEnter(node) && node.attr().count("is_constant") > 0 &&
+         node.attr().at("is_constant").b();
+}
+
+bool IsPreserved(const NodeDef& node,
+                 const std::unordered_set<string>& nodes_to_preserve) {
+  return nodes_to_preserve.find(node.name()) != nodes_to_preserve.end();
+}
+
+// Returns the only consumer of "node", or nullptr.
+NodeDef* GetSingleOutput(const NodeDef& node, const NodeMap& node_map) {
+  const std::set<NodeDef*>& outputs = node_map.GetOutputs(node.name());
+  return outputs.size() == 1 ? *outputs.begin() : nullptr;
+}
+
+// Returns the integer scalar held by "node", looking through the Enter nodes
+// that bring constants into loops.
+bool GetIntegerConstant(const NodeDef* node, const NodeMap& node_map,
+                        int64* value) {
+  while (node != nullptr && IsEnter(*node)) {
+    node = node_map.GetNode(node->input(0));
+  }
+  if (node == nullptr || !IsConstant(*node) ||
+      node->attr().count("value") == 0) {
+    return false;
+  }
+  Tensor tensor;
+  if (!tensor.FromProto(node->attr().at("value").tensor()) ||
+      tensor.NumElements() != 1) {
+    return false;
+  }
+  if (tensor.dtype() == DT_INT32) {
+    *value = tensor.flat<int32>()(0);
+    return true;
+  }
+  if (tensor.dtype() == DT_INT64) {
+    *value = tensor.flat<int64>()(0);
+    return true;
+  }
+  return false;
+}
+
+void EraseNodes(const std::unordered_set<const NodeDef*>& nodes_to_delete,
+                GraphDef* optimized_graph) {
+  std::vector<int> nodes_idx_to_delete;
+  nodes_idx_to_delete.reserve(nodes_to_delete.size());
+  for (int i = 0; i < optimized_graph->node_size(); ++i) {
+    if (nodes_to_delete.count(&optimized_graph->node(i))) {
+      nodes_idx_to_delete.push_back(i);
+    }
+  }
+  EraseNodesFromGraph(std::move(nodes_idx_to_delete), optimized_graph);
+}
+
+// Turns the loop variables that are passed unchanged to the next iteration
+// into loop invariants:
+//
+//   Enter -> Merge -> Switch:1 -> (Identity ->) NextIteration -> Merge
+//                     Switch:0 -> Exit
+//
+// The Enter becomes constant and feeds the consumers of the value in the
+// loop, and the Exit becomes an Identity of the input of the Enter. This
+// removes the per-iteration Merge/Switch/NextIteration overhead, the
+// Enter/Exit pair when the variable is not used in the loop, and lets the
+// loop invariant node motion hoist the computations only depending on it.
+Status RemoveInvariantLoopVariables(
+    const std::unordered_set<string>& nodes_to_preserve,
+    GraphDef* optimized_graph) {
+  NodeMap node_map(optimized_graph);
+  std::unordered_set<const NodeDef*> nodes_to_delete;
+  for (int i = 0; i < optimized_graph->node_size(); ++i) {
+    NodeDef* merge = optimized_graph->mutable_node(i);
+    if (!IsMerge(*merge) || merge->input_size() != 2 ||
+        IsPreserved(*merge, nodes_to_preserve)) {
+      continue;
+    }
+    NodeDef* enter = node_map.GetNode(merge->input(0));
+    NodeDef* next = node_map.GetNode(merge->input(1));
+    if (enter == nullptr || next == nullptr) continue;
+    if (IsNextIteration(*enter)) std::swap(enter, next);
+    if (!IsEnter(*enter) || IsConstantEnter(*enter) ||
+        !IsNextIteration(*next) || next->input_size() != 1 ||
+        GetSingleOutput(*enter, node_map) != merge ||
+        GetSingleOutput(*next, node_map) != merge ||
+        IsPreserved(*enter, nodes_to_preserve) ||
+        IsPreserved(*next, nodes_to_preserve)) {
+      continue;
+    }
+    NodeDef* switch_node = GetSingleOutput(*merge, node_map);
+    if (switch_node == nullptr || !IsSwitch(*switch_node) ||
+        switch_node->input_size() != 2 ||
+        switch_node->input(0) != merge->name() ||
+        IsPreserved(*switch_node, nodes_to_preserve)) {
+      continue;
+    }
+    const NodeDef* pred = node_map.GetNode(switch_node->input(1));
+    if (pred == nullptr || pred->op() != "LoopCond") continue;
+
+    // The value of the variable in an iteration is the true output of the
+    // Switch, possibly through an Identity, and is passed as is to the
+    // NextIteration.
+    const string switch_true = StrCat(switch_node->name(), ":1");
+    NodeDef* identity = node_map.GetNode(next->input(0));
+    if (identity != nullptr &&
+        (!IsIdentity(*identity) || identity->input_size() != 1 ||
+         identity->input(0) != switch_true)) {
+      identity = nullptr;
+    }
+    if ((identity == nullptr && next->input(0) != switch_true) ||
+        (identity != nullptr && IsPreserved(*identity, nodes_to_preserve))) {
+      continue;
+    }
+    const string value = identity != nullptr ? identity->name() : switch_true;
+
+    // The Switch must only feed the iteration and the Exit, and the consumers
+    // of the value in the loop must not use it as the pivot of the iteration.
+    NodeDef* exit = nullptr;
+    std::set<NodeDef*> consumers;
+    bool valid = true;
+    for (NodeDef* consumer : node_map.GetOutputs(switch_node->name())) {
+      for (const string& input : consumer->input()) {
+        int port;
+        if (ParseNodeName(input, &port) != switch_node->name()) continue;
+        if (input == switch_true) {
+          if (consumer == identity || consumer == next) continue;
+          valid &= identity == nullptr;
+          consumers.insert(consumer);
+        } else if (port == 0 && IsExit(*consumer) &&
+                   (exit == nullptr || exit == consumer)) {
+          exit = consumer;
+        } else {
+          valid = false;
+        }
+      }
+    }
+    // An Exit only fires once the loop is done, which its control outputs may
+    // depend on, whereas the Identity replacing it would not wait for the
+    // loop.
+    if (exit != nullptr) {
+      const string exit_control = AsControlDependency(exit->name());
+      for (const NodeDef* consumer : node_map.GetOutputs(exit->name())) {
+        for (const string& input : consumer->input()) {
+          valid &= input != exit_control;
+        }
+      }
+    }
+    if (identity != nullptr) {
+      for (NodeDef* consumer : node_map.GetOutputs(identity->name())) {
+        if (consumer == next) continue;
+        for (const string& input : consumer->input()) {
+          valid &= !IsControlInput(input) || NodeName(input) != value;
+        }
+        consumers.insert(consumer);
+      }
+    }
+    if (!valid) continue;
+
+    VLOG(1) << "Loop variable " << merge->name() << " is invariant";
+    if (exit != nullptr) {
+      std::vector<string> exit_inputs(enter->input().begin(),
+                                      enter->input().end());
+      for (const string& input : exit->input()) {
+        if (IsControlInput(input)) exit_inputs.push_back(input);
+      }
+      node_map.RemoveInputs(exit->name());
+      exit->set_op("Identity");
+      exit->clear_input();
+      for (const string& input : exit_inputs) {
+        exit->add_input(input);
+        node_map.AddOutput(NodeName(input), exit->name());
+      }
+    }
+    if (consumers.empty()) {
+      nodes_to_delete.insert(enter);
+    } else {
+      (*enter->mutable_attr())["is_constant"].set_b(true);
+      for (NodeDef* consumer : consumers) {
+        for (int j = 0; j < consumer->input_size(); ++j) {
+          if (consumer->input(j) == value) {
+            consumer->set_input(j, enter->name());
+          }
+        }
+        node_map.AddOutput(enter->name(), consumer->name());
+      }
+    }
+    nodes_to_delete.insert(merge);
+    nodes_to_delete.insert(switch_node);
+    if (identity != nullptr) nodes_to_delete.insert(identity);
+    nodes_to_delete.insert(next);
+  }
+  EraseNodes(nodes_to_delete, optimized_graph);
+  return Status::OK();
+}
+
+// Replaces the stacks saving the same loop invariant at every iteration of a
+// loop, typically to make it available to the corresponding gradient loop,
+// with the invariant: the pops become Identity nodes reading the invariant
+// through a constant Enter in the frame of the pop, and the pushes become
+// Identity nodes too.
+Status RemoveInvariantStacks(
+    const std::unordered_set<string>& nodes_to_preserve,
+    GraphDef* optimized_graph) {
+  NodeMap node_map(optimized_graph);
+  FrameMap frames;
+  int num_frames;
+  TF_RETURN_IF_ERROR(IdentifyFramesWithNodeMap(*optimized_graph, node_map,
+                                               &frames, &num_frames));
+  // The nodes added below are not stacks.
+  const int num_nodes = optimized_graph->node_size();
+  for (int i = 0; i < num_nodes; ++i) {
+    const NodeDef& stack = optimized_graph->node(i);
+    if (!IsStackOp(stack) || IsPreserved(stack, nodes_to_preserve)) continue;
+
+    // Find the pushes and pops of the stack, which reach the handle through
+    // Enter and Identity nodes.
+    std::vector<NodeDef*> pushes;
+    std::vector<NodeDef*> pops;
+    bool valid = true;
+    std::vector<const NodeDef*> queue = {&stack};
+    std::unordered_set<const NodeDef*> visited;
+    while (valid && !queue.empty()) {
+      const NodeDef* node = queue.back();
+      queue.pop_back();
+      if (!visited.insert(node).second) continue;
+      for (NodeDef* consumer : node_map.GetOutputs(node->name())) {
+        if (IsEnter(*consumer) || IsIdentity(*consumer)) {
+          queue.push_back(consumer);
+        } else if (IsStackPushOp(*consumer) &&
+                   NodeName(consumer->input(0)) == node->name()) {
+          pushes.push_back(consumer);
+        } else if (IsStackPopOp(*consumer) &&
+                   NodeName(consumer->input(0)) == node->name()) {
+          pops.push_back(consumer);
+        } else if (!IsStackCloseOp(*consumer)) {
+          valid = false;
+        }
+      }
+    }
+    if (!valid || pushes.empty() || pops.empty()) continue;
+
+    // All the pushes must save the same invariant, defined outside of any
+    // loop.
+    string invariant;
+    for (const NodeDef* push : pushes) {
+      const NodeDef* value = node_map.GetNode(push->input(1));
+      if (IsPreserved(*push, nodes_to_preserve) || value == nullptr ||
+          !IsConstantEnter(*value) ||
+          (!invariant.empty() && invariant != value->input(0))) {
+        valid = false;
+        break;
+      }
+      invariant = value->input(0);
+    }
+    const NodeDef* invariant_node = node_map.GetNode(invariant);
+    if (!valid || invariant_node == nullptr ||
+        !frames[invariant_node].empty()) {
+      continue;
+    }
+    // The pops must read the handle through a constant Enter into a loop at
+    // the top level, in which the invariant can be made available.
+    std::vector<const NodeDef*> pop_enters;
+    for (const NodeDef* pop : pops) {
+      const NodeDef* handle = node_map.GetNode(pop->input(0));
+      if (IsPreserved(*pop, nodes_to_preserve) || handle == nullptr ||
+          !IsConstantEnter(*handle) || frames[pop].size() != 1 ||
+          pop->attr().count("elem_type") == 0) {
+        valid = false;
+        break;
+      }
+      pop_enters.push_back(handle);
+    }
+    if (!valid) continue;
+
+    VLOG(1) << "Stack " << stack.name() << " only saves " << invariant;
+    for (int j = 0; j < pops.size(); ++j) {
+      NodeDef* pop = pops[j];
+      const NodeDef* handle = pop_enters[j];
+      const DataType type = pop->attr().at("elem_type").type();
+      NodeDef* enter = optimized_graph->add_node();
+      enter->set_name(
+          AddPrefixToNodeName(StrCat(pop->name(), "/Enter"), kLoopOptimizer));
+      enter->set_op("Enter");
+      enter->set_device(pop->device());
+      enter->add_input(invariant);
+      (*enter->mutable_attr())["T"].set_type(type);
+      (*enter->mutable_attr())["frame_name"] = handle->attr().at("frame_name");
+      (*enter->mutable_attr())["is_constant"].set_b(true);
+      if (handle->attr().count("parallel_iterations") > 0) {
+        (*enter->mutable_attr())["parallel_iterations"] =
+            handle->attr().at("parallel_iterations");
+      }
+      node_map.AddNode(enter->name(), enter);
+      node_map.AddOutput(NodeName(invariant), enter->name());
+
+      std::vector<string> control_inputs;
+      for (const string& input : pop->input()) {
+        if (IsControlInput(input)) control_inputs.push_back(input);
+      }
+      node_map.RemoveOutput(handle->name(), pop->name());
+      pop->set_op("Identity");
+      pop->clear_input();
+      pop->add_input(enter->name());
+      for (const string& input : control_inputs) {
+        pop->add_input(input);
+      }
+      pop->mutable_attr()->clear();
+      (*pop->mutable_attr())["T"].set_type(type);
+      node_map.AddOutput(enter->name(), pop->name());
+    }
+    for (NodeDef* push : pushes) {
+      ConvertStackPushToIdentity(push, optimized_graph, &node_map);
+    }
+  }
+  return Status::OK();
+}
+
+// A loop at the top level of the graph.
+struct CountedLoop {
+  string frame_name;
+  int64 parallel_iterations = 0;
+  NodeDef* loop_cond = nullptr;
+  std::vector<NodeDef*> enters;
+  std::unordered_set<const NodeDef*> nodes;
+  // Number of iterations of the loop, or -1 if unknown.
+  int64 trip_count = -1;
+  bool valid = true;
+};
+
+// Returns the number of iterations of a loop whose condition compares a
+// counter incremented by a constant to a constant:
+//
+//   LoopCond(Less(Merge(Enter(start),
+//                       NextIteration(Add(Identity(Switch:1), delta))),
+//                 limit))
+//
+// Returns -1 if the loop doesn't have this form, or if its number of
+// iterations can't be computed without overflowing.
+int64 GetTripCount(const NodeDef& loop_cond, const NodeMap& node_map) {
+  const NodeDef* less = node_map.GetNode(loop_cond.input(0));
+  if (less == nullptr || !IsLess(*less) || less->input_size() < 2) return -1;
+  int64 limit;
+  const NodeDef* merge = node_map.GetNode(less->input(0));
+  if (merge == nullptr || !IsMerge(*merge) || merge->input_size() != 2 ||
+      !GetIntegerConstant(node_map.GetNode(less->input(1)), node_map,
+                          &limit)) {
+    return -1;
+  }
+  const NodeDef* enter = node_map.GetNode(merge->input(0));
+  const NodeDef* next = node_map.GetNode(merge->input(1));
+  if (enter == nullptr || next == nullptr) return -1;
+  if (IsNextIteration(*enter)) std::swap(enter, next);
+  int64 start;
+  if (!IsEnter(*enter) || !IsNextIteration(*next) ||
+      !GetIntegerConstant(enter, node_map, &start)) {
+    return -1;
+  }
+  const NodeDef* add = node_map.GetNode(next->input(0));
+  if (add == nullptr || !IsAdd(*add) || add->input_size() < 2) return -1;
+  for (int i = 0; i < 2; ++i) {
+    const NodeDef* identity = node_map.GetNode(add->input(i));
+    if (identity == nullptr || !IsIdentity(*identity)) continue;
+    const NodeDef* switch_node = node_map.GetNode(identity->input(0));
+    int64 delta;
+    if (switch_node != nullptr && IsSwitch(*switch_node) &&
+        NodeName(switch_node->input(0)) == merge->name() &&
+        GetIntegerConstant(node_map.GetNode(add->input(1 - i)), node_map,
+                           &delta) &&
+        delta > 0) {
+      if (limit <= start) return 0;
+      if (start < 0 && limit > std::numeric_limits<int64>::max() + start) {
+        return -1;
+      }
+      const int64 range = limit - start;
+      if (range > std::numeric_limits<int64>::max() - (delta - 1)) return -1;
+      return (range + delta - 1) / delta;
+    }
+  }
+  return -1;
+}
+
+// Returns true if the inputs of "loop" depend on any node of "other".
+bool LoopDependsOn(const CountedLoop& loop, const CountedLoop& other,
+                   const NodeMap& node_map) {
+  std::vector<const NodeDef*> queue;
+  std::unordered_set<const NodeDef*> visited;
+  for (const NodeDef* enter : loop.enters) {
+    for (const string& input : enter->input()) {
+      queue.push_back(node_map.GetNode(input));
+    }
+  }
+  while (!queue.empty()) {
+    const NodeDef* node = queue.back();
+    queue.pop_back();
+    if (node == nullptr || !visited.insert(node).second) continue;
+    if (other.nodes.count(node)) return true;
+    for (const string& input : node->input()) {
+      queue.push_back(node_map.GetNode(input));
+    }
+  }
+  return false;
+}
+
+// Moves the nodes of "loop" into the frame of "into", and switches its
+// variables on the condition of "into". The condition of "loop" is removed.
+void FuseLoop(const std::unordered_set<string>& nodes_to_preserve,
+              CountedLoop* loop, CountedLoop* into, NodeMap* node_map,
+              std::unordered_set<const NodeDef*>* nodes_to_delete) {
+  VLOG(1) << "Fusing loop " << loop->frame_name << " into "
+          << into->frame_name;
+  for (NodeDef* enter : loop->enters) {
+    (*enter->mutable_attr())["frame_name"].set_s(into->frame_name);
+  }
+  const string& cond = loop->loop_cond->name();
+  const string& into_cond = into->loop_cond->name();
+  const std::set<NodeDef*> switches = node_map->GetOutputs(cond);
+  for (NodeDef* switch_node : switches) {
+    switch_node->set_input(1, into_cond);
+    node_map->RemoveOutput(cond, switch_node->name());
+    node_map->AddOutput(into_cond, switch_node->name());
+  }
+
+  // Remove the condition, and the nodes only computing it.
+  std::vector<NodeDef*> dead = {loop->loop_cond};
+  while (!dead.empty()) {
+    NodeDef* node = dead.back();
+    dead.pop_back();
+    if (!nodes_to_delete->insert(node).second) continue;
+    for (const string& input : node->input()) {
+      node_map->RemoveOutput(NodeName(input), node->name());
+      NodeDef* producer = node_map->GetNode(input);
+      if (producer != nullptr && loop->nodes.count(producer) &&
+          node_map->GetOutputs(producer->name()).empty() &&
+          !ModifiesFrameInfo(*producer) && !IsMerge(*producer) &&
+          !IsSwitch(*producer) && IsFreeOfSideEffect(*producer) &&
+          !IsPreserved(*producer, nodes_to_preserve)) {
+        dead.push_back(producer);
+      }
+    }
+  }
+  into->nodes.insert(loop->nodes.begin(), loop->nodes.end());
+  into->enters.insert(into->enters.end(), loop->enters.begin(),
+                      loop->enters.end());
+}
+
+// Fuses the loops at the top level of the graph that run the same constant
+// number of iterations with the same parallelism, and don't depend on each
+// other: the fused loop runs one frame instead of two, and the iterations of
+// both loops run in parallel.
+Status FuseLoops(const std::unordered_set<string>& nodes_to_preserve,
+                 GraphDef* optimized_graph) {
+  NodeMap node_map(optimized_graph);
+  FrameMap frames;
+  int num_frames;
+  TF_RETURN_IF_ERROR(IdentifyFramesWithNodeMap(*optimized_graph, node_map,
+                                               &frames, &num_frames));
+  if (num_frames < 2) {
+    return Status::OK();
+  }
+  std::map<int, CountedLoop> loops;
+  for (const auto& it : frames) {
+    const std::vector<int>& frame_ids = it.second;
+    if (frame_ids.empty()) continue;
+    CountedLoop& loop = loops[frame_ids[0]];
+    NodeDef* node = const_cast<NodeDef*>(it.first);
+    loop.nodes.insert(node);
+    if (frame_ids.size() > 1) {
+      // Loops containing other loops are left alone.
+      loop.valid = false;
+    } else if (IsEnter(*node)) {
+      loop.enters.push_back(node);
+    } else if (node->op() == "LoopCond") {
+      loop.valid &= loop.loop_cond == nullptr;
+      loop.loop_cond = node;
+    }
+  }
+
+  std::vector<CountedLoop*> candidates;
+  for (auto& it : loops) {
+    CountedLoop& loop = it.second;
+    if (!loop.valid || loop.loop_cond == nullptr || loop.enters.empty() ||
+        IsPreserved(*loop.loop_cond, nodes_to_preserve)) {
+      continue;
+    }
+    const NodeDef& first_enter = *loop.enters[0];
+    if (first_enter.attr().count("parallel_iterations") == 0) continue;
+    loop.frame_name = first_enter.attr().at("frame_name").s();
+    loop.parallel_iterations =
+        first_enter.attr().at("parallel_iterations").i();
+    for (const NodeDef* enter : loop.enters) {
+      loop.valid &= enter->attr().at("frame_name").s() == loop.frame_name &&
+                    enter->attr().count("parallel_iterations") > 0 &&
+                    enter->attr().at("parallel_iterations").i() ==
+                        loop.parallel_iterations;
+    }
+    for (const NodeDef* output : node_map.GetOutputs(loop.loop_cond->name())) {
+      loop.valid &= IsSwitch(*output) && output->input_size() == 2 &&
+                    output->input(1) == loop.loop_cond->name();
+    }
+    loop.trip_count = GetTripCount(*loop.loop_cond, node_map);
+    if (loop.valid && loop.trip_count >= 0) {
+      candidates.push_back(&loop);
+    }
+  }
+
+  std::unordered_set<const NodeDef*> nodes_to_delete;
+  std::vector<bool> fused(candidates.size(), false);
+  for (int i = 0; i < candidates.size(); ++i) {
+    if (fused[i]) continue;
+    CountedLoop* into = candidates[i];
+    for (int j = i + 1; j < candidates.size(); ++j) {
+      CountedLoop* loop = candidates[j];
+      if (fused[j] || loop->trip_count != into->trip_count ||
+          loop->parallel_iterations != into->parallel_iterations ||
+          LoopDependsOn(*loop, *into, node_map) ||
+          LoopDependsOn(*into, *loop, node_map)) {
+        continue;
+      }
+      FuseLoop(nodes_to_preserve, loop, into, &node_map, &nodes_to_delete);
+      fused[j] = true;
+    }
+  }
+  EraseNodes(nodes_to_delete, optimized_graph);
+  return Status::OK();
+}
+
 bool IsSimpleBinaryOperator(const NodeDef& node) {
   return (IsLess(node) || IsLessEqual(node) || IsGreater(node) ||
           IsGreaterEqual(node) || IsEqual(node));
@@ -674,27 +1226,40 @@ LoopOptimizer::LoopOptimizer(RewriterConfig::Toggle opt_level,
                              DeviceBase* cpu_device)
     : opt_level_(opt_level),
       cpu_device_(cpu_device),
-      options_(LoopOptimizerOptions::Default(RewriterConfig::ON)) {
+      options_(LoopOptimizerOptions::Default(opt_level)) {
   resource_mgr_.reset(new ResourceMgr());
 }
 
 Status LoopOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                GraphDef* optimized_graph) {
   *optimized_graph = item.graph;
+  const std::unordered_set<string> nodes_to_preserve = item.NodesToPreserve();
+  if (options_.enable_invariant_loop_variable_removal) {
+    TF_RETURN_IF_ERROR(
+        RemoveInvariantLoopVariables(nodes_to_preserve, optimized_graph));
+  }
   // Set up helper data structures.
   if (options_.enable_loop_invariant_node_motion) {
-    LoopInvariantNodeMotionOptimizer linm_optimizer(optimized_graph);
+    LoopInvariantNodeMotionOptimizer linm_optimizer(nodes_to_preserve,
+                                                    optimized_graph);
     TF_RETURN_IF_ERROR(linm_optimizer.Optimize());
   }
+  if (options_.enable_invariant_stack_removal) {
+    TF_RETURN_IF_ERROR(
+        RemoveInvariantStacks(nodes_to_preserve, optimized_graph));
+  }
   if (options_.enable_stack_push_removal) {
-    TF_RETURN_IF_ERROR(RemoveStackOps(item.NodesToPreserve(), optimized_graph));
+    TF_RETURN_IF_ERROR(RemoveStackOps(nodes_to_preserve, optimized_graph));
+  }
+  if (options_.enable_loop_fusion) {
+    TF_RETURN_IF_ERROR(FuseLoops(nodes_to_preserve, optimized_graph));
   }
   if (options_.enable_dead_branch_removal) {
     // TODO(srjoglekar): Figure out if we can optimize NodeMap creations across
     // optimizer passes.
     NodeMap node_map(optimized_graph);
     TF_RETURN_IF_ERROR(
-        RemoveDeadBranches(item.NodesToPreserve(), node_map, optimized_graph));
+        RemoveDeadBranches(nodes_to_preserve, node_map, optimized_graph));
   }
 
   return Status::OK();
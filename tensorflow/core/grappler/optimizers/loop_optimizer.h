@@ -53,9 +53,25 @@ class LoopOptimizer : public GraphOptimizer {
     bool enable_loop_invariant_node_motion = false;
     bool enable_stack_push_removal = true;
     bool enable_dead_branch_removal = true;
+    // Turns loop variables that are passed unchanged from one iteration to the
+    // next into loop invariants, and removes their Enter/Exit pairs.
+    bool enable_invariant_loop_variable_removal = false;
+    // Replaces the stacks that save the same loop invariant value at every
+    // iteration of a loop, to pop it in another (e.g. gradient) loop, with the
+    // invariant itself.
+    bool enable_invariant_stack_removal = false;
+    // Fuses independent loops that run the same constant number of
+    // iterations.
+    bool enable_loop_fusion = false;
 
     static LoopOptimizerOptions Default(RewriterConfig::Toggle opt_level) {
       LoopOptimizerOptions options;
+      if (opt_level == RewriterConfig::AGGRESSIVE) {
+        options.enable_loop_invariant_node_motion = true;
+        options.enable_invariant_loop_variable_removal = true;
+        options.enable_invariant_stack_removal = true;
+        options.enable_loop_fusion = true;
+      }
       return options;
     }
   };
@@ -14,7 +14,11 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
+
+#include <limits>
+
 #include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/cc/ops/while_loop.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/grappler/grappler_item.h"
@@ -23,6 +27,8 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -62,6 +68,9 @@ class LoopOptimizerTest : public GrapplerTest {
     LoopOptimizer::LoopOptimizerOptions options;
     options.enable_loop_invariant_node_motion = false;
     options.enable_stack_push_removal = false;
+    options.enable_invariant_loop_variable_removal = false;
+    options.enable_invariant_stack_removal = false;
+    options.enable_loop_fusion = false;
     optimizer->options_ = options;
   }
 
@@ -74,8 +83,115 @@ class LoopOptimizerTest : public GrapplerTest {
     DisableAllStages(optimizer);
     optimizer->options_.enable_stack_push_removal = true;
   }
+
+  void EnableOnlyInvariantLoopVariableRemoval(LoopOptimizer* optimizer) {
+    DisableAllStages(optimizer);
+    optimizer->options_.enable_invariant_loop_variable_removal = true;
+  }
+
+  void EnableOnlyInvariantStackRemoval(LoopOptimizer* optimizer) {
+    DisableAllStages(optimizer);
+    optimizer->options_.enable_invariant_stack_removal = true;
+  }
+
+  void EnableOnlyLoopFusion(LoopOptimizer* optimizer) {
+    DisableAllStages(optimizer);
+    optimizer->options_.enable_loop_fusion = true;
+  }
+
+  void AddIntConstNode(const string& name, int64 value, DataType dtype,
+                       GraphDef* graph) const {
+    std::vector<std::pair<string, AttrValue>> attributes;
+    AttrValue type;
+    type.set_type(dtype);
+    attributes.emplace_back("dtype", type);
+    AttrValue tensor;
+    if (dtype == DT_INT64) {
+      test::AsScalar<int64>(value).AsProtoTensorContent(
+          tensor.mutable_tensor());
+    } else {
+      test::AsScalar<int32>(value).AsProtoTensorContent(
+          tensor.mutable_tensor());
+    }
+    attributes.emplace_back("value", tensor);
+    AddNode(name, "Const", {}, attributes, graph);
+  }
+
+  // Adds the loop "<prefix>/while" counting from 0 to "limit" by 1. The loop
+  // runs after "control_input" if not empty.
+  void AddCountingLoop(const string& prefix, int limit,
+                       const string& control_input, GraphDef* graph) const {
+    AddCountingLoop(prefix, 0, limit, DT_INT32, control_input, graph);
+  }
+
+  // Adds the loop "<prefix>/while" counting from "start" to "limit" by 1
+  // with a counter of type "dtype".
+  void AddCountingLoop(const string& prefix, int64 start, int64 limit,
+                       DataType dtype, const string& control_input,
+                       GraphDef* graph) const {
+    const string frame = prefix + "/while";
+    AddIntConstNode(prefix + "/start", start, dtype, graph);
+    AddIntConstNode(prefix + "/limit", limit, dtype, graph);
+    AddIntConstNode(prefix + "/delta", 1, dtype, graph);
+    std::vector<string> enter_inputs = {prefix + "/start"};
+    if (!control_input.empty()) {
+      enter_inputs.push_back(AsControlDependency(control_input));
+    }
+    AddEnterNode(prefix + "/Enter", frame, false, 10, enter_inputs, graph);
+    AddEnterNode(prefix + "/LimitEnter", frame, true, 10,
+                 {prefix + "/limit"}, graph);
+    AddEnterNode(prefix + "/DeltaEnter", frame, true, 10,
+                 {prefix + "/delta"}, graph);
+    AddSimpleNode(prefix + "/Merge", "Merge",
+                  {prefix + "/Enter", prefix + "/NextIteration"}, graph);
+    AddSimpleNode(prefix + "/Less", "Less",
+                  {prefix + "/Merge", prefix + "/LimitEnter"}, graph);
+    AddSimpleNode(prefix + "/LoopCond", "LoopCond", {prefix + "/Less"},
+                  graph);
+    AddSimpleNode(prefix + "/Switch", "Switch",
+                  {prefix + "/Merge", prefix + "/LoopCond"}, graph);
+    AddSimpleNode(prefix + "/Identity", "Identity", {prefix + "/Switch:1"},
+                  graph);
+    AddSimpleNode(prefix + "/Add", "Add",
+                  {prefix + "/Identity", prefix + "/DeltaEnter"}, graph);
+    AddSimpleNode(prefix + "/NextIteration", "NextIteration",
+                  {prefix + "/Add"}, graph);
+    AddSimpleNode(prefix + "/Exit", "Exit", {prefix + "/Switch"}, graph);
+  }
 };
 
+// Builds a loop updating the state of a recurrent network with the
+// loop-carried weights "w": h = tanh(matmul(h, square(w))).
+GraphDef BuildRnnLikeLoop(int num_steps, int batch_size, int num_units) {
+  Scope scope = Scope::NewRootScope();
+  Output i = ops::Const(scope.WithOpName("i"), 0);
+  Output h = ops::Const(scope.WithOpName("h"), 0.5f, {batch_size, num_units});
+  Output w = ops::Const(scope.WithOpName("w"), 0.01f, {num_units, num_units});
+  ops::CondGraphBuilderFn cond = [num_steps](const Scope& s,
+                                             const std::vector<Output>& inputs,
+                                             Output* output) {
+    *output = ops::Less(s, inputs[0], num_steps);
+    return s.status();
+  };
+  ops::BodyGraphBuilderFn body = [](const Scope& s,
+                                    const std::vector<Output>& inputs,
+                                    std::vector<Output>* outputs) {
+    Output weights = ops::Square(s, inputs[2]);
+    outputs->push_back(ops::Add(s, inputs[0], 1));
+    outputs->push_back(ops::Tanh(s, ops::MatMul(s, inputs[1], weights)));
+    outputs->push_back(inputs[2]);
+    return s.status();
+  };
+  ops::OutputList outputs;
+  TF_CHECK_OK(ops::BuildWhileLoop(scope.NewSubScope("rnn"), {i, h, w}, cond,
+                                  body, "rnn", &outputs));
+  ops::Identity(scope.WithOpName("state"), outputs[1]);
+  ops::Identity(scope.WithOpName("weights"), outputs[2]);
+  GraphDef graph;
+  TF_CHECK_OK(scope.ToGraphDef(&graph));
+  return graph;
+}
+
 TEST_F(LoopOptimizerTest, Basic) {
   GraphDef graph;
   AddSimpleNode("In", "Identity", {}, &graph);
@@ -952,5 +1068,305 @@ versions {
   EXPECT_EQ(8, nodes_present);
 }
 
+TEST_F(LoopOptimizerTest, StatefulNodesStayInLoop) {
+  GraphDef graph;
+  AddSimpleNode("In", "Identity", {}, &graph);
+  AddEnterNode("InvariantEnter", "while/while_context", true, 1, {"In"},
+               &graph);
+  AddSimpleNode("InvariantAdd", "Add", {"InvariantEnter", "InvariantEnter"},
+                &graph);
+  AddSimpleNode("Random", "RandomUniform", {"InvariantAdd"}, &graph);
+  AddSimpleNode("VariantAdd", "Add", {"Random", "Identity"}, &graph);
+  AddEnterNode("VariantEnter", "while/while_context", false, 1, {"In"}, &graph);
+  AddSimpleNode("Merge", "Merge", {"VariantEnter", "NextIteration"}, &graph);
+  AddSimpleNode("Less/y", "Const", {"^Identity"}, &graph);
+  AddSimpleNode("Less", "Less", {"VariantAdd", "Less/y"}, &graph);
+  AddSimpleNode("LoopCond", "LoopCond", {"Less"}, &graph);
+  AddSimpleNode("Switch", "Switch", {"Merge", "LoopCond"}, &graph);
+  AddSimpleNode("Identity", "Identity", {"Switch:1"}, &graph);
+  AddSimpleNode("NextIteration", "NextIteration", {"VariantAdd"}, &graph);
+  AddSimpleNode("Exit", "Exit", {"Switch"}, &graph);
+  AddSimpleNode("Out", "Identity", {"Exit"}, &graph);
+
+  GrapplerItem item;
+  item.graph = graph;
+
+  LoopOptimizer optimizer;
+  EnableOnlyLoopInvariantNodeMotion(&optimizer);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The random values must be drawn at every iteration.
+  NodeMap node_map(&output);
+  std::unordered_map<const NodeDef*, std::vector<int>> frames;
+  int num_frames;
+  TF_EXPECT_OK(IdentifyFrames(output, &frames, &num_frames));
+  EXPECT_EQ(0, frames.at(node_map.GetNode("InvariantAdd")).size());
+  EXPECT_EQ(1, frames.at(node_map.GetNode("Random")).size());
+}
+
+TEST_F(LoopOptimizerTest, RemoveInvariantLoopVariables) {
+  GrapplerItem item;
+  GraphDef& graph = item.graph;
+  AddSimpleNode("In", "Identity", {}, &graph);
+  AddSimpleNode("In2", "Identity", {}, &graph);
+  AddEnterNode("VariantEnter", "while/while_context", false, 1, {"In"}, &graph);
+  AddSimpleNode("Merge", "Merge", {"VariantEnter", "NextIteration"}, &graph);
+  AddSimpleNode("Less/y", "Const", {"^Identity"}, &graph);
+  AddSimpleNode("Less", "Less", {"Merge", "Less/y"}, &graph);
+  AddSimpleNode("LoopCond", "LoopCond", {"Less"}, &graph);
+  AddSimpleNode("Switch", "Switch", {"Merge", "LoopCond"}, &graph);
+  AddSimpleNode("Identity", "Identity", {"Switch:1"}, &graph);
+  AddSimpleNode("VariantAdd", "Add", {"Identity", "PassIdentity"}, &graph);
+  AddSimpleNode("NextIteration", "NextIteration", {"VariantAdd"}, &graph);
+  AddSimpleNode("Exit", "Exit", {"Switch"}, &graph);
+  // A loop variable passed unchanged to the next iteration.
+  AddEnterNode("PassEnter", "while/while_context", false, 1, {"In2"}, &graph);
+  AddSimpleNode("PassMerge", "Merge", {"PassEnter", "PassNextIteration"},
+                &graph);
+  AddSimpleNode("PassSwitch", "Switch", {"PassMerge", "LoopCond"}, &graph);
+  AddSimpleNode("PassIdentity", "Identity", {"PassSwitch:1"}, &graph);
+  AddSimpleNode("PassNextIteration", "NextIteration", {"PassIdentity"},
+                &graph);
+  AddSimpleNode("PassExit", "Exit", {"PassSwitch"}, &graph);
+  AddSimpleNode("Out", "Identity", {"PassExit"}, &graph);
+  item.fetch = {"Exit", "Out"};
+
+  LoopOptimizer optimizer;
+  EnableOnlyInvariantLoopVariableRemoval(&optimizer);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(graph.node_size() - 4, output.node_size());
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("PassMerge", node.name());
+    EXPECT_NE("PassSwitch", node.name());
+    EXPECT_NE("PassIdentity", node.name());
+    EXPECT_NE("PassNextIteration", node.name());
+    if (node.name() == "PassEnter") {
+      EXPECT_TRUE(node.attr().at("is_constant").b());
+    } else if (node.name() == "VariantAdd") {
+      EXPECT_EQ("Identity", node.input(0));
+      EXPECT_EQ("PassEnter", node.input(1));
+    } else if (node.name() == "PassExit") {
+      EXPECT_EQ("Identity", node.op());
+      ASSERT_EQ(1, node.input_size());
+      EXPECT_EQ("In2", node.input(0));
+    } else if (node.name() == "Merge") {
+      EXPECT_EQ("NextIteration", node.input(1));
+    }
+  }
+}
+
+TEST_F(LoopOptimizerTest, KeepsInvariantLoopVariablesOrderingTheLoopExit) {
+  GrapplerItem item;
+  GraphDef& graph = item.graph;
+  AddSimpleNode("In", "Identity", {}, &graph);
+  AddSimpleNode("In2", "Identity", {}, &graph);
+  AddEnterNode("VariantEnter", "while/while_context", false, 1, {"In"}, &graph);
+  AddSimpleNode("Merge", "Merge", {"VariantEnter", "NextIteration"}, &graph);
+  AddSimpleNode("Less/y", "Const", {"^Identity"}, &graph);
+  AddSimpleNode("Less", "Less", {"Merge", "Less/y"}, &graph);
+  AddSimpleNode("LoopCond", "LoopCond", {"Less"}, &graph);
+  AddSimpleNode("Switch", "Switch", {"Merge", "LoopCond"}, &graph);
+  AddSimpleNode("Identity", "Identity", {"Switch:1"}, &graph);
+  AddSimpleNode("VariantAdd", "Add", {"Identity", "PassIdentity"}, &graph);
+  AddSimpleNode("NextIteration", "NextIteration", {"VariantAdd"}, &graph);
+  AddSimpleNode("Exit", "Exit", {"Switch"}, &graph);
+  AddEnterNode("PassEnter", "while/while_context", false, 1, {"In2"}, &graph);
+  AddSimpleNode("PassMerge", "Merge", {"PassEnter", "PassNextIteration"},
+                &graph);
+  AddSimpleNode("PassSwitch", "Switch", {"PassMerge", "LoopCond"}, &graph);
+  AddSimpleNode("PassIdentity", "Identity", {"PassSwitch:1"}, &graph);
+  AddSimpleNode("PassNextIteration", "NextIteration", {"PassIdentity"},
+                &graph);
+  AddSimpleNode("PassExit", "Exit", {"PassSwitch"}, &graph);
+  // Must only run once the loop is done.
+  AddSimpleNode("AfterLoop", "Identity", {"In", "^PassExit"}, &graph);
+  item.fetch = {"Exit", "AfterLoop"};
+
+  LoopOptimizer optimizer;
+  EnableOnlyInvariantLoopVariableRemoval(&optimizer);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(graph.node_size(), output.node_size());
+  NodeMap node_map(&output);
+  EXPECT_NE(nullptr, node_map.GetNode("PassMerge"));
+  EXPECT_EQ("Exit", node_map.GetNode("PassExit")->op());
+  EXPECT_EQ("PassSwitch", node_map.GetNode("PassExit")->input(0));
+  EXPECT_FALSE(node_map.GetNode("PassEnter")->attr().at("is_constant").b());
+}
+
+TEST_F(LoopOptimizerTest, RemoveInvariantStacks) {
+  GrapplerItem item;
+  GraphDef& graph = item.graph;
+  AddSimpleNode("W", "Identity", {}, &graph);
+  AddSimpleNode("stack", "StackV2", {}, &graph);
+  // The forward loop saves W at every iteration.
+  AddEnterNode("fwd/StackEnter", "fwd", true, 1, {"stack"}, &graph);
+  AddEnterNode("fwd/WEnter", "fwd", true, 1, {"W"}, &graph);
+  AddSimpleNode("fwd/push", "StackPushV2", {"fwd/StackEnter", "fwd/WEnter"},
+                &graph);
+  // The backward loop pops it at every iteration.
+  AddEnterNode("bwd/StackEnter", "bwd", true, 1, {"stack"}, &graph);
+  AttrValue elem_type;
+  elem_type.set_type(DT_FLOAT);
+  AddNode("bwd/pop", "StackPopV2", {"bwd/StackEnter"},
+          {{"elem_type", elem_type}}, &graph);
+  AddSimpleNode("bwd/Square", "Square", {"bwd/pop"}, &graph);
+
+  LoopOptimizer optimizer;
+  EnableOnlyInvariantStackRemoval(&optimizer);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_EQ(graph.node_size() + 1, output.node_size());
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "fwd/push") {
+      EXPECT_EQ("Identity", node.op());
+      ASSERT_EQ(2, node.input_size());
+      EXPECT_EQ("fwd/WEnter", node.input(0));
+      EXPECT_EQ("^fwd/StackEnter", node.input(1));
+    } else if (node.name() == "bwd/pop") {
+      EXPECT_EQ("Identity", node.op());
+      ASSERT_EQ(1, node.input_size());
+      EXPECT_EQ("LoopOptimizer/bwd/pop/Enter", node.input(0));
+      EXPECT_EQ(DT_FLOAT, node.attr().at("T").type());
+    } else if (node.name() == "LoopOptimizer/bwd/pop/Enter") {
+      EXPECT_EQ("Enter", node.op());
+      ASSERT_EQ(1, node.input_size());
+      EXPECT_EQ("W", node.input(0));
+      EXPECT_EQ("bwd", node.attr().at("frame_name").s());
+      EXPECT_TRUE(node.attr().at("is_constant").b());
+    }
+  }
+}
+
+TEST_F(LoopOptimizerTest, FuseLoops) {
+  GrapplerItem item;
+  GraphDef& graph = item.graph;
+  AddCountingLoop("a", 10, "", &graph);
+  AddCountingLoop("b", 10, "", &graph);
+  // Runs another number of iterations.
+  AddCountingLoop("c", 20, "", &graph);
+  // Depends on the first loop.
+  AddCountingLoop("d", 10, "a/Exit", &graph);
+  item.fetch = {"a/Exit", "b/Exit", "c/Exit", "d/Exit"};
+
+  LoopOptimizer optimizer;
+  EnableOnlyLoopFusion(&optimizer);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  NodeMap node_map(&output);
+  // The condition of the second loop is gone, along with the comparison
+  // computing it.
+  EXPECT_EQ(nullptr, node_map.GetNode("b/LoopCond"));
+  EXPECT_EQ(nullptr, node_map.GetNode("b/Less"));
+  EXPECT_EQ(graph.node_size() - 2, output.node_size());
+  for (const string& enter : {"b/Enter", "b/LimitEnter", "b/DeltaEnter"}) {
+    EXPECT_EQ("a/while",
+              node_map.GetNode(enter)->attr().at("frame_name").s());
+  }
+  EXPECT_EQ("a/LoopCond", node_map.GetNode("b/Switch")->input(1));
+  EXPECT_EQ("c/LoopCond", node_map.GetNode("c/Switch")->input(1));
+  EXPECT_EQ("d/LoopCond", node_map.GetNode("d/Switch")->input(1));
+  EXPECT_EQ("d/while",
+            node_map.GetNode("d/Enter")->attr().at("frame_name").s());
+
+  std::unordered_map<const NodeDef*, std::vector<int>> frames;
+  int num_frames;
+  TF_EXPECT_OK(IdentifyFrames(output, &frames, &num_frames));
+  EXPECT_EQ(3, num_frames);
+}
+
+TEST_F(LoopOptimizerTest, DoesNotFuseLoopsWithOverflowingTripCounts) {
+  GrapplerItem item;
+  GraphDef& graph = item.graph;
+  // The number of iterations of these loops doesn't fit in an int64.
+  const int64 min = std::numeric_limits<int64>::min();
+  const int64 max = std::numeric_limits<int64>::max();
+  AddCountingLoop("a", min, max, DT_INT64, "", &graph);
+  AddCountingLoop("b", min, max, DT_INT64, "", &graph);
+  AddCountingLoop("c", -1, max, DT_INT64, "", &graph);
+  AddCountingLoop("d", -1, max, DT_INT64, "", &graph);
+  item.fetch = {"a/Exit", "b/Exit", "c/Exit", "d/Exit"};
+
+  LoopOptimizer optimizer;
+  EnableOnlyLoopFusion(&optimizer);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  std::unordered_map<const NodeDef*, std::vector<int>> frames;
+  int num_frames;
+  TF_EXPECT_OK(IdentifyFrames(output, &frames, &num_frames));
+  EXPECT_EQ(4, num_frames);
+  EXPECT_EQ(graph.node_size(), output.node_size());
+}
+
+TEST_F(LoopOptimizerTest, AggressiveOptimizationOfRnnLikeLoop) {
+  GrapplerItem item;
+  item.graph = BuildRnnLikeLoop(5, 2, 3);
+  item.fetch = {"state", "weights"};
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+
+  LoopOptimizer optimizer(RewriterConfig::AGGRESSIVE, nullptr);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The weights are no longer a loop variable, and are squared once before
+  // the loop.
+  NodeMap node_map(&output);
+  std::unordered_map<const NodeDef*, std::vector<int>> frames;
+  int num_frames;
+  TF_EXPECT_OK(IdentifyFrames(output, &frames, &num_frames));
+  int num_merges = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.op() == "Merge") {
+      ++num_merges;
+    } else if (node.op() == "Square") {
+      EXPECT_TRUE(frames.at(&node).empty());
+    }
+  }
+  EXPECT_EQ(2, num_merges);
+
+  auto tensors = EvaluateNodes(output, item.fetch);
+  ASSERT_EQ(2, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+  test::ExpectTensorEqual<float>(tensors_expected[1], tensors[1]);
+}
+
+static void BM_RnnLikeLoop(int iters, int aggressive) {
+  testing::StopTiming();
+  GrapplerItem item;
+  item.graph = BuildRnnLikeLoop(100, 32, 256);
+  item.fetch = {"state", "weights"};
+  GraphDef graph = item.graph;
+  if (aggressive) {
+    LoopOptimizer optimizer(RewriterConfig::AGGRESSIVE, nullptr);
+    TF_CHECK_OK(optimizer.Optimize(nullptr, item, &graph));
+  }
+
+  // Runs the graph as is.
+  SessionOptions options;
+  GraphOptions* graph_options = options.config.mutable_graph_options();
+  graph_options->mutable_optimizer_options()->set_opt_level(
+      OptimizerOptions::L0);
+  graph_options->mutable_rewrite_options()->set_disable_meta_optimizer(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_CHECK_OK(session->Create(graph));
+  std::vector<Tensor> outputs;
+  TF_CHECK_OK(session->Run({}, item.fetch, {}, &outputs));
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    TF_CHECK_OK(session->Run({}, item.fetch, {}, &outputs));
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(session->Close());
+}
+BENCHMARK(BM_RnnLikeLoop)->Arg(0)->Arg(1);
+
 }  // namespace grappler
 }  // namespace tensorflow
@@ -38,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/topological_sort.h"
 #include "tensorflow/core/grappler/utils/traversal.h"
 #include "tensorflow/core/lib/math/math_util.h"
+#include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 
 namespace tensorflow {
@@ -414,6 +415,17 @@ void RecomputeSubgraph(
   }
 }
 
+// Returns true for nodes whose inputs we may want to recompute. This matches
+// node names that contain recomputation_targets_name_scope as a name scope,
+// meaning it either begins with or contains the name scope. Defaults to
+// "gradients/" which will match any node names that begins with "gradients/"
+// or contains "/gradients/".
+bool IsRecomputationTarget(const string& recomputation_targets_name_scope,
+                           const NodeDef& node) {
+  return node.name().find(recomputation_targets_name_scope) == 0 ||
+         node.name().find("/" + recomputation_targets_name_scope) != -1;
+}
+
 void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                                 const string& recomputation_targets_name_scope,
                                 GraphDef* graph, const GrapplerItem& item) {
@@ -441,13 +453,7 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
   std::function<bool(const NodeDef&)> is_target =
       [&recomputation_targets_name_scope](const NodeDef& node) {
-        // Nodes whose inputs we may want to recompute. This matches node names
-        // that contain recomputation_targets_name_scope as a name scope,
-        // meaning it either begins with or contains the name scope.
-        // Defaults to "gradients/" which will match any node names that begins
-        // with "gradients/" or contains "/gradients/".
-        return node.name().find(recomputation_targets_name_scope) == 0 ||
-               node.name().find("/" + recomputation_targets_name_scope) != -1;
+        return IsRecomputationTarget(recomputation_targets_name_scope, node);
       };
 
   if (optimization_level == RewriterConfig::RECOMPUTATION_HEURISTICS ||
@@ -490,6 +496,206 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
 }
 
+// A forward activation live at the peak memory usage of a device, which its
+// consumers in the backward pass could recompute instead.
+struct RecomputationCandidate {
+  const NodeDef* node;
+  int64 memory_used;
+  // Memory freed per nanosecond of recomputation.
+  double fitness;
+
+  // Sorts the fittest candidates first, breaking ties by name so that the
+  // rewritten graph is deterministic.
+  bool operator<(const RecomputationCandidate& other) const {
+    return fitness > other.fitness ||
+           (fitness == other.fitness && node->name() < other.node->name());
+  }
+};
+
+// Recomputes in the backward pass the forward activations live at the peak
+// memory usage of each device which exceeds "memory_budget", in the spirit of
+// rematerialization: the activations freeing the most memory per unit of
+// recomputation time are picked first, until the peak fits in the budget.
+// Only activations computed from tensors also live at the peak, or persistent
+// ones, are recomputed, so that their recomputation doesn't keep other
+// tensors alive, and only once their forward consumers have completed at the
+// peak, since they are otherwise still needed there. Returns true if the
+// graph was updated.
+bool BudgetedRecomputationPass(const string& recomputation_targets_name_scope,
+                               int64 memory_budget, Cluster* cluster,
+                               GrapplerItem* item) {
+  const std::unordered_map<string, DeviceProperties>& devices =
+      cluster->GetDevices();
+  GraphMemory memory(*item);
+  Status s = memory.InferStatically(devices);
+  if (!s.ok()) {
+    VLOG(1) << "Failed to infer memory usage: " << s.error_message();
+    return false;
+  }
+  bool over_budget = false;
+  for (const auto& device : devices) {
+    over_budget |=
+        memory.GetPeakMemoryUsage(device.first).used_memory > memory_budget;
+  }
+  if (!over_budget) {
+    return false;
+  }
+
+  // The cost of recomputing a node is its execution time.
+  std::unordered_map<string, double> op_time_ns;
+  std::unordered_map<string, Costs::NanoSeconds> op_completion_times;
+  {
+    VirtualCluster vcluster(devices);
+    if (!vcluster.Provision().ok() || !vcluster.Initialize(*item).ok()) {
+      return false;
+    }
+    RunMetadata metadata;
+    s = vcluster.Run(item->graph, item->feed, item->fetch, &metadata);
+    if (!s.ok() && s.code() != error::RESOURCE_EXHAUSTED) {
+      return false;
+    }
+    for (const auto& dev_stats : metadata.step_stats().dev_stats()) {
+      for (const auto& node_stats : dev_stats.node_stats()) {
+        op_time_ns[node_stats.node_name()] =
+            1e3 * (node_stats.op_end_rel_micros() -
+                   node_stats.op_start_rel_micros());
+        op_completion_times[node_stats.node_name()] =
+            Costs::NanoSeconds(1) +
+            Costs::MicroSeconds(node_stats.all_start_micros() +
+                                node_stats.op_end_rel_micros());
+      }
+    }
+  }
+
+  // Do not recompute nodes which are fed, since the recomputed node would not
+  // take on the fed value.
+  std::unordered_set<string> feeds;
+  for (const auto& feed : item->feed) {
+    feeds.insert(NodeName(feed.first));
+  }
+  // Invalidates NodeDef pointers, so must be done before collecting them.
+  if (!TopologicalSort(&item->graph).ok()) {
+    return false;
+  }
+  NodeMap node_map(&item->graph);
+  auto is_target = [&recomputation_targets_name_scope](const NodeDef& node) {
+    return IsRecomputationTarget(recomputation_targets_name_scope, node);
+  };
+
+  // Only used for membership tests: the nodes are recomputed in graph order.
+  std::unordered_set<const NodeDef*> to_recompute;
+  std::vector<string> device_names;
+  for (const auto& device : devices) {
+    device_names.push_back(device.first);
+  }
+  std::sort(device_names.begin(), device_names.end());
+  for (const string& device_name : device_names) {
+    const GraphMemory::MemoryUsage& mem_usage =
+        memory.GetPeakMemoryUsage(device_name);
+    if (mem_usage.used_memory <= memory_budget) {
+      continue;
+    }
+    int64 required_savings = mem_usage.used_memory - memory_budget;
+    VLOG(1) << "Peak memory usage of " << device_name << " exceeds the "
+            << "budget by " << required_savings << " bytes";
+
+    std::unordered_set<string> live_at_peak;
+    Costs::Duration peak_time = -1;
+    for (const auto& live_tensor : mem_usage.live_tensors) {
+      live_at_peak.insert(
+          strings::StrCat(live_tensor.node, ":", live_tensor.output_id));
+      peak_time = std::max(peak_time, live_tensor.allocation_time);
+    }
+    std::vector<RecomputationCandidate> candidates;
+    for (const auto& live_tensor : mem_usage.live_tensors) {
+      const NodeDef* node = node_map.GetNode(live_tensor.node);
+      if (node == nullptr || live_tensor.memory_used <= 1024 ||
+          to_recompute.count(node) > 0 || is_target(*node) ||
+          feeds.count(node->name()) > 0 || IsPersistent(*node) ||
+          ModifiesFrameInfo(*node) || IsMerge(*node) || IsSwitch(*node) ||
+          !IsFreeOfSideEffect(*node) ||
+          // Already recomputed.
+          str_util::StartsWith(node->name(), kRecomputedNodePrefix) ||
+          node_map.GetNode(AddPrefixToNodeName(
+              node->name(), kRecomputedNodePrefix)) != nullptr) {
+        continue;
+      }
+      bool has_target_output = false;
+      bool forward_outputs_done = true;
+      for (const NodeDef* output : node_map.GetOutputs(node->name())) {
+        if (is_target(*output)) {
+          has_target_output = true;
+          continue;
+        }
+        auto it = op_completion_times.find(output->name());
+        forward_outputs_done &=
+            it != op_completion_times.end() && it->second <= peak_time;
+      }
+      bool inputs_available = true;
+      for (const string& input : node->input()) {
+        if (IsControlInput(input)) {
+          continue;
+        }
+        const NodeDef* input_node = node_map.GetNode(input);
+        int port;
+        ParseNodeName(input, &port);
+        inputs_available &=
+            input_node != nullptr &&
+            (IsPersistent(*input_node) ||
+             live_at_peak.count(strings::StrCat(input_node->name(), ":",
+                                                port)) > 0);
+      }
+      if (!has_target_output || !forward_outputs_done || !inputs_available) {
+        continue;
+      }
+      RecomputationCandidate candidate;
+      candidate.node = node;
+      candidate.memory_used = live_tensor.memory_used;
+      auto it = op_time_ns.find(node->name());
+      const double cost_ns = 1 + (it == op_time_ns.end() ? 0 : it->second);
+      candidate.fitness = candidate.memory_used / cost_ns;
+      candidates.push_back(candidate);
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    for (const RecomputationCandidate& candidate : candidates) {
+      if (required_savings <= 0) {
+        break;
+      }
+      if (to_recompute.insert(candidate.node).second) {
+        required_savings -= candidate.memory_used;
+      }
+    }
+  }
+  if (to_recompute.empty()) {
+    return false;
+  }
+
+  std::unordered_map<const NodeDef*, int> topological_numbering;
+  std::vector<const NodeDef*> to_recompute_in_order;
+  for (int node_number = 0; node_number < item->graph.node_size();
+       ++node_number) {
+    const NodeDef* node = item->graph.mutable_node(node_number);
+    topological_numbering[node] = item->graph.node_size() - node_number - 1;
+    if (to_recompute.count(node) > 0) {
+      to_recompute_in_order.push_back(node);
+    }
+  }
+  for (const NodeDef* node : to_recompute_in_order) {
+    std::unordered_set<NodeDef*> target_nodes;
+    for (NodeDef* output : node_map.GetOutputs(node->name())) {
+      if (is_target(*output)) {
+        target_nodes.insert(output);
+      }
+    }
+    VLOG(1) << "Recomputing " << node->name() << " for "
+            << target_nodes.size() << " backward nodes";
+    RecomputeSubgraph({node}, target_nodes, node_map, topological_numbering,
+                      &item->graph);
+  }
+  return true;
+}
+
 bool SchedulingPass(Cluster* cluster, GrapplerItem* item) {
   // Look for AddN nodes (and equivalent) and record input names.
   GraphView view(&item->graph);
@@ -1348,9 +1554,15 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                  GraphDef* optimized_graph) {
   *optimized_graph = item.graph;
 
-  RecomputationRewritingPass(optimization_level_,
-                             recomputation_targets_name_scope_, optimized_graph,
-                             item);
+  // With a memory budget, the activations to recompute are picked by
+  // BudgetedRecomputationPass rather than from a list of cheap ops.
+  const bool budgeted_recomputation =
+      memory_budget_bytes_ > 0 &&
+      (optimization_level_ == RewriterConfig::RECOMPUTATION_HEURISTICS ||
+       optimization_level_ == RewriterConfig::HEURISTICS);
+  RecomputationRewritingPass(
+      budgeted_recomputation ? RewriterConfig::MANUAL : optimization_level_,
+      recomputation_targets_name_scope_, optimized_graph, item);
 
   GrapplerItem optimized_item(item, optimized_graph);
   std::unordered_set<string> skip_list;
@@ -1366,6 +1578,12 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       updated_graph |= SchedulingPass(cluster, &optimized_item);
     }
 
+    if (budgeted_recomputation && cluster != nullptr) {
+      updated_graph |= BudgetedRecomputationPass(
+          recomputation_targets_name_scope_, memory_budget_bytes_, cluster,
+          &optimized_item);
+    }
+
     if ((optimization_level_ == RewriterConfig::DEFAULT_MEM_OPT ||
          optimization_level_ == RewriterConfig::SWAPPING_HEURISTICS ||
          optimization_level_ == RewriterConfig::HEURISTICS ||
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils.h"
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/str_util.h"
 
 namespace tensorflow {
 namespace grappler {
@@ -440,6 +441,114 @@ TEST_F(MemoryOptimizerTest, AccumulationRewrites) {
   }
 }
 
+TEST_F(MemoryOptimizerTest, BudgetedRecomputation) {
+  // A forward pass on the CPU whose activations are all live when the
+  // backward pass starts.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice("/cpu:0");
+  Output v = ops::Variable(s.WithOpName("v"), {128, 128, 8}, DT_FLOAT);
+  Output a = ops::Sqrt(s.WithOpName("a"), v);
+  Output b = ops::Square(s.WithOpName("b"), a);
+  Output c = ops::Tanh(s.WithOpName("c"), b);
+  Output d = ops::Exp(s.WithOpName("d"), c);
+  Output g1 = ops::Mul(s.WithOpName("gradients/g1"), d, c);
+  Output g2 = ops::Mul(s.WithOpName("gradients/g2"), g1, b);
+  Output g3 = ops::Mul(s.WithOpName("gradients/g3"), g2, a);
+
+  Output constant = ops::Const(s.WithOpName("constant"), 2.0f, {128, 128, 8});
+  Output init = ops::Assign(s.WithOpName("init"), v, constant);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/g3"};
+  item.init_ops = {init.name()};
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  auto count_recomputed = [](const GraphDef& graph) {
+    int recomputed = 0;
+    for (const NodeDef& node : graph.node()) {
+      if (str_util::StartsWith(node.name(), "Recomputed/")) {
+        ++recomputed;
+      }
+    }
+    return recomputed;
+  };
+
+  // Fits in the budget: nothing to recompute, and the cheap op heuristics
+  // are disabled.
+  MemoryOptimizer roomy(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                        "gradients/", 1LL << 30);
+  GraphDef output;
+  TF_EXPECT_OK(roomy.Optimize(cluster.get(), item, &output));
+  EXPECT_EQ(0, count_recomputed(output));
+
+  const int64 activation_size = 128 * 128 * 8 * sizeof(float);
+  MemoryOptimizer tight(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                        "gradients/", 3 * activation_size);
+  TF_EXPECT_OK(tight.Optimize(cluster.get(), item, &output));
+  EXPECT_LT(0, count_recomputed(output));
+  NodeMap node_map(&output);
+  for (const NodeDef& node : output.node()) {
+    if (!str_util::StartsWith(node.name(), "Recomputed/")) {
+      continue;
+    }
+    // Only consumed by the backward pass.
+    for (const NodeDef* consumer : node_map.GetOutputs(node.name())) {
+      EXPECT_TRUE(str_util::StartsWith(consumer->name(), "gradients/") ||
+                  str_util::StartsWith(consumer->name(), "Recomputed/"))
+          << consumer->name();
+    }
+  }
+
+  // The rewritten graph, including the order of its nodes, is deterministic.
+  for (int i = 0; i < 3; ++i) {
+    MemoryOptimizer other_tight(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                                "gradients/", 3 * activation_size);
+    GraphDef other_output;
+    TF_EXPECT_OK(other_tight.Optimize(cluster.get(), item, &other_output));
+    ASSERT_EQ(output.node_size(), other_output.node_size());
+    for (int j = 0; j < output.node_size(); ++j) {
+      EXPECT_EQ(output.node(j).DebugString(),
+                other_output.node(j).DebugString());
+    }
+  }
+
+  auto tensors_expected = EvaluateFetchNodes(item);
+  GrapplerItem optimized(item, std::move(output));
+  auto tensors = EvaluateFetchNodes(optimized);
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(MemoryOptimizerTest, BudgetedRecomputationSkipsTensorsUsedAtPeak) {
+  // "a" is consumed by the backward pass, but also by "tiled", which runs last
+  // and makes the peak memory usage: "a" is still needed at the peak, so
+  // recomputing it would not lower it.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice("/cpu:0");
+  Output v = ops::Variable(s.WithOpName("v"), {128, 128, 8}, DT_FLOAT);
+  Output a = ops::Sqrt(s.WithOpName("a"), v);
+  Output g = ops::Square(s.WithOpName("gradients/g"), a);
+  Output tiled = ops::Tile(s.WithOpName("tiled").WithControlDependencies(g),
+                           a, {4, 1, 1});
+
+  Output constant = ops::Const(s.WithOpName("constant"), 2.0f, {128, 128, 8});
+  Output init = ops::Assign(s.WithOpName("init"), v, constant);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/g", "tiled"};
+  item.init_ops = {init.name()};
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  const int64 activation_size = 128 * 128 * 8 * sizeof(float);
+  MemoryOptimizer tight(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                        "gradients/", activation_size);
+  GraphDef output;
+  TF_EXPECT_OK(tight.Optimize(cluster.get(), item, &output));
+  for (const NodeDef& node : output.node()) {
+    EXPECT_FALSE(str_util::StartsWith(node.name(), "Recomputed/"))
+        << node.name();
+  }
+}
+
 class RelaxAllocatorConstraintsTest : public GrapplerTest {};
 
 TEST_F(RelaxAllocatorConstraintsTest, SameDevice) {
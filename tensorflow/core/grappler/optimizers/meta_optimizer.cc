@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
+
+#include <algorithm>
+
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/versions.pb.h"
@@ -25,11 +28,14 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/dependency_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/experimental_implementation_selector.h"
 #include "tensorflow/core/grappler/optimizers/function_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/int8_quantization.h"
 #include "tensorflow/core/grappler/optimizers/layout_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
+#include "tensorflow/core/grappler/optimizers/op_sharding.h"
 #include "tensorflow/core/grappler/optimizers/pin_to_host_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/ps_load_balancer.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 #include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/shape_optimizer.h"
@@ -37,7 +43,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/functions.h"
 #include "tensorflow/core/grappler/utils/topological_sort.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/util/ptr_util.h"
 
 namespace tensorflow {
@@ -69,10 +77,17 @@ int NumIterations(const RewriterConfig& cfg) {
              : cfg.meta_optimizer_iterations();
 }
 
+int NumFunctionOptimizationThreads(const RewriterConfig& cfg) {
+  return cfg.function_optimization_threads() < 0
+             ? port::NumSchedulableCPUs()
+             : std::max(cfg.function_optimization_threads(), 1);
+}
+
 // Check if optimizer is allowed to run only once.
 bool IsRunOnceOptimizer(const string& name) {
   return name == "layout" || name == "memory_optimizer" ||
-         name == "loop_optimizer";
+         name == "loop_optimizer" || name == "ps_load_balancer" ||
+         name == "op_sharding" || name == "int8_quantization";
 }
 
 // Check if the graphdef contains nodes that indicate TPU execution.
@@ -108,6 +123,11 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
          new ScopedAllocatorOptimizer(cfg_.scoped_allocator_optimization(),
                                       cfg_.scoped_allocator_opts()));
   MK_OPT("small_op", new PinToHostOptimizer(cfg_.pin_to_host_optimization()));
+  MK_OPT("ps_load_balancer", new PsLoadBalancer(cfg_.ps_load_balancing()));
+  MK_OPT("op_sharding", new OpSharding(cfg_.op_sharding()));
+  MK_OPT("int8_quantization",
+         new Int8Quantization(cfg_.int8_quantization(),
+                              cfg_.int8_quantization_opts()));
 
   return std::unique_ptr<GraphOptimizer>();
 }
@@ -119,6 +139,12 @@ Status MetaOptimizer::InitializeOptimizers(
   if (cfg_.disable_meta_optimizer()) {
     return Status::OK();
   }
+  // Runs first, while the tensors still have the names their calibration
+  // ranges were recorded under.
+  if (cfg_.int8_quantization() == RewriterConfig::ON) {
+    optimizers->push_back(MakeUnique<Int8Quantization>(
+        cfg_.int8_quantization(), cfg_.int8_quantization_opts()));
+  }
   if (!cfg_.disable_model_pruning()) {
     optimizers->push_back(MakeUnique<ModelPruner>());
   }
@@ -158,20 +184,26 @@ Status MetaOptimizer::InitializeOptimizers(
     optimizers->push_back(MakeUnique<LayoutOptimizer>());
   }
   if (cfg_.memory_optimization() != RewriterConfig::NO_MEM_OPT) {
-    if (cfg_.memory_optimizer_target_node_name_scope().empty()) {
-      optimizers->push_back(
-          // Use the default target node name prefix "gradients/"
-          MakeUnique<MemoryOptimizer>(cfg_.memory_optimization()));
-    } else {
-      optimizers->push_back(MakeUnique<MemoryOptimizer>(
-          cfg_.memory_optimization(),
-          cfg_.memory_optimizer_target_node_name_scope()));
-    }
+    // Use the default target node name prefix "gradients/" unless
+    // overridden.
+    const string target_node_name_scope =
+        cfg_.memory_optimizer_target_node_name_scope().empty()
+            ? "gradients/"
+            : cfg_.memory_optimizer_target_node_name_scope();
+    optimizers->push_back(MakeUnique<MemoryOptimizer>(
+        cfg_.memory_optimization(), target_node_name_scope,
+        cfg_.memory_optimizer_budget_bytes()));
   }
   if (cfg_.auto_parallel().enable()) {
     optimizers->push_back(
         MakeUnique<AutoParallel>(cfg_.auto_parallel().num_replicas()));
   }
+  if (cfg_.ps_load_balancing() == RewriterConfig::ON) {
+    optimizers->push_back(MakeUnique<PsLoadBalancer>());
+  }
+  if (cfg_.op_sharding() == RewriterConfig::ON) {
+    optimizers->push_back(MakeUnique<OpSharding>(cfg_.op_sharding()));
+  }
   if (cfg_.scoped_allocator_optimization()) {
     optimizers->push_back(MakeUnique<ScopedAllocatorOptimizer>(
         cfg_.scoped_allocator_optimization(), cfg_.scoped_allocator_opts()));
@@ -346,7 +378,10 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
   }
 
   // Record graph optimization result.
-  optimization_results_.push_back(optimization_result);
+  {
+    mutex_lock l(mu_);
+    optimization_results_.push_back(optimization_result);
+  }
 
   if (is_optimized) {
     TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
@@ -370,6 +405,10 @@ Status MetaOptimizer::RunOptimizer(
   Status status =
       optimizer->Optimize(cluster, *optimized_item, optimized_graph);
   uint64 end_us = Env::Default()->NowMicros();
+  {
+    mutex_lock l(mu_);
+    optimizer_time_us_[optimizer->name()] += end_us - start_us;
+  }
 
   string result;
   if (!status.ok()) {
@@ -391,11 +430,17 @@ Status MetaOptimizer::RunOptimizer(
 Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                GraphDef* optimized_graph) {
   VLOG(1) << "Starting optimization for grappler item: " << item.id;
-  optimization_results_.clear();
+  {
+    mutex_lock l(mu_);
+    optimization_results_.clear();
+    optimizer_time_us_.clear();
+  }
 
   // 1. Optimize main graph
+  uint64 start_us = Env::Default()->NowMicros();
   TF_RETURN_IF_ERROR(OptimizeGraph(cluster, item, optimized_graph));
-  VLOG(1) << "Optimized main graph.";
+  VLOG(1) << "Optimized main graph in "
+          << (Env::Default()->NowMicros() - start_us) / 1000.0f << "ms.";
 
   // Skip optimizing functions if this is a TPU graph. Currently, Grappler
   // passes do not handle TPU functions correctly in a variety of ways (Note
@@ -425,11 +470,14 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
 
   // Optimize each function only once.
   std::unordered_set<string> optimized_funcs;
-  bool optimize_function_library = true;
-
-  while (optimize_function_library) {
-    optimize_function_library = false;
-
+  const int num_threads = NumFunctionOptimizationThreads(cfg_);
+  start_us = Env::Default()->NowMicros();
+
+  // Function optimization might specialize nested function calls, so we have
+  // to do at least one more pass over the library after optimizing some
+  // functions.
+  while (true) {
+    std::vector<const FunctionDef*> funcs;
     for (const FunctionDef& func : optimized_graph->library().function()) {
       const string& func_name = func.signature().name();
 
@@ -442,34 +490,73 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
       // the function optimizer, before we can optimize function body.
       if (IsParametrized(func)) continue;
 
-      VLOG(3) << "Optimize function: function=" << func_name;
-
-      // Function optimization might specialize nested function calls, so we
-      // have to reset the flag and do at least one more pass over the library.
-      optimize_function_library = true;
       optimized_funcs.insert(func_name);
+      funcs.push_back(&func);
+    }
+    if (funcs.empty()) break;
 
-      // Make a GrapplerItem from a FunctionDef.
-      GrapplerFunctionItem func_item;
-      TF_RETURN_IF_ERROR(MakeGrapplerFunctionItem(
-          func, flib, item.graph.versions().producer(), &func_item));
-
-      // If we need to compute the gradient of optimized function at runtime, we
-      // can't perform non-differentiable rewrites.
-      if (differentiable_functions.find(func_name) !=
-          differentiable_functions.end()) {
-        func_item.allowed_optimizations.non_differentiable_rewrites = false;
+    // The functions of a pass are optimized in parallel, in the context of the
+    // library as it was at the beginning of the pass.
+    std::unordered_set<string> flib_names;
+    for (const FunctionDef& func : optimized_graph->library().function()) {
+      flib_names.insert(func.signature().name());
+    }
+    const int graph_def_version = item.graph.versions().producer();
+    const int num_funcs = funcs.size();
+    std::vector<Status> statuses(num_funcs);
+    std::vector<GrapplerFunctionItem> func_items(num_funcs);
+    std::vector<GraphDef> optimized_func_graphs(num_funcs);
+    // If we need to compute the gradient of optimized function at runtime, we
+    // can't perform non-differentiable rewrites.
+    auto is_differentiable = [&differentiable_functions, &funcs](int i) {
+      return differentiable_functions.find(funcs[i]->signature().name()) !=
+             differentiable_functions.end();
+    };
+    auto optimize_function = [&](int i) {
+      VLOG(3) << "Optimize function: function="
+              << funcs[i]->signature().name();
+      statuses[i] = OptimizeFunction(cluster, *funcs[i], flib,
+                                     graph_def_version, is_differentiable(i),
+                                     &func_items[i], &optimized_func_graphs[i]);
+    };
+    if (num_threads > 1 && num_funcs > 1) {
+      thread::ThreadPool pool(Env::Default(), "optimize_functions",
+                              std::min(num_threads, num_funcs));
+      for (int i = 0; i < num_funcs; ++i) {
+        pool.Schedule([&optimize_function, i]() { optimize_function(i); });
       }
+    } else {
+      for (int i = 0; i < num_funcs; ++i) optimize_function(i);
+    }
 
-      // Optimize function body graph.
-      GraphDef optimized_func_graph;
-      TF_RETURN_IF_ERROR(
-          OptimizeGraph(cluster, func_item, &optimized_func_graph));
+    // Update the library in the order of the functions, so that the result
+    // doesn't depend on the scheduling of the optimizations.
+    for (int i = 0; i < num_funcs; ++i) {
+      TF_RETURN_IF_ERROR(statuses[i]);
+      const string& func_name = funcs[i]->signature().name();
+
+      // A function optimized concurrently might have created a specialized
+      // function of the same name: optimize the function again, in the
+      // context of the updated library, as if the functions had been
+      // optimized one at a time.
+      for (const FunctionDef& func_def :
+           optimized_func_graphs[i].library().function()) {
+        const string& name = func_def.signature().name();
+        if (flib_names.find(name) == flib_names.end() &&
+            flib.Find(name) != nullptr) {
+          VLOG(2) << "Optimize function again: function=" << func_name;
+          TF_RETURN_IF_ERROR(OptimizeFunction(
+              cluster, *funcs[i], flib, graph_def_version,
+              is_differentiable(i), &func_items[i],
+              &optimized_func_graphs[i]));
+          break;
+        }
+      }
 
       // Function body optimization might have created new specialized
       // functions for each instantiation context. Add them to the library.
       for (const FunctionDef& func_def :
-           optimized_func_graph.library().function()) {
+           optimized_func_graphs[i].library().function()) {
         if (flib.Find(func_def.signature().name()) == nullptr) {
           TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
         }
@@ -477,32 +564,61 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
 
       // Convert optimized graph back to FunctionDef.
       FunctionDef optimized_func;
-      func_item.SwapFunctionBody(std::move(optimized_func_graph));
-      TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
+      func_items[i].SwapFunctionBody(std::move(optimized_func_graphs[i]));
+      TF_RETURN_IF_ERROR(MakeFunctionDef(func_items[i], flib, &optimized_func));
 
       // Replace optimized function with a new FunctionDef.
       TF_RETURN_IF_ERROR(flib.ReplaceFunction(func_name, optimized_func));
     }
 
-    // If optimized at least one function, update the graph library.
-    if (optimize_function_library) {
-      *optimized_graph->mutable_library() = flib.ToProto();
-    }
+    // Optimized at least one function, update the graph library.
+    *optimized_graph->mutable_library() = flib.ToProto();
   }
 
-  VLOG(1) << "Optimized " << optimized_funcs.size()
-          << " functions: " << str_util::Join(optimized_funcs, ", ");
+  VLOG(1) << "Optimized " << optimized_funcs.size() << " functions in "
+          << (Env::Default()->NowMicros() - start_us) / 1000.0f
+          << "ms: " << str_util::Join(optimized_funcs, ", ");
 
   return Status::OK();
 }
 
+Status MetaOptimizer::OptimizeFunction(Cluster* cluster,
+                                       const FunctionDef& func,
+                                       const FunctionLibraryDefinition& flib,
+                                       int graph_def_version,
+                                       bool is_differentiable,
+                                       GrapplerFunctionItem* func_item,
+                                       GraphDef* optimized_func_graph) {
+  // Make a GrapplerItem from a FunctionDef.
+  TF_RETURN_IF_ERROR(
+      MakeGrapplerFunctionItem(func, flib, graph_def_version, func_item));
+  if (is_differentiable) {
+    func_item->allowed_optimizations.non_differentiable_rewrites = false;
+  }
+
+  // Optimize function body graph.
+  optimized_func_graph->Clear();
+  return OptimizeGraph(cluster, *func_item, optimized_func_graph);
+}
+
 void MetaOptimizer::PrintResult() {
+  mutex_lock l(mu_);
   for (const GraphOptimizationResult& graph_result : optimization_results_) {
     LOG(INFO) << "Optimization results for grappler item: " << graph_result.id;
     for (const OptimizerResult& result : graph_result.results) {
       LOG(INFO) << "  " << result.optimizer_name << ": " << result.result;
     }
   }
+  LOG(INFO) << "Total time per optimizer:";
+  for (const auto& optimizer_time : optimizer_time_us_) {
+    LOG(INFO) << "  " << optimizer_time.first << ": "
+              << optimizer_time.second / 1000.0f << "ms";
+  }
+}
+
+std::map<string, uint64> MetaOptimizer::optimizer_time_us() const {
+  mutex_lock l(mu_);
+  return optimizer_time_us_;
 }
 
 void MetaOptimizer::Feedback(Cluster* cluster, const GrapplerItem& item,
@@ -528,6 +644,9 @@ bool MetaOptimizerEnabled(const RewriterConfig& cfg) {
          cfg.debug_stripper() == RewriterConfig::ON ||
          cfg.scoped_allocator_optimization() == RewriterConfig::ON ||
          cfg.pin_to_host_optimization() == RewriterConfig::ON ||
+         cfg.ps_load_balancing() == RewriterConfig::ON ||
+         cfg.op_sharding() == RewriterConfig::ON ||
+         cfg.int8_quantization() == RewriterConfig::ON ||
          !cfg.optimizers().empty() || !cfg.custom_optimizers().empty();
 }
 
@@ -16,10 +16,16 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_H_
 #define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_H_
 
+#include <map>
+
 #include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/grappler/utils/functions.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 
 namespace tensorflow {
@@ -39,6 +45,11 @@ class MetaOptimizer : public GraphOptimizer {
 
   void PrintResult();
 
+  // The wall time spent in each optimizer during the last call to Optimize(),
+  // in microseconds, summed over the main graph and the functions of its
+  // library (which may be optimized in parallel).
+  std::map<string, uint64> optimizer_time_us() const;
+
   void Feedback(Cluster* cluster, const GrapplerItem& item,
                 const GraphDef& optimized_graph, double result) override;
 
@@ -65,6 +76,14 @@ class MetaOptimizer : public GraphOptimizer {
   Status OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
                        GraphDef* optimized_graph);
 
+  // Optimizes the body of the function "func" of the library "flib" into
+  // "optimized_func_graph", the body of "func_item".
+  Status OptimizeFunction(Cluster* cluster, const FunctionDef& func,
+                          const FunctionLibraryDefinition& flib,
+                          int graph_def_version, bool is_differentiable,
+                          GrapplerFunctionItem* func_item,
+                          GraphDef* optimized_func_graph);
+
   DeviceBase* const cpu_device_;  // may be NULL
   RewriterConfig cfg_;
 
@@ -83,7 +102,10 @@ class MetaOptimizer : public GraphOptimizer {
                       GrapplerItem* optimized_item, GraphDef* optimized_graph,
                       GraphOptimizationResult* optimization_result);
 
-  std::vector<GraphOptimizationResult> optimization_results_;
+  // Optimizations of function bodies run concurrently.
+  mutable mutex mu_;
+  std::vector<GraphOptimizationResult> optimization_results_ GUARDED_BY(mu_);
+  std::map<string, uint64> optimizer_time_us_ GUARDED_BY(mu_);
 };
 
 bool MetaOptimizerEnabled(const RewriterConfig& cfg);
@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/grappler_test.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -461,6 +462,75 @@ TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryWithRestrictions) {
   EXPECT_FALSE(allowed_optimizations_my_mul_2->non_differentiable_rewrites);
 }
 
+TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryInParallel) {
+  using test::function::NDef;
+
+  // MySquareI(x) = MyMul(x, x) for I in [0, 8), where both functions are
+  // marked as noinline, and every MySquareI has a node "my_mul": the
+  // specializations of MyMul created concurrently for the specializations of
+  // MySquareI are all named "MyMul_specialized_for_my_mul".
+  FunctionDef mul_func = FunctionDefHelper::Create(
+      "MyMul", {"x:T", "y:T"}, {"z:T"}, {"T: {float, int32}"},
+      {{{"mul"}, "Mul", {"x", "y"}, {{"T", "$T"}}}},
+      /* Mapping between function returns and function node outputs. */
+      {{"z", "mul:z:0"}});
+  (*mul_func.mutable_attr())["_noinline"].set_b(true);
+
+  std::vector<FunctionDef> library = {mul_func};
+  std::vector<NodeDef> nodes = {
+      NDef("a", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice),
+      NDef("b", "Placeholder", {}, {{"dtype", DT_INT32}}, kDevice)};
+  for (int i = 0; i < 8; ++i) {
+    const string name = strings::StrCat("MySquare", i);
+    FunctionDef square_func = FunctionDefHelper::Create(
+        name, {"x:T"}, {"z:T"}, {"T: {float, int32}"},
+        {{{"my_mul"}, "MyMul", {"x", "x"}, {{"T", "$T"}}}},
+        /* Mapping between function returns and function node outputs. */
+        {{"z", "my_mul:z:0"}});
+    (*square_func.mutable_attr())["_noinline"].set_b(true);
+    library.push_back(square_func);
+    const bool is_float = i % 2 == 0;
+    nodes.push_back(NDef(strings::StrCat("square", i), name,
+                         {is_float ? "a" : "b"},
+                         {{"T", is_float ? DT_FLOAT : DT_INT32}}, kDevice));
+  }
+  GrapplerItem item;
+  item.graph = test::function::GDef(nodes, library);
+
+  auto optimize = [&item](int num_threads, GraphDef* output,
+                          std::map<string, uint64>* optimizer_time_us) {
+    RewriterConfig rewriter_config;
+    rewriter_config.set_function_optimization(RewriterConfig::ON);
+    rewriter_config.add_optimizers("function");
+    rewriter_config.set_min_graph_nodes(-1);
+    rewriter_config.set_function_optimization_threads(num_threads);
+    MetaOptimizer optimizer(nullptr, rewriter_config);
+    TF_EXPECT_OK(optimizer.Optimize(nullptr, item, output));
+    *optimizer_time_us = optimizer.optimizer_time_us();
+  };
+
+  GraphDef expected;
+  std::map<string, uint64> optimizer_time_us;
+  optimize(1, &expected, &optimizer_time_us);
+  GraphDef output;
+  optimize(4, &output, &optimizer_time_us);
+  EXPECT_EQ(1, optimizer_time_us.count("function_optimizer"));
+
+  // The concurrent optimizations must not change the result.
+  CompareGraphs(expected, output);
+  FunctionLibraryDefinition optimized_flib(OpRegistry::Global(),
+                                           output.library());
+  EXPECT_EQ(expected.library().function_size(),
+            optimized_flib.num_functions());
+  for (const FunctionDef& expected_func : expected.library().function()) {
+    const string& name = expected_func.signature().name();
+    const FunctionDef* optimized_func = optimized_flib.Find(name);
+    ASSERT_NE(optimized_func, nullptr) << name;
+    EXPECT_TRUE(FunctionDefsEqual(expected_func, *optimized_func)) << name;
+  }
+  EXPECT_NE(optimized_flib.Find("MyMul_specialized_for_my_mul_1"), nullptr);
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
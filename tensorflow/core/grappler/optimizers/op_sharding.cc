@@ -0,0 +1,364 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/op_sharding.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/analytical_cost_estimator.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/frame.h"
+#include "tensorflow/core/grappler/utils/symbolic_shapes.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+namespace grappler {
+
+constexpr int64 OpSharding::kDefaultMinBytes;
+
+namespace {
+
+constexpr char kShardingPrefix[] = "OpSharding";
+
+// Upper bound on the number of splits simulated per graph, since every
+// simulation schedules the whole graph.
+constexpr int kMaxCandidates = 16;
+
+// Describes how a node is split.
+struct ShardingPlan {
+  string node;
+  // The devices running the shards.
+  std::vector<string> devices;
+  // The inputs that are split, and the dimension they are split along. The
+  // other inputs are broadcast to all the shards.
+  std::vector<std::pair<int, int>> split_inputs;
+  // The dimension of the output along which the shards are concatenated, or
+  // -1 if the shards are added up.
+  int concat_axis = 0;
+  // Size of the largest input or output of the node.
+  int64 bytes = 0;
+};
+
+int64 TensorBytes(const OpInfo::TensorProperties& prop) {
+  const int64 num_elements = NumCoefficients(prop.shape());
+  if (num_elements < 0) return -1;
+  return num_elements * DataTypeSize(BaseType(prop.dtype()));
+}
+
+// Returns true if "prop" is known to hold the integer scalar "value".
+bool IsConstantScalar(const OpInfo::TensorProperties& prop, int64 value) {
+  if (!prop.has_value()) return false;
+  Tensor tensor;
+  if (!tensor.FromProto(prop.value()) || tensor.NumElements() != 1) {
+    return false;
+  }
+  if (tensor.dtype() == DT_INT32) return tensor.flat<int32>()(0) == value;
+  if (tensor.dtype() == DT_INT64) return tensor.flat<int64>()(0) == value;
+  return false;
+}
+
+bool GetBoolAttr(const NodeDef& node, const string& name) {
+  return node.attr().count(name) > 0 && node.attr().at(name).b();
+}
+
+// Fills "plan" with a split of "node" in "num_shards" even shards. Returns
+// false if the node can't be split.
+bool PlanSharding(const NodeDef& node, const GraphProperties& properties,
+                  int num_shards, ShardingPlan* plan) {
+  if (!properties.HasOutputProperties(node.name())) return false;
+  const auto& inputs = properties.GetInputProperties(node.name());
+  const auto& outputs = properties.GetOutputProperties(node.name());
+  if (inputs.size() < 2 || outputs.size() != 1) return false;
+  plan->bytes = TensorBytes(outputs[0]);
+  if (plan->bytes < 0) return false;
+  for (const auto& input : inputs) {
+    const int64 bytes = TensorBytes(input);
+    if (bytes < 0) return false;
+    plan->bytes = std::max(plan->bytes, bytes);
+  }
+
+  auto dim = [&inputs](int input, int d) {
+    return inputs[input].shape().dim(d).size();
+  };
+  auto divisible = [num_shards](int64 size) {
+    return size >= num_shards && size % num_shards == 0;
+  };
+  plan->node = node.name();
+  plan->split_inputs.clear();
+
+  if (node.op() == "MatMul") {
+    const int a_rows = GetBoolAttr(node, "transpose_a") ? 1 : 0;
+    const int b_cols = GetBoolAttr(node, "transpose_b") ? 0 : 1;
+    struct Split {
+      int64 size;
+      std::vector<std::pair<int, int>> split_inputs;
+      int concat_axis;
+    };
+    // Splits whose shards are concatenated come first: on ties they are
+    // preferred over the split of the contracting dimension, which needs an
+    // extra addition.
+    std::vector<Split> splits = {
+        {dim(0, a_rows), {{0, a_rows}}, 0},
+        {dim(1, b_cols), {{1, b_cols}}, 1},
+        {dim(0, 1 - a_rows), {{0, 1 - a_rows}, {1, 1 - b_cols}}, -1}};
+    std::stable_sort(splits.begin(), splits.end(),
+                     [](const Split& a, const Split& b) {
+                       return a.size > b.size;
+                     });
+    for (const Split& split : splits) {
+      if (divisible(split.size)) {
+        plan->split_inputs = split.split_inputs;
+        plan->concat_axis = split.concat_axis;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if (node.op() == "Conv2D") {
+    // The batch dimension comes first in both data formats.
+    if (!divisible(dim(0, 0))) return false;
+    plan->split_inputs = {{0, 0}};
+    plan->concat_axis = 0;
+    return true;
+  }
+
+  if (node.op() == "Gather" || node.op() == "GatherV2") {
+    if (node.op() == "GatherV2" &&
+        (inputs.size() != 3 || !IsConstantScalar(inputs[2], 0))) {
+      return false;
+    }
+    // When gathering along the first axis, the first dimension of the output
+    // is the first dimension of the indices.
+    if (inputs[1].shape().dim_size() < 1 || !divisible(dim(1, 0))) {
+      return false;
+    }
+    plan->split_inputs = {{1, 0}};
+    plan->concat_axis = 0;
+    return true;
+  }
+
+  return false;
+}
+
+NodeDef* AddScalarConst(const string& name, const string& device, int32 value,
+                        GraphDef* graph) {
+  NodeDef* node = graph->add_node();
+  node->set_name(name);
+  node->set_op("Const");
+  node->set_device(device);
+  (*node->mutable_attr())["dtype"].set_type(DT_INT32);
+  Tensor tensor(DT_INT32, TensorShape({}));
+  tensor.scalar<int32>()() = value;
+  tensor.AsProtoTensorContent(
+      (*node->mutable_attr())["value"].mutable_tensor());
+  return node;
+}
+
+// Rewrites "graph" according to "plan". The shards get the name of the node
+// prefixed with "OpSharding/" and suffixed with "/shard_<i>", and the node is
+// replaced by the op combining them.
+void ApplySharding(const ShardingPlan& plan, const GraphProperties& properties,
+                   GraphDef* graph) {
+  NodeDef* node = nullptr;
+  for (NodeDef& n : *graph->mutable_node()) {
+    if (n.name() == plan.node) {
+      node = &n;
+      break;
+    }
+  }
+  if (node == nullptr) return;
+  const NodeDef original = *node;
+  const auto& inputs = properties.GetInputProperties(plan.node);
+  const DataType output_type =
+      BaseType(properties.GetOutputProperties(plan.node)[0].dtype());
+  const int num_shards = plan.devices.size();
+  const string prefix = AddPrefixToNodeName(original.name(), kShardingPrefix);
+
+  std::vector<std::vector<string>> shard_inputs(
+      num_shards,
+      std::vector<string>(original.input().begin(), original.input().end()));
+  for (const auto& split_input : plan.split_inputs) {
+    const string split_name = strings::StrCat(prefix, "/split_",
+                                              split_input.first);
+    const NodeDef* split_dim =
+        AddScalarConst(strings::StrCat(split_name, "/dim"), original.device(),
+                       split_input.second, graph);
+    NodeDef* split = graph->add_node();
+    split->set_name(split_name);
+    split->set_op("Split");
+    split->set_device(original.device());
+    split->add_input(split_dim->name());
+    split->add_input(original.input(split_input.first));
+    (*split->mutable_attr())["num_split"].set_i(num_shards);
+    (*split->mutable_attr())["T"].set_type(
+        BaseType(inputs[split_input.first].dtype()));
+    for (int i = 0; i < num_shards; ++i) {
+      shard_inputs[i][split_input.first] =
+          i == 0 ? split_name : strings::StrCat(split_name, ":", i);
+    }
+  }
+
+  for (int i = 0; i < num_shards; ++i) {
+    NodeDef* shard = graph->add_node();
+    *shard = original;
+    shard->set_name(strings::StrCat(prefix, "/shard_", i));
+    shard->set_device(plan.devices[i]);
+    // The shards must not be colocated with the original node.
+    shard->mutable_attr()->erase(kColocationAttrName);
+    shard->mutable_attr()->erase("_output_shapes");
+    shard->clear_input();
+    for (const string& input : shard_inputs[i]) {
+      shard->add_input(input);
+    }
+  }
+
+  // The combining op takes over the name of the node, so that its consumers
+  // are unchanged.
+  node->clear_input();
+  auto* attr = node->mutable_attr();
+  attr->clear();
+  if (original.attr().count(kColocationAttrName) > 0) {
+    (*attr)[kColocationAttrName] = original.attr().at(kColocationAttrName);
+  }
+  for (int i = 0; i < num_shards; ++i) {
+    node->add_input(strings::StrCat(prefix, "/shard_", i));
+  }
+  (*attr)["N"].set_i(num_shards);
+  (*attr)["T"].set_type(output_type);
+  if (plan.concat_axis >= 0) {
+    const NodeDef* axis =
+        AddScalarConst(strings::StrCat(prefix, "/concat_axis"),
+                       original.device(), plan.concat_axis, graph);
+    node->set_op("ConcatV2");
+    node->add_input(axis->name());
+    (*attr)["Tidx"].set_type(DT_INT32);
+  } else {
+    node->set_op("AddN");
+  }
+}
+
+}  // namespace
+
+Status OpSharding::Optimize(Cluster* cluster, const GrapplerItem& item,
+                            GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  num_sharded_nodes_ = 0;
+  if (cluster == nullptr) {
+    // Without a cluster there are neither devices to split nodes across nor
+    // a cost model to tell whether it helps.
+    return Status::OK();
+  }
+
+  std::map<string, std::vector<string>> devices_by_type;
+  for (const auto& device : cluster->GetDevices()) {
+    devices_by_type[device.second.type()].push_back(device.first);
+  }
+  for (auto& devices : devices_by_type) {
+    std::sort(devices.second.begin(), devices.second.end());
+  }
+  // The type of the device that runs nodes that aren't assigned to any.
+  const string default_type = devices_by_type.count("GPU") ? "GPU" : "CPU";
+
+  GraphProperties properties(item);
+  TF_RETURN_IF_ERROR(properties.InferStatically(false));
+  FrameMap frames;
+  int num_frames;
+  TF_RETURN_IF_ERROR(IdentifyFrames(item.graph, &frames, &num_frames));
+  std::unordered_set<string> fed_nodes;
+  for (const auto& feed : item.feed) {
+    fed_nodes.insert(NodeName(feed.first));
+  }
+
+  std::vector<ShardingPlan> candidates;
+  for (const NodeDef& node : item.graph.node()) {
+    // The splits and constants added for the nodes in loops would need to be
+    // in their frames.
+    if (fed_nodes.count(node.name()) > 0 || !frames[&node].empty()) {
+      continue;
+    }
+    string type = default_type;
+    DeviceNameUtils::ParsedName parsed;
+    if (DeviceNameUtils::ParseFullName(node.device(), &parsed) &&
+        parsed.has_type) {
+      type = str_util::Uppercase(parsed.type);
+    }
+    const auto devices = devices_by_type.find(type);
+    if (devices == devices_by_type.end() || devices->second.size() < 2) {
+      continue;
+    }
+    ShardingPlan plan;
+    if (!PlanSharding(node, properties, devices->second.size(), &plan) ||
+        plan.bytes < min_bytes_) {
+      continue;
+    }
+    plan.devices = devices->second;
+    candidates.push_back(std::move(plan));
+  }
+  if (candidates.empty()) {
+    return Status::OK();
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const ShardingPlan& a, const ShardingPlan& b) {
+                     return a.bytes > b.bytes;
+                   });
+  if (candidates.size() > kMaxCandidates) {
+    candidates.resize(kMaxCandidates);
+  }
+
+  AnalyticalCostEstimator estimator(cluster, /*use_static_shapes=*/true);
+  TF_RETURN_IF_ERROR(estimator.Initialize(item));
+  Costs costs;
+  TF_RETURN_IF_ERROR(estimator.PredictCosts(*optimized_graph, nullptr, &costs));
+  Costs::Duration best_time = costs.execution_time;
+  for (const ShardingPlan& plan : candidates) {
+    GraphDef trial = *optimized_graph;
+    ApplySharding(plan, properties, &trial);
+    Costs trial_costs;
+    Status s = estimator.PredictCosts(trial, nullptr, &trial_costs);
+    if (!s.ok()) {
+      VLOG(1) << "Failed to simulate the split of " << plan.node << ": "
+              << s.error_message();
+      continue;
+    }
+    VLOG(1) << "Splitting " << plan.node << " in " << plan.devices.size()
+            << " shards changes the execution time from " << best_time
+            << " to " << trial_costs.execution_time;
+    if (trial_costs.execution_time < best_time) {
+      best_time = trial_costs.execution_time;
+      optimized_graph->Swap(&trial);
+      ++num_sharded_nodes_;
+    }
+  }
+  return Status::OK();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
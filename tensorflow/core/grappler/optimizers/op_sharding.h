@@ -0,0 +1,73 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OP_SHARDING_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OP_SHARDING_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Model parallelism at the granularity of single ops: splits oversized MatMul,
+// Conv2D and Gather nodes along one dimension into shards running on the
+// devices of the cluster that have the type of the device of the node (e.g.
+// several virtual CPU devices, or the CPUs of several tasks). The shards are
+// combined by a ConcatV2, or by an AddN when a MatMul is split along its
+// contracting dimension, that takes over the name of the original node.
+//
+//   MatMul:  splits the rows of a, the columns of b or the contracting
+//            dimension, whichever is largest.
+//   Conv2D:  splits the batch.
+//   Gather:  splits the indices, when gathering along the first axis.
+//
+// Every split is simulated with the VirtualScheduler and only kept if it
+// reduces the predicted execution time of the graph, so that the transfers
+// and the concatenation don't outweigh the parallelism.
+class OpSharding : public GraphOptimizer {
+ public:
+  // Nodes with no input or output of at least "min_bytes" bytes are never
+  // split.
+  static constexpr int64 kDefaultMinBytes = 1 << 20;
+
+  OpSharding() : opt_level_(RewriterConfig::DEFAULT) {}
+  explicit OpSharding(RewriterConfig::Toggle opt_level,
+                      int64 min_bytes = kDefaultMinBytes)
+      : opt_level_(opt_level), min_bytes_(min_bytes) {}
+
+  ~OpSharding() override {}
+
+  string name() const override { return "op_sharding"; };
+
+  // Number of nodes split by the last call to Optimize().
+  int num_sharded_nodes() const { return num_sharded_nodes_; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+
+ private:
+  RewriterConfig::Toggle opt_level_;
+  int64 min_bytes_ = kDefaultMinBytes;
+  int num_sharded_nodes_ = 0;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OP_SHARDING_H_
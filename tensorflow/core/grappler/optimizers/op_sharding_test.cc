@@ -0,0 +1,308 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/op_sharding.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kCpu0[] = "/job:localhost/replica:0/task:0/cpu:0";
+constexpr char kCpu1[] = "/job:localhost/replica:0/task:0/cpu:1";
+
+class OpShardingTest : public GrapplerTest {
+ protected:
+  void SetUp() override { CreateCluster(2); }
+
+  void TearDown() override {
+    TF_CHECK_OK(cluster_->Shutdown());
+    cluster_.reset();
+  }
+
+  // Invents "num_cpus" CPUs so that predictions remain the same from machine
+  // to machine.
+  void CreateCluster(int num_cpus) {
+    if (cluster_ != nullptr) TF_CHECK_OK(cluster_->Shutdown());
+    DeviceProperties cpu_device;
+    cpu_device.set_type("CPU");
+    cpu_device.set_frequency(1000);
+    cpu_device.set_num_cores(4);
+    cpu_device.set_bandwidth(32 * 1000 * 1000);
+    cpu_device.set_memory_size(1024 * 1024 * 1024);
+    std::unordered_map<string, DeviceProperties> devices;
+    for (int i = 0; i < num_cpus; ++i) {
+      devices[strings::StrCat("/job:localhost/replica:0/task:0/cpu:", i)] =
+          cpu_device;
+    }
+    cluster_.reset(new VirtualCluster(devices));
+    TF_CHECK_OK(cluster_->Provision());
+  }
+
+  // Returns a tensor of "shape" filled with values in [0, 1).
+  static Tensor RandomTensor(const TensorShape& shape) {
+    Tensor tensor(DT_FLOAT, shape);
+    tensor.flat<float>().setRandom();
+    return tensor;
+  }
+
+  // Runs "graph" on as many CPUs as the shards may be placed on.
+  std::vector<Tensor> Evaluate(const GraphDef& graph,
+                               const GrapplerItem& item) {
+    SessionOptions options;
+    (*options.config.mutable_device_count())["CPU"] = 4;
+    options.config.mutable_graph_options()
+        ->mutable_rewrite_options()
+        ->set_disable_meta_optimizer(true);
+    std::unique_ptr<Session> session(NewSession(options));
+    TF_CHECK_OK(session->Create(graph));
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->Run(item.feed, item.fetch, {}, &outputs));
+    TF_CHECK_OK(session->Close());
+    return outputs;
+  }
+
+  // Checks that "optimized" computes the same fetches as the graph of "item".
+  void ExpectSameOutputs(const GrapplerItem& item, const GraphDef& optimized) {
+    const std::vector<Tensor> expected = Evaluate(item.graph, item);
+    const std::vector<Tensor> actual = Evaluate(optimized, item);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      test::ExpectClose(expected[i], actual[i], /*atol=*/1e-4, /*rtol=*/1e-4);
+    }
+  }
+
+  // Returns the node named "name" in "graph".
+  const NodeDef* Node(const GraphDef& graph, const string& name) {
+    for (const NodeDef& node : graph.node()) {
+      if (node.name() == name) return &node;
+    }
+    return nullptr;
+  }
+
+  std::unique_ptr<VirtualCluster> cluster_;
+};
+
+TEST_F(OpShardingTest, SplitsRowsOfMatMul) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+  Output a = ops::Placeholder(s.WithOpName("a"), DT_FLOAT,
+                              ops::Placeholder::Shape({1024, 256}));
+  Output b = ops::Placeholder(s.WithOpName("b"), DT_FLOAT,
+                              ops::Placeholder::Shape({256, 1024}));
+  Output mm = ops::MatMul(s.WithOpName("mm"), a, b);
+  Output out = ops::Identity(s.WithOpName("out"), mm);
+
+  GrapplerItem item;
+  item.fetch = {"out"};
+  item.feed = {{"a", RandomTensor({1024, 256})},
+               {"b", RandomTensor({256, 1024})}};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpSharding optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster_.get(), item, &output));
+  EXPECT_EQ(1, optimizer.num_sharded_nodes());
+
+  const NodeDef* concat = Node(output, "mm");
+  ASSERT_NE(nullptr, concat);
+  EXPECT_EQ("ConcatV2", concat->op());
+  EXPECT_EQ(kCpu0, concat->device());
+  ASSERT_EQ(3, concat->input_size());
+  EXPECT_EQ("OpSharding/mm/shard_0", concat->input(0));
+  EXPECT_EQ("OpSharding/mm/shard_1", concat->input(1));
+  EXPECT_EQ("OpSharding/mm/concat_axis", concat->input(2));
+
+  const NodeDef* split = Node(output, "OpSharding/mm/split_0");
+  ASSERT_NE(nullptr, split);
+  EXPECT_EQ("Split", split->op());
+  EXPECT_EQ("a", split->input(1));
+
+  const NodeDef* shard1 = Node(output, "OpSharding/mm/shard_1");
+  ASSERT_NE(nullptr, shard1);
+  EXPECT_EQ("MatMul", shard1->op());
+  EXPECT_EQ(kCpu1, shard1->device());
+  ASSERT_EQ(2, shard1->input_size());
+  EXPECT_EQ("OpSharding/mm/split_0:1", shard1->input(0));
+  EXPECT_EQ("b", shard1->input(1));
+
+  ExpectSameOutputs(item, output);
+}
+
+TEST_F(OpShardingTest, SplitsContractingDimensionOfMatMul) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+  Output a = ops::Placeholder(s.WithOpName("a"), DT_FLOAT,
+                              ops::Placeholder::Shape({8192, 256}));
+  Output b = ops::Placeholder(s.WithOpName("b"), DT_FLOAT,
+                              ops::Placeholder::Shape({8192, 256}));
+  Output mm = ops::MatMul(s.WithOpName("mm"), a, b,
+                          ops::MatMul::TransposeA(true));
+  Output out = ops::Identity(s.WithOpName("out"), mm);
+
+  GrapplerItem item;
+  item.fetch = {"out"};
+  item.feed = {{"a", RandomTensor({8192, 256})},
+               {"b", RandomTensor({8192, 256})}};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpSharding optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster_.get(), item, &output));
+  EXPECT_EQ(1, optimizer.num_sharded_nodes());
+
+  const NodeDef* sum = Node(output, "mm");
+  ASSERT_NE(nullptr, sum);
+  EXPECT_EQ("AddN", sum->op());
+  EXPECT_EQ(2, sum->input_size());
+  EXPECT_NE(nullptr, Node(output, "OpSharding/mm/split_0"));
+  EXPECT_NE(nullptr, Node(output, "OpSharding/mm/split_1"));
+  const NodeDef* shard0 = Node(output, "OpSharding/mm/shard_0");
+  ASSERT_NE(nullptr, shard0);
+  EXPECT_EQ("OpSharding/mm/split_0", shard0->input(0));
+  EXPECT_EQ("OpSharding/mm/split_1", shard0->input(1));
+
+  ExpectSameOutputs(item, output);
+}
+
+TEST_F(OpShardingTest, SplitsBatchOfConv2D) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+  Output input = ops::Placeholder(s.WithOpName("input"), DT_FLOAT,
+                                  ops::Placeholder::Shape({16, 32, 32, 16}));
+  Output filter = ops::Placeholder(s.WithOpName("filter"), DT_FLOAT,
+                                   ops::Placeholder::Shape({3, 3, 16, 32}));
+  Output conv =
+      ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1}, "SAME");
+  Output out = ops::Identity(s.WithOpName("out"), conv);
+
+  GrapplerItem item;
+  item.fetch = {"out"};
+  item.feed = {{"input", RandomTensor({16, 32, 32, 16})},
+               {"filter", RandomTensor({3, 3, 16, 32})}};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpSharding optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster_.get(), item, &output));
+  EXPECT_EQ(1, optimizer.num_sharded_nodes());
+
+  const NodeDef* concat = Node(output, "conv");
+  ASSERT_NE(nullptr, concat);
+  EXPECT_EQ("ConcatV2", concat->op());
+  ASSERT_EQ(3, concat->input_size());
+  EXPECT_EQ("OpSharding/conv/concat_axis", concat->input(2));
+
+  const NodeDef* split = Node(output, "OpSharding/conv/split_0");
+  ASSERT_NE(nullptr, split);
+  EXPECT_EQ("input", split->input(1));
+
+  const NodeDef* shard1 = Node(output, "OpSharding/conv/shard_1");
+  ASSERT_NE(nullptr, shard1);
+  EXPECT_EQ("Conv2D", shard1->op());
+  EXPECT_EQ(kCpu1, shard1->device());
+  ASSERT_EQ(2, shard1->input_size());
+  EXPECT_EQ("OpSharding/conv/split_0:1", shard1->input(0));
+  EXPECT_EQ("filter", shard1->input(1));
+
+  ExpectSameOutputs(item, output);
+}
+
+TEST_F(OpShardingTest, SplitsIndicesOfGather) {
+  // The concatenation of the gathered rows costs as much as gathering half of
+  // them, so splitting only pays off across more than two devices.
+  CreateCluster(4);
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+  Output table = ops::Placeholder(s.WithOpName("table"), DT_FLOAT,
+                                  ops::Placeholder::Shape({1024, 64}));
+  Output ids = ops::Placeholder(s.WithOpName("ids"), DT_INT32,
+                                ops::Placeholder::Shape({16384}));
+  Output gather = ops::Gather(s.WithOpName("gather"), table, ids);
+  Output out = ops::Identity(s.WithOpName("out"), gather);
+
+  Tensor ids_t(DT_INT32, {16384});
+  for (int i = 0; i < ids_t.NumElements(); ++i) {
+    ids_t.flat<int32>()(i) = (i * 7) % 1024;
+  }
+  GrapplerItem item;
+  item.fetch = {"out"};
+  item.feed = {{"table", RandomTensor({1024, 64})}, {"ids", ids_t}};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpSharding optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster_.get(), item, &output));
+  EXPECT_EQ(1, optimizer.num_sharded_nodes());
+
+  const NodeDef* concat = Node(output, "gather");
+  ASSERT_NE(nullptr, concat);
+  EXPECT_EQ("ConcatV2", concat->op());
+  ASSERT_EQ(5, concat->input_size());
+  EXPECT_EQ("OpSharding/gather/concat_axis", concat->input(4));
+
+  const NodeDef* split = Node(output, "OpSharding/gather/split_1");
+  ASSERT_NE(nullptr, split);
+  EXPECT_EQ("ids", split->input(1));
+
+  const NodeDef* shard3 = Node(output, "OpSharding/gather/shard_3");
+  ASSERT_NE(nullptr, shard3);
+  EXPECT_EQ("Gather", shard3->op());
+  EXPECT_EQ("/job:localhost/replica:0/task:0/cpu:3", shard3->device());
+  ASSERT_EQ(2, shard3->input_size());
+  EXPECT_EQ("table", shard3->input(0));
+  EXPECT_EQ("OpSharding/gather/split_1:3", shard3->input(1));
+
+  ExpectSameOutputs(item, output);
+}
+
+TEST_F(OpShardingTest, KeepsSmallAndCheapOps) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice(kCpu0);
+  // Too small.
+  Output a = ops::Variable(s.WithOpName("a"), {64, 64}, DT_FLOAT);
+  Output mm = ops::MatMul(s.WithOpName("mm"), a, a);
+  // Large, but the concatenation costs more than the split saves.
+  Output table =
+      ops::Variable(s.WithOpName("table"), {1 << 16, 64}, DT_FLOAT);
+  Output ids = ops::Variable(s.WithOpName("ids"), {1024}, DT_INT32);
+  Output gather = ops::Gather(s.WithOpName("gather"), table, ids);
+  Output out1 = ops::Identity(s.WithOpName("out1"), mm);
+  Output out2 = ops::Identity(s.WithOpName("out2"), gather);
+
+  GrapplerItem item;
+  item.fetch = {"out1", "out2"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  OpSharding optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster_.get(), item, &output));
+  EXPECT_EQ(0, optimizer.num_sharded_nodes());
+  CompareGraphs(item.graph, output);
+
+  // Nothing to split across without a cluster.
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  CompareGraphs(item.graph, output);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
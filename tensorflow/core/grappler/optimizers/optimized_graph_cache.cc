@@ -0,0 +1,107 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// Appends "value" to "data" so that the concatenation of the values is
+// unambiguous.
+void AppendField(StringPiece value, string* data) {
+  strings::StrAppend(data, value.size(), ":", value);
+}
+
+}  // namespace
+
+/* static */ string OptimizedGraphCache::Key(
+    const GrapplerItem& item, const RewriterConfig& cfg,
+    const std::vector<string>& devices) {
+  string data;
+  AppendField(TF_VERSION_STRING, &data);
+  AppendField(strings::StrCat(TF_GRAPH_DEF_VERSION), &data);
+
+  string serialized;
+  SerializeToStringDeterministic(item.graph, &serialized);
+  AppendField(serialized, &data);
+  for (const auto& feed : item.feed) {
+    AppendField(feed.first, &data);
+    AppendField(DataTypeString(feed.second.dtype()), &data);
+    AppendField(feed.second.shape().DebugString(), &data);
+  }
+  AppendField("fetch", &data);
+  for (const string& fetch : item.fetch) {
+    AppendField(fetch, &data);
+  }
+
+  RewriterConfig key_cfg = cfg;
+  key_cfg.clear_optimized_graph_cache_dir();
+  SerializeToStringDeterministic(key_cfg, &serialized);
+  AppendField(serialized, &data);
+  for (const string& device : devices) {
+    AppendField(device, &data);
+  }
+
+  const Fprint128 fingerprint = Fingerprint128(data);
+  return strings::StrCat(strings::Hex(fingerprint.high64, strings::kZeroPad16),
+                         strings::Hex(fingerprint.low64, strings::kZeroPad16));
+}
+
+string OptimizedGraphCache::EntryPath(const string& key) const {
+  return io::JoinPath(cache_dir_, strings::StrCat(key, ".graph.pb"));
+}
+
+Status OptimizedGraphCache::Lookup(const string& key,
+                                   GraphDef* optimized_graph) const {
+  const string path = EntryPath(key);
+  if (!env_->FileExists(path).ok()) {
+    return errors::NotFound("No optimized graph cached under ", key);
+  }
+  return ReadBinaryProto(env_, path, optimized_graph);
+}
+
+Status OptimizedGraphCache::Insert(const string& key,
+                                   const GraphDef& optimized_graph) const {
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(cache_dir_));
+  // Written to a temporary file first, so that readers never see a partial
+  // entry.
+  const string path = EntryPath(key);
+  string tmp_path = path;
+  if (!env_->CreateUniqueFileName(&tmp_path, ".tmp")) {
+    return errors::Internal("Failed to create a temporary file name for ",
+                            path);
+  }
+  Status s = WriteBinaryProto(env_, tmp_path, optimized_graph);
+  if (s.ok()) {
+    s = env_->RenameFile(tmp_path, path);
+  }
+  if (!s.ok()) {
+    env_->DeleteFile(tmp_path).IgnoreError();
+  }
+  return s;
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
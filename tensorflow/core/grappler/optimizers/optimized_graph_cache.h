@@ -0,0 +1,66 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+
+#include <vector>
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// An on-disk cache of the graphs optimized by the meta optimizer (see
+// RewriterConfig::optimized_graph_cache_dir), so that processes optimizing a
+// graph they, or another process sharing the cache, already optimized skip
+// the optimization passes.
+//
+// Entries are written atomically, so several processes can share a cache
+// directory. Nothing is ever evicted.
+class OptimizedGraphCache {
+ public:
+  OptimizedGraphCache(Env* env, const string& cache_dir)
+      : env_(env), cache_dir_(cache_dir) {}
+
+  // Returns the key of the optimization of "item" by a meta optimizer
+  // configured by "cfg" (ignoring the location of the cache) for the devices
+  // described by "devices". The key also depends on the version of
+  // TensorFlow.
+  static string Key(const GrapplerItem& item, const RewriterConfig& cfg,
+                    const std::vector<string>& devices);
+
+  // Reads the optimized graph cached under "key". Returns NotFound if there
+  // is none.
+  Status Lookup(const string& key, GraphDef* optimized_graph) const;
+
+  // Caches "optimized_graph" under "key", replacing any previous entry.
+  Status Insert(const string& key, const GraphDef& optimized_graph) const;
+
+ private:
+  string EntryPath(const string& key) const;
+
+  Env* const env_;
+  const string cache_dir_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
@@ -0,0 +1,98 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class OptimizedGraphCacheTest : public GrapplerTest {
+ protected:
+  GrapplerItem MakeItem(float value) {
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+    Output c = ops::Const(s.WithOpName("c"), value, {});
+    Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT);
+    Output y = ops::Mul(s.WithOpName("y"), c, x);
+    GrapplerItem item;
+    item.fetch = {"y"};
+    TF_CHECK_OK(s.ToGraphDef(&item.graph));
+    return item;
+  }
+};
+
+TEST_F(OptimizedGraphCacheTest, KeyDependsOnInputs) {
+  const GrapplerItem item = MakeItem(2.0f);
+  RewriterConfig cfg;
+  const std::vector<string> devices = {"/job:localhost/replica:0/task:0/"
+                                       "device:CPU:0"};
+  const string key = OptimizedGraphCache::Key(item, cfg, devices);
+  EXPECT_EQ(32, key.size());
+  EXPECT_EQ(key, OptimizedGraphCache::Key(item, cfg, devices));
+
+  // The location of the cache is not part of the key.
+  RewriterConfig cached_cfg = cfg;
+  cached_cfg.set_optimized_graph_cache_dir("/tmp/cache");
+  EXPECT_EQ(key, OptimizedGraphCache::Key(item, cached_cfg, devices));
+
+  EXPECT_NE(key, OptimizedGraphCache::Key(MakeItem(3.0f), cfg, devices));
+  GrapplerItem other_fetch = item;
+  other_fetch.fetch = {"c"};
+  EXPECT_NE(key, OptimizedGraphCache::Key(other_fetch, cfg, devices));
+  GrapplerItem with_feed = item;
+  with_feed.feed.emplace_back("x", Tensor(DT_FLOAT, {}));
+  EXPECT_NE(key, OptimizedGraphCache::Key(with_feed, cfg, devices));
+  RewriterConfig other_cfg = cfg;
+  other_cfg.set_constant_folding(RewriterConfig::OFF);
+  EXPECT_NE(key, OptimizedGraphCache::Key(item, other_cfg, devices));
+  EXPECT_NE(key, OptimizedGraphCache::Key(item, cfg, {}));
+}
+
+TEST_F(OptimizedGraphCacheTest, LookupAndInsert) {
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "optimized_graph_cache");
+  OptimizedGraphCache cache(Env::Default(), cache_dir);
+  const GrapplerItem item = MakeItem(2.0f);
+  const string key = OptimizedGraphCache::Key(item, RewriterConfig(), {});
+
+  GraphDef cached;
+  EXPECT_TRUE(errors::IsNotFound(cache.Lookup(key, &cached)));
+
+  TF_EXPECT_OK(cache.Insert(key, item.graph));
+  TF_EXPECT_OK(cache.Lookup(key, &cached));
+  CompareGraphs(item.graph, cached);
+
+  // Entries are replaced.
+  GraphDef pruned = item.graph;
+  pruned.mutable_node()->RemoveLast();
+  TF_EXPECT_OK(cache.Insert(key, pruned));
+  TF_EXPECT_OK(cache.Lookup(key, &cached));
+  CompareGraphs(pruned, cached);
+
+  // Shared with other instances.
+  OptimizedGraphCache other_cache(Env::Default(), cache_dir);
+  TF_EXPECT_OK(other_cache.Lookup(key, &cached));
+  CompareGraphs(pruned, cached);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
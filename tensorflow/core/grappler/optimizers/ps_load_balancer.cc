@@ -0,0 +1,356 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/ps_load_balancer.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/graph_view.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/grappler/utils/symbolic_shapes.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// Number of rows assumed to be touched per sparse access when the shape of
+// the indices can't be inferred.
+constexpr int64 kDefaultSparseRowsPerAccess = 1024;
+
+bool IsVariableStorage(const NodeDef& node) {
+  const auto& op = node.op();
+  return op == "Variable" || op == "VariableV2" || op == "VarHandleOp" ||
+         op == "AutoReloadVariable";
+}
+
+bool IsSparseAccess(const NodeDef& node) {
+  const auto& op = node.op();
+  return op == "Gather" || op == "GatherV2" || op == "ResourceGather" ||
+         str_util::StartsWith(op, "Scatter") ||
+         str_util::StartsWith(op, "ResourceScatter") ||
+         str_util::StartsWith(op, "SparseApply") ||
+         str_util::StartsWith(op, "ResourceSparseApply");
+}
+
+// Returns the input position of the "indices" argument of a sparse access, or
+// -1 if the op has no such argument.
+int IndicesInputPosition(const NodeDef& node) {
+  const OpDef* op_def = nullptr;
+  if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok()) {
+    return -1;
+  }
+  // None of the sparse accesses take list arguments, so the position of the
+  // argument is also the position of the input tensor.
+  for (int i = 0; i < op_def->input_arg_size(); ++i) {
+    if (op_def->input_arg(i).name() == "indices") return i;
+  }
+  return -1;
+}
+
+int64 VariableBytes(const NodeDef& node) {
+  if (node.attr().count("shape") == 0 || node.attr().count("dtype") == 0) {
+    return -1;
+  }
+  const int64 num_elements = NumCoefficients(node.attr().at("shape").shape());
+  if (num_elements < 0) return -1;
+  return num_elements * DataTypeSize(BaseType(node.attr().at("dtype").type()));
+}
+
+// Returns the names of the nodes "node" is colocated with.
+std::vector<string> ColocationGroups(const NodeDef& node) {
+  std::vector<string> groups;
+  if (node.attr().count(kColocationAttrName) == 0) return groups;
+  for (const string& loc : node.attr().at(kColocationAttrName).list().s()) {
+    StringPiece group(loc);
+    if (str_util::ConsumePrefix(&group, kColocationGroupPrefix) &&
+        group != node.name()) {
+      groups.emplace_back(group);
+    }
+  }
+  return groups;
+}
+
+struct VariableInfo {
+  NodeDef* node;
+  // The variable together with all the nodes colocated with it, including
+  // the variables colocated with it.
+  std::vector<NodeDef*> group;
+  int num_variables;
+  int64 bytes;
+  double traffic;
+  double cost;
+};
+
+}  // namespace
+
+/* static */ std::unordered_map<string, int64>
+PsLoadBalancer::AccessCountsFromCostModel(const CostModel& cost_model,
+                                          const Graph& graph) {
+  std::unordered_map<string, int64> counts;
+  for (const Node* node : graph.op_nodes()) {
+    const int64 count = cost_model.TotalCount(node);
+    if (count > 0) counts[node->name()] = count;
+  }
+  return counts;
+}
+
+double PsLoadBalancer::AccessFrequency(const string& node_name) const {
+  if (num_steps_ <= 0) return 1.0;
+  auto it = access_counts_.find(node_name);
+  if (it == access_counts_.end()) return 1.0;
+  return static_cast<double>(it->second) / num_steps_;
+}
+
+Status PsLoadBalancer::Optimize(Cluster* cluster, const GrapplerItem& item,
+                                GraphDef* optimized_graph) {
+  *optimized_graph = item.graph;
+  ps_loads_.clear();
+
+  // Parameter server tasks, keyed by their "/job:ps/replica:R/task:T" prefix.
+  std::map<string, DeviceNameUtils::ParsedName> ps_tasks;
+  auto add_ps_task = [this, &ps_tasks](const string& device) {
+    DeviceNameUtils::ParsedName parsed;
+    if (!DeviceNameUtils::ParseFullName(device, &parsed) || !parsed.has_job ||
+        parsed.job != ps_job_ || !parsed.has_task) {
+      return false;
+    }
+    DeviceNameUtils::ParsedName task;
+    task.has_job = true;
+    task.job = parsed.job;
+    task.has_replica = parsed.has_replica;
+    task.replica = parsed.replica;
+    task.has_task = true;
+    task.task = parsed.task;
+    ps_tasks.emplace(DeviceNameUtils::ParsedNameToString(task), task);
+    return true;
+  };
+  if (cluster) {
+    for (const string& device : cluster->GetDeviceNames()) {
+      add_ps_task(device);
+    }
+  }
+
+  // Collect the nodes colocated with every variable.
+  std::unordered_map<string, std::vector<NodeDef*>> colocated;
+  for (NodeDef& node : *optimized_graph->mutable_node()) {
+    for (const string& group : ColocationGroups(node)) {
+      colocated[group].push_back(&node);
+    }
+  }
+
+  GraphView graph(optimized_graph);
+  GraphProperties properties(item);
+  bool properties_inferred = false;
+  bool has_properties = false;
+
+  std::vector<VariableInfo> variables;
+  for (NodeDef& node : *optimized_graph->mutable_node()) {
+    if (!IsVariableStorage(node) || !add_ps_task(node.device())) continue;
+    const int64 bytes = VariableBytes(node);
+    if (bytes < 0) {
+      VLOG(2) << "Not balancing variable with unknown size: " << node.name();
+      continue;
+    }
+
+    VariableInfo var{&node, {&node}, 1, bytes, 0.0, 0.0};
+    for (NodeDef* member : colocated[node.name()]) {
+      // Only move the colocated nodes that were put on the same task, so that
+      // explicit user placements are never overridden.
+      if (member->device().empty() || member->device() == node.device()) {
+        var.group.push_back(member);
+      }
+    }
+
+    // Every dense access moves the whole variable, every sparse one only the
+    // addressed rows, as often as the access runs per step. Read snapshots
+    // are looked through once.
+    const int64 dim0 =
+        node.attr().at("shape").shape().dim_size() > 0
+            ? node.attr().at("shape").shape().dim(0).size()
+            : 1;
+    const double row_bytes = dim0 > 0 ? static_cast<double>(bytes) / dim0 : 0;
+    auto access_traffic = [&](const NodeDef& consumer) -> double {
+      const double frequency = AccessFrequency(consumer.name());
+      if (!IsSparseAccess(consumer)) return frequency * bytes;
+      int64 num_rows = kDefaultSparseRowsPerAccess;
+      const int pos = IndicesInputPosition(consumer);
+      if (pos >= 0) {
+        if (!properties_inferred) {
+          // This is an expensive call, call it lazily.
+          has_properties = properties.InferStatically(false).ok();
+          properties_inferred = true;
+        }
+        if (has_properties) {
+          const auto& inputs = properties.GetInputProperties(consumer.name());
+          if (pos < static_cast<int>(inputs.size())) {
+            const int64 num_indices = NumCoefficients(inputs[pos].shape());
+            if (num_indices >= 0) num_rows = num_indices;
+          }
+        }
+      }
+      return frequency * std::min<double>(bytes, num_rows * row_bytes);
+    };
+    for (const auto& fanout : graph.GetFanouts(node, false)) {
+      const NodeDef& consumer = *fanout.node;
+      if (IsIdentity(consumer) || consumer.op() == "ReadVariableOp") {
+        double snapshot_traffic = 0;
+        bool dense_read = false;
+        for (const auto& read : graph.GetFanouts(consumer, false)) {
+          if (!IsSparseAccess(*read.node)) {
+            dense_read = true;
+            break;
+          }
+          snapshot_traffic += access_traffic(*read.node);
+        }
+        var.traffic += dense_read ? AccessFrequency(consumer.name()) * bytes
+                                  : snapshot_traffic;
+      } else {
+        var.traffic += access_traffic(consumer);
+      }
+    }
+    variables.push_back(std::move(var));
+  }
+
+  // Fold the variables colocated with another balanced variable (e.g. the
+  // slots of an optimizer, "loc:@var") into the unit of that variable, so
+  // that they are never separated from it and are only counted once.
+  std::unordered_map<string, int> variable_index;
+  for (int i = 0; i < variables.size(); ++i) {
+    variable_index[variables[i].node->name()] = i;
+  }
+  auto primary_of = [&](int i) {
+    // Follow the colocation constraints to the root variable.
+    std::vector<int> path = {i};
+    while (true) {
+      int next = -1;
+      for (const string& group : ColocationGroups(*variables[i].node)) {
+        auto it = variable_index.find(group);
+        if (it != variable_index.end()) {
+          next = it->second;
+          break;
+        }
+      }
+      if (next < 0) return i;
+      auto seen = std::find(path.begin(), path.end(), next);
+      if (seen != path.end()) {
+        // The root of a cycle of constraints is its first variable.
+        return *std::min_element(seen, path.end());
+      }
+      path.push_back(next);
+      i = next;
+    }
+  };
+  std::vector<int> primary(variables.size());
+  for (int i = 0; i < variables.size(); ++i) {
+    primary[i] = primary_of(i);
+  }
+  for (int i = 0; i < variables.size(); ++i) {
+    if (primary[i] == i) continue;
+    VariableInfo& unit = variables[primary[i]];
+    unit.num_variables += variables[i].num_variables;
+    unit.bytes += variables[i].bytes;
+    unit.traffic += variables[i].traffic;
+    for (NodeDef* member : variables[i].group) {
+      if (std::find(unit.group.begin(), unit.group.end(), member) ==
+          unit.group.end()) {
+        unit.group.push_back(member);
+      }
+    }
+  }
+  std::vector<VariableInfo> units;
+  for (int i = 0; i < variables.size(); ++i) {
+    if (primary[i] == i) units.push_back(std::move(variables[i]));
+  }
+  variables = std::move(units);
+
+  if (ps_tasks.size() < 2 || variables.empty()) {
+    VLOG(1) << "No parameter server variables to balance across "
+            << ps_tasks.size() << " task(s).";
+    return Status::OK();
+  }
+
+  // Balance the sum of the normalized bytes and traffic, placing the most
+  // expensive variables first on the least loaded task (LPT scheduling).
+  double total_bytes = 0;
+  double total_traffic = 0;
+  for (const VariableInfo& var : variables) {
+    total_bytes += var.bytes;
+    total_traffic += var.traffic;
+  }
+  for (VariableInfo& var : variables) {
+    var.cost = (total_bytes > 0 ? var.bytes / total_bytes : 0) +
+               (total_traffic > 0 ? var.traffic / total_traffic : 0);
+  }
+  std::stable_sort(variables.begin(), variables.end(),
+                   [](const VariableInfo& a, const VariableInfo& b) {
+                     return a.cost > b.cost;
+                   });
+
+  std::vector<const DeviceNameUtils::ParsedName*> tasks;
+  for (const auto& task : ps_tasks) {
+    PsLoad load;
+    load.device = task.first;
+    ps_loads_.push_back(load);
+    tasks.push_back(&task.second);
+  }
+  std::vector<double> task_cost(tasks.size(), 0.0);
+
+  for (const VariableInfo& var : variables) {
+    const int target = std::min_element(task_cost.begin(), task_cost.end()) -
+                       task_cost.begin();
+    task_cost[target] += var.cost;
+    PsLoad& load = ps_loads_[target];
+    load.num_variables += var.num_variables;
+    load.bytes += var.bytes;
+    load.traffic += var.traffic;
+
+    for (NodeDef* member : var.group) {
+      DeviceNameUtils::ParsedName device;
+      if (!DeviceNameUtils::ParseFullName(member->device(), &device)) {
+        continue;
+      }
+      device.has_job = true;
+      device.job = tasks[target]->job;
+      device.has_replica = tasks[target]->has_replica;
+      device.replica = tasks[target]->replica;
+      device.has_task = true;
+      device.task = tasks[target]->task;
+      member->set_device(DeviceNameUtils::ParsedNameToString(device));
+    }
+  }
+
+  for (const PsLoad& load : ps_loads_) {
+    VLOG(1) << "Expected load of " << load.device << ": "
+            << load.num_variables << " variables, " << load.bytes
+            << " bytes, " << load.traffic << " bytes/step.";
+  }
+  return Status::OK();
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,102 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_PS_LOAD_BALANCER_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_PS_LOAD_BALANCER_H_
+
+#include <unordered_map>
+#include <vector>
+#include "tensorflow/core/graph/costmodel.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Expected load of a single parameter server task after balancing.
+struct PsLoad {
+  string device;        // e.g. "/job:ps/task:1"
+  int num_variables = 0;
+  int64 bytes = 0;      // Bytes of variable storage resident on the task.
+  double traffic = 0;   // Expected bytes read or updated per step.
+};
+
+// Reassigns variables that are already placed on parameter server tasks (e.g.
+// by a round-robin ReplicaDeviceSetter) so that both the resident bytes and
+// the expected per-step traffic are balanced across the tasks. Nodes that are
+// colocated with a variable (initializers, read snapshots, optimizer updates)
+// follow it to its new task.
+//
+// Variables colocated with another variable, like the slots of an
+// optimizer, are balanced together with it as a single unit.
+//
+// Per-step traffic is estimated statically: dense readers and updaters move
+// the whole variable, sparse accesses (Gather, Scatter*, SparseApply*) move
+// only the rows addressed by their indices. When measured execution counts
+// are available (see SetAccessCounts()), they weight every access by how
+// often it actually runs. Other accesses are assumed to run once per step.
+class PsLoadBalancer : public GraphOptimizer {
+ public:
+  PsLoadBalancer() : opt_level_(RewriterConfig::DEFAULT), ps_job_("ps") {}
+  explicit PsLoadBalancer(RewriterConfig::Toggle opt_level,
+                          const string& ps_job = "ps")
+      : opt_level_(opt_level), ps_job_(ps_job) {}
+
+  ~PsLoadBalancer() override {}
+
+  string name() const override { return "ps_load_balancer"; };
+
+  // Per node execution counts accumulated over `num_steps` steps, typically
+  // exported from the CostModel of a previous run with
+  // AccessCountsFromCostModel(). Nodes missing from the map are assumed to
+  // run once per step.
+  void SetAccessCounts(const std::unordered_map<string, int64>& counts,
+                       int64 num_steps) {
+    access_counts_ = counts;
+    num_steps_ = num_steps;
+  }
+
+  // Returns the execution counts (CostModel::TotalCount) of the nodes of
+  // `graph` recorded in `cost_model`, keyed by node name. Nodes that were
+  // never recorded are left out.
+  static std::unordered_map<string, int64> AccessCountsFromCostModel(
+      const CostModel& cost_model, const Graph& graph);
+
+  // Load of every parameter server task computed by the last call to
+  // Optimize(), sorted by device name.
+  const std::vector<PsLoad>& ps_loads() const { return ps_loads_; }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimized_graph, double result) override {}
+
+ private:
+  // Expected number of executions per step of `node_name`.
+  double AccessFrequency(const string& node_name) const;
+
+  RewriterConfig::Toggle opt_level_;
+  const string ps_job_;
+  std::unordered_map<string, int64> access_counts_;
+  int64 num_steps_ = 0;
+  std::vector<PsLoad> ps_loads_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_PS_LOAD_BALANCER_H_
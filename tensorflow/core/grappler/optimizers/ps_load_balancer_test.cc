@@ -0,0 +1,240 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/ps_load_balancer.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/graph/costmodel.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/utils/grappler_test.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class PsLoadBalancerTest : public GrapplerTest {};
+
+TEST_F(PsLoadBalancerTest, BalancesBytesAcrossTasks) {
+  // Round-robin placement puts both large variables on task 0.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output big1 = ops::Variable(s.WithOpName("big1").WithDevice("/job:ps/task:0"),
+                              {1000, 100}, DT_FLOAT);
+  Output small1 = ops::Variable(
+      s.WithOpName("small1").WithDevice("/job:ps/task:1"), {100}, DT_FLOAT);
+  Output big2 = ops::Variable(s.WithOpName("big2").WithDevice("/job:ps/task:0"),
+                              {1000, 100}, DT_FLOAT);
+  Output small2 = ops::Variable(
+      s.WithOpName("small2").WithDevice("/job:ps/task:1"), {100}, DT_FLOAT);
+  Output read = ops::Identity(s.WithOpName("big2/read")
+                                  .WithDevice("/job:ps/task:0")
+                                  .ColocateWith(big2),
+                              big2);
+  Output w1 = ops::Identity(s.WithOpName("w1").WithDevice("/job:worker/task:0"),
+                            big1);
+  Output w2 = ops::Identity(s.WithOpName("w2").WithDevice("/job:worker/task:0"),
+                            read);
+  Output w3 = ops::AddN(s.WithOpName("w3").WithDevice("/job:worker/task:0"),
+                        {small1, small2});
+
+  GrapplerItem item;
+  item.fetch = {"w1", "w2", "w3"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  GraphDef output;
+  PsLoadBalancer optimizer(RewriterConfig::ON);
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  std::unordered_map<string, string> devices;
+  for (const NodeDef& node : output.node()) {
+    devices[node.name()] = node.device();
+  }
+  EXPECT_NE(devices["big1"], devices["big2"]);
+  EXPECT_NE(devices["small1"], devices["small2"]);
+  EXPECT_EQ(devices["big2"], devices["big2/read"]);
+  EXPECT_EQ("/job:worker/task:0", devices["w1"]);
+
+  ASSERT_EQ(2, optimizer.ps_loads().size());
+  for (const PsLoad& load : optimizer.ps_loads()) {
+    EXPECT_EQ(2, load.num_variables);
+    EXPECT_EQ(4 * (1000 * 100 + 100), load.bytes);
+  }
+}
+
+TEST_F(PsLoadBalancerTest, SparseAccessesWeighTraffic) {
+  // An embedding table that is only gathered from generates little traffic,
+  // while a small dense variable read by many consumers generates a lot.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output table = ops::Variable(
+      s.WithOpName("table").WithDevice("/job:ps/task:0"), {10000, 8}, DT_FLOAT);
+  Output dense = ops::Variable(
+      s.WithOpName("dense").WithDevice("/job:ps/task:0"), {1000, 8}, DT_FLOAT);
+  Output ids = ops::Const(s.WithOpName("ids"), {1, 2, 3, 4}, {4});
+  Output lookup = ops::Gather(s.WithOpName("lookup"), table, ids);
+  Output r1 = ops::Square(s.WithOpName("r1"), dense);
+  Output r2 = ops::Square(s.WithOpName("r2"), dense);
+  Output idle = ops::Variable(s.WithOpName("idle").WithDevice("/job:ps/task:1"),
+                              {1}, DT_FLOAT);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  GraphDef output;
+  PsLoadBalancer optimizer(RewriterConfig::ON);
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  ASSERT_EQ(2, optimizer.ps_loads().size());
+  double total_traffic = 0;
+  for (const PsLoad& load : optimizer.ps_loads()) {
+    total_traffic += load.traffic;
+  }
+  // 4 gathered rows of 32 bytes plus two dense reads of 32000 bytes.
+  EXPECT_DOUBLE_EQ(4 * 32 + 2 * 32000, total_traffic);
+
+  std::unordered_map<string, string> devices;
+  for (const NodeDef& node : output.node()) {
+    devices[node.name()] = node.device();
+  }
+  EXPECT_NE(devices["table"], devices["dense"]);
+}
+
+TEST_F(PsLoadBalancerTest, AccessCountsWeighTraffic) {
+  // A small variable read at every iteration of a loop is hotter than two
+  // large ones only read once per step.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output hot = ops::Variable(s.WithOpName("hot").WithDevice("/job:ps/task:0"),
+                             {100}, DT_FLOAT);
+  Output cold1 = ops::Variable(
+      s.WithOpName("cold1").WithDevice("/job:ps/task:0"), {1000}, DT_FLOAT);
+  Output cold2 = ops::Variable(
+      s.WithOpName("cold2").WithDevice("/job:ps/task:1"), {1000}, DT_FLOAT);
+  Output hot_read = ops::Square(s.WithOpName("hot_read"), hot);
+  Output cold1_read = ops::Square(s.WithOpName("cold1_read"), cold1);
+  Output cold2_read = ops::Square(s.WithOpName("cold2_read"), cold2);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  // Without counts, the large variables are the most expensive ones and are
+  // balanced across the tasks.
+  GraphDef output;
+  PsLoadBalancer optimizer(RewriterConfig::ON);
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  std::unordered_map<string, string> devices;
+  for (const NodeDef& node : output.node()) {
+    devices[node.name()] = node.device();
+  }
+  EXPECT_NE(devices["cold1"], devices["cold2"]);
+
+  // Over 10 steps, "hot" was read 1000 times and the others 10 times.
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(ConvertGraphDefToGraph(GraphConstructorOptions(), item.graph,
+                                      &graph));
+  CostModel cost_model(/*is_global=*/false);
+  cost_model.InitFromGraph(graph);
+  for (const Node* node : graph.op_nodes()) {
+    if (node->name() == "hot_read") {
+      cost_model.RecordCount(node, 1000);
+    } else if (node->name() != "cold2_read") {
+      cost_model.RecordCount(node, 10);
+    }
+  }
+  auto counts = PsLoadBalancer::AccessCountsFromCostModel(cost_model, graph);
+  EXPECT_EQ(1000, counts["hot_read"]);
+  EXPECT_EQ(0, counts.count("cold2_read"));
+  optimizer.SetAccessCounts(counts, /*num_steps=*/10);
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  devices.clear();
+  for (const NodeDef& node : output.node()) {
+    devices[node.name()] = node.device();
+  }
+  EXPECT_NE(devices["hot"], devices["cold1"]);
+  EXPECT_EQ(devices["cold1"], devices["cold2"]);
+
+  // "cold2_read" has no count, so it is assumed to run once per step.
+  double total_traffic = 0;
+  for (const PsLoad& load : optimizer.ps_loads()) {
+    total_traffic += load.traffic;
+  }
+  EXPECT_DOUBLE_EQ(100 * 400 + 4000 + 4000, total_traffic);
+}
+
+TEST_F(PsLoadBalancerTest, SlotsFollowTheirVariable) {
+  // Round-robin placement separated the slots from their variable.
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output var = ops::Variable(s.WithOpName("var").WithDevice("/job:ps/task:0"),
+                             {100, 10}, DT_FLOAT);
+  Output m = ops::Variable(
+      s.WithOpName("var/Adam").WithDevice("/job:ps/task:1").ColocateWith(var),
+      {100, 10}, DT_FLOAT);
+  Output v = ops::Variable(
+      s.WithOpName("var/Adam_1").WithDevice("/job:ps/task:1").ColocateWith(var),
+      {100, 10}, DT_FLOAT);
+  Output m_init = ops::Assign(s.WithOpName("var/Adam/Assign")
+                                 .WithDevice("/job:ps/task:1")
+                                 .ColocateWith(m),
+                             m, ops::ZerosLike(s.WithOpName("zeros"), m));
+  Output other = ops::Variable(
+      s.WithOpName("other").WithDevice("/job:ps/task:0"), {300, 10}, DT_FLOAT);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  GraphDef output;
+  PsLoadBalancer optimizer(RewriterConfig::ON);
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  std::unordered_map<string, string> devices;
+  for (const NodeDef& node : output.node()) {
+    devices[node.name()] = node.device();
+  }
+  EXPECT_EQ(devices["var"], devices["var/Adam"]);
+  EXPECT_EQ(devices["var"], devices["var/Adam_1"]);
+  EXPECT_EQ(devices["var"], devices["var/Adam/Assign"]);
+  EXPECT_NE(devices["var"], devices["other"]);
+
+  // Every variable is counted once.
+  ASSERT_EQ(2, optimizer.ps_loads().size());
+  int num_variables = 0;
+  for (const PsLoad& load : optimizer.ps_loads()) {
+    num_variables += load.num_variables;
+    EXPECT_EQ(4 * 3000, load.bytes);
+  }
+  EXPECT_EQ(4, num_variables);
+}
+
+TEST_F(PsLoadBalancerTest, SingleTaskIsNoop) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Variable(s.WithOpName("a").WithDevice("/job:ps/task:0"),
+                           {10, 10}, DT_FLOAT);
+  Output b = ops::Variable(s.WithOpName("b").WithDevice("/job:ps/task:0"),
+                           {10}, DT_FLOAT);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  GraphDef output;
+  PsLoadBalancer optimizer(RewriterConfig::ON);
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  CompareGraphs(item.graph, output);
+  EXPECT_TRUE(optimizer.ps_loads().empty());
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/constant_op.h"
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/constant_pool.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -80,6 +81,10 @@ ConstantOp::ConstantOp(OpKernelConstruction* ctx)
       errors::InvalidArgument("Type mismatch between value (",
                               DataTypeString(tensor_.dtype()), ") and dtype (",
                               DataTypeString(ctx->output_type(0)), ")"));
+  if (ctx->device_type() == DeviceType(DEVICE_CPU)) {
+    // Share the buffer of identical constants of other graphs and sessions.
+    tensor_ = ConstantPool::Global()->Intern(tensor_);
+  }
 }
 
 void ConstantOp::Compute(OpKernelContext* ctx) {
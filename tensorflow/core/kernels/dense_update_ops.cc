@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
 
 namespace tensorflow {
 
@@ -35,6 +36,13 @@ class AssignOpT : public AssignOp {
  public:
   using AssignOp::AssignOp;
 
+  void Compute(OpKernelContext* context) override {
+    AssignOp::Compute(context);
+    // The assignment may have replaced the buffer of the variable.
+    const Tensor lhs = context->mutable_input(0, /* lock_held */ false);
+    ScopedDirtyRowRecorder dirty_rows({&lhs});
+  }
+
   void Copy(OpKernelContext* context, Tensor* lhs, const Tensor& rhs) override {
     functor::DenseUpdate<Device, T, ASSIGN> copy;
     copy(context->eigen_device<Device>(), lhs->flat<T>(), rhs.flat<T>());
@@ -68,6 +76,7 @@ class DenseUpdateOp : public OpKernel {
  private:
   void DoUpdate(OpKernelContext* context) {
     Tensor Tparams = context->mutable_input(0, use_exclusive_lock_);
+    ScopedDirtyRowRecorder dirty_rows({&Tparams});
     const Tensor& Tupdate = context->input(1);
     OP_REQUIRES(context, Tparams.IsInitialized(),
                 errors::FailedPrecondition("Attempting to use uninitialized "
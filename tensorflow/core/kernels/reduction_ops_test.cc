@@ -149,6 +149,16 @@ static void BM_Sum2DColumnReduceGPU(int iters, int num_x, int num_y) {
 }
 BENCHMARK(BM_Sum2DColumnReduceGPU)->RangePair(1, 8192, 1, 8192);
 
+static void BM_Sum2DRowReduceCPU(int iters, int num_x, int num_y) {
+  DoRowReduce(iters, "cpu", "Sum", num_x, num_y);
+}
+BENCHMARK(BM_Sum2DRowReduceCPU)->RangePair(1, 8192, 1, 8192);
+
+static void BM_Sum2DColumnReduceCPU(int iters, int num_x, int num_y) {
+  DoColReduce(iters, "cpu", "Sum", num_x, num_y);
+}
+BENCHMARK(BM_Sum2DColumnReduceCPU)->RangePair(1, 8192, 1, 8192);
+
 static void BM_Sum3DYReduceGPU(int iters, int num_x, int num_y) {
   Do3DYReduce(iters, "gpu", "Sum", num_x, num_y);
 }
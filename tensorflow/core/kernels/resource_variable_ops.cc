@@ -71,6 +71,7 @@ limitations under the License.
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
 #include "tensorflow/core/util/util.h"
 
 namespace tensorflow {
@@ -293,6 +294,7 @@ class AssignVariableOp : public OpKernel {
                                 }));
     core::ScopedUnref s(variable);
     mutex_lock ml(*variable->mu());
+    ScopedDirtyRowRecorder dirty_rows({variable->tensor()});
     OP_REQUIRES(context, variable->tensor()->dtype() == dtype_,
                 errors::InvalidArgument(
                     "Trying to assign variable with wrong dtype. Expected ",
@@ -428,6 +430,7 @@ class AssignUpdateVariableOp : public OpKernel {
     Tensor* var_tensor = variable->tensor();
     OP_REQUIRES_OK(context,
                    PrepareToUpdateVariable<Device, T>(context, var_tensor));
+    ScopedDirtyRowRecorder dirty_rows({var_tensor});
     functor::DenseUpdate<Device, T, Op> update_functor;
     update_functor(context->eigen_device<Device>(), var_tensor->flat<T>(),
                    value.flat<T>());
@@ -628,6 +631,9 @@ class ResourceScatterUpdateOp : public OpKernel {
     OP_REQUIRES_OK(c, PrepareToUpdateVariable<Device, T>(c, params));
     const Tensor& indices = c->input(1);
     const Tensor& updates = c->input(2);
+    ScopedDirtyRowRecorder dirty_rows(
+        {params}, indices,
+        std::is_same<Device, Eigen::ThreadPoolDevice>::value);
 
     // Check that we have enough index space
     const int64 N_big = indices.NumElements();
@@ -30,6 +30,8 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -236,6 +238,10 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64 kLargeShapeThreshold = 16 << 20;  // 16M
 
+// Full tensors are restored from a thread-pool if their total size is larger
+// than this threshold.
+const int64 kLargeRestoreBytesThreshold = 16 << 20;  // 16MB
+
 // A restore operation for a single tensor.  Small tensors may be restored
 // directly from the op thread to improve read locality.  Large tensors can be
 // restored from a thread pool: this requires creating a separate BundleReader
@@ -265,7 +271,9 @@ struct RestoreOp {
     status = run(&reader);
   }
 
-  Status run(BundleReader* reader) {
+  // "Reader" is a BundleReader or a DeltaBundleReader.
+  template <typename Reader>
+  Status run(Reader* reader) {
     TensorShape restored_full_shape;
     TF_RETURN_IF_ERROR(
         reader->LookupTensorShape(tensor_name, &restored_full_shape));
@@ -337,13 +345,25 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
   BundleReader default_reader(Env::Default(), prefix_string);
   TF_RETURN_IF_ERROR(default_reader.status());
 
+  // A delta bundle only holds the rows modified since its parent: its tensors
+  // are read through its chain of bundles, from the op thread.
+  std::unique_ptr<DeltaBundleReader> delta_reader;
+  if (!default_reader.delta_parent().empty()) {
+    delta_reader.reset(new DeltaBundleReader(Env::Default(), prefix_string));
+    TF_RETURN_IF_ERROR(delta_reader->status());
+  }
+
   std::vector<string> mismatched_errors;
   for (const size_t i : sorted_name_idx) {
     TensorShape restored_full_shape;
     DataType original_dtype;
     const string& tensor_name = tensor_names_flat(i);
-    TF_RETURN_IF_ERROR(default_reader.LookupDtypeAndShape(
-        tensor_name, &original_dtype, &restored_full_shape));
+    TF_RETURN_IF_ERROR(
+        delta_reader != nullptr
+            ? delta_reader->LookupDtypeAndShape(tensor_name, &original_dtype,
+                                                &restored_full_shape)
+            : default_reader.LookupDtypeAndShape(tensor_name, &original_dtype,
+                                                 &restored_full_shape));
     if (dtypes[i] != original_dtype) {
       string error_msg = strings::StrCat(
           "tensor_name = ", tensor_name, "; expected dtype ",
@@ -357,9 +377,54 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     return errors::InvalidArgument(error_msg);
   }
 
+  if (delta_reader != nullptr) {
+    for (auto i : sorted_name_idx) {
+      RestoreOp op{context, i, tensor_names_flat(i), shape_and_slices_flat(i),
+                   prefix_string};
+      TF_RETURN_IF_ERROR(op.run(delta_reader.get()));
+    }
+    return Status::OK();
+  }
+
+  // With TF_CHECKPOINT_RESTORE_MMAP set, full tensors that were saved with a
+  // mappable alignment are returned as read-only views of the memory-mapped
+  // checkpoint, so that processes serving the same model share its weights.
+  // Only meant for inference: variables restored this way are copied on their
+  // first update.
+  bool restore_mapped = false;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_CHECKPOINT_RESTORE_MMAP",
+                                        false, &restore_mapped));
+
+  // Full tensors are preallocated and restored together, so that their reads
+  // can be coalesced and issued in parallel.  Slices go through RestoreOp.
+  std::vector<string> full_tensor_names;
+  std::vector<Tensor*> full_tensors;
+  int64 full_tensor_bytes = 0;
   for (auto i : sorted_name_idx) {
     const string& tensor_name = tensor_names_flat(i);
     const string& shape_and_slice = shape_and_slices_flat(i);
+    if (shape_and_slice.empty()) {
+      if (restore_mapped) {
+        Tensor mapped;
+        Status s = default_reader.LookupMapped(tensor_name, &mapped);
+        if (s.ok()) {
+          context->set_output(i, mapped);
+          continue;
+        }
+        if (!errors::IsFailedPrecondition(s)) return s;
+        VLOG(1) << "Copying " << tensor_name << ": " << s.error_message();
+      }
+      TensorShape restored_full_shape;
+      TF_RETURN_IF_ERROR(
+          default_reader.LookupTensorShape(tensor_name, &restored_full_shape));
+      Tensor* restored_tensor;
+      TF_RETURN_IF_ERROR(
+          context->allocate_output(i, restored_full_shape, &restored_tensor));
+      full_tensor_names.push_back(tensor_name);
+      full_tensors.push_back(restored_tensor);
+      full_tensor_bytes += restored_tensor->TotalBytes();
+      continue;
+    }
     auto op =
         new RestoreOp{context, i, tensor_name, shape_and_slice, prefix_string};
     if (op->should_run_in_pool(&default_reader)) {
@@ -373,7 +438,8 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     // Schedule any threaded operations first, skipping thread pool creation if
     // we don't have any expensive operations.
     std::unique_ptr<thread::ThreadPool> reader_pool;
-    if (!pool_restore_ops.empty()) {
+    if (!pool_restore_ops.empty() ||
+        full_tensor_bytes > kLargeRestoreBytesThreshold) {
       reader_pool.reset(
           new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
       for (auto& op : pool_restore_ops) {
@@ -381,6 +447,9 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
       }
     }
 
+    TF_RETURN_IF_ERROR(default_reader.LookupMany(
+        full_tensor_names, full_tensors, reader_pool.get()));
+
     // Read small tensors from the op thread
     for (auto& op : direct_restore_ops) {
       TF_RETURN_IF_ERROR(op->run(&default_reader));
@@ -20,16 +20,22 @@ limitations under the License.
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
+#include "tensorflow/core/util/tensor_bundle/async_bundle_writer.h"
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 
@@ -37,11 +43,13 @@ namespace tensorflow {
 
 namespace {
 
-// Shared validations of the inputs to the SaveV2 and RestoreV2 ops.
+// Shared validations of the inputs to the SaveV2 and RestoreV2 ops.  The
+// tensors to save follow the first "num_fixed_inputs" inputs (prefix, tensor
+// names and shape_and_slices by default).
 void ValidateInputs(bool is_save_op, OpKernelContext* context,
                     const Tensor& prefix, const Tensor& tensor_names,
-                    const Tensor& shape_and_slices) {
-  const int kFixedInputs = 3;  // Prefix, tensor names, shape_and_slices.
+                    const Tensor& shape_and_slices,
+                    int num_fixed_inputs = 3) {
   const int num_tensors = static_cast<int>(tensor_names.NumElements());
   OP_REQUIRES(
       context, prefix.NumElements() == 1,
@@ -62,22 +70,24 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
                                       tensor_names.NumElements(), " vs. ",
                                       shape_and_slices.NumElements()));
   OP_REQUIRES(context,
-              FastBoundsCheck(tensor_names.NumElements() + kFixedInputs,
+              FastBoundsCheck(tensor_names.NumElements() + num_fixed_inputs,
                               std::numeric_limits<int>::max()),
               errors::InvalidArgument("Too many inputs to the op"));
   OP_REQUIRES(
       context, shape_and_slices.NumElements() == num_tensors,
       errors::InvalidArgument("Expected ", num_tensors,
                               " elements in shapes_and_slices, but got ",
-                              context->input(2).NumElements()));
+                              shape_and_slices.NumElements()));
   if (is_save_op) {
-    OP_REQUIRES(context, context->num_inputs() == num_tensors + kFixedInputs,
+    OP_REQUIRES(context,
+                context->num_inputs() == num_tensors + num_fixed_inputs,
                 errors::InvalidArgument(
                     "Got ", num_tensors, " tensor names but ",
-                    context->num_inputs() - kFixedInputs, " tensors."));
-    OP_REQUIRES(context, context->num_inputs() == num_tensors + kFixedInputs,
+                    context->num_inputs() - num_fixed_inputs, " tensors."));
+    OP_REQUIRES(context,
+                context->num_inputs() == num_tensors + num_fixed_inputs,
                 errors::InvalidArgument(
-                    "Expected a total of ", num_tensors + kFixedInputs,
+                    "Expected a total of ", num_tensors + num_fixed_inputs,
                     " inputs as input #1 (which is a string "
                     "tensor of saved names) contains ",
                     num_tensors, " names, but received ", context->num_inputs(),
@@ -85,12 +95,47 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
   }
 }
 
+// Parses the "shape_and_slice" spec of a tensor to save, and checks that it
+// matches the shape of "tensor".
+Status ParseSaveSliceSpec(const string& shape_spec, const Tensor& tensor,
+                          TensorShape* shape, TensorSlice* slice) {
+  TensorShape slice_shape;
+  *slice = TensorSlice(tensor.dims());
+  TF_RETURN_IF_ERROR(
+      checkpoint::ParseShapeAndSlice(shape_spec, shape, slice, &slice_shape));
+  if (!slice_shape.IsSameSize(tensor.shape())) {
+    return errors::InvalidArgument(
+        "Slice in shape_and_slice "
+        "specification does not match the "
+        "shape of the tensor to  save: ",
+        shape_spec, ", tensor: ", tensor.shape().DebugString());
+  }
+  return Status::OK();
+}
+
+// Options of the bundles written by the save ops.
+Status ReadWriterOptions(BundleWriter::Options* options) {
+  // Setting TF_CHECKPOINT_DATA_ALIGNMENT to kMappableDataAlignment writes
+  // checkpoints that can be restored without copies (see LookupMapped()).
+  int64 data_alignment = options->data_alignment;
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_CHECKPOINT_DATA_ALIGNMENT",
+                                         data_alignment, &data_alignment));
+  if (data_alignment < 1) {
+    return errors::InvalidArgument(
+        "TF_CHECKPOINT_DATA_ALIGNMENT must be positive, got ", data_alignment);
+  }
+  options->data_alignment = static_cast<int>(data_alignment);
+  return Status::OK();
+}
+
 }  // namespace
 
 // Saves a list of named tensors using the tensor bundle library.
 class SaveV2 : public OpKernel {
  public:
-  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {}
+  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, ReadWriterOptions(&writer_options_));
+  }
 
   void Compute(OpKernelContext* context) override {
     const Tensor& prefix = context->input(0);
@@ -105,7 +150,10 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<string>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<string>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
+    // Don't race with an asynchronous save of the same prefix.
+    OP_REQUIRES_OK(context, AsyncBundleWriter::WaitGlobal(prefix_string));
+
+    BundleWriter writer(Env::Default(), prefix_string, writer_options_);
     OP_REQUIRES_OK(context, writer.status());
     VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
 
@@ -114,19 +162,11 @@ class SaveV2 : public OpKernel {
       const Tensor& tensor = context->input(i + kFixedInputs);
 
       if (!shape_and_slices_flat(i).empty()) {
-        const string& shape_spec = shape_and_slices_flat(i);
         TensorShape shape;
-        TensorSlice slice(tensor.dims());
-        TensorShape slice_shape;
-
-        OP_REQUIRES_OK(context, checkpoint::ParseShapeAndSlice(
-                                    shape_spec, &shape, &slice, &slice_shape));
-        OP_REQUIRES(context, slice_shape.IsSameSize(tensor.shape()),
-                    errors::InvalidArgument("Slice in shape_and_slice "
-                                            "specification does not match the "
-                                            "shape of the tensor to  save: ",
-                                            shape_spec, ", tensor: ",
-                                            tensor.shape().DebugString()));
+        TensorSlice slice;
+        OP_REQUIRES_OK(context,
+                       ParseSaveSliceSpec(shape_and_slices_flat(i), tensor,
+                                          &shape, &slice));
 
         OP_REQUIRES_OK(context,
                        writer.AddSlice(tensor_name, shape, slice, tensor));
@@ -136,9 +176,153 @@ class SaveV2 : public OpKernel {
     }
     OP_REQUIRES_OK(context, writer.Finish());
   }
+
+ private:
+  BundleWriter::Options writer_options_;
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
 
+// Saves a list of named tensors like SaveV2, but only snapshots them into host
+// memory and leaves the writing to the background AsyncBundleWriter.
+class AsyncSaveV2 : public OpKernel {
+ public:
+  explicit AsyncSaveV2(OpKernelConstruction* context) : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& prefix = context->input(0);
+    const Tensor& tensor_names = context->input(1);
+    const Tensor& shape_and_slices = context->input(2);
+    ValidateInputs(true /* is save op */, context, prefix, tensor_names,
+                   shape_and_slices);
+    if (!context->status().ok()) return;
+
+    const int kFixedInputs = 3;  // Prefix, tensor names, shape_and_slices.
+    const int num_tensors = static_cast<int>(tensor_names.NumElements());
+    const string& prefix_string = prefix.scalar<string>()();
+    const auto& tensor_names_flat = tensor_names.flat<string>();
+    const auto& shape_and_slices_flat = shape_and_slices.flat<string>();
+
+    std::vector<AsyncBundleWriter::Entry> entries(num_tensors);
+    int64 bytes = 0;
+    for (int i = 0; i < num_tensors; ++i) {
+      AsyncBundleWriter::Entry& entry = entries[i];
+      const Tensor& tensor = context->input(i + kFixedInputs);
+      entry.key = tensor_names_flat(i);
+      if (!shape_and_slices_flat(i).empty()) {
+        entry.is_slice = true;
+        OP_REQUIRES_OK(context,
+                       ParseSaveSliceSpec(shape_and_slices_flat(i), tensor,
+                                          &entry.full_shape,
+                                          &entry.slice_spec));
+      }
+      bytes += tensor.TotalBytes();
+    }
+    // The snapshots are only taken once they fit in the budget of the writer.
+    OP_REQUIRES_OK(
+        context,
+        AsyncBundleWriter::Global()->Schedule(
+            prefix_string, bytes,
+            [context, &entries](std::vector<AsyncBundleWriter::Entry>* out) {
+              for (int i = 0; i < entries.size(); ++i) {
+                // The inputs may alias variables that the following steps
+                // update in place, so the snapshot can't share their buffers.
+                entries[i].tensor =
+                    tensor::DeepCopy(context->input(i + kFixedInputs));
+              }
+              *out = std::move(entries);
+              return Status::OK();
+            }));
+  }
+};
+REGISTER_KERNEL_BUILDER(Name("AsyncSaveV2").Device(DEVICE_CPU), AsyncSaveV2);
+
+// Saves a list of named tensors like SaveV2, but as a delta of the bundle
+// "parent_prefix": only the rows of the tensors modified by sparse updates
+// since they were saved in it are written (see delta_bundle.h).  Writes a full
+// bundle if "parent_prefix" is empty.
+class SaveDeltaV2 : public OpKernel {
+ public:
+  explicit SaveDeltaV2(OpKernelConstruction* context) : OpKernel(context) {
+    // The sparse updates only record the rows they modify from now on, so the
+    // first save must be a full one.
+    DirtyRowTracker::Global()->Enable();
+    OP_REQUIRES_OK(context, ReadWriterOptions(&writer_options_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& prefix = context->input(0);
+    const Tensor& parent_prefix = context->input(1);
+    const Tensor& tensor_names = context->input(2);
+    const Tensor& shape_and_slices = context->input(3);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(parent_prefix.shape()),
+                errors::InvalidArgument(
+                    "Input parent_prefix should be a scalar tensor, but got ",
+                    parent_prefix.shape().DebugString()));
+    // Prefix, parent prefix, tensor names, shape_and_slices.
+    const int kFixedInputs = 4;
+    ValidateInputs(true /* is save op */, context, prefix, tensor_names,
+                   shape_and_slices, kFixedInputs);
+    if (!context->status().ok()) return;
+
+    const int num_tensors = static_cast<int>(tensor_names.NumElements());
+    const string& prefix_string = prefix.scalar<string>()();
+    const string& parent_string = parent_prefix.scalar<string>()();
+    const auto& tensor_names_flat = tensor_names.flat<string>();
+    const auto& shape_and_slices_flat = shape_and_slices.flat<string>();
+
+    OP_REQUIRES_OK(context, AsyncBundleWriter::WaitGlobal(prefix_string));
+
+    BundleWriter::Options options = writer_options_;
+    options.delta_parent = parent_string;
+    BundleWriter writer(Env::Default(), prefix_string, options);
+    OP_REQUIRES_OK(context, writer.status());
+    VLOG(1) << "BundleWriter, prefix_string: " << prefix_string
+            << ", delta_parent: " << parent_string;
+
+    DirtyRowTracker* tracker = DirtyRowTracker::Global();
+    // Until committed, the rows taken are recorded as modified again if the
+    // save fails.
+    std::vector<DirtyRowTracker::TakenRows> taken(num_tensors);
+    std::vector<int64> rows;
+    for (int i = 0; i < num_tensors; ++i) {
+      const string& tensor_name = tensor_names_flat(i);
+      const string& shape_and_slice = shape_and_slices_flat(i);
+      const Tensor& tensor = context->input(i + kFixedInputs);
+
+      TensorShape shape = tensor.shape();
+      TensorSlice slice(tensor.dims());
+      if (!shape_and_slice.empty()) {
+        OP_REQUIRES_OK(context, ParseSaveSliceSpec(shape_and_slice, tensor,
+                                                   &shape, &slice));
+      }
+      // Taken before the tensor is read, so that the rows written concurrently
+      // are saved next time.
+      const bool rows_known = tracker->TakeDirtyRows(
+          strings::StrCat(tensor_name, shape_and_slice), tensor, &rows,
+          &taken[i]);
+
+      if (parent_string.empty() || !rows_known) {
+        // Saved in full, superseding the older bundles of the chain.
+        if (shape_and_slice.empty()) {
+          OP_REQUIRES_OK(context, writer.Add(tensor_name, tensor));
+        } else {
+          OP_REQUIRES_OK(context,
+                         writer.AddSlice(tensor_name, shape, slice, tensor));
+        }
+        continue;
+      }
+      OP_REQUIRES_OK(context,
+                     AddDeltaRows(&writer, tensor_name, slice, tensor, rows));
+    }
+    OP_REQUIRES_OK(context, writer.Finish());
+    tracker->Commit(&taken);
+  }
+
+ private:
+  BundleWriter::Options writer_options_;
+};
+REGISTER_KERNEL_BUILDER(Name("SaveDeltaV2").Device(DEVICE_CPU), SaveDeltaV2);
+
 // Restores a list of named tensors from a tensor bundle (V2 checkpoint format).
 class RestoreV2 : public OpKernel {
  public:
@@ -158,6 +342,7 @@ class RestoreV2 : public OpKernel {
                    shape_and_slices);
 
     const string& prefix_string = prefix.scalar<string>()();
+    OP_REQUIRES_OK(context, AsyncBundleWriter::WaitGlobal(prefix_string));
 
     // Intention: we plan to use the RestoreV2 op as a backward-compatible
     // reader as we upgrade to the V2 format.  This allows transparent upgrade.
@@ -216,6 +401,10 @@ class MergeV2Checkpoints : public OpKernel {
         gtl::ArraySlice<string>(checkpoint_prefixes.flat<string>());
     Env* env = Env::Default();
     const string& merged_prefix = destination_prefix.scalar<string>()();
+    // The shards may still be written by AsyncSaveV2.
+    for (const string& input_prefix : input_prefixes) {
+      OP_REQUIRES_OK(context, AsyncBundleWriter::WaitGlobal(input_prefix));
+    }
     OP_REQUIRES_OK(
         context, tensorflow::MergeBundles(env, input_prefixes, merged_prefix));
 
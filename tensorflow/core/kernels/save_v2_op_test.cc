@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
@@ -28,6 +29,9 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/async_bundle_writer.h"
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 namespace tensorflow {
@@ -339,5 +343,238 @@ TEST_F(SaveV2OpTest, Simple) {
   }
 }
 
+class AsyncSaveV2OpTest : public OpsTestBase {
+ protected:
+  void MakeOp() {
+    TF_ASSERT_OK(NodeDefBuilder("myop", "AsyncSaveV2")
+                     .Input(FakeInput())                      // prefix
+                     .Input(FakeInput())                      // tensor_names
+                     .Input(FakeInput())                      // shape_and_slices
+                     .Input(FakeInput({DT_INT32, DT_FLOAT}))  // tensors
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+TEST_F(AsyncSaveV2OpTest, WritesSnapshot) {
+  const string prefix = io::JoinPath(testing::TmpDir(), "tensor_async");
+  const string tensornames[] = {"tensor_int", "tensor_float_slice"};
+
+  MakeOp();
+  AddInput<string>(TensorShape({}),
+                   [&prefix](int x) -> string { return prefix; });
+  AddInput<string>(TensorShape({2}),
+                   [&tensornames](int x) -> string { return tensornames[x]; });
+  AddInput<string>(TensorShape({2}), [](int x) -> string {
+    return x == 0 ? "" : "4 2 0,2:-";
+  });
+  AddInput<int32>(TensorShape({10}), [](int x) -> int32 { return x + 1; });
+  AddInput<float>(TensorShape({2, 2}),
+                  [](int x) -> float { return static_cast<float>(x) / 10; });
+  TF_ASSERT_OK(RunOpKernel());
+
+  // Mutating the inputs after the op returned must not change the checkpoint.
+  mutable_input(3).tensor->flat<int32>().setZero();
+
+  TF_ASSERT_OK(AsyncBundleWriter::WaitGlobal(prefix));
+  BundleReader reader(Env::Default(), prefix);
+  TF_ASSERT_OK(reader.status());
+
+  Tensor val;
+  TF_EXPECT_OK(reader.Lookup("tensor_int", &val));
+  EXPECT_EQ(DT_INT32, val.dtype());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i + 1, val.flat<int32>()(i));
+  }
+
+  TensorShape shape;
+  TF_EXPECT_OK(reader.LookupTensorShape("tensor_float_slice", &shape));
+  EXPECT_TRUE(shape.IsSameSize(TensorShape({4, 2})));
+}
+
+class SaveDeltaV2OpTest : public OpsTestBase {
+ protected:
+  void MakeOp(int num_tensors = 1) {
+    TF_ASSERT_OK(NodeDefBuilder("myop", "SaveDeltaV2")
+                     .Input(FakeInput())  // prefix
+                     .Input(FakeInput())  // parent_prefix
+                     .Input(FakeInput())  // tensor_names
+                     .Input(FakeInput())  // shape_and_slices
+                     .Input(FakeInput(DataTypeVector(num_tensors, DT_FLOAT)))
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+};
+
+TEST_F(SaveDeltaV2OpTest, SavesModifiedRows) {
+  const string base = io::JoinPath(testing::TmpDir(), "tensor_delta_base");
+  const string delta = io::JoinPath(testing::TmpDir(), "tensor_delta_1");
+
+  MakeOp();
+  AddInput<string>(TensorShape({}), [&base](int x) -> string { return base; });
+  AddInput<string>(TensorShape({}), [](int x) -> string { return ""; });
+  AddInput<string>(TensorShape({1}), [](int x) -> string { return "emb"; });
+  AddInput<string>(TensorShape({1}), [](int x) -> string { return ""; });
+  AddInput<float>(TensorShape({4, 2}),
+                  [](int x) -> float { return static_cast<float>(x); });
+  TF_ASSERT_OK(RunOpKernel());
+  {
+    BundleReader reader(Env::Default(), base);
+    TF_ASSERT_OK(reader.status());
+    EXPECT_TRUE(reader.delta_parent().empty());
+    EXPECT_TRUE(reader.Contains("emb"));
+  }
+
+  // A sparse update of row 2, then a delta of the full bundle.  The rows
+  // modified before the variable was tracked are not known, so it is saved in
+  // full.
+  Tensor* emb = mutable_input(4).tensor;
+  emb->matrix<float>()(2, 0) = -4;
+  DirtyRowTracker::Global()->RecordRows(*emb, test::AsTensor<int64>({2}));
+  mutable_input(0).tensor->scalar<string>()() = delta;
+  mutable_input(1).tensor->scalar<string>()() = base;
+  TF_ASSERT_OK(RunOpKernel());
+  {
+    BundleReader reader(Env::Default(), delta);
+    TF_ASSERT_OK(reader.status());
+    EXPECT_EQ(base, reader.delta_parent());
+    EXPECT_TRUE(reader.Contains("emb"));
+  }
+
+  // A sparse update of row 3, then a delta of the previous delta.
+  const string delta2 = io::JoinPath(testing::TmpDir(), "tensor_delta_2");
+  emb->matrix<float>()(3, 1) = -7;
+  DirtyRowTracker::Global()->RecordRows(*emb, test::AsTensor<int64>({3}));
+  mutable_input(0).tensor->scalar<string>()() = delta2;
+  mutable_input(1).tensor->scalar<string>()() = delta;
+  TF_ASSERT_OK(RunOpKernel());
+  {
+    BundleReader reader(Env::Default(), delta2);
+    TF_ASSERT_OK(reader.status());
+    EXPECT_FALSE(reader.Contains("emb"));
+    Tensor ids;
+    TF_ASSERT_OK(reader.Lookup(DeltaRowIdsKey("emb", 0), &ids));
+    test::ExpectTensorEqual<int64>(test::AsTensor<int64>({3}), ids);
+  }
+
+  DeltaBundleReader reader(Env::Default(), delta2);
+  TF_ASSERT_OK(reader.status());
+  Tensor val(DT_FLOAT, TensorShape({4, 2}));
+  TF_ASSERT_OK(reader.Lookup("emb", &val));
+  test::ExpectTensorEqual<float>(*emb, val);
+}
+
+TEST_F(SaveDeltaV2OpTest, SavesDenselyUpdatedVariablesInFull) {
+  const string base = io::JoinPath(testing::TmpDir(), "tensor_dense_base");
+  const string delta = io::JoinPath(testing::TmpDir(), "tensor_dense_1");
+
+  MakeOp();
+  AddInput<string>(TensorShape({}), [&base](int x) -> string { return base; });
+  AddInput<string>(TensorShape({}), [](int x) -> string { return ""; });
+  AddInput<string>(TensorShape({1}), [](int x) -> string { return "v"; });
+  AddInput<string>(TensorShape({1}), [](int x) -> string { return ""; });
+  AddInput<float>(TensorShape({4}),
+                  [](int x) -> float { return static_cast<float>(x); });
+  Tensor* v = mutable_input(4).tensor;
+  DirtyRowTracker::Global()->RecordRows(*v, test::AsTensor<int64>({0}));
+  TF_ASSERT_OK(RunOpKernel());
+
+  // A dense update, e.g. by Assign or ApplyAdam.
+  v->flat<float>().setConstant(5);
+  { ScopedDirtyRowRecorder dirty_rows({v}); }
+  mutable_input(0).tensor->scalar<string>()() = delta;
+  mutable_input(1).tensor->scalar<string>()() = base;
+  TF_ASSERT_OK(RunOpKernel());
+
+  DeltaBundleReader reader(Env::Default(), delta);
+  TF_ASSERT_OK(reader.status());
+  Tensor val(DT_FLOAT, TensorShape({4}));
+  TF_ASSERT_OK(reader.Lookup("v", &val));
+  test::ExpectTensorEqual<float>(*v, val);
+}
+
+TEST_F(SaveDeltaV2OpTest, SavesVariablesUpdatedOnOtherDevicesInFull) {
+  const string base = io::JoinPath(testing::TmpDir(), "tensor_device_base");
+  const string delta = io::JoinPath(testing::TmpDir(), "tensor_device_1");
+
+  MakeOp();
+  AddInput<string>(TensorShape({}), [&base](int x) -> string { return base; });
+  AddInput<string>(TensorShape({}), [](int x) -> string { return ""; });
+  AddInput<string>(TensorShape({1}), [](int x) -> string { return "emb"; });
+  AddInput<string>(TensorShape({1}), [](int x) -> string { return ""; });
+  AddInput<float>(TensorShape({4, 2}),
+                  [](int x) -> float { return static_cast<float>(x); });
+  Tensor* emb = mutable_input(4).tensor;
+  DirtyRowTracker::Global()->RecordRows(*emb, test::AsTensor<int64>({0}));
+  TF_ASSERT_OK(RunOpKernel());
+
+  // A sparse update of row 2 whose indices are not on the host, e.g. by
+  // ScatterUpdate on a GPU.
+  emb->matrix<float>()(2, 0) = -4;
+  const Tensor indices = test::AsTensor<int64>({2});
+  {
+    ScopedDirtyRowRecorder dirty_rows({emb}, indices,
+                                      /*indices_on_host=*/false);
+  }
+  mutable_input(0).tensor->scalar<string>()() = delta;
+  mutable_input(1).tensor->scalar<string>()() = base;
+  TF_ASSERT_OK(RunOpKernel());
+  {
+    BundleReader reader(Env::Default(), delta);
+    TF_ASSERT_OK(reader.status());
+    EXPECT_TRUE(reader.Contains("emb"));
+  }
+
+  DeltaBundleReader reader(Env::Default(), delta);
+  TF_ASSERT_OK(reader.status());
+  Tensor val(DT_FLOAT, TensorShape({4, 2}));
+  TF_ASSERT_OK(reader.Lookup("emb", &val));
+  test::ExpectTensorEqual<float>(*emb, val);
+}
+
+TEST_F(SaveDeltaV2OpTest, FailedSaveKeepsModifiedRows) {
+  const string base = io::JoinPath(testing::TmpDir(), "tensor_failed_base");
+  const string delta = io::JoinPath(testing::TmpDir(), "tensor_failed_1");
+
+  MakeOp(2);
+  AddInput<string>(TensorShape({}), [&base](int x) -> string { return base; });
+  AddInput<string>(TensorShape({}), [](int x) -> string { return ""; });
+  AddInput<string>(TensorShape({2}),
+                   [](int x) -> string { return x == 0 ? "w" : "x"; });
+  AddInput<string>(TensorShape({2}), [](int x) -> string { return ""; });
+  AddInput<float>(TensorShape({4, 2}),
+                  [](int x) -> float { return static_cast<float>(x); });
+  AddInput<float>(TensorShape({2}), [](int x) -> float { return 0; });
+  Tensor* w = mutable_input(4).tensor;
+  DirtyRowTracker::Global()->RecordRows(*w, test::AsTensor<int64>({0}));
+  TF_ASSERT_OK(RunOpKernel());
+
+  // Fails once the rows of "w" are taken, on the slice spec of "x".
+  w->matrix<float>()(1, 0) = -2;
+  DirtyRowTracker::Global()->RecordRows(*w, test::AsTensor<int64>({1}));
+  mutable_input(0).tensor->scalar<string>()() =
+      io::JoinPath(testing::TmpDir(), "tensor_failed_delta");
+  mutable_input(1).tensor->scalar<string>()() = base;
+  mutable_input(3).tensor->flat<string>()(1) = "invalid";
+  EXPECT_FALSE(RunOpKernel().ok());
+
+  // Row 1 is saved by the next delta.
+  mutable_input(0).tensor->scalar<string>()() = delta;
+  mutable_input(3).tensor->flat<string>()(1) = "";
+  TF_ASSERT_OK(RunOpKernel());
+  {
+    BundleReader reader(Env::Default(), delta);
+    TF_ASSERT_OK(reader.status());
+    Tensor ids;
+    TF_ASSERT_OK(reader.Lookup(DeltaRowIdsKey("w", 0), &ids));
+    test::ExpectTensorEqual<int64>(test::AsTensor<int64>({1}), ids);
+  }
+  DeltaBundleReader reader(Env::Default(), delta);
+  TF_ASSERT_OK(reader.status());
+  Tensor val(DT_FLOAT, TensorShape({4, 2}));
+  TF_ASSERT_OK(reader.Lookup("w", &val));
+  test::ExpectTensorEqual<float>(*w, val);
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
 #include "tensorflow/core/util/util.h"
 
 #ifdef TENSORFLOW_USE_SYCL
@@ -199,6 +200,12 @@ class ScatterNdUpdateOp : public OpKernel {
       }
     }
 
+    // The rows of variables are not tracked individually, as the indices may
+    // not be on the host: all of them are marked as modified.
+    std::unique_ptr<ScopedDirtyRowRecorder> dirty_rows;
+    if (dtype_ == DT_RESOURCE || IsRefType(c->input_dtype(0))) {
+      dirty_rows.reset(new ScopedDirtyRowRecorder({&params}));
+    }
     OP_REQUIRES_OK(
         c, functor::DoScatterNd<Device, T, Index, op>(
                c, indices, updates, params_shape, &params, false /*allocate*/));
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/scatter_functor.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
 #include "tensorflow/core/util/util.h"
 
 #ifdef TENSORFLOW_USE_SYCL
@@ -97,6 +98,8 @@ class ScatterUpdateOp : public OpKernel {
   void DoCompute(OpKernelContext* c) {
     Tensor params = c->mutable_input(0, use_exclusive_lock_);
     const Tensor& indices = c->input(1);
+    ScopedDirtyRowRecorder dirty_rows(
+        {&params}, indices, std::is_same<Device, CPUDevice>::value);
     const Tensor& updates = c->input(2);
     DoValidationChecking(c, params, indices, updates);
     if (!c->status().ok()) return;
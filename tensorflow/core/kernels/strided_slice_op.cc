@@ -38,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/platform/prefetch.h"
 #include "tensorflow/core/util/strided_slice_op.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
 
 namespace tensorflow {
 namespace {
@@ -321,6 +322,7 @@ class StridedSliceAssignOp : public OpKernel {
       tmp = context->mutable_input(0, true);
       old_lhs = &tmp;
     }
+    ScopedDirtyRowRecorder dirty_rows({old_lhs});
 
     OP_REQUIRES_OK(
         context, ValidateStridedSliceOp(
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/training_op_helpers.h"
 #include "tensorflow/core/kernels/training_ops.h"
 #include "tensorflow/core/kernels/variable_ops.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
 
 #ifdef TENSORFLOW_USE_SYCL
 #include "tensorflow/core/common_runtime/sycl/sycl_util.h"
@@ -432,6 +433,7 @@ class ApplyGradientDescentOp : public OpKernel {
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, false, &var));
+    ScopedDirtyRowRecorder dirty_rows({&var});
 
     OP_REQUIRES(
         ctx, var.IsInitialized(),
@@ -473,6 +475,7 @@ class ApplyGradientDescentOp<SYCLDevice, T> : public OpKernel {
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<SYCLDevice, T>(
                             ctx, 0, use_exclusive_lock_, false, &var));
+    ScopedDirtyRowRecorder dirty_rows({&var});
 
     OP_REQUIRES(
         ctx, var.IsInitialized(),
@@ -648,6 +651,7 @@ class ApplyAdadeltaOp : public OpKernel {
     Tensor accum_update;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 2, use_exclusive_lock_, false, &accum_update));
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum, &accum_update});
 
     const Tensor& lr = ctx->input(3);
     const Tensor& rho = ctx->input(4);
@@ -776,6 +780,8 @@ class SparseApplyAdadeltaOp : public OpKernel {
                                         epsilon.shape().DebugString()));
     const Tensor& grad = ctx->input(6);
     const Tensor& indices = ctx->input(7);
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum_grad, &accum_update},
+                                      indices);
     OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
                 errors::InvalidArgument("indices must be one-dimensional"));
 
@@ -874,6 +880,7 @@ class ApplyProximalGradientDescentOp : public OpKernel {
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 0, use_exclusive_lock_, false, &var));
+    ScopedDirtyRowRecorder dirty_rows({&var});
 
     OP_REQUIRES(
         ctx, var.IsInitialized(),
@@ -963,6 +970,7 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
 
     const Tensor& grad = ctx->input(4);
     const Tensor& indices = ctx->input(5);
+    ScopedDirtyRowRecorder dirty_rows({&var}, indices);
     OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
                 errors::InvalidArgument("indices must be one-dimensional"));
 
@@ -1091,6 +1099,7 @@ class ApplyAdagradOp : public OpKernel {
     Tensor accum;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 1, use_exclusive_lock_, false, &accum));
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -1184,6 +1193,7 @@ class ApplyProximalAdagradOp : public OpKernel {
     Tensor accum;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 1, use_exclusive_lock_, false, &accum));
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -1308,6 +1318,7 @@ class SparseApplyAdagradOp : public OpKernel {
                                         lr.shape().DebugString()));
     const Tensor& grad = ctx->input(3);
     const Tensor& indices = ctx->input(4);
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum}, indices);
     OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
                 errors::InvalidArgument("indices must be one-dimensional"));
 
@@ -1465,6 +1476,7 @@ class SparseApplyProximalAdagradOp : public OpKernel {
 
     const Tensor& grad = ctx->input(5);
     const Tensor& indices = ctx->input(6);
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum}, indices);
     OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
                 errors::InvalidArgument("indices must be one-dimensional"));
 
@@ -1603,6 +1615,8 @@ class ApplyAdagradDAOp : public OpKernel {
     OP_REQUIRES_OK(
         ctx, GetInputTensorFromVariable<Device, T>(
                  ctx, 2, use_exclusive_lock_, false, &gradient_squared_accum));
+    ScopedDirtyRowRecorder dirty_rows(
+        {&var, &gradient_accum, &gradient_squared_accum});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -1732,6 +1746,8 @@ class SparseApplyAdagradDAOp : public OpKernel {
 
     const Tensor& grad = ctx->input(3);
     const Tensor& indices = ctx->input(4);
+    ScopedDirtyRowRecorder dirty_rows(
+        {&var, &gradient_accum, &gradient_squared_accum}, indices);
     OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
                 errors::InvalidArgument("indices must be one-dimensional"));
 
@@ -1901,6 +1917,7 @@ class ApplyFtrlOp : public OpKernel {
     Tensor linear;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 2, use_exclusive_lock_, false, &linear));
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum, &linear});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -2079,6 +2096,7 @@ class SparseApplyFtrlOp : public OpKernel {
 
     const Tensor& grad = ctx->input(3);
     const Tensor& indices = ctx->input(4);
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum, &linear}, indices);
     OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
                 errors::InvalidArgument("indices must be one-dimensional"));
 
@@ -2324,6 +2342,7 @@ class ApplyMomentumOp : public OpKernel {
     Tensor accum;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 1, use_exclusive_lock_, false, &accum));
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -2447,6 +2466,7 @@ class SparseApplyMomentumOp : public OpKernel {
                                         lr.shape().DebugString()));
     const Tensor& grad = ctx->input(3);
     const Tensor& indices = ctx->input(4);
+    ScopedDirtyRowRecorder dirty_rows({&var, &accum}, indices);
     OP_REQUIRES(ctx, TensorShapeUtils::IsVector(indices.shape()),
                 errors::InvalidArgument("indices must be one-dimensional"));
 
@@ -2546,6 +2566,7 @@ class ApplyAdamOp : public OpKernel {
     Tensor v;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 2, use_exclusive_lock_, false, &v));
+    ScopedDirtyRowRecorder dirty_rows({&var, &m, &v});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -2636,6 +2657,7 @@ class ApplyAdamOp<SYCLDevice, T> : public OpKernel {
     Tensor v;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<SYCLDevice, T>(
                             ctx, 2, use_exclusive_lock_, false, &v));
+    ScopedDirtyRowRecorder dirty_rows({&var, &m, &v});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -2806,6 +2828,7 @@ class ApplyAdaMaxOp : public OpKernel {
     Tensor v;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 2, use_exclusive_lock_, false, &v));
+    ScopedDirtyRowRecorder dirty_rows({&var, &m, &v});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -2934,6 +2957,7 @@ class ApplyRMSPropOp : public OpKernel {
     Tensor mom;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 2, use_exclusive_lock_, false, &mom));
+    ScopedDirtyRowRecorder dirty_rows({&var, &ms, &mom});
 
     OP_REQUIRES(
         ctx, var.IsInitialized(),
@@ -3019,6 +3043,7 @@ class ApplyCenteredRMSPropOp : public OpKernel {
     Tensor mom;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 3, use_exclusive_lock_, false, &mom));
+    ScopedDirtyRowRecorder dirty_rows({&var, &mg, &ms, &mom});
 
     OP_REQUIRES(
         ctx, var.IsInitialized(),
@@ -3195,6 +3220,7 @@ class SparseApplyRMSPropOp : public OpKernel {
     const Tensor& epsilon = ctx->input(6);
     const Tensor& grad = ctx->input(7);
     const Tensor& indices = ctx->input(8);
+    ScopedDirtyRowRecorder dirty_rows({&var, &ms, &mom}, indices);
 
     OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(lr.shape()),
                 errors::InvalidArgument("lr is not a scalar: ",
@@ -3327,6 +3353,7 @@ class SparseApplyCenteredRMSPropOp : public OpKernel {
     const Tensor& epsilon = ctx->input(7);
     const Tensor& grad = ctx->input(8);
     const Tensor& indices = ctx->input(9);
+    ScopedDirtyRowRecorder dirty_rows({&var, &mg, &ms, &mom}, indices);
 
     OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(lr.shape()),
                 errors::InvalidArgument("lr is not a scalar: ",
@@ -3471,6 +3498,7 @@ class ApplyAddSignOp : public OpKernel {
     Tensor m;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 1, use_exclusive_lock_, false, &m));
+    ScopedDirtyRowRecorder dirty_rows({&var, &m});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -3577,6 +3605,7 @@ class ApplyPowerSignOp : public OpKernel {
     Tensor m;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
                             ctx, 1, use_exclusive_lock_, false, &m));
+    ScopedDirtyRowRecorder dirty_rows({&var, &m});
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -0,0 +1,193 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/async_bundle_writer.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+AsyncBundleWriter::AsyncBundleWriter(Env* env, const Options& options)
+    : env_(env),
+      options_(options),
+      thread_pool_(new thread::ThreadPool(env, "async_bundle_writer",
+                                          std::max(1, options.num_threads))) {}
+
+AsyncBundleWriter::~AsyncBundleWriter() {
+  Status s = WaitAll();
+  if (!s.ok()) {
+    LOG(ERROR) << "Asynchronous checkpoint write failed: " << s;
+  }
+}
+
+namespace {
+
+// Set once the process-wide writer is created.
+std::atomic<AsyncBundleWriter*> global_writer{nullptr};
+
+}  // namespace
+
+/* static */ AsyncBundleWriter* AsyncBundleWriter::Global() {
+  static AsyncBundleWriter* global = [] {
+    Options options;
+    int64 num_threads = options.num_threads;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_ASYNC_CHECKPOINT_THREADS",
+                                    num_threads, &num_threads));
+    options.num_threads = static_cast<int>(num_threads);
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_ASYNC_CHECKPOINT_MAX_PENDING_BYTES",
+                                    options.max_pending_bytes,
+                                    &options.max_pending_bytes));
+    int64 data_alignment = options.writer_options.data_alignment;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_CHECKPOINT_DATA_ALIGNMENT",
+                                    data_alignment, &data_alignment));
+    options.writer_options.data_alignment =
+        std::max(1, static_cast<int>(data_alignment));
+    AsyncBundleWriter* writer = new AsyncBundleWriter(Env::Default(), options);
+    global_writer.store(writer);
+    return writer;
+  }();
+  return global;
+}
+
+/* static */ Status AsyncBundleWriter::WaitGlobal(const string& prefix) {
+  AsyncBundleWriter* writer = global_writer.load();
+  if (writer == nullptr) return Status::OK();
+  return writer->Wait(prefix);
+}
+
+Status AsyncBundleWriter::Schedule(const string& prefix,
+                                   std::vector<Entry> entries) {
+  int64 bytes = 0;
+  for (const Entry& entry : entries) {
+    bytes += entry.tensor.TotalBytes();
+  }
+  return Schedule(prefix, bytes, [&entries](std::vector<Entry>* snapshot) {
+    *snapshot = std::move(entries);
+    return Status::OK();
+  });
+}
+
+Status AsyncBundleWriter::Schedule(
+    const string& prefix, int64 bytes,
+    const std::function<Status(std::vector<Entry>* entries)>& snapshot) {
+  {
+    mutex_lock l(mu_);
+    // Never write the same files from two threads, and apply backpressure
+    // when too many snapshots are held in host memory.
+    while (pending_.count(prefix) > 0 ||
+           (pending_bytes_ > 0 &&
+            pending_bytes_ + bytes > options_.max_pending_bytes)) {
+      cond_.wait(l);
+    }
+    TF_RETURN_IF_ERROR(TakeFailuresLocked());
+    pending_bytes_ += bytes;
+    ++pending_[prefix];
+  }
+
+  std::vector<Entry> entries;
+  Status s = snapshot(&entries);
+  if (!s.ok()) {
+    mutex_lock l(mu_);
+    ReleaseLocked(prefix, bytes);
+    return s;
+  }
+
+  VLOG(1) << "Scheduled asynchronous write of " << entries.size()
+          << " tensors (" << bytes << " bytes) to " << prefix;
+  auto shared_entries =
+      std::make_shared<const std::vector<Entry>>(std::move(entries));
+  thread_pool_->Schedule([this, prefix, shared_entries, bytes]() {
+    Write(prefix, *shared_entries, bytes);
+  });
+  return Status::OK();
+}
+
+void AsyncBundleWriter::Write(const string& prefix,
+                              const std::vector<Entry>& entries, int64 bytes) {
+  const uint64 start_us = env_->NowMicros();
+  BundleWriter writer(env_, prefix, options_.writer_options);
+  Status s = writer.status();
+  for (const Entry& entry : entries) {
+    if (!s.ok()) break;
+    if (entry.is_slice) {
+      s = writer.AddSlice(entry.key, entry.full_shape, entry.slice_spec,
+                          entry.tensor);
+    } else {
+      s = writer.Add(entry.key, entry.tensor);
+    }
+  }
+  if (s.ok()) {
+    s = writer.Finish();
+  }
+  VLOG(1) << "Asynchronous write of " << prefix << " finished in "
+          << (env_->NowMicros() - start_us) / 1000 << "ms: " << s;
+
+  mutex_lock l(mu_);
+  if (!s.ok()) {
+    failed_.emplace_back(
+        s.code(), strings::StrCat("Asynchronous write of checkpoint ", prefix,
+                                  " failed: ", s.error_message()));
+  }
+  ReleaseLocked(prefix, bytes);
+}
+
+void AsyncBundleWriter::ReleaseLocked(const string& prefix, int64 bytes) {
+  pending_bytes_ -= bytes;
+  if (--pending_[prefix] == 0) pending_.erase(prefix);
+  cond_.notify_all();
+}
+
+Status AsyncBundleWriter::TakeFailuresLocked() {
+  if (failed_.empty()) return Status::OK();
+  Status s = failed_.front();
+  for (int i = 1; i < failed_.size(); ++i) {
+    LOG(ERROR) << failed_[i];
+  }
+  if (failed_.size() > 1) {
+    errors::AppendToMessage(&s, failed_.size() - 1,
+                            " more asynchronous writes failed.");
+  }
+  failed_.clear();
+  return s;
+}
+
+Status AsyncBundleWriter::Wait(const string& prefix) {
+  mutex_lock l(mu_);
+  while (pending_.count(prefix) > 0) {
+    cond_.wait(l);
+  }
+  return TakeFailuresLocked();
+}
+
+Status AsyncBundleWriter::WaitAll() {
+  mutex_lock l(mu_);
+  while (!pending_.empty()) {
+    cond_.wait(l);
+  }
+  return TakeFailuresLocked();
+}
+
+int64 AsyncBundleWriter::pending_bytes() const {
+  mutex_lock l(mu_);
+  return pending_bytes_;
+}
+
+}  // namespace tensorflow
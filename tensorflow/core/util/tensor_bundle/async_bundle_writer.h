@@ -0,0 +1,163 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Writes tensor bundles from a background thread pool, so that a training step
+// that saves a checkpoint only pays for taking a host memory snapshot of the
+// tensors rather than for streaming them to storage.  Typical usage:
+//
+//   TF_RETURN_IF_ERROR(AsyncBundleWriter::Global()->Schedule(
+//       prefix, bytes, [](std::vector<AsyncBundleWriter::Entry>* entries) {
+//         ...  // Takes the snapshots.
+//       }));
+//   ...  // Training continues while the bundle is written.
+//   TF_RETURN_IF_ERROR(AsyncBundleWriter::Global()->Wait(prefix));
+//
+// Bundles scheduled for different prefixes (e.g. the shards of a sharded
+// checkpoint) are written in parallel.  The total size of the snapshots that
+// are waiting to be written is bounded: Schedule() blocks until enough of the
+// earlier writes have completed, before the snapshots are taken.
+//
+// A failed write is reported once, by the first call to Schedule(), Wait() or
+// WaitAll() after it failed, whatever the prefix of that call.  Callers using
+// a new prefix for every checkpoint therefore still see the failures of the
+// previous ones.
+
+#ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_ASYNC_BUNDLE_WRITER_H_
+#define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_ASYNC_BUNDLE_WRITER_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_slice.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+
+// Thread-safe.
+class AsyncBundleWriter {
+ public:
+  struct Options {
+    Options() {}
+    // Number of bundles that are written concurrently.
+    int num_threads{4};
+    // Upper bound, in bytes, on the snapshots waiting to be written.  A single
+    // bundle larger than this bound is admitted once nothing else is pending.
+    int64 max_pending_bytes{int64{4} << 30};
+    // Options of the underlying BundleWriter.
+    BundleWriter::Options writer_options;
+  };
+
+  // A tensor, or a slice of a partitioned tensor, to be added to a bundle.
+  struct Entry {
+    string key;
+    // Must not be modified once scheduled, so this is normally a deep copy of
+    // the saved value.
+    Tensor tensor;
+    // Set iff "tensor" is a slice of a partitioned tensor.
+    bool is_slice = false;
+    TensorShape full_shape;
+    TensorSlice slice_spec;
+  };
+
+  AsyncBundleWriter(Env* env, const Options& options = Options());
+
+  // Waits for all the pending writes.
+  ~AsyncBundleWriter();
+
+  // Process-wide writer used by the checkpointing kernels.  Its options can
+  // be overridden with the TF_ASYNC_CHECKPOINT_THREADS,
+  // TF_ASYNC_CHECKPOINT_MAX_PENDING_BYTES and TF_CHECKPOINT_DATA_ALIGNMENT
+  // environment variables.
+  static AsyncBundleWriter* Global();
+
+  // Waits for the write of "prefix" on the process-wide writer, without
+  // creating the writer if nothing was ever scheduled on it.  Like Wait(),
+  // also returns the failures of the writes of other prefixes.
+  static Status WaitGlobal(const string& prefix);
+
+  // Schedules writing "entries" as the bundle at "prefix" and returns as soon
+  // as the bundle is queued.  Blocks while the snapshots that are still
+  // pending exceed "max_pending_bytes", or while an earlier bundle with the
+  // same prefix is being written.
+  //
+  // Failures of previous writes that were not reported yet, whatever their
+  // prefix, are returned here, and "entries" are then not scheduled.
+  Status Schedule(const string& prefix, std::vector<Entry> entries);
+
+  // Like Schedule() above, but takes the snapshots by calling "snapshot" once
+  // "bytes" (the size of the snapshots) fit in "max_pending_bytes", so that
+  // they are only held in host memory within that bound.  Nothing is
+  // scheduled if "snapshot" fails, and its error is returned.
+  Status Schedule(
+      const string& prefix, int64 bytes,
+      const std::function<Status(std::vector<Entry>* entries)>& snapshot);
+
+  // Blocks until the bundle at "prefix" is written, and returns the status of
+  // that write together with the failures of any other write not reported
+  // yet.  Does not block if no write of "prefix" is pending.
+  Status Wait(const string& prefix);
+
+  // Blocks until every scheduled bundle is written, and returns the failures
+  // not reported yet.
+  Status WaitAll();
+
+  // Total size of the snapshots waiting to be written.
+  int64 pending_bytes() const;
+
+ private:
+  void Write(const string& prefix, const std::vector<Entry>& entries,
+             int64 bytes);
+
+  // Releases the budget of a write of "bytes" to "prefix", once written or
+  // abandoned.
+  void ReleaseLocked(const string& prefix, int64 bytes)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Consumes the failures that were not reported yet.
+  Status TakeFailuresLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;  // Not owned.
+  const Options options_;
+
+  mutable mutex mu_;
+  condition_variable cond_;
+  int64 pending_bytes_ GUARDED_BY(mu_) = 0;
+  // Prefixes scheduled but not yet written.
+  std::unordered_map<string, int> pending_ GUARDED_BY(mu_);
+  // Failures not reported yet, in the order the writes failed.
+  std::vector<Status> failed_ GUARDED_BY(mu_);
+
+  // Declared last so that its destructor, which joins the worker threads,
+  // runs while the members above are still alive.
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AsyncBundleWriter);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_ASYNC_BUNDLE_WRITER_H_
@@ -0,0 +1,207 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/async_bundle_writer.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+namespace {
+
+string Prefix(const string& prefix) {
+  return strings::StrCat(testing::TmpDir(), "/", prefix);
+}
+
+AsyncBundleWriter::Entry MakeEntry(const string& key, int64 size, float value) {
+  AsyncBundleWriter::Entry entry;
+  entry.key = key;
+  entry.tensor = Tensor(DT_FLOAT, TensorShape({size}));
+  entry.tensor.flat<float>().setConstant(value);
+  return entry;
+}
+
+void ExpectBundleValue(const string& prefix, const string& key, float value) {
+  BundleReader reader(Env::Default(), prefix);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  TF_ASSERT_OK(reader.Lookup(key, &val));
+  Tensor expected(DT_FLOAT, val.shape());
+  expected.flat<float>().setConstant(value);
+  test::ExpectTensorEqual<float>(expected, val);
+}
+
+TEST(AsyncBundleWriterTest, WritesShardsInParallel) {
+  AsyncBundleWriter writer(Env::Default());
+  for (int shard = 0; shard < 8; ++shard) {
+    std::vector<AsyncBundleWriter::Entry> entries;
+    entries.push_back(MakeEntry("a", 1000, shard));
+    entries.push_back(MakeEntry("b", 10, -shard));
+    TF_EXPECT_OK(writer.Schedule(Prefix(strings::StrCat("shard_", shard)),
+                                 std::move(entries)));
+  }
+  TF_EXPECT_OK(writer.WaitAll());
+  EXPECT_EQ(0, writer.pending_bytes());
+
+  for (int shard = 0; shard < 8; ++shard) {
+    const string prefix = Prefix(strings::StrCat("shard_", shard));
+    ExpectBundleValue(prefix, "a", shard);
+    ExpectBundleValue(prefix, "b", -shard);
+  }
+}
+
+TEST(AsyncBundleWriterTest, BoundsPendingBytes) {
+  AsyncBundleWriter::Options options;
+  options.num_threads = 2;
+  options.max_pending_bytes = 3 * 1000 * sizeof(float);
+  AsyncBundleWriter writer(Env::Default(), options);
+  for (int i = 0; i < 10; ++i) {
+    std::vector<AsyncBundleWriter::Entry> entries;
+    entries.push_back(MakeEntry("x", 1000, i));
+    TF_EXPECT_OK(writer.Schedule(Prefix(strings::StrCat("bounded_", i)),
+                                 std::move(entries)));
+    EXPECT_LE(writer.pending_bytes(), options.max_pending_bytes);
+  }
+
+  // A bundle larger than the bound is still admitted.
+  std::vector<AsyncBundleWriter::Entry> entries;
+  entries.push_back(MakeEntry("x", 10000, 42));
+  TF_EXPECT_OK(writer.Schedule(Prefix("bounded_large"), std::move(entries)));
+  TF_EXPECT_OK(writer.Wait(Prefix("bounded_large")));
+  ExpectBundleValue(Prefix("bounded_large"), "x", 42);
+  TF_EXPECT_OK(writer.WaitAll());
+}
+
+TEST(AsyncBundleWriterTest, TakesSnapshotsWithinBound) {
+  AsyncBundleWriter::Options options;
+  options.max_pending_bytes = 1000 * sizeof(float);
+  AsyncBundleWriter writer(Env::Default(), options);
+  auto snapshot = [](float value) {
+    return [value](std::vector<AsyncBundleWriter::Entry>* entries) {
+      entries->push_back(MakeEntry("x", 1000, value));
+      return Status::OK();
+    };
+  };
+
+  // The first save holds the whole budget while its snapshot is taken.
+  Notification first_started;
+  Notification first_done;
+  Notification second_taken;
+  std::unique_ptr<Thread> first(Env::Default()->StartThread(
+      ThreadOptions(), "first_save", [&]() {
+        TF_EXPECT_OK(writer.Schedule(
+            Prefix("within_bound_1"), 1000 * sizeof(float),
+            [&](std::vector<AsyncBundleWriter::Entry>* entries) {
+              first_started.Notify();
+              first_done.WaitForNotification();
+              return snapshot(1)(entries);
+            }));
+      }));
+  first_started.WaitForNotification();
+  std::unique_ptr<Thread> second(Env::Default()->StartThread(
+      ThreadOptions(), "second_save", [&]() {
+        TF_EXPECT_OK(writer.Schedule(
+            Prefix("within_bound_2"), 1000 * sizeof(float),
+            [&](std::vector<AsyncBundleWriter::Entry>* entries) {
+              second_taken.Notify();
+              return snapshot(2)(entries);
+            }));
+      }));
+
+  // The second save blocks before taking its snapshot.
+  Env::Default()->SleepForMicroseconds(100 * 1000);
+  EXPECT_FALSE(second_taken.HasBeenNotified());
+  EXPECT_EQ(options.max_pending_bytes, writer.pending_bytes());
+  first_done.Notify();
+  first.reset();
+  second.reset();
+  TF_EXPECT_OK(writer.WaitAll());
+  EXPECT_TRUE(second_taken.HasBeenNotified());
+  ExpectBundleValue(Prefix("within_bound_1"), "x", 1);
+  ExpectBundleValue(Prefix("within_bound_2"), "x", 2);
+}
+
+TEST(AsyncBundleWriterTest, ReleasesBudgetOfFailedSnapshots) {
+  AsyncBundleWriter writer(Env::Default());
+  EXPECT_FALSE(writer
+                   .Schedule(Prefix("failed_snapshot"), 100,
+                             [](std::vector<AsyncBundleWriter::Entry>*) {
+                               return errors::Internal("snapshot failed");
+                             })
+                   .ok());
+  EXPECT_EQ(0, writer.pending_bytes());
+  TF_EXPECT_OK(writer.Wait(Prefix("failed_snapshot")));
+}
+
+TEST(AsyncBundleWriterTest, RewritesSamePrefix) {
+  AsyncBundleWriter writer(Env::Default());
+  for (int i = 0; i < 4; ++i) {
+    std::vector<AsyncBundleWriter::Entry> entries;
+    entries.push_back(MakeEntry("x", 100, i));
+    TF_EXPECT_OK(writer.Schedule(Prefix("same"), std::move(entries)));
+  }
+  TF_EXPECT_OK(writer.Wait(Prefix("same")));
+  ExpectBundleValue(Prefix("same"), "x", 3);
+}
+
+TEST(AsyncBundleWriterTest, ReportsErrorsOnWait) {
+  AsyncBundleWriter writer(Env::Default());
+  std::vector<AsyncBundleWriter::Entry> entries;
+  entries.push_back(MakeEntry("x", 10, 1));
+  entries.push_back(MakeEntry("x", 10, 2));  // Duplicate key.
+  TF_EXPECT_OK(writer.Schedule(Prefix("dup"), std::move(entries)));
+  EXPECT_FALSE(writer.Wait(Prefix("dup")).ok());
+  // The error is only reported once.
+  TF_EXPECT_OK(writer.Wait(Prefix("dup")));
+}
+
+TEST(AsyncBundleWriterTest, ReportsErrorsOfOtherPrefixes) {
+  AsyncBundleWriter writer(Env::Default());
+  std::vector<AsyncBundleWriter::Entry> entries;
+  entries.push_back(MakeEntry("x", 10, 1));
+  entries.push_back(MakeEntry("x", 10, 2));  // Duplicate key.
+  TF_EXPECT_OK(writer.Schedule(Prefix("failed_step_1"), std::move(entries)));
+  while (writer.pending_bytes() > 0) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+
+  // Reported by the save of the next step.
+  entries.clear();
+  entries.push_back(MakeEntry("x", 10, 1));
+  EXPECT_FALSE(
+      writer.Schedule(Prefix("failed_step_2"), std::move(entries)).ok());
+  TF_EXPECT_OK(writer.Wait(Prefix("failed_step_1")));
+
+  // Reported by waiting for another prefix.
+  entries.clear();
+  entries.push_back(MakeEntry("x", 10, 1));
+  entries.push_back(MakeEntry("x", 10, 2));
+  TF_EXPECT_OK(writer.Schedule(Prefix("failed_step_3"), std::move(entries)));
+  while (writer.pending_bytes() > 0) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  EXPECT_FALSE(writer.Wait(Prefix("failed_step_4")).ok());
+  TF_EXPECT_OK(writer.WaitAll());
+}
+
+}  // namespace
+
+}  // namespace tensorflow
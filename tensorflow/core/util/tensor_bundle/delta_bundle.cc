@@ -0,0 +1,403 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <set>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Separates the key of a tensor from the first row of a delta entry.
+const char kDeltaKeyInfix[] = "/.DELTA_";
+const char kRowsSuffix[] = "/rows";
+const char kRowIdsSuffix[] = "/ids";
+
+// Guards against cyclic chains.
+const int kMaxDeltaChainLength = 1024;
+
+string DeltaKeyPrefix(StringPiece key) {
+  return strings::StrCat(key, kDeltaKeyInfix);
+}
+
+// Number of rows of "t", where a scalar has a single row.
+int64 NumRows(const Tensor& t) { return t.dims() > 0 ? t.dim_size(0) : 1; }
+
+// Copies rows "src_rows" of "src" to rows "dst_rows" of "dst".
+Status CopyRows(const Tensor& src, gtl::ArraySlice<int64> src_rows,
+                Tensor* dst, gtl::ArraySlice<int64> dst_rows) {
+  CHECK_EQ(src_rows.size(), dst_rows.size());
+  const int64 src_num_rows = NumRows(src);
+  const int64 dst_num_rows = NumRows(*dst);
+  const int64 row_size = src_num_rows > 0 ? src.NumElements() / src_num_rows
+                                          : 0;
+  if (src.dtype() != dst->dtype() ||
+      (dst_num_rows > 0 && dst->NumElements() / dst_num_rows != row_size)) {
+    return errors::InvalidArgument(
+        "Rows of ", DataTypeString(src.dtype()), " ",
+        src.shape().DebugString(), " don't match rows of ",
+        DataTypeString(dst->dtype()), " ", dst->shape().DebugString());
+  }
+  if (row_size == 0) return Status::OK();
+
+  if (DataTypeCanUseMemcpy(src.dtype())) {
+    const size_t row_bytes = row_size * DataTypeSize(src.dtype());
+    const char* src_data = src.tensor_data().data();
+    char* dst_data = const_cast<char*>(dst->tensor_data().data());
+    for (size_t i = 0; i < src_rows.size(); ++i) {
+      memcpy(dst_data + dst_rows[i] * row_bytes,
+             src_data + src_rows[i] * row_bytes, row_bytes);
+    }
+  } else if (src.dtype() == DT_STRING) {
+    const auto src_flat = src.flat<string>();
+    auto dst_flat = dst->flat<string>();
+    for (size_t i = 0; i < src_rows.size(); ++i) {
+      for (int64 j = 0; j < row_size; ++j) {
+        dst_flat(dst_rows[i] * row_size + j) =
+            src_flat(src_rows[i] * row_size + j);
+      }
+    }
+  } else {
+    return errors::Unimplemented("Delta checkpoints of ",
+                                 DataTypeString(src.dtype()),
+                                 " tensors are not supported");
+  }
+  return Status::OK();
+}
+
+// Returns an error unless "slice_spec" only partitions dimension 0, and sets
+// "first_row" to the first row it covers.
+Status GetFirstRow(StringPiece key, const TensorSlice& slice_spec,
+                   int64* first_row) {
+  *first_row = 0;
+  if (slice_spec.IsFull()) return Status::OK();
+  for (int d = 1; d < slice_spec.dims(); ++d) {
+    if (!slice_spec.IsFullAt(d)) {
+      return errors::Unimplemented(
+          "Delta checkpoints only support tensors partitioned along their "
+          "first dimension; got slice ",
+          slice_spec.DebugString(), " of ", key);
+    }
+  }
+  if (!slice_spec.IsFullAt(0)) *first_row = slice_spec.start(0);
+  return Status::OK();
+}
+
+}  // namespace
+
+string DeltaRowsKey(StringPiece key, int64 first_row) {
+  return strings::StrCat(key, kDeltaKeyInfix, first_row, kRowsSuffix);
+}
+
+string DeltaRowIdsKey(StringPiece key, int64 first_row) {
+  return strings::StrCat(key, kDeltaKeyInfix, first_row, kRowIdsSuffix);
+}
+
+Status AddDeltaRows(BundleWriter* writer, StringPiece key,
+                    const TensorSlice& slice_spec, const Tensor& val,
+                    gtl::ArraySlice<int64> rows) {
+  int64 first_row;
+  TF_RETURN_IF_ERROR(GetFirstRow(key, slice_spec, &first_row));
+  if (rows.empty()) return Status::OK();
+  const int64 num_rows = NumRows(val);
+  if (rows.front() < 0 || rows.back() >= num_rows) {
+    return errors::InvalidArgument("Rows of ", key, " out of range [0, ",
+                                   num_rows, ")");
+  }
+  if (static_cast<int64>(rows.size()) == num_rows) {
+    // Sorted and unique, so all the rows: stores "val" as is.
+    return writer->Add(DeltaRowsKey(key, first_row), val);
+  }
+
+  TensorShape rows_shape(val.shape());
+  rows_shape.set_dim(0, rows.size());
+  Tensor values(val.dtype(), rows_shape);
+  Tensor ids(DT_INT64, TensorShape({static_cast<int64>(rows.size())}));
+  auto ids_flat = ids.flat<int64>();
+  std::vector<int64> dst_rows(rows.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    ids_flat(i) = first_row + rows[i];
+    dst_rows[i] = i;
+  }
+  TF_RETURN_IF_ERROR(CopyRows(val, rows, &values, dst_rows));
+  TF_RETURN_IF_ERROR(writer->Add(DeltaRowIdsKey(key, first_row), ids));
+  return writer->Add(DeltaRowsKey(key, first_row), values);
+}
+
+DeltaBundleReader::DeltaBundleReader(Env* env, StringPiece prefix) {
+  string current(prefix);
+  while (true) {
+    if (static_cast<int>(chain_.size()) >= kMaxDeltaChainLength) {
+      status_ = errors::InvalidArgument(
+          "The chain of delta checkpoints of ", prefix, " is longer than ",
+          kMaxDeltaChainLength, " bundles; is it cyclic?");
+      return;
+    }
+    std::unique_ptr<BundleReader> reader(new BundleReader(env, current));
+    status_ = reader->status();
+    if (!status_.ok()) return;
+    string parent = reader->delta_parent();
+    chain_.push_back(current);
+    readers_.push_back(std::move(reader));
+    if (parent.empty()) break;
+    if (!io::IsAbsolutePath(parent)) {
+      parent = io::JoinPath(io::Dirname(current), parent);
+    }
+    current = parent;
+  }
+  std::reverse(chain_.begin(), chain_.end());
+  std::reverse(readers_.begin(), readers_.end());
+  VLOG(1) << "Reading " << prefix << " as a chain of " << chain_.size()
+          << " bundles";
+}
+
+int DeltaBundleReader::NewestFullBundle(StringPiece key) {
+  for (int r = static_cast<int>(readers_.size()) - 1; r >= 0; --r) {
+    if (readers_[r]->Contains(key)) return r;
+  }
+  return -1;
+}
+
+Status DeltaBundleReader::BaseBundle(StringPiece key,
+                                     const TensorSlice& slice_spec,
+                                     int* base) {
+  *base = -1;
+  for (int r = static_cast<int>(readers_.size()) - 1; r >= 0; --r) {
+    if (!readers_[r]->Contains(key)) continue;
+    *base = r;
+    std::vector<TensorSlice> slices;
+    TF_RETURN_IF_ERROR(readers_[r]->LookupTensorSlices(key, &slices));
+    if (slices.empty()) return Status::OK();
+    for (const TensorSlice& slice : slices) {
+      if (slice == slice_spec) return Status::OK();
+    }
+  }
+  if (*base < 0) {
+    return errors::NotFound("Key ", key, " not found in the chain of ",
+                            chain_.back());
+  }
+  return Status::OK();
+}
+
+Status DeltaBundleReader::LookupDtypeAndShape(StringPiece key,
+                                              DataType* dtype,
+                                              TensorShape* shape) {
+  const int r = NewestFullBundle(key);
+  if (r < 0) return readers_.back()->LookupDtypeAndShape(key, dtype, shape);
+  return readers_[r]->LookupDtypeAndShape(key, dtype, shape);
+}
+
+Status DeltaBundleReader::LookupTensorShape(StringPiece key,
+                                            TensorShape* shape) {
+  DataType ignored;
+  return LookupDtypeAndShape(key, &ignored, shape);
+}
+
+Status DeltaBundleReader::LookupTensorSlices(StringPiece key,
+                                             std::vector<TensorSlice>* slices) {
+  // The oldest bundle storing the tensor has all its slices.
+  int base;
+  TF_RETURN_IF_ERROR(BaseBundle(key, TensorSlice(0), &base));
+  return readers_[base]->LookupTensorSlices(key, slices);
+}
+
+Status DeltaBundleReader::Lookup(StringPiece key, Tensor* val) {
+  const TensorSlice full(val->dims());
+  int base;
+  TF_RETURN_IF_ERROR(BaseBundle(key, full, &base));
+  TF_RETURN_IF_ERROR(readers_[base]->Lookup(key, val));
+  return ApplyDeltas(key, full, base, val);
+}
+
+Status DeltaBundleReader::LookupSlice(StringPiece full_tensor_key,
+                                      const TensorSlice& slice_spec,
+                                      Tensor* val) {
+  int base;
+  TF_RETURN_IF_ERROR(BaseBundle(full_tensor_key, slice_spec, &base));
+  TF_RETURN_IF_ERROR(
+      readers_[base]->LookupSlice(full_tensor_key, slice_spec, val));
+  return ApplyDeltas(full_tensor_key, slice_spec, base, val);
+}
+
+Status DeltaBundleReader::ApplyDeltas(StringPiece key,
+                                      const TensorSlice& slice_spec, int base,
+                                      Tensor* val) {
+  int64 start;
+  TF_RETURN_IF_ERROR(GetFirstRow(key, slice_spec, &start));
+  const int64 end = start + NumRows(*val);
+  const string prefix = DeltaKeyPrefix(key);
+
+  // Copies the rows of "values", whose ids in the full tensor are "ids", that
+  // "val" holds.
+  auto copy_rows = [start, end, val](const Tensor& values,
+                                     gtl::ArraySlice<int64> ids) {
+    std::vector<int64> src_rows;
+    std::vector<int64> dst_rows;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      if (ids[i] >= start && ids[i] < end) {
+        src_rows.push_back(i);
+        dst_rows.push_back(ids[i] - start);
+      }
+    }
+    return CopyRows(values, src_rows, val, dst_rows);
+  };
+
+  for (size_t r = base + 1; r < readers_.size(); ++r) {
+    BundleReader* reader = readers_[r].get();
+    DataType dtype;
+    TensorShape shape;
+    std::vector<int64> ids;
+
+    // The slices of the tensor stored in full.
+    if (reader->Contains(key)) {
+      TF_RETURN_IF_ERROR(reader->LookupDtypeAndShape(key, &dtype, &shape));
+      std::vector<TensorSlice> slices;
+      TF_RETURN_IF_ERROR(reader->LookupTensorSlices(key, &slices));
+      if (slices.empty()) slices.emplace_back(shape.dims());
+      for (const TensorSlice& slice : slices) {
+        int64 first_row;
+        TF_RETURN_IF_ERROR(GetFirstRow(key, slice, &first_row));
+        TensorShape slice_shape;
+        TF_RETURN_IF_ERROR(slice.SliceTensorShape(shape, &slice_shape));
+        Tensor values(dtype, slice_shape);
+        if (slice.IsFull()) {
+          TF_RETURN_IF_ERROR(reader->Lookup(key, &values));
+        } else {
+          TF_RETURN_IF_ERROR(reader->LookupSlice(key, slice, &values));
+        }
+        ids.resize(NumRows(values));
+        std::iota(ids.begin(), ids.end(), first_row);
+        TF_RETURN_IF_ERROR(copy_rows(values, ids));
+      }
+    }
+
+    // Finds the delta entries first, as lookups move the iterator.
+    std::vector<int64> first_rows;
+    for (reader->Seek(prefix);
+         reader->Valid() && str_util::StartsWith(reader->key(), prefix);
+         reader->Next()) {
+      StringPiece first_row_str = reader->key();
+      first_row_str.remove_prefix(prefix.size());
+      if (!str_util::ConsumeSuffix(&first_row_str, kRowsSuffix)) continue;
+      int64 first_row;
+      if (!strings::safe_strto64(first_row_str, &first_row)) {
+        return errors::DataLoss("Invalid delta entry ", reader->key(), " in ",
+                                chain_[r]);
+      }
+      first_rows.push_back(first_row);
+    }
+
+    for (int64 first_row : first_rows) {
+      const string rows_key = DeltaRowsKey(key, first_row);
+      TF_RETURN_IF_ERROR(reader->LookupDtypeAndShape(rows_key, &dtype, &shape));
+      Tensor values(dtype, shape);
+      TF_RETURN_IF_ERROR(reader->Lookup(rows_key, &values));
+
+      // The ids of the rows in the full tensor.
+      const string ids_key = DeltaRowIdsKey(key, first_row);
+      if (reader->Contains(ids_key)) {
+        TF_RETURN_IF_ERROR(reader->LookupTensorShape(ids_key, &shape));
+        Tensor ids_tensor(DT_INT64, shape);
+        TF_RETURN_IF_ERROR(reader->Lookup(ids_key, &ids_tensor));
+        const auto ids_flat = ids_tensor.flat<int64>();
+        ids.assign(ids_flat.data(), ids_flat.data() + ids_flat.size());
+      } else {
+        ids.resize(NumRows(values));
+        std::iota(ids.begin(), ids.end(), first_row);
+      }
+      if (static_cast<int64>(ids.size()) != NumRows(values)) {
+        return errors::DataLoss("Mismatched delta entries of ", key, " in ",
+                                chain_[r], ": ", ids.size(), " ids vs. ",
+                                NumRows(values), " rows");
+      }
+      TF_RETURN_IF_ERROR(copy_rows(values, ids));
+    }
+  }
+  return Status::OK();
+}
+
+Status CompactDeltaBundles(Env* env, StringPiece prefix,
+                           StringPiece compacted_prefix,
+                           const BundleWriter::Options& options) {
+  DeltaBundleReader reader(env, prefix);
+  TF_RETURN_IF_ERROR(reader.status());
+  for (const string& chained : reader.chain()) {
+    if (chained == compacted_prefix) {
+      return errors::InvalidArgument("Can't compact ", prefix,
+                                     " into a bundle of its chain, ",
+                                     compacted_prefix);
+    }
+  }
+
+  // Collects the keys of the tensors stored in full in any bundle of the
+  // chain, e.g. the tensors added after the full bundle was written.  Collects
+  // them first, as lookups move the iterators.
+  std::set<string> keys;
+  for (const string& chained : reader.chain()) {
+    BundleReader bundle(env, chained);
+    TF_RETURN_IF_ERROR(bundle.status());
+    bundle.Seek(kHeaderEntryKey);
+    for (bundle.Next(); bundle.Valid(); bundle.Next()) {
+      // Skips the entries of the slices of partitioned tensors, whose encoded
+      // keys start with a 0 byte, and the delta entries.
+      const StringPiece key = bundle.key();
+      if (key.empty() || key[0] == '\0' ||
+          str_util::StrContains(key, kDeltaKeyInfix)) {
+        continue;
+      }
+      keys.insert(string(key));
+    }
+  }
+
+  BundleWriter::Options writer_options(options);
+  writer_options.delta_parent.clear();
+  BundleWriter writer(env, compacted_prefix, writer_options);
+  TF_RETURN_IF_ERROR(writer.status());
+  for (const string& key : keys) {
+    DataType dtype;
+    TensorShape shape;
+    TF_RETURN_IF_ERROR(reader.LookupDtypeAndShape(key, &dtype, &shape));
+    std::vector<TensorSlice> slices;
+    TF_RETURN_IF_ERROR(reader.LookupTensorSlices(key, &slices));
+    if (slices.empty()) {
+      Tensor val(dtype, shape);
+      TF_RETURN_IF_ERROR(reader.Lookup(key, &val));
+      TF_RETURN_IF_ERROR(writer.Add(key, val));
+      continue;
+    }
+    for (const TensorSlice& slice : slices) {
+      TensorShape slice_shape;
+      TF_RETURN_IF_ERROR(slice.SliceTensorShape(shape, &slice_shape));
+      Tensor val(dtype, slice_shape);
+      TF_RETURN_IF_ERROR(reader.LookupSlice(key, slice, &val));
+      TF_RETURN_IF_ERROR(writer.AddSlice(key, shape, slice, val));
+    }
+  }
+  return writer.Finish();
+}
+
+}  // namespace tensorflow
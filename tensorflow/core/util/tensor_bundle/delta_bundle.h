@@ -0,0 +1,133 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Incremental ("delta") checkpoints, for variables that only change in a few
+// rows between checkpoints, such as large embedding tables.
+//
+// A delta bundle is a tensor bundle written with a non-empty
+// BundleWriter::Options::delta_parent.  It stores, for each tensor or slice of
+// a partitioned tensor, only the rows (slices along dimension 0) that changed
+// since its parent bundle was written:
+//
+//   DeltaRowsKey(key, first_row)   -> the values of the rows.
+//   DeltaRowIdsKey(key, first_row) -> int64 ids of the rows, in the full
+//                                     tensor.  Absent if all the rows of the
+//                                     tensor or slice starting at "first_row"
+//                                     are stored.
+//
+// Tensors without changed rows have no entries.  Tensors or slices whose
+// changed rows are not known, e.g. the ones added or assigned since the parent
+// was written, are stored in full under their own key instead, as in a full
+// bundle.
+//
+// The parent is either a full bundle or another delta: DeltaBundleReader
+// reads each tensor from the newest bundle of the chain storing it in full
+// (usually the full bundle at its root), and applies the newer deltas, the
+// oldest first.  CompactDeltaBundles() turns a chain into a full bundle.
+
+#ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
+#define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_slice.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+
+// Keys of the entries of a delta bundle, see above.
+string DeltaRowsKey(StringPiece key, int64 first_row);
+string DeltaRowIdsKey(StringPiece key, int64 first_row);
+
+// Adds to the delta bundle written by "writer" the rows "rows" of "val",
+// which is either the full tensor "key" or its slice "slice_spec".  "rows" are
+// relative to "val", and must be sorted and unique.
+//
+// Only slices that partition the tensor along dimension 0 are supported.
+Status AddDeltaRows(BundleWriter* writer, StringPiece key,
+                    const TensorSlice& slice_spec, const Tensor& val,
+                    gtl::ArraySlice<int64> rows) TF_MUST_USE_RESULT;
+
+// Reads a bundle, applying its chain of deltas if it is a delta bundle.
+//
+// On construction, opens every bundle of the chain, so "status()" must be
+// checked before calling any member functions.
+// All threads accessing the same DeltaBundleReader must synchronize.
+class DeltaBundleReader {
+ public:
+  DeltaBundleReader(Env* env, StringPiece prefix);
+
+  Status status() const { return status_; }
+
+  // Prefixes of the bundles of the chain: the full bundle first and "prefix"
+  // last.
+  const std::vector<string>& chain() const { return chain_; }
+
+  // Like the BundleReader methods of the same names.
+  // REQUIRES: status().ok()
+  Status LookupDtypeAndShape(StringPiece key, DataType* dtype,
+                             TensorShape* shape) TF_MUST_USE_RESULT;
+  Status LookupTensorShape(StringPiece key,
+                           TensorShape* shape) TF_MUST_USE_RESULT;
+  Status LookupTensorSlices(StringPiece key, std::vector<TensorSlice>* slices)
+      TF_MUST_USE_RESULT;
+  Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
+  Status LookupSlice(StringPiece full_tensor_key, const TensorSlice& slice_spec,
+                     Tensor* val) TF_MUST_USE_RESULT;
+
+ private:
+  // Returns the index in "readers_" of the newest bundle storing the tensor
+  // "key" in full, or -1.
+  int NewestFullBundle(StringPiece key);
+
+  // Returns the index in "readers_" of the bundle to read the slice
+  // "slice_spec" of the tensor "key" from before applying the deltas: the
+  // newest one storing all of it, or else the oldest one storing the tensor.
+  Status BaseBundle(StringPiece key, const TensorSlice& slice_spec,
+                    int* base) TF_MUST_USE_RESULT;
+
+  // Applies the bundles of the chain newer than "base" to "val", which holds
+  // the slice "slice_spec" of the tensor "key" in bundle "base".
+  Status ApplyDeltas(StringPiece key, const TensorSlice& slice_spec, int base,
+                     Tensor* val) TF_MUST_USE_RESULT;
+
+  std::vector<string> chain_;
+  // Readers of "chain_", in the same order.
+  std::vector<std::unique_ptr<BundleReader>> readers_;
+  Status status_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(DeltaBundleReader);
+};
+
+// Writes the tensors of the bundle "prefix", with its deltas applied, as the
+// full bundle "compacted_prefix", keeping the partitioning of the tensors.
+// The bundles of the chain are left untouched.
+Status CompactDeltaBundles(
+    Env* env, StringPiece prefix, StringPiece compacted_prefix,
+    const BundleWriter::Options& options = BundleWriter::Options());
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
@@ -0,0 +1,372 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
+
+namespace tensorflow {
+
+namespace {
+
+string Prefix(const string& prefix) {
+  return strings::StrCat(testing::TmpDir(), "/", prefix);
+}
+
+// Writes the base bundle "prefix" and two deltas, "prefix_1" and "prefix_2".
+// Returns the expected values of the tensors after the second delta.
+void WriteChain(const string& prefix, Tensor* emb, Tensor* step,
+                Tensor* part) {
+  *emb = test::AsTensor<float>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}, {5, 2});
+  *step = test::AsScalar<int64>(100);
+  *part = test::AsTensor<string>({"a", "b", "c", "d"}, {4});
+  const TensorSlice part0 = TensorSlice::ParseOrDie("0,2");
+  const TensorSlice part1 = TensorSlice::ParseOrDie("2,2");
+  {
+    BundleWriter writer(Env::Default(), prefix);
+    TF_EXPECT_OK(writer.Add("emb", *emb));
+    TF_EXPECT_OK(writer.Add("step", *step));
+    TF_EXPECT_OK(writer.AddSlice("part", {4}, part0,
+                                 test::AsTensor<string>({"a", "b"})));
+    TF_EXPECT_OK(writer.AddSlice("part", {4}, part1,
+                                 test::AsTensor<string>({"c", "d"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    BundleWriter::Options options;
+    options.delta_parent = prefix;
+    BundleWriter writer(Env::Default(), strings::StrCat(prefix, "_1"),
+                        options);
+    TF_EXPECT_OK(AddDeltaRows(&writer, "emb", TensorSlice(2),
+                              test::AsTensor<float>({0, 1, -2, -3, 4, 5, 6, 7,
+                                                     -8, -9},
+                                                    {5, 2}),
+                              {1, 4}));
+    TF_EXPECT_OK(AddDeltaRows(&writer, "step", TensorSlice(0),
+                              test::AsScalar<int64>(200), {0}));
+    TF_EXPECT_OK(AddDeltaRows(&writer, "part", part1,
+                              test::AsTensor<string>({"C", "d"}), {0}));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    // Relative to the directory of the delta.
+    BundleWriter::Options options;
+    options.delta_parent = strings::StrCat(io::Basename(prefix), "_1");
+    BundleWriter writer(Env::Default(), strings::StrCat(prefix, "_2"),
+                        options);
+    TF_EXPECT_OK(AddDeltaRows(&writer, "emb", TensorSlice(2),
+                              test::AsTensor<float>({0, 1, -2, -3, 4, 5, 6, 7,
+                                                     80, 90},
+                                                    {5, 2}),
+                              {4}));
+    TF_EXPECT_OK(AddDeltaRows(&writer, "part", part0,
+                              test::AsTensor<string>({"A", "B"}), {0, 1}));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  *emb = test::AsTensor<float>({0, 1, -2, -3, 4, 5, 6, 7, 80, 90}, {5, 2});
+  *step = test::AsScalar<int64>(200);
+  *part = test::AsTensor<string>({"A", "B", "C", "d"}, {4});
+}
+
+TEST(DeltaBundleTest, AppliesChain) {
+  Tensor expected_emb, expected_step, expected_part;
+  WriteChain(Prefix("chain"), &expected_emb, &expected_step, &expected_part);
+
+  DeltaBundleReader reader(Env::Default(), Prefix("chain_2"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_EQ(3, reader.chain().size());
+  EXPECT_EQ(Prefix("chain"), reader.chain()[0]);
+
+  Tensor emb(DT_FLOAT, {5, 2});
+  TF_ASSERT_OK(reader.Lookup("emb", &emb));
+  test::ExpectTensorEqual<float>(expected_emb, emb);
+  Tensor step(DT_INT64, {});
+  TF_ASSERT_OK(reader.Lookup("step", &step));
+  test::ExpectTensorEqual<int64>(expected_step, step);
+  Tensor part(DT_STRING, {4});
+  TF_ASSERT_OK(reader.Lookup("part", &part));
+  test::ExpectTensorEqual<string>(expected_part, part);
+  Tensor part1(DT_STRING, {2});
+  TF_ASSERT_OK(
+      reader.LookupSlice("part", TensorSlice::ParseOrDie("2,2"), &part1));
+  test::ExpectTensorEqual<string>(test::AsTensor<string>({"C", "d"}), part1);
+
+  // The intermediate delta only has the first updates.
+  DeltaBundleReader reader1(Env::Default(), Prefix("chain_1"));
+  TF_ASSERT_OK(reader1.status());
+  TF_ASSERT_OK(reader1.Lookup("emb", &emb));
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({0, 1, -2, -3, 4, 5, 6, 7, -8, -9}, {5, 2}), emb);
+}
+
+TEST(DeltaBundleTest, ReadsTensorsStoredInFull) {
+  Tensor expected_emb, expected_step, expected_part;
+  WriteChain(Prefix("in_full"), &expected_emb, &expected_step,
+             &expected_part);
+  {
+    // A new tensor, a reassigned one and a reassigned slice.
+    BundleWriter::Options options;
+    options.delta_parent = Prefix("in_full_2");
+    BundleWriter writer(Env::Default(), Prefix("in_full_3"), options);
+    TF_EXPECT_OK(writer.Add("new", test::AsTensor<int32>({1, 2, 3})));
+    TF_EXPECT_OK(writer.Add("step", test::AsScalar<int64>(300)));
+    TF_EXPECT_OK(writer.AddSlice("part", {4}, TensorSlice::ParseOrDie("2,2"),
+                                 test::AsTensor<string>({"x", "y"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    BundleWriter::Options options;
+    options.delta_parent = Prefix("in_full_3");
+    BundleWriter writer(Env::Default(), Prefix("in_full_4"), options);
+    TF_EXPECT_OK(AddDeltaRows(&writer, "new", TensorSlice(1),
+                              test::AsTensor<int32>({1, 20, 3}), {1}));
+    TF_EXPECT_OK(AddDeltaRows(&writer, "part",
+                              TensorSlice::ParseOrDie("2,2"),
+                              test::AsTensor<string>({"x", "Y"}), {1}));
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  DeltaBundleReader reader(Env::Default(), Prefix("in_full_4"));
+  TF_ASSERT_OK(reader.status());
+  DataType dtype;
+  TensorShape shape;
+  TF_ASSERT_OK(reader.LookupDtypeAndShape("new", &dtype, &shape));
+  EXPECT_EQ(DT_INT32, dtype);
+  EXPECT_EQ(TensorShape({3}), shape);
+  Tensor added(DT_INT32, {3});
+  TF_ASSERT_OK(reader.Lookup("new", &added));
+  test::ExpectTensorEqual<int32>(test::AsTensor<int32>({1, 20, 3}), added);
+  Tensor step(DT_INT64, {});
+  TF_ASSERT_OK(reader.Lookup("step", &step));
+  test::ExpectTensorEqual<int64>(test::AsScalar<int64>(300), step);
+
+  Tensor part(DT_STRING, {4});
+  TF_ASSERT_OK(reader.Lookup("part", &part));
+  test::ExpectTensorEqual<string>(
+      test::AsTensor<string>({"A", "B", "x", "Y"}), part);
+  Tensor part1(DT_STRING, {2});
+  TF_ASSERT_OK(
+      reader.LookupSlice("part", TensorSlice::ParseOrDie("2,2"), &part1));
+  test::ExpectTensorEqual<string>(test::AsTensor<string>({"x", "Y"}), part1);
+  std::vector<TensorSlice> slices;
+  TF_ASSERT_OK(reader.LookupTensorSlices("part", &slices));
+  EXPECT_EQ(2, slices.size());
+
+  TF_ASSERT_OK(CompactDeltaBundles(Env::Default(), Prefix("in_full_4"),
+                                   Prefix("in_full_compacted")));
+  BundleReader compacted(Env::Default(), Prefix("in_full_compacted"));
+  TF_ASSERT_OK(compacted.status());
+  TF_ASSERT_OK(compacted.Lookup("new", &added));
+  test::ExpectTensorEqual<int32>(test::AsTensor<int32>({1, 20, 3}), added);
+  TF_ASSERT_OK(compacted.Lookup("part", &part));
+  test::ExpectTensorEqual<string>(
+      test::AsTensor<string>({"A", "B", "x", "Y"}), part);
+}
+
+TEST(DeltaBundleTest, CompactsChain) {
+  Tensor expected_emb, expected_step, expected_part;
+  WriteChain(Prefix("compact"), &expected_emb, &expected_step,
+             &expected_part);
+  EXPECT_TRUE(errors::IsInvalidArgument(CompactDeltaBundles(
+      Env::Default(), Prefix("compact_2"), Prefix("compact_1"))));
+  TF_ASSERT_OK(CompactDeltaBundles(Env::Default(), Prefix("compact_2"),
+                                   Prefix("compacted")));
+
+  BundleReader reader(Env::Default(), Prefix("compacted"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_TRUE(reader.delta_parent().empty());
+  Tensor emb(DT_FLOAT, {5, 2});
+  TF_ASSERT_OK(reader.Lookup("emb", &emb));
+  test::ExpectTensorEqual<float>(expected_emb, emb);
+  Tensor step(DT_INT64, {});
+  TF_ASSERT_OK(reader.Lookup("step", &step));
+  test::ExpectTensorEqual<int64>(expected_step, step);
+  Tensor part(DT_STRING, {4});
+  TF_ASSERT_OK(reader.Lookup("part", &part));
+  test::ExpectTensorEqual<string>(expected_part, part);
+  std::vector<TensorSlice> slices;
+  TF_ASSERT_OK(reader.LookupTensorSlices("part", &slices));
+  EXPECT_EQ(2, slices.size());
+}
+
+TEST(DeltaBundleTest, MergesShardsOfDelta) {
+  auto write_shards = [](const string& name, const string& parent0,
+                         const string& parent1) {
+    std::vector<string> prefixes;
+    for (int shard = 0; shard < 2; ++shard) {
+      prefixes.push_back(Prefix(strings::StrCat(name, "_shard", shard)));
+      BundleWriter::Options options;
+      options.delta_parent = shard == 0 ? parent0 : parent1;
+      BundleWriter writer(Env::Default(), prefixes.back(), options);
+      TF_EXPECT_OK(AddDeltaRows(&writer, strings::StrCat("v", shard),
+                                TensorSlice(1), test::AsTensor<float>({1, 2}),
+                                {1}));
+      TF_EXPECT_OK(writer.Finish());
+    }
+    return prefixes;
+  };
+
+  TF_ASSERT_OK(MergeBundles(Env::Default(),
+                            write_shards("same", "parent", "parent"),
+                            Prefix("same")));
+  BundleReader reader(Env::Default(), Prefix("same"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_EQ("parent", reader.delta_parent());
+  EXPECT_TRUE(reader.Contains(DeltaRowIdsKey("v0", 0)));
+  EXPECT_TRUE(reader.Contains(DeltaRowsKey("v1", 0)));
+
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      MergeBundles(Env::Default(), write_shards("other", "parent", "other"),
+                   Prefix("other"))));
+}
+
+TEST(DeltaBundleTest, RejectsSlicesOfOtherDimensions) {
+  BundleWriter::Options options;
+  options.delta_parent = "parent";
+  BundleWriter writer(Env::Default(), Prefix("bad_slice"), options);
+  EXPECT_TRUE(errors::IsUnimplemented(AddDeltaRows(
+      &writer, "v", TensorSlice::ParseOrDie("-:0,1"),
+      test::AsTensor<float>({1, 2}, {2, 1}), {0})));
+}
+
+// Takes the rows of "var" and commits the save.
+bool TakeAndCommit(DirtyRowTracker* tracker, const string& key,
+                   const Tensor& var, std::vector<int64>* rows) {
+  std::vector<DirtyRowTracker::TakenRows> taken(1);
+  const bool known = tracker->TakeDirtyRows(key, var, rows, &taken[0]);
+  tracker->Commit(&taken);
+  return known;
+}
+
+TEST(DirtyRowTrackerTest, TakesRecordedRows) {
+  DirtyRowTracker tracker;
+  Tensor var(DT_FLOAT, {100, 4});
+  std::vector<int64> rows;
+
+  // Unknown until saved once.
+  tracker.RecordRows(var, test::AsTensor<int32>({3}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "v", var, &rows));
+
+  tracker.RecordRows(var, test::AsTensor<int32>({70, 3, 70}));
+  tracker.RecordRows(var, test::AsTensor<int64>({99, 100, -1}));
+  EXPECT_TRUE(TakeAndCommit(&tracker, "v", var, &rows));
+  EXPECT_EQ(std::vector<int64>({3, 70, 99}), rows);
+  EXPECT_TRUE(TakeAndCommit(&tracker, "v", var, &rows));
+  EXPECT_TRUE(rows.empty());
+
+  // Saved under another key.
+  tracker.RecordRows(var, test::AsTensor<int32>({5}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "w", var, &rows));
+
+  // Never updated.
+  Tensor other(DT_FLOAT, {100, 4});
+  EXPECT_FALSE(TakeAndCommit(&tracker, "other", other, &rows));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "other", other, &rows));
+}
+
+TEST(DirtyRowTrackerTest, DenseUpdatesModifyAllRows) {
+  DirtyRowTracker tracker;
+  Tensor var(DT_FLOAT, {10, 4});
+  std::vector<int64> rows;
+  tracker.RecordRows(var, test::AsTensor<int32>({3}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "v", var, &rows));
+
+  tracker.RecordAllRows(var);
+  tracker.RecordRows(var, test::AsTensor<int32>({4}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "v", var, &rows));
+  EXPECT_TRUE(TakeAndCommit(&tracker, "v", var, &rows));
+  EXPECT_TRUE(rows.empty());
+}
+
+TEST(DirtyRowTrackerTest, KeepsRowsOfFailedSaves) {
+  DirtyRowTracker tracker;
+  Tensor var(DT_FLOAT, {10, 4});
+  std::vector<int64> rows;
+  tracker.RecordRows(var, test::AsTensor<int32>({3}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "v", var, &rows));
+
+  tracker.RecordRows(var, test::AsTensor<int32>({5}));
+  {
+    DirtyRowTracker::TakenRows taken;
+    EXPECT_TRUE(tracker.TakeDirtyRows("v", var, &rows, &taken));
+    EXPECT_EQ(std::vector<int64>({5}), rows);
+    // Written while saving.
+    tracker.RecordRows(var, test::AsTensor<int32>({7}));
+  }
+  EXPECT_TRUE(TakeAndCommit(&tracker, "v", var, &rows));
+  EXPECT_EQ(std::vector<int64>({5, 7}), rows);
+
+  // A failed save doesn't change the key either.
+  tracker.RecordAllRows(var);
+  {
+    DirtyRowTracker::TakenRows taken;
+    EXPECT_FALSE(tracker.TakeDirtyRows("w", var, &rows, &taken));
+  }
+  tracker.RecordRows(var, test::AsTensor<int32>({1}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "v", var, &rows));
+  EXPECT_TRUE(TakeAndCommit(&tracker, "v", var, &rows));
+  EXPECT_TRUE(rows.empty());
+}
+
+TEST(DirtyRowTrackerTest, ForgetsReplacedAndIdleVariables) {
+  DirtyRowTracker tracker;
+  Tensor var(DT_FLOAT, {10, 4});
+  Tensor replaced(DT_FLOAT, {10, 4});
+  Tensor idle(DT_FLOAT, {10, 4});
+  std::vector<int64> rows;
+  tracker.RecordRows(var, test::AsTensor<int32>({3}));
+  tracker.RecordRows(idle, test::AsTensor<int32>({3}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "v", var, &rows));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "idle", idle, &rows));
+
+  // "v" is now saved from another buffer, e.g. after an assignment.
+  tracker.RecordAllRows(replaced);
+  EXPECT_FALSE(TakeAndCommit(&tracker, "v", replaced, &rows));
+  tracker.RecordRows(var, test::AsTensor<int32>({3}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "v", var, &rows));
+
+  for (int i = 0; i < DirtyRowTracker::kMaxIdleSaves; ++i) {
+    EXPECT_TRUE(TakeAndCommit(&tracker, "v", var, &rows));
+  }
+  tracker.RecordRows(idle, test::AsTensor<int32>({3}));
+  EXPECT_FALSE(TakeAndCommit(&tracker, "idle", idle, &rows));
+}
+
+TEST(DirtyRowTrackerTest, ScopedRecorder) {
+  DirtyRowTracker* tracker = DirtyRowTracker::Global();
+  tracker->Enable();
+  Tensor var(DT_FLOAT, {10});
+  Tensor accum(DT_FLOAT, {10});
+  std::vector<int64> rows;
+  {
+    ScopedDirtyRowRecorder recorder({&accum});
+  }
+  EXPECT_FALSE(TakeAndCommit(tracker, "accum", accum, &rows));
+  const Tensor indices = test::AsTensor<int64>({2, 8});
+  {
+    ScopedDirtyRowRecorder recorder({&var, &accum}, indices);
+  }
+  EXPECT_TRUE(TakeAndCommit(tracker, "accum", accum, &rows));
+  EXPECT_EQ(std::vector<int64>({2, 8}), rows);
+}
+
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,172 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/dirty_row_tracker.h"
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+// A bitmap of the modified rows of a variable.
+struct DirtyRowTracker::Rows {
+  explicit Rows(int64 num_rows)
+      : num_rows(num_rows), bits(new std::atomic<uint64>[NumWords()]()) {}
+
+  int64 NumWords() const { return (num_rows + 63) / 64; }
+
+  const int64 num_rows;
+  const std::unique_ptr<std::atomic<uint64>[]> bits;
+  // Whether all the rows were modified, in addition to the ones in "bits".
+  std::atomic<bool> all{false};
+
+  // The key the variable was last saved under, if any, and the number of
+  // saves committed when it was last updated or saved.  Guarded by the mutex
+  // of the tracker.
+  string key;
+  bool saved = false;
+  int64 last_used = 0;
+};
+
+namespace {
+
+template <typename Tindex>
+void MarkRows(const Tensor& indices, int64 num_rows,
+              std::atomic<uint64>* bits) {
+  const auto indices_flat = indices.flat<Tindex>();
+  for (int64 i = 0; i < indices_flat.size(); ++i) {
+    const int64 row = indices_flat(i);
+    if (row < 0 || row >= num_rows) continue;
+    // Releases the row written by the caller to the thread taking the rows.
+    bits[row / 64].fetch_or(uint64{1} << (row % 64),
+                            std::memory_order_release);
+  }
+}
+
+}  // namespace
+
+constexpr int64 DirtyRowTracker::kMaxIdleSaves;
+
+/* static */ DirtyRowTracker* DirtyRowTracker::Global() {
+  static DirtyRowTracker* tracker = new DirtyRowTracker;
+  return tracker;
+}
+
+std::shared_ptr<DirtyRowTracker::Rows> DirtyRowTracker::GetRows(
+    const Tensor& var) {
+  const int64 num_rows = var.dim_size(0);
+  mutex_lock l(mu_);
+  std::shared_ptr<Rows>& entry = rows_[var.tensor_data().data()];
+  if (entry == nullptr || entry->num_rows != num_rows) {
+    // A new variable, or a new one reusing the buffer of a freed one.
+    entry = std::make_shared<Rows>(num_rows);
+  }
+  entry->last_used = num_saves_;
+  return entry;
+}
+
+void DirtyRowTracker::RecordRows(const Tensor& var, const Tensor& indices) {
+  if (!var.IsInitialized() || var.dims() == 0) return;
+  std::shared_ptr<Rows> rows = GetRows(var);
+  switch (indices.dtype()) {
+    case DT_INT32:
+      MarkRows<int32>(indices, rows->num_rows, rows->bits.get());
+      break;
+    case DT_INT64:
+      MarkRows<int64>(indices, rows->num_rows, rows->bits.get());
+      break;
+    default:
+      LOG(DFATAL) << "Unsupported indices type "
+                  << DataTypeString(indices.dtype());
+  }
+}
+
+void DirtyRowTracker::RecordAllRows(const Tensor& var) {
+  if (!var.IsInitialized() || var.dims() == 0) return;
+  GetRows(var)->all.store(true, std::memory_order_release);
+}
+
+bool DirtyRowTracker::TakeDirtyRows(const string& key, const Tensor& var,
+                                    std::vector<int64>* rows,
+                                    TakenRows* taken) {
+  rows->clear();
+  if (!var.IsInitialized() || var.dims() == 0) return false;
+  mutex_lock l(mu_);
+  auto it = rows_.find(var.tensor_data().data());
+  if (it == rows_.end() || it->second->num_rows != var.dim_size(0)) {
+    return false;
+  }
+  Rows* tracked = it->second.get();
+  tracked->last_used = num_saves_;
+  taken->rows_ = it->second;
+  taken->address_ = it->first;
+  taken->key_ = key;
+  taken->bits_.resize(tracked->NumWords());
+  // Clears the bitmap before the caller reads the rows, so that the rows
+  // written concurrently are saved again next time.
+  taken->all_ = tracked->all.exchange(false, std::memory_order_acquire);
+  const bool known = !taken->all_ && tracked->saved && tracked->key == key;
+  for (int64 w = 0; w < tracked->NumWords(); ++w) {
+    uint64 bits = tracked->bits[w].exchange(0, std::memory_order_acquire);
+    taken->bits_[w] = bits;
+    if (!known) continue;
+    for (int64 row = w * 64; bits != 0; ++row, bits >>= 1) {
+      if (bits & 1) rows->push_back(row);
+    }
+  }
+  return known;
+}
+
+void DirtyRowTracker::Commit(std::vector<TakenRows>* taken) {
+  mutex_lock l(mu_);
+  ++num_saves_;
+  for (TakenRows& t : *taken) {
+    if (t.rows_ == nullptr) continue;
+    t.rows_->key = t.key_;
+    t.rows_->saved = true;
+    // A variable saved under the same key with another buffer was replaced,
+    // e.g. by an assignment, so its old buffer is not tracked anymore.
+    const void*& address = keys_[t.key_];
+    if (address != t.address_) {
+      auto old = rows_.find(address);
+      if (old != rows_.end() && old->second->key == t.key_) rows_.erase(old);
+      address = t.address_;
+    }
+    t.rows_.reset();
+  }
+  for (auto it = rows_.begin(); it != rows_.end();) {
+    const Rows& rows = *it->second;
+    if (num_saves_ - rows.last_used <= kMaxIdleSaves) {
+      ++it;
+      continue;
+    }
+    auto key = keys_.find(rows.key);
+    if (key != keys_.end() && key->second == it->first) keys_.erase(key);
+    it = rows_.erase(it);
+  }
+}
+
+DirtyRowTracker::TakenRows::~TakenRows() {
+  if (rows_ == nullptr) return;
+  // The save failed: the rows taken are still to be saved.
+  for (int64 w = 0; w < rows_->NumWords(); ++w) {
+    if (bits_[w] != 0) {
+      rows_->bits[w].fetch_or(bits_[w], std::memory_order_release);
+    }
+  }
+  if (all_) rows_->all.store(true, std::memory_order_release);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,167 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Tracks the rows (i.e. the slices along dimension 0) of the variables that
+// sparse updates modify, so that delta checkpoints (see delta_bundle.h) only
+// save the rows that changed since the previous checkpoint.
+//
+// Variables are identified by the address of their buffer, so only variables
+// updated in place benefit from tracking.  Every kernel writing a variable
+// must record it here: the sparse updates (e.g. the SparseApply* and Scatter*
+// kernels) record the rows they modify, and the dense ones (e.g. Assign and
+// the Apply* kernels) mark all the rows of the variable as modified.  A write
+// that is not recorded goes unnoticed by the delta checkpoints.
+#ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DIRTY_ROW_TRACKER_H_
+#define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DIRTY_ROW_TRACKER_H_
+
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Thread-safe.
+class DirtyRowTracker {
+ public:
+  DirtyRowTracker() {}
+
+  // Process-wide tracker used by the kernels.
+  static DirtyRowTracker* Global();
+
+  // Tracking is off until enabled, which the delta checkpointing kernels do
+  // when they are constructed, so that sparse updates don't pay for it
+  // otherwise.
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void Enable() { enabled_.store(true, std::memory_order_relaxed); }
+
+  // Records that the rows "indices" (an int32 or int64 tensor) of "var" were
+  // modified.  Must be called once the rows are written.  Ignores the indices
+  // that are out of range.
+  void RecordRows(const Tensor& var, const Tensor& indices);
+
+  // Records that all the rows of "var" were modified, e.g. by a dense update.
+  // Must be called once "var" is written.
+  void RecordAllRows(const Tensor& var);
+
+  // The rows of a variable taken for a save by TakeDirtyRows().
+  class TakenRows;
+
+  // Takes the rows of "var" modified since it was last saved under "key", in
+  // increasing order, and returns true.  Returns false if they are not known,
+  // i.e. if "var" was not updated since tracking was enabled, was updated
+  // densely, or was not saved under "key" before: all its rows must be saved
+  // then.
+  //
+  // Must be called before "var" is read for saving, and the save committed
+  // with Commit() once written.  The rows written concurrently with the save
+  // are saved next time.
+  bool TakeDirtyRows(const string& key, const Tensor& var,
+                     std::vector<int64>* rows, TakenRows* taken);
+
+  // Records that the rows in "taken" were saved, under the keys they were
+  // taken with.  Also forgets the variables that were neither updated nor
+  // saved during the last kMaxIdleSaves saves, e.g. the freed ones.
+  void Commit(std::vector<TakenRows>* taken);
+
+  static constexpr int64 kMaxIdleSaves = 100;
+
+ private:
+  struct Rows;
+
+  // Returns the rows of "var", tracking it if needed.
+  std::shared_ptr<Rows> GetRows(const Tensor& var) LOCKS_EXCLUDED(mu_);
+
+  std::atomic<bool> enabled_{false};
+  mutex mu_;
+  // Keyed by the address of the buffer of the variable.
+  std::unordered_map<const void*, std::shared_ptr<Rows>> rows_ GUARDED_BY(mu_);
+  // The address of the variable last saved under each key.
+  std::unordered_map<string, const void*> keys_ GUARDED_BY(mu_);
+  // The number of committed saves.
+  int64 num_saves_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(DirtyRowTracker);
+};
+
+// Unless the save is committed, the rows taken are recorded as modified again
+// when this object is destroyed, so that the rows of a failed save are saved
+// next time.
+class DirtyRowTracker::TakenRows {
+ public:
+  TakenRows() {}
+  ~TakenRows();
+
+ private:
+  friend class DirtyRowTracker;
+
+  std::shared_ptr<Rows> rows_;
+  const void* address_ = nullptr;
+  string key_;
+  std::vector<uint64> bits_;
+  bool all_ = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(TakenRows);
+};
+
+// Records the rows of "vars" addressed by "indices" (or all their rows if
+// there are no indices) in the global tracker, if enabled, when it goes out of
+// scope, i.e. after an update wrote them (even partially, if the update
+// failed).
+//
+// "vars" and "indices" must outlive this object.  The indices are read on
+// the host, so unless "indices_on_host" (e.g. for sparse updates on other
+// devices) all the rows of "vars" are recorded, as for a dense update.
+class ScopedDirtyRowRecorder {
+ public:
+  ScopedDirtyRowRecorder(std::initializer_list<const Tensor*> vars,
+                         const Tensor& indices, bool indices_on_host = true)
+      : vars_(vars), indices_(&indices), indices_on_host_(indices_on_host) {}
+
+  // Records all the rows of "vars", after a dense update.
+  explicit ScopedDirtyRowRecorder(std::initializer_list<const Tensor*> vars)
+      : vars_(vars), indices_(nullptr), indices_on_host_(true) {}
+
+  ~ScopedDirtyRowRecorder() {
+    DirtyRowTracker* tracker = DirtyRowTracker::Global();
+    if (!tracker->enabled()) return;
+    for (const Tensor* var : vars_) {
+      if (indices_ == nullptr || !indices_on_host_) {
+        tracker->RecordAllRows(*var);
+      } else {
+        tracker->RecordRows(*var, *indices_);
+      }
+    }
+  }
+
+ private:
+  const gtl::InlinedVector<const Tensor*, 4> vars_;
+  const Tensor* const indices_;
+  const bool indices_on_host_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ScopedDirtyRowRecorder);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DIRTY_ROW_TRACKER_H_
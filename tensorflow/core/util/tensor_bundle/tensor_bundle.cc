@@ -18,9 +18,12 @@ limitations under the License.
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <map>
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb_text.h"
@@ -32,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/framework/variant_tensor_data.h"
 #include "tensorflow/core/framework/versions.h"
 #include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
@@ -59,6 +63,8 @@ static const int kBufferSize = 1024 * 1024;
 // bundle.
 const char* const kHeaderEntryKey = "";
 
+const int kMappableDataAlignment = 4096;
+
 namespace {
 
 // Reads "num_elements" string elements from file[offset, offset+size) into the
@@ -519,6 +525,7 @@ Status BundleWriter::Finish() {
     VersionDef* version = header.mutable_version();
     version->set_producer(kTensorBundleVersion);
     version->set_min_consumer(kTensorBundleMinConsumer);
+    header.set_delta_parent(options_.delta_parent);
 
     builder.Add(kHeaderEntryKey, header.SerializeAsString());
 
@@ -554,6 +561,7 @@ struct MergeState {
   bool seen_first_bundle = false;
   BundleHeaderProto_Endianness endianness;
   VersionDef version;
+  string delta_parent;
 
   // Tensor key -> BundleEntryProto.
   std::map<string, BundleEntryProto> entries;
@@ -595,6 +603,7 @@ static Status MergeOneBundle(Env* env, StringPiece prefix,
       merge_state->seen_first_bundle = true;
       merge_state->endianness = header.endianness();
       merge_state->version = header.version();
+      merge_state->delta_parent = header.delta_parent();
     } else {
       // Validates "endianness".
       if (merge_state->endianness != header.endianness()) {
@@ -610,6 +619,13 @@ static Status MergeOneBundle(Env* env, StringPiece prefix,
             "Merging bundles with different format versions: merged ",
             merge_version, " vs. curr ", curr_version);
       }
+      // Validates "delta_parent".
+      if (merge_state->delta_parent != header.delta_parent()) {
+        return errors::InvalidArgument(
+            "Merging bundles with different delta parents: merged \"",
+            merge_state->delta_parent, "\" vs. curr \"",
+            header.delta_parent(), "\"");
+      }
     }
     num_shards = header.num_shards();
     iter->Next();
@@ -693,6 +709,7 @@ Status MergeBundles(Env* env, gtl::ArraySlice<string> prefixes,
     header.set_num_shards(merge.num_shards);
     header.set_endianness(merge.endianness);
     *header.mutable_version() = merge.version;
+    header.set_delta_parent(merge.delta_parent);
     builder.Add(kHeaderEntryKey, header.SerializeAsString());
     // All others.
     for (const auto& p : merge.entries) {
@@ -711,6 +728,35 @@ Status MergeBundles(Env* env, gtl::ArraySlice<string> prefixes,
   return status;
 }
 
+// A read-only view of a tensor stored in a memory-mapped data file.  Keeps the
+// mapping alive.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const void* data, size_t len)
+      : region_(std::move(region)), data_(data), len_(len) {}
+
+  void* data() const override { return const_cast<void*>(data_); }
+  size_t size() const override { return len_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(static_cast<int64>(len_));
+    proto->set_allocator_name("mapped_tensor_bundle");
+  }
+  Tensor MakeTensor(DataType dtype, const TensorShape& shape) {
+    CHECK_EQ(len_, shape.num_elements() * DataTypeSize(dtype));
+    return Tensor(dtype, shape, this);
+  }
+
+  // Prevents input forwarding from overwriting this (read-only) buffer.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const void* const data_;
+  const size_t len_;
+};
+
 // Interface for reading a tensor bundle.
 
 BundleReader::BundleReader(Env* env, StringPiece prefix)
@@ -747,6 +793,7 @@ BundleReader::BundleReader(Env* env, StringPiece prefix)
     return;
   }
   num_shards_ = header.num_shards();
+  delta_parent_ = header.delta_parent();
   if ((header.endianness() == BundleHeaderProto::BIG && port::kLittleEndian) ||
       (header.endianness() == BundleHeaderProto::LITTLE &&
        !port::kLittleEndian)) {
@@ -793,6 +840,22 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return Status::OK();
 }
 
+Status BundleReader::GetDataFile(int32 shard_id,
+                                 io::InputBuffer** buffered_file) {
+  // Open the data file if it has not been opened.
+  *buffered_file = data_[shard_id];
+  if (*buffered_file == nullptr) {
+    std::unique_ptr<RandomAccessFile> file = nullptr;
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+        DataFilename(prefix_, shard_id, num_shards_), &file));
+    *buffered_file = new io::InputBuffer(file.release(), kBufferSize);
+    // The InputBuffer and RandomAccessFile objects are both released in dtor.
+    data_[shard_id] = *buffered_file;
+  }
+  CHECK(*buffered_file != nullptr);
+  return Status::OK();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
@@ -822,17 +885,8 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     }
   }
 
-  // Open the data file if it has not been opened.
-  io::InputBuffer* buffered_file = data_[entry.shard_id()];
-  if (buffered_file == nullptr) {
-    std::unique_ptr<RandomAccessFile> file = nullptr;
-    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
-        DataFilename(prefix_, entry.shard_id(), num_shards_), &file));
-    buffered_file = new io::InputBuffer(file.release(), kBufferSize);
-    // The InputBuffer and RandomAccessFile objects are both released in dtor.
-    data_[entry.shard_id()] = buffered_file;
-  }
-  CHECK(buffered_file != nullptr);
+  io::InputBuffer* buffered_file;
+  TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
 
   TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
   uint32 actual_crc32c = 0;
@@ -876,10 +930,34 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   return Status::OK();
 }
 
+namespace {
+
+// Checks that "val", unless empty, is preallocated with the dtype and shape of
+// the tensor stored as "entry".
+Status CheckPreallocated(StringPiece key, const BundleEntryProto& entry,
+                        const Tensor& val) {
+  if (val.NumElements() == 0) return Status::OK();
+  if (val.dtype() != entry.dtype()) {
+    return errors::InvalidArgument(
+        "Tensor ", key, " is stored as ", DataTypeString(entry.dtype()),
+        " but was looked up as ", DataTypeString(val.dtype()));
+  }
+  const TensorShape stored_shape(entry.shape());
+  if (val.shape() != stored_shape) {
+    return errors::InvalidArgument(
+        "Tensor ", key, " has shape ", stored_shape.DebugString(),
+        " but was looked up with shape ", val.shape().DebugString());
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
 Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
   TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  TF_RETURN_IF_ERROR(CheckPreallocated(key, entry, *val));
 
   if (entry.slices().empty()) {
     return GetValue(entry, val);
@@ -890,6 +968,203 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupMapped(StringPiece key, Tensor* val) {
+  CHECK(val != nullptr);
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  const TensorShape stored_shape(entry.shape());
+  if (!entry.slices().empty() || !DataTypeCanUseMemcpy(entry.dtype()) ||
+      stored_shape.num_elements() == 0) {
+    return errors::FailedPrecondition("Tensor ", key,
+                                      " can't be memory-mapped");
+  }
+  const int64 expected_size =
+      stored_shape.num_elements() * DataTypeSize(entry.dtype());
+  if (entry.size() != expected_size) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key,
+                            "; stored size ", entry.size(),
+                            "; expected size ", expected_size);
+  }
+
+  std::shared_ptr<ReadOnlyMemoryRegion>& region =
+      mapped_data_[entry.shard_id()];
+  if (region == nullptr) {
+    std::unique_ptr<ReadOnlyMemoryRegion> mapped;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(
+        DataFilename(prefix_, entry.shard_id(), num_shards_), &mapped);
+    if (!s.ok()) {
+      mapped_data_.erase(entry.shard_id());
+      return s;
+    }
+    region.reset(mapped.release());
+  }
+  if (entry.offset() + entry.size() > region->length()) {
+    return errors::DataLoss("Contents of ", key, " at offset ", entry.offset(),
+                            " exceed the size of the data file, ",
+                            region->length());
+  }
+  const char* data =
+      static_cast<const char*>(region->data()) + entry.offset();
+  if (reinterpret_cast<uintptr_t>(data) % Allocator::kAllocatorAlignment != 0) {
+    return errors::FailedPrecondition(
+        "Tensor ", key, " is not aligned for memory mapping; write the bundle "
+        "with a data_alignment of ", kMappableDataAlignment);
+  }
+
+  const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the mapped bytes ", actual_crc32c);
+  }
+
+  MappedTensorBuffer* buf = new MappedTensorBuffer(region, data, entry.size());
+  *val = buf->MakeTensor(entry.dtype(), stored_shape);
+  buf->Unref();
+  return Status::OK();
+}
+
+namespace {
+
+// Neighboring tensor contents separated by at most this many bytes (e.g. the
+// padding of aligned bundles) are fetched with the same read.
+const int64 kMaxCoalescedReadGap = 64 << 10;  // 64K
+
+// A single read serving the contents of one or more tensors.
+struct CoalescedRead {
+  RandomAccessFile* file;
+  uint64 offset;
+  uint64 size;
+  // Indices of the tensors it serves, in offset order.
+  std::vector<size_t> members;
+};
+
+}  // namespace
+
+Status BundleReader::LookupMany(gtl::ArraySlice<string> keys,
+                                gtl::ArraySlice<Tensor*> vals,
+                                thread::ThreadPool* pool,
+                                int64 max_read_size) {
+  if (keys.size() != vals.size()) {
+    return errors::InvalidArgument("Got ", keys.size(), " keys but ",
+                                   vals.size(), " tensors");
+  }
+
+  // Reads the metadata, and directly restores the tensors that can't be
+  // restored by copying a contiguous range of bytes.
+  std::vector<BundleEntryProto> entries(keys.size());
+  std::map<int32, std::vector<size_t>> by_shard;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    CHECK(vals[i] != nullptr);
+    BundleEntryProto& entry = entries[i];
+    TF_RETURN_IF_ERROR(GetBundleEntryProto(keys[i], &entry));
+    TF_RETURN_IF_ERROR(CheckPreallocated(keys[i], entry, *vals[i]));
+    if (!entry.slices().empty()) {
+      TF_RETURN_IF_ERROR(GetSliceValue(
+          keys[i], entry,
+          /* a full slice */ TensorSlice(TensorShape(entry.shape()).dims()),
+          vals[i]));
+      continue;
+    }
+    if (!DataTypeCanUseMemcpy(entry.dtype()) || entry.size() == 0 ||
+        vals[i]->NumElements() == 0) {
+      TF_RETURN_IF_ERROR(GetValue(entry, vals[i]));
+      continue;
+    }
+    if (entry.size() != vals[i]->TotalBytes()) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", keys[i],
+                              "; stored size ", entry.size(),
+                              "; expected size ", vals[i]->TotalBytes());
+    }
+    by_shard[entry.shard_id()].push_back(i);
+  }
+
+  // Coalesces neighboring contents of each data file.
+  std::vector<CoalescedRead> reads;
+  for (auto& shard : by_shard) {
+    io::InputBuffer* buffered_file;
+    TF_RETURN_IF_ERROR(GetDataFile(shard.first, &buffered_file));
+    std::vector<size_t>& indices = shard.second;
+    std::sort(indices.begin(), indices.end(), [&entries](size_t a, size_t b) {
+      return entries[a].offset() < entries[b].offset();
+    });
+    for (const size_t i : indices) {
+      const BundleEntryProto& entry = entries[i];
+      if (!reads.empty() && reads.back().file == buffered_file->file()) {
+        CoalescedRead& read = reads.back();
+        const uint64 end = read.offset + read.size;
+        if (entry.offset() >= end &&
+            entry.offset() - end <= kMaxCoalescedReadGap &&
+            entry.offset() + entry.size() - read.offset <= max_read_size) {
+          read.size = entry.offset() + entry.size() - read.offset;
+          read.members.push_back(i);
+          continue;
+        }
+      }
+      reads.push_back(
+          {buffered_file->file(), static_cast<uint64>(entry.offset()),
+           static_cast<uint64>(entry.size()), {i}});
+    }
+  }
+
+  auto do_read = [&entries, &keys,
+                  &vals](const CoalescedRead& read) -> Status {
+    std::unique_ptr<char[]> scratch;
+    char* buffer;
+    if (read.members.size() == 1) {
+      // Reads straight into the preallocated tensor.
+      buffer = const_cast<char*>(vals[read.members[0]]->tensor_data().data());
+    } else {
+      scratch.reset(new char[read.size]);
+      buffer = scratch.get();
+    }
+    StringPiece sp;
+    TF_RETURN_IF_ERROR(read.file->Read(read.offset, read.size, &sp, buffer));
+    if (sp.size() != read.size) {
+      return errors::DataLoss("Requested ", read.size, " bytes but read ",
+                              sp.size(), " bytes at offset ", read.offset);
+    }
+    for (const size_t i : read.members) {
+      const BundleEntryProto& entry = entries[i];
+      char* backing_buffer = const_cast<char*>(vals[i]->tensor_data().data());
+      const char* data = sp.data() + (entry.offset() - read.offset);
+      if (data != backing_buffer) {
+        memmove(backing_buffer, data, entry.size());
+      }
+      const uint32 actual_crc32c = crc32c::Value(backing_buffer, entry.size());
+      if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+        return errors::DataLoss(
+            "Checksum does not match for key ", keys[i], ": stored ",
+            strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+            " vs. calculated on the restored bytes ", actual_crc32c);
+      }
+    }
+    return Status::OK();
+  };
+
+  if (pool == nullptr || reads.size() < 2) {
+    for (const CoalescedRead& read : reads) {
+      TF_RETURN_IF_ERROR(do_read(read));
+    }
+    return Status::OK();
+  }
+
+  std::vector<Status> statuses(reads.size());
+  BlockingCounter counter(reads.size());
+  for (size_t r = 0; r < reads.size(); ++r) {
+    pool->Schedule([&do_read, &reads, &statuses, &counter, r]() {
+      statuses[r] = do_read(reads[r]);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  for (const Status& status : statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
+  return Status::OK();
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -64,6 +64,7 @@ limitations under the License.
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -71,6 +72,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/io/table.h"
@@ -99,6 +101,11 @@ extern const int kTensorBundleVersion;
 // corresponding value is a BundleHeaderProto.
 extern const char* const kHeaderEntryKey;
 
+// Data alignment that lets BundleReader::LookupMapped() serve the tensors of a
+// bundle straight out of memory-mapped data files: the size of a page on
+// common platforms.
+extern const int kMappableDataAlignment;
+
 // Builds a string-string table of tensor names to BundleEntryProto (metadata).
 //
 // On construction, attempts to create a directory given by the dirname of
@@ -111,7 +118,11 @@ class BundleWriter {
     Options() {}
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
+    // kMappableDataAlignment lays tensors out for zero-copy loading.
     int data_alignment{1};
+    // If non-empty, writes a delta bundle relative to the bundle with this
+    // prefix.  See delta_bundle.h.
+    string delta_parent;
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
@@ -170,6 +181,9 @@ class BundleWriter {
 // query information about a tensor.  In particular, this function does not
 // guarantee not to re-order the input data files.
 //
+// The bundles must either all be full bundles, or all be deltas relative to
+// the same parent.
+//
 // Once merged, makes a best effort to delete the old metadata files.
 // Returns OK iff all bundles are successfully merged.
 Status MergeBundles(Env* env, gtl::ArraySlice<string> prefixes,
@@ -188,6 +202,11 @@ class BundleReader {
   // the metadata).
   Status status() const { return status_; }
 
+  // Prefix of the parent bundle iff this bundle is a delta (see
+  // delta_bundle.h), as written in the header.
+  // REQUIRES: status().ok()
+  const string& delta_parent() const { return delta_parent_; }
+
   // Queries whether the bundle contains an entry keyed by "key".  Calls Seek()
   // internally, so this call invalidates the reader's current position.
   // REQUIRES: status().ok()
@@ -209,7 +228,8 @@ class BundleReader {
   //
   // Caller must make sure "val" has the same shape and dtype as the
   // corresponding contents, so that its buffer can be filled without needing
-  // extra allocation.  These can be queried via "LookupDtypeAndShape()".
+  // extra allocation.  These can be queried via "LookupDtypeAndShape()".  An
+  // InvalidArgument error is returned if they differ.
   //
   // On error, "val" may contain nonsense data.  Returns a NotFound error if
   // tensor keyed by "key" does not exist in this bundle.
@@ -218,6 +238,40 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up several tensors, like calling Lookup() on each of "keys", with
+  // "vals" preallocated the same way.
+  //
+  // The stored contents of the non-partitioned tensors are grouped by data
+  // file and sorted by offset, and neighboring contents are fetched with one
+  // read of up to "max_read_size" bytes.  If "pool" is not null, the reads are
+  // issued from it in parallel, both across data files and within a file.
+  //
+  // Validates the stored crc32c checksums against the restored bytes.
+  // REQUIRES: status().ok()
+  Status LookupMany(gtl::ArraySlice<string> keys, gtl::ArraySlice<Tensor*> vals,
+                    thread::ThreadPool* pool,
+                    int64 max_read_size = 64 << 20) TF_MUST_USE_RESULT;
+
+  // Looks up the tensor keyed by "key" without copying its contents: on OK,
+  // "val" is a read-only view of the memory-mapped data file, which is shared
+  // through the page cache with every other process that maps the same bundle.
+  // The mapping stays alive as long as "val" (or any Tensor sharing its
+  // buffer) does, even after this reader is destroyed.
+  //
+  // Ops never modify such a buffer in place: input forwarding is disabled for
+  // it, and resource variables assigned from it make a copy before their first
+  // update.  Hence this is meant for inference, where restored weights are
+  // only read.
+  //
+  // Returns a FailedPrecondition error if the tensor can't be mapped, i.e. if
+  // it is partitioned, empty, not of a memcpy-able dtype, or if its stored
+  // contents are not aligned (see kMappableDataAlignment); callers are
+  // expected to fall back to Lookup() then.
+  //
+  // Validates the stored crc32c checksum against the mapped bytes.
+  // REQUIRES: status().ok()
+  Status LookupMapped(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -269,6 +323,10 @@ class BundleReader {
   Status GetBundleEntryProto(StringPiece key,
                              BundleEntryProto* entry) TF_MUST_USE_RESULT;
 
+  // Returns the data file "shard_id", opening it if needed.
+  Status GetDataFile(int32 shard_id,
+                     io::InputBuffer** buffered_file) TF_MUST_USE_RESULT;
+
   // Reads the tensor value described by the metadata proto "entry".
   // Usage for "val" follows the comment of "Lookup()".
   Status GetValue(const BundleEntryProto& entry,
@@ -291,6 +349,9 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // Data files mapped by LookupMapped(), shared with the tensors it returned.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
@@ -299,6 +360,8 @@ class BundleReader {
   // Expected number of data file shards in the bundle.  Extracted by reading
   // the header entry in the metadata table.
   int num_shards_;
+  // Also extracted from the header entry.
+  string delta_parent_;
 
   friend class TensorBundleAlignmentTest;  // For testing data alignment.
 
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -661,6 +662,122 @@ TEST(TensorBundleTest, Error) {
   }
 }
 
+TEST(TensorBundleTest, LookupMany) {
+  // Two shards, with full tensors, a string tensor and a partitioned tensor.
+  {
+    BundleWriter writer(Env::Default(), Prefix("many0"));
+    TF_EXPECT_OK(writer.Add("a", Constant_2x3(1.f)));
+    TF_EXPECT_OK(writer.Add("b", Constant(2, TensorShape({1000}))));
+    TF_EXPECT_OK(writer.Add("s", Constant_2x3(string("str"))));
+    TF_EXPECT_OK(writer.AddSlice("p", TensorShape({4}),
+                                 TensorSlice::ParseOrDie("0,2"),
+                                 Constant(5.0, TensorShape({2}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    BundleWriter writer(Env::Default(), Prefix("many1"));
+    TF_EXPECT_OK(writer.Add("c", Constant_2x3(3.0)));
+    TF_EXPECT_OK(writer.Add("d", Constant(int64{4}, TensorShape({7, 3}))));
+    TF_EXPECT_OK(writer.AddSlice("p", TensorShape({4}),
+                                 TensorSlice::ParseOrDie("2,2"),
+                                 Constant(5.0, TensorShape({2}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_ASSERT_OK(MergeBundles(Env::Default(), {Prefix("many0"), Prefix("many1")},
+                            Prefix("many")));
+
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  for (thread::ThreadPool* p : {static_cast<thread::ThreadPool*>(nullptr),
+                                &pool}) {
+    // A small maximum read size splits the reads of the first shard.
+    for (int64 max_read_size : {int64{1}, int64{64} << 20}) {
+      BundleReader reader(Env::Default(), Prefix("many"));
+      TF_ASSERT_OK(reader.status());
+      Tensor a(DT_FLOAT, {2, 3}), b(DT_INT32, {1000}), s(DT_STRING, {2, 3});
+      Tensor pt(DT_DOUBLE, {4}), c(DT_DOUBLE, {2, 3}), d(DT_INT64, {7, 3});
+      TF_ASSERT_OK(reader.LookupMany({"d", "a", "s", "p", "c", "b"},
+                                     {&d, &a, &s, &pt, &c, &b}, p,
+                                     max_read_size));
+      test::ExpectTensorEqual<float>(a, Constant_2x3(1.f));
+      test::ExpectTensorEqual<int32>(b, Constant(2, TensorShape({1000})));
+      test::ExpectTensorEqual<string>(s, Constant_2x3(string("str")));
+      test::ExpectTensorEqual<double>(pt, Constant(5.0, TensorShape({4})));
+      test::ExpectTensorEqual<double>(c, Constant_2x3(3.0));
+      test::ExpectTensorEqual<int64>(d,
+                                     Constant(int64{4}, TensorShape({7, 3})));
+    }
+  }
+
+  {  // Mismatched preallocated tensors, rejected like Lookup() does.
+    BundleReader reader(Env::Default(), Prefix("many"));
+    TF_ASSERT_OK(reader.status());
+    Tensor wrong_size(DT_FLOAT, {3});
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        reader.LookupMany({"a"}, {&wrong_size}, &pool)));
+    EXPECT_TRUE(errors::IsInvalidArgument(reader.Lookup("a", &wrong_size)));
+    // Same number of bytes as the stored tensors.
+    Tensor wrong_shape(DT_FLOAT, {3, 2});
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        reader.LookupMany({"a"}, {&wrong_shape}, &pool)));
+    EXPECT_TRUE(errors::IsInvalidArgument(reader.Lookup("a", &wrong_shape)));
+    Tensor wrong_dtype(DT_INT32, {2, 3});
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        reader.LookupMany({"a"}, {&wrong_dtype}, &pool)));
+    EXPECT_TRUE(errors::IsInvalidArgument(reader.Lookup("a", &wrong_dtype)));
+    Tensor wrong_partitioned(DT_FLOAT, {4});
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        reader.LookupMany({"p"}, {&wrong_partitioned}, &pool)));
+  }
+  {  // Not found.
+    BundleReader reader(Env::Default(), Prefix("many"));
+    TF_ASSERT_OK(reader.status());
+    Tensor a(DT_FLOAT, {2, 3});
+    EXPECT_TRUE(errors::IsNotFound(reader.LookupMany({"x"}, {&a}, &pool)));
+  }
+}
+
+TEST(TensorBundleTest, LookupMapped) {
+  for (int alignment : {1, kMappableDataAlignment}) {
+    const string prefix = Prefix(strings::StrCat("mapped_", alignment));
+    {
+      BundleWriter::Options opts;
+      opts.data_alignment = alignment;
+      BundleWriter writer(Env::Default(), prefix, opts);
+      TF_EXPECT_OK(writer.Add("a", Constant_2x3(true)));
+      TF_EXPECT_OK(writer.Add("b", Constant(2.f, TensorShape({1000}))));
+      TF_EXPECT_OK(writer.Add("s", Constant_2x3(string("str"))));
+      TF_EXPECT_OK(writer.AddSlice("p", TensorShape({4}),
+                                   TensorSlice::ParseOrDie("0,2"),
+                                   Constant(5.0, TensorShape({2}))));
+      TF_ASSERT_OK(writer.Finish());
+    }
+    Tensor a, b;
+    {
+      BundleReader reader(Env::Default(), prefix);
+      TF_ASSERT_OK(reader.status());
+      // The first tensor is at the start of the (page aligned) mapping.
+      TF_ASSERT_OK(reader.LookupMapped("a", &a));
+      const Status s = reader.LookupMapped("b", &b);
+      if (alignment == 1) {
+        EXPECT_TRUE(errors::IsFailedPrecondition(s)) << s;
+      } else {
+        TF_EXPECT_OK(s);
+      }
+      Tensor unused;
+      EXPECT_TRUE(errors::IsFailedPrecondition(
+          reader.LookupMapped("s", &unused)));
+      EXPECT_TRUE(errors::IsFailedPrecondition(
+          reader.LookupMapped("p", &unused)));
+      EXPECT_TRUE(errors::IsNotFound(reader.LookupMapped("x", &unused)));
+    }
+    // The mapped tensors outlive the reader.
+    test::ExpectTensorEqual<bool>(a, Constant_2x3(true));
+    if (alignment != 1) {
+      test::ExpectTensorEqual<float>(b, Constant(2.f, TensorShape({1000})));
+    }
+  }
+}
+
 TEST(TensorBundleTest, Checksum) {
   // Randomly flips a byte in [pos_lhs, end of data file), or exactly byte
   // pos_lhs if exact_pos == True.
@@ -917,4 +1034,68 @@ BM_BundleAlignment(4096, 512);
 BM_BundleAlignment(4096, 4096);
 BM_BundleAlignment(4096, 1048576);
 
+// Restores "num_tensors" float tensors with a total size of "total_mb" from
+// a bundle of 4 data files, either one at a time with Lookup() or all at once
+// with LookupMany().
+static void BM_BundleRestore(int iters, int total_mb, int num_tensors,
+                             bool lookup_many) {
+  testing::StopTiming();
+  const int kNumShards = 4;
+  const int64 tensor_size =
+      (int64{total_mb} << 20) / num_tensors / sizeof(float);
+  const string merged_prefix = Prefix(strings::StrCat("restore_", total_mb));
+  if (!Env::Default()->FileExists(MetaFilename(merged_prefix)).ok()) {
+    std::vector<string> prefixes;
+    for (int shard = 0; shard < kNumShards; ++shard) {
+      prefixes.push_back(strings::StrCat(merged_prefix, "_tmp_", shard));
+      BundleWriter writer(Env::Default(), prefixes.back());
+      for (int i = shard; i < num_tensors; i += kNumShards) {
+        TF_CHECK_OK(writer.Add(strings::StrCat("t", i),
+                               Constant(1.f * i, TensorShape({tensor_size}))));
+      }
+      TF_CHECK_OK(writer.Finish());
+    }
+    TF_CHECK_OK(MergeBundles(Env::Default(), prefixes, merged_prefix));
+  }
+
+  std::vector<string> keys;
+  std::vector<Tensor> tensors;
+  std::vector<Tensor*> tensor_ptrs;
+  for (int i = 0; i < num_tensors; ++i) {
+    keys.push_back(strings::StrCat("t", i));
+    tensors.emplace_back(DT_FLOAT, TensorShape({tensor_size}));
+  }
+  for (Tensor& t : tensors) tensor_ptrs.push_back(&t);
+  thread::ThreadPool pool(Env::Default(), "restore", 8);
+
+  testing::BytesProcessed(static_cast<int64>(iters) * total_mb << 20);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    BundleReader reader(Env::Default(), merged_prefix);
+    TF_CHECK_OK(reader.status());
+    if (lookup_many) {
+      TF_CHECK_OK(reader.LookupMany(keys, tensor_ptrs, &pool));
+    } else {
+      for (int j = 0; j < num_tensors; ++j) {
+        TF_CHECK_OK(reader.Lookup(keys[j], tensor_ptrs[j]));
+      }
+    }
+  }
+  testing::StopTiming();
+}
+
+#define BM_BundleRestoreDef(MB, NUM)                                    \
+  static void BM_BundleRestore_Lookup_##MB##_##NUM(int iters) {         \
+    BM_BundleRestore(iters, MB, NUM, false);                            \
+  }                                                                     \
+  BENCHMARK(BM_BundleRestore_Lookup_##MB##_##NUM);                      \
+  static void BM_BundleRestore_LookupMany_##MB##_##NUM(int iters) {     \
+    BM_BundleRestore(iters, MB, NUM, true);                             \
+  }                                                                     \
+  BENCHMARK(BM_BundleRestore_LookupMany_##MB##_##NUM)
+
+BM_BundleRestoreDef(64, 1024);
+BM_BundleRestoreDef(256, 64);
+BM_BundleRestoreDef(2048, 256);
+
 }  // namespace tensorflow